@@ -64,6 +64,9 @@ generate_src src xr_generated_dispatch_table.c  "$TARNAME"
 generate_src src xr_generated_dispatch_table.h  "$TARNAME"
 generate_src src/loader xr_generated_loader.cpp  "$TARNAME"
 generate_src src/loader xr_generated_loader.hpp  "$TARNAME"
+generate_src src/loader xr_generated_loader_commands.hpp  "$TARNAME"
+generate_src src/loader xr_generated_loader_extensions.hpp  "$TARNAME"
+generate_src src/loader xr_generated_loader_lookup.cpp  "$TARNAME"
 
 # If the loader doc has been generated, include it too.
 if [ -f specification/out/1.0/loader.html ]; then
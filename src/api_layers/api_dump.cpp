@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -459,8 +460,8 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
             XR_API_LAYER_CREATE_INFO_STRUCT_VERSION > apiLayerInfo->structVersion ||
             sizeof(XrApiLayerCreateInfo) > apiLayerInfo->structSize || nullptr == apiLayerInfo->nextInfo ||
             XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO != apiLayerInfo->nextInfo->structType ||
-            XR_API_LAYER_NEXT_INFO_STRUCT_VERSION > apiLayerInfo->nextInfo->structVersion ||
-            sizeof(XrApiLayerNextInfo) > apiLayerInfo->nextInfo->structSize ||
+            1 > apiLayerInfo->nextInfo->structVersion ||
+            offsetof(XrApiLayerNextInfo, nextGetInstanceProcAddrBatch) > apiLayerInfo->nextInfo->structSize ||
             0 != strcmp("XR_APILAYER_LUNARG_api_dump", apiLayerInfo->nextInfo->layerName) ||
             nullptr == apiLayerInfo->nextInfo->nextGetInstanceProcAddr ||
             nullptr == apiLayerInfo->nextInfo->nextCreateApiLayerInstance) {
@@ -530,6 +531,10 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
         // Get the function pointers we need
         next_get_instance_proc_addr = apiLayerInfo->nextInfo->nextGetInstanceProcAddr;
         next_create_api_layer_instance = apiLayerInfo->nextInfo->nextCreateApiLayerInstance;
+        PFN_xrGetInstanceProcAddrBatch next_get_instance_proc_addr_batch = nullptr;
+        if (apiLayerInfo->nextInfo->structVersion >= 2 && apiLayerInfo->nextInfo->structSize >= sizeof(XrApiLayerNextInfo)) {
+            next_get_instance_proc_addr_batch = apiLayerInfo->nextInfo->nextGetInstanceProcAddrBatch;
+        }
 
         // Create the instance
         XrInstance returned_instance = *instance;
@@ -538,7 +543,8 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
 
         // Create the dispatch table to the next levels
         auto *next_dispatch = new XrGeneratedDispatchTable();
-        GeneratedXrPopulateDispatchTable(next_dispatch, returned_instance, next_get_instance_proc_addr);
+        GeneratedXrPopulateDispatchTableBatch(next_dispatch, returned_instance, next_get_instance_proc_addr,
+                                              next_get_instance_proc_addr_batch);
 
         std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);
         g_instance_dispatch_map[returned_instance] = next_dispatch;
@@ -587,17 +593,18 @@ XrResult LAYER_EXPORT XRAPI_CALL xrNegotiateLoaderApiLayerInterface(const XrNego
                                                                     XrNegotiateApiLayerRequest *apiLayerRequest) {
     if (nullptr == loaderInfo || nullptr == apiLayerRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        apiLayerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
-        apiLayerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
-        apiLayerRequest->structSize != sizeof(XrNegotiateApiLayerRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        apiLayerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST || apiLayerRequest->structVersion < 1 ||
+        apiLayerRequest->structSize < offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->maxApiVersion < XR_CURRENT_API_VERSION || loaderInfo->minApiVersion > XR_CURRENT_API_VERSION) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
 
-    apiLayerRequest->layerInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    // A loader built against interface version 1 passes the shorter version 1 request, so never answer with
+    // a newer interface version than the loader offered.
+    apiLayerRequest->layerInterfaceVersion =
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ? loaderInfo->maxInterfaceVersion
+                                                                              : XR_CURRENT_LOADER_API_LAYER_VERSION;
     apiLayerRequest->layerApiVersion = XR_CURRENT_API_VERSION;
     apiLayerRequest->getInstanceProcAddr = reinterpret_cast<PFN_xrGetInstanceProcAddr>(ApiDumpLayerXrGetInstanceProcAddr);
     apiLayerRequest->createApiLayerInstance = reinterpret_cast<PFN_xrCreateApiLayerInstance>(ApiDumpLayerXrCreateApiLayerInstance);
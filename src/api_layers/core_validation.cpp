@@ -32,6 +32,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -458,12 +459,13 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrCreateInstance(const XrInstanceCr
     return XR_SUCCESS;
 }
 
-GenValidUsageXrInstanceInfo::GenValidUsageXrInstanceInfo(XrInstance inst, PFN_xrGetInstanceProcAddr next_get_instance_proc_addr)
+GenValidUsageXrInstanceInfo::GenValidUsageXrInstanceInfo(XrInstance inst, PFN_xrGetInstanceProcAddr next_get_instance_proc_addr,
+                                                         PFN_xrGetInstanceProcAddrBatch next_get_instance_proc_addr_batch)
     : instance(inst), dispatch_table(new XrGeneratedDispatchTable()) {
     /// @todo smart pointer here!
 
     // Create the dispatch table to the next levels
-    GeneratedXrPopulateDispatchTable(dispatch_table, instance, next_get_instance_proc_addr);
+    GeneratedXrPopulateDispatchTableBatch(dispatch_table, instance, next_get_instance_proc_addr, next_get_instance_proc_addr_batch);
 }
 
 GenValidUsageXrInstanceInfo::~GenValidUsageXrInstanceInfo() { delete dispatch_table; }
@@ -520,6 +522,10 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrCreateApiLayerInstance(const XrIn
         // Get the function pointers we need
         PFN_xrGetInstanceProcAddr next_get_instance_proc_addr = apiLayerInfo->nextInfo->nextGetInstanceProcAddr;
         PFN_xrCreateApiLayerInstance next_create_api_layer_instance = apiLayerInfo->nextInfo->nextCreateApiLayerInstance;
+        PFN_xrGetInstanceProcAddrBatch next_get_instance_proc_addr_batch = nullptr;
+        if (apiLayerInfo->nextInfo->structVersion >= 2 && apiLayerInfo->nextInfo->structSize >= sizeof(XrApiLayerNextInfo)) {
+            next_get_instance_proc_addr_batch = apiLayerInfo->nextInfo->nextGetInstanceProcAddrBatch;
+        }
 
         // Create the instance using the layer create instance command for the next layer
         XrInstance returned_instance = *instance;
@@ -528,7 +534,7 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrCreateApiLayerInstance(const XrIn
 
         // Create the instance information
         std::unique_ptr<GenValidUsageXrInstanceInfo> instance_info(
-            new GenValidUsageXrInstanceInfo(returned_instance, next_get_instance_proc_addr));
+            new GenValidUsageXrInstanceInfo(returned_instance, next_get_instance_proc_addr, next_get_instance_proc_addr_batch));
 
         // Save the enabled extensions.
         for (uint32_t extension = 0; extension < info->enabledExtensionCount; ++extension) {
@@ -833,17 +839,18 @@ LAYER_EXPORT XrResult xrNegotiateLoaderApiLayerInterface(const XrNegotiateLoader
                                                          XrNegotiateApiLayerRequest *apiLayerRequest) {
     if (nullptr == loaderInfo || nullptr == apiLayerRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        apiLayerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
-        apiLayerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
-        apiLayerRequest->structSize != sizeof(XrNegotiateApiLayerRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        apiLayerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST || apiLayerRequest->structVersion < 1 ||
+        apiLayerRequest->structSize < offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->maxApiVersion < XR_CORE_VALIDATION_API_VERSION || loaderInfo->minApiVersion > XR_CORE_VALIDATION_API_VERSION) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
 
-    apiLayerRequest->layerInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    // A loader built against interface version 1 passes the shorter version 1 request, so never answer with
+    // a newer interface version than the loader offered.
+    apiLayerRequest->layerInterfaceVersion =
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ? loaderInfo->maxInterfaceVersion
+                                                                              : XR_CURRENT_LOADER_API_LAYER_VERSION;
     apiLayerRequest->layerApiVersion = XR_CORE_VALIDATION_API_VERSION;
     apiLayerRequest->getInstanceProcAddr = reinterpret_cast<PFN_xrGetInstanceProcAddr>(GenValidUsageXrGetInstanceProcAddr);
     apiLayerRequest->createApiLayerInstance =
@@ -27,6 +27,7 @@
 #include "api_layer_platform_defines.h"
 #include "hex_and_handles.h"
 #include "extra_algorithms.h"
+#include "loader_interfaces.h"
 #include "object_info.h"
 
 #include <openxr/openxr.h>
@@ -76,7 +77,8 @@ typedef std::unique_ptr<CoreValidationMessengerInfo, CoreValidationMessengerInfo
 // This information includes things like the dispatch table as well as the
 // enabled extensions.
 struct GenValidUsageXrInstanceInfo {
-    GenValidUsageXrInstanceInfo(XrInstance inst, PFN_xrGetInstanceProcAddr next_get_instance_proc_addr);
+    GenValidUsageXrInstanceInfo(XrInstance inst, PFN_xrGetInstanceProcAddr next_get_instance_proc_addr,
+                                PFN_xrGetInstanceProcAddrBatch next_get_instance_proc_addr_batch);
     ~GenValidUsageXrInstanceInfo();
     XrInstance const instance;
     XrGeneratedDispatchTable *dispatch_table;
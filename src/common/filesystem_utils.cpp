@@ -14,6 +14,7 @@
 
 #include <cstring>
 #include <string>
+#include <utility>
 
 #if defined DISABLE_STD_FILESYSTEM
 #define USE_EXPERIMENTAL_FS 0
@@ -51,6 +52,18 @@
 #define DIRECTORY_SYMBOL '/'
 #endif
 
+#if !defined(XR_USE_PLATFORM_WIN32)
+// Needed by FileSysUtilsGetFileStatus and FileSysUtilsScanDirectory whichever implementation is used for the rest
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(XR_OS_LINUX)
+#include <sys/syscall.h>
+#endif
+
 #if (USE_FINAL_FS == 1) || (USE_EXPERIMENTAL_FS == 1)
 // We can use one of the C++ filesystem packages
 
@@ -320,3 +333,161 @@ bool FileSysUtilsFindFilesInPath(const std::string& path, std::vector<std::strin
 }
 
 #endif
+
+#if defined(XR_USE_PLATFORM_WIN32)
+
+bool FileSysUtilsGetFileStatus(const std::string& path, FileSysUtilsFileStatus& status) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(utf8_to_wide(path).c_str(), GetFileExInfoStandard, &data)) {
+        return false;
+    }
+    status = {};
+    status.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    status.modified_time =
+        static_cast<int64_t>((static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime);
+    return true;
+}
+
+static bool NameEndsWith(const std::string& name, const std::string& suffix) {
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// The find data holds the same size and write time that GetFileAttributesExW reports.
+bool FileSysUtilsScanDirectory(const std::string& path, const std::string& name_suffix,
+                               std::vector<FileSysUtilsDirectoryEntry>& entries) {
+    std::string search_path;
+    FileSysUtilsCombinePaths(path, "*", search_path);
+
+    WIN32_FIND_DATAW file_data;
+    HANDLE file_handle = FindFirstFileW(utf8_to_wide(search_path).c_str(), &file_data);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    do {
+        FileSysUtilsDirectoryEntry entry;
+        entry.name = wide_to_utf8(file_data.cFileName);
+        if (entry.name == "." || entry.name == ".." || !NameEndsWith(entry.name, name_suffix)) {
+            continue;
+        }
+        entry.type = (file_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? FileSysUtilsFileType::Directory
+                                                                                : FileSysUtilsFileType::RegularFile;
+        // The find data of a symbolic link describes the link rather than its target.
+        entry.is_symbolic_link = (file_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+        if (!entry.is_symbolic_link) {
+            entry.status.size = (static_cast<uint64_t>(file_data.nFileSizeHigh) << 32) | file_data.nFileSizeLow;
+            entry.status.modified_time = static_cast<int64_t>(
+                (static_cast<uint64_t>(file_data.ftLastWriteTime.dwHighDateTime) << 32) | file_data.ftLastWriteTime.dwLowDateTime);
+            entry.has_status = true;
+        }
+        entries.push_back(std::move(entry));
+    } while (FindNextFileW(file_handle, &file_data));
+    FindClose(file_handle);
+    return true;
+}
+
+#else
+
+static void FileStatusFromStat(const struct stat& path_stat, FileSysUtilsFileStatus& status) {
+    status.device = static_cast<uint64_t>(path_stat.st_dev);
+    status.inode = static_cast<uint64_t>(path_stat.st_ino);
+    status.size = static_cast<uint64_t>(path_stat.st_size);
+#if defined(XR_OS_APPLE)
+    status.modified_time = static_cast<int64_t>(path_stat.st_mtimespec.tv_sec) * 1000000000 + path_stat.st_mtimespec.tv_nsec;
+#else
+    status.modified_time = static_cast<int64_t>(path_stat.st_mtim.tv_sec) * 1000000000 + path_stat.st_mtim.tv_nsec;
+#endif
+}
+
+bool FileSysUtilsGetFileStatus(const std::string& path, FileSysUtilsFileStatus& status) {
+    struct stat path_stat;
+    if (stat(path.c_str(), &path_stat) != 0) {
+        return false;
+    }
+    FileStatusFromStat(path_stat, status);
+    return true;
+}
+
+// Record one entry of the directory open as dir_fd, given its name and the d_type the directory listing reported for it.
+static void AddDirectoryEntry(int dir_fd, const char* name, unsigned char listed_type, const std::string& name_suffix,
+                              std::vector<FileSysUtilsDirectoryEntry>& entries) {
+    const size_t name_length = strlen(name);
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || name_length < name_suffix.size() ||
+        name_suffix.compare(0, name_suffix.size(), name + name_length - name_suffix.size()) != 0) {
+        return;
+    }
+    FileSysUtilsDirectoryEntry entry;
+    entry.name.assign(name, name_length);
+    struct stat entry_stat;
+    if (listed_type == DT_UNKNOWN) {
+        // Some file systems do not report the type in the directory listing.
+        entry.is_symbolic_link = fstatat(dir_fd, name, &entry_stat, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(entry_stat.st_mode);
+    } else {
+        entry.is_symbolic_link = listed_type == DT_LNK;
+    }
+    if (fstatat(dir_fd, name, &entry_stat, 0) == 0) {
+        if (S_ISREG(entry_stat.st_mode)) {
+            entry.type = FileSysUtilsFileType::RegularFile;
+        } else if (S_ISDIR(entry_stat.st_mode)) {
+            entry.type = FileSysUtilsFileType::Directory;
+        }
+        FileStatusFromStat(entry_stat, entry.status);
+        entry.has_status = true;
+    }
+    entries.push_back(std::move(entry));
+}
+
+#if defined(XR_OS_LINUX)
+
+// Lists the directory with getdents64 directly, which returns as many entries as fit in the buffer per call, and reads the
+// status of each entry relative to the open directory so its path is not looked up again from the start.
+bool FileSysUtilsScanDirectory(const std::string& path, const std::string& name_suffix,
+                               std::vector<FileSysUtilsDirectoryEntry>& entries) {
+    const int dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        return false;
+    }
+    // Each record is a struct linux_dirent64, which the C library does not declare: a 64-bit inode and offset, a 16-bit
+    // record length and an 8-bit type, followed by the null-terminated name.
+    const size_t kRecordLengthOffset = 16;
+    const size_t kTypeOffset = 18;
+    const size_t kNameOffset = 19;
+    alignas(8) char buffer[16384];
+    bool success = true;
+    for (;;) {
+        const long bytes = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            success = bytes == 0;
+            break;
+        }
+        for (long offset = 0; offset < bytes;) {
+            const char* record = buffer + offset;
+            uint16_t record_length = 0;
+            memcpy(&record_length, record + kRecordLengthOffset, sizeof(record_length));
+            AddDirectoryEntry(dir_fd, record + kNameOffset, static_cast<unsigned char>(record[kTypeOffset]), name_suffix, entries);
+            offset += record_length;
+        }
+    }
+    close(dir_fd);
+    return success;
+}
+
+#else
+
+bool FileSysUtilsScanDirectory(const std::string& path, const std::string& name_suffix,
+                               std::vector<FileSysUtilsDirectoryEntry>& entries) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    const int dir_fd = dirfd(dir);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        AddDirectoryEntry(dir_fd, entry->d_name, entry->d_type, name_suffix, entries);
+    }
+    closedir(dir);
+    return true;
+}
+
+#endif  // defined(XR_OS_LINUX)
+
+#endif
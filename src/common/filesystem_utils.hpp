@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -44,3 +45,39 @@ bool FileSysUtilsParsePathList(std::string& path_list, std::vector<std::string>&
 
 // Record all the filenames for files found in the provided path.
 bool FileSysUtilsFindFilesInPath(const std::string& path, std::vector<std::string>& files);
+
+// Identity, size and modification time of a file, which together tell whether it changed since it was last read.
+// The device and inode are zero on platforms that do not report them.
+struct FileSysUtilsFileStatus {
+    uint64_t device{0};
+    uint64_t inode{0};
+    uint64_t size{0};
+    int64_t modified_time{0};
+};
+
+inline bool operator==(const FileSysUtilsFileStatus& lhs, const FileSysUtilsFileStatus& rhs) {
+    return lhs.device == rhs.device && lhs.inode == rhs.inode && lhs.size == rhs.size && lhs.modified_time == rhs.modified_time;
+}
+
+inline bool operator!=(const FileSysUtilsFileStatus& lhs, const FileSysUtilsFileStatus& rhs) { return !(lhs == rhs); }
+
+// Get the status of a file, following symbolic links
+bool FileSysUtilsGetFileStatus(const std::string& path, FileSysUtilsFileStatus& status);
+
+// What a directory entry is, after following symbolic links.  Entries whose target cannot be read, such as dangling
+// symbolic links, are Other.
+enum class FileSysUtilsFileType { Other, RegularFile, Directory };
+
+struct FileSysUtilsDirectoryEntry {
+    std::string name;
+    FileSysUtilsFileType type{FileSysUtilsFileType::Other};
+    bool is_symbolic_link{false};
+    // Only set when has_status is true
+    FileSysUtilsFileStatus status;
+    bool has_status{false};
+};
+
+// Record the name, type and status of the entries in a directory whose names end with name_suffix, reading the status of
+// each from the directory as it is listed rather than looking up each path again.  The "." and ".." entries are skipped.
+bool FileSysUtilsScanDirectory(const std::string& path, const std::string& name_suffix,
+                               std::vector<FileSysUtilsDirectoryEntry>& entries);
@@ -23,13 +23,21 @@ typedef struct XrApiLayerCreateInfo XrApiLayerCreateInfo;
 typedef XrResult(XRAPI_PTR *PFN_xrCreateApiLayerInstance)(const XrInstanceCreateInfo *info,
                                                           const XrApiLayerCreateInfo *apiLayerInfo, XrInstance *instance);
 
+// Function pointer prototype for resolving several commands at once.  For each of the nameCount names, the function
+// pointer for that command (or NULL if it is not available) is written to the matching element of functions.  This
+// returns an error only if the whole query fails, such as for an invalid instance.
+typedef XrResult(XRAPI_PTR *PFN_xrGetInstanceProcAddrBatch)(XrInstance instance, uint32_t nameCount, const char *const *names,
+                                                            PFN_xrVoidFunction *functions);
+
 // Loader/API Layer Interface versions
 //  1 - First version, introduces negotiation structure and functions
-#define XR_CURRENT_LOADER_API_LAYER_VERSION 1
+//  2 - Adds getInstanceProcAddrBatch to the negotiation and next info structures
+#define XR_CURRENT_LOADER_API_LAYER_VERSION 2
 
 // Loader/Runtime Interface versions
 //  1 - First version, introduces negotiation structure and functions
-#define XR_CURRENT_LOADER_RUNTIME_VERSION 1
+//  2 - Adds getInstanceProcAddrBatch to the negotiation structure
+#define XR_CURRENT_LOADER_RUNTIME_VERSION 2
 
 // Version negotiation values
 typedef enum XrLoaderInterfaceStructs {
@@ -52,7 +60,9 @@ typedef struct XrNegotiateLoaderInfo {
     XrVersion maxApiVersion;
 } XrNegotiateLoaderInfo;
 
-#define XR_API_LAYER_INFO_STRUCT_VERSION 1
+// Structure version 2 appends getInstanceProcAddrBatch.  A loader that negotiates interface version 1 passes a
+// version 1 structure, whose structSize ends before that member.
+#define XR_API_LAYER_INFO_STRUCT_VERSION 2
 typedef struct XrNegotiateApiLayerRequest {
     XrLoaderInterfaceStructs structType;  // XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST
     uint32_t structVersion;               // XR_API_LAYER_INFO_STRUCT_VERSION
@@ -61,9 +71,12 @@ typedef struct XrNegotiateApiLayerRequest {
     XrVersion layerApiVersion;
     PFN_xrGetInstanceProcAddr getInstanceProcAddr;
     PFN_xrCreateApiLayerInstance createApiLayerInstance;
+    PFN_xrGetInstanceProcAddrBatch getInstanceProcAddrBatch;  // Optional, structure version 2 and later
 } XrNegotiateApiLayerRequest;
 
-#define XR_RUNTIME_INFO_STRUCT_VERSION 1
+// Structure version 2 appends getInstanceProcAddrBatch.  A loader that negotiates interface version 1 passes a
+// version 1 structure, whose structSize ends before that member.
+#define XR_RUNTIME_INFO_STRUCT_VERSION 2
 typedef struct XrNegotiateRuntimeRequest {
     XrLoaderInterfaceStructs structType;  // XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST
     uint32_t structVersion;               // XR_RUNTIME_INFO_STRUCT_VERSION
@@ -71,6 +84,7 @@ typedef struct XrNegotiateRuntimeRequest {
     uint32_t runtimeInterfaceVersion;     // CURRENT_LOADER_RUNTIME_VERSION
     XrVersion runtimeApiVersion;
     PFN_xrGetInstanceProcAddr getInstanceProcAddr;
+    PFN_xrGetInstanceProcAddrBatch getInstanceProcAddrBatch;  // Optional, structure version 2 and later
 } XrNegotiateRuntimeRequest;
 
 // Function used to negotiate an interface betewen the loader and an API layer.  Each library exposing one or
@@ -87,15 +101,16 @@ typedef XrResult(XRAPI_PTR *PFN_xrNegotiateLoaderRuntimeInterface)(const XrNegot
 // Forward declare.
 typedef struct XrApiLayerNextInfo XrApiLayerNextInfo;
 
-#define XR_API_LAYER_NEXT_INFO_STRUCT_VERSION 1
+#define XR_API_LAYER_NEXT_INFO_STRUCT_VERSION 2
 struct XrApiLayerNextInfo {
-    XrLoaderInterfaceStructs structType;                      // XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO
-    uint32_t structVersion;                                   // XR_API_LAYER_NEXT_INFO_STRUCT_VERSION
-    size_t structSize;                                        // sizeof(XrApiLayerNextInfo)
-    char layerName[XR_MAX_API_LAYER_NAME_SIZE];               // Name of API layer which should receive this info
-    PFN_xrGetInstanceProcAddr nextGetInstanceProcAddr;        // Pointer to next API layer's xrGetInstanceProcAddr
-    PFN_xrCreateApiLayerInstance nextCreateApiLayerInstance;  // Pointer to next API layer's xrCreateApiLayerInstance
-    XrApiLayerNextInfo *next;                                 // Pointer to the next API layer info in the sequence
+    XrLoaderInterfaceStructs structType;                          // XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO
+    uint32_t structVersion;                                       // XR_API_LAYER_NEXT_INFO_STRUCT_VERSION
+    size_t structSize;                                            // sizeof(XrApiLayerNextInfo)
+    char layerName[XR_MAX_API_LAYER_NAME_SIZE];                   // Name of API layer which should receive this info
+    PFN_xrGetInstanceProcAddr nextGetInstanceProcAddr;            // Pointer to next API layer's xrGetInstanceProcAddr
+    PFN_xrCreateApiLayerInstance nextCreateApiLayerInstance;      // Pointer to next API layer's xrCreateApiLayerInstance
+    XrApiLayerNextInfo *next;                                     // Pointer to the next API layer info in the sequence
+    PFN_xrGetInstanceProcAddrBatch nextGetInstanceProcAddrBatch;  // Next API layer's batched query, or NULL (version 2)
 };
 
 #define XR_API_LAYER_MAX_SETTINGS_PATH_SIZE 512
@@ -9,18 +9,24 @@
 
 #include "api_layer_interface.hpp"
 
+#include "filesystem_utils.hpp"
 #include "loader_interfaces.h"
+#include "loader_environment.hpp"
 #include "loader_logger.hpp"
+#include "loader_parallel.hpp"
 #include "loader_platform.hpp"
+#include "loader_timing.hpp"
 #include "manifest_file.hpp"
 #include "platform_utils.hpp"
 
 #include <openxr/openxr.h>
 
+#include <cstddef>
 #include <cstring>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -28,7 +34,7 @@
 
 // Add any layers defined in the loader layer environment variable.
 static void AddEnvironmentApiLayers(std::vector<std::string>& enabled_layers) {
-    std::string layers = PlatformUtilsGetEnv(OPENXR_ENABLE_LAYERS_ENV_VAR);
+    std::string layers = LoaderEnvironment::Get(OPENXR_ENABLE_LAYERS_ENV_VAR);
 
     std::size_t last_found = 0;
     std::size_t found = layers.find_first_of(PATH_SEPARATOR);
@@ -149,38 +155,170 @@ XrResult ApiLayerInterface::GetInstanceExtensionProperties(const std::string& op
         }
         // Otherwise, we want to add only implicit API layers and explicit API layers enabled using the environment variables
     } else {
-        XrResult result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_IMPLICIT_API_LAYER, manifest_files);
-        if (XR_SUCCEEDED(result)) {
-            // Find any environmentally enabled explicit layers.  If they're present, treat them like implicit layers
-            // since we know that they're going to be enabled.
-            std::vector<std::string> env_enabled_layers;
-            AddEnvironmentApiLayers(env_enabled_layers);
-            if (!env_enabled_layers.empty()) {
-                std::vector<std::unique_ptr<ApiLayerManifestFile>> exp_layer_man_files = {};
-                result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_EXPLICIT_API_LAYER, exp_layer_man_files);
-                if (XR_SUCCEEDED(result)) {
-                    for (auto& exp_layer_man_file : exp_layer_man_files) {
-                        for (std::string& enabled_layer : env_enabled_layers) {
-                            // If this is an enabled layer, transfer it over to the manifest list.
-                            if (enabled_layer == exp_layer_man_file->LayerName()) {
-                                manifest_files.push_back(std::move(exp_layer_man_file));
-                                break;
-                            }
+        XrResult result = FindInstanceExtensionManifestFiles(manifest_files);
+        if (XR_FAILED(result)) {
+            return result;
+        }
+
+        // Grab the layer instance extensions information
+        for (const std::unique_ptr<ApiLayerManifestFile>& manifest_file : manifest_files) {
+            manifest_file->GetInstanceExtensionProperties(extension_properties);
+        }
+    }
+    return XR_SUCCESS;
+}
+
+XrResult ApiLayerInterface::FindInstanceExtensionManifestFiles(std::vector<std::unique_ptr<ApiLayerManifestFile>>& manifest_files) {
+    XrResult result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_IMPLICIT_API_LAYER, manifest_files);
+    if (XR_SUCCEEDED(result)) {
+        // Find any environmentally enabled explicit layers.  If they're present, treat them like implicit layers
+        // since we know that they're going to be enabled.
+        std::vector<std::string> env_enabled_layers;
+        AddEnvironmentApiLayers(env_enabled_layers);
+        if (!env_enabled_layers.empty()) {
+            std::vector<std::unique_ptr<ApiLayerManifestFile>> exp_layer_man_files = {};
+            result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_EXPLICIT_API_LAYER, exp_layer_man_files);
+            if (XR_SUCCEEDED(result)) {
+                for (auto& exp_layer_man_file : exp_layer_man_files) {
+                    for (std::string& enabled_layer : env_enabled_layers) {
+                        // If this is an enabled layer, transfer it over to the manifest list.
+                        if (enabled_layer == exp_layer_man_file->LayerName()) {
+                            manifest_files.push_back(std::move(exp_layer_man_file));
+                            break;
                         }
                     }
                 }
             }
         }
-
-        // Grab the layer instance extensions information
-        auto num_files = static_cast<uint32_t>(manifest_files.size());
-        for (uint32_t man_file = 0; man_file < num_files; ++man_file) {
-            manifest_files[man_file]->GetInstanceExtensionProperties(extension_properties);
-        }
     }
     return XR_SUCCESS;
 }
 
+namespace {
+// What came of opening one API layer library and negotiating with it.
+struct ApiLayerLoad {
+    std::unique_ptr<ApiLayerInterface> api_layer;
+    XrResult result{XR_SUCCESS};
+    // Whether result only becomes the error returned by LoadApiLayers when no layer before this one was loaded.
+    bool error_if_none_loaded{false};
+    // The messages logged while loading the layer, logged again in layer order once every layer is done.
+    LoaderLogCapture log;
+};
+
+// API layer libraries are opened and negotiated with on up to this many threads.  The work is mostly file access and
+// library initialization, which is worth overlapping even on a single core.
+const size_t kMaxApiLayerLoadThreads = 8;
+
+// Open the library of the API layer described by manifest_file and negotiate an interface with it.
+void LoadApiLayer(const std::string& openxr_command, ApiLayerManifestFile& manifest_file, ApiLayerLoad& load) {
+    LoaderTimingSpan open_span("API layer library open", manifest_file.LayerName());
+    LoaderPlatformLibraryHandle layer_library = LoaderPlatformLibraryOpen(manifest_file.LibraryPath());
+    open_span.End();
+    if (nullptr == layer_library) {
+        load.result = XR_ERROR_FILE_ACCESS_ERROR;
+        load.error_if_none_loaded = true;
+        std::string library_message = LoaderPlatformLibraryOpenError(manifest_file.LibraryPath());
+        std::string warning_message = "ApiLayerInterface::LoadApiLayers skipping layer ";
+        warning_message += manifest_file.LayerName();
+        warning_message += ", failed to load with message \"";
+        warning_message += library_message;
+        warning_message += "\"";
+        LoaderLogger::LogWarningMessage(openxr_command, warning_message);
+        return;
+    }
+
+    // Get and settle on an layer interface version (using any provided name if required).
+    std::string function_name = manifest_file.GetFunctionName("xrNegotiateLoaderApiLayerInterface");
+    auto negotiate = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
+        LoaderPlatformLibraryGetProcAddr(layer_library, function_name));
+
+    if (nullptr == negotiate) {
+        std::ostringstream oss;
+        oss << "ApiLayerInterface::LoadApiLayers skipping layer " << manifest_file.LayerName()
+            << " because negotiation function " << function_name << " was not found";
+        LoaderLogger::LogErrorMessage(openxr_command, oss.str());
+        LoaderPlatformLibraryClose(layer_library);
+        load.result = XR_ERROR_API_LAYER_NOT_PRESENT;
+        return;
+    }
+
+    // Loader info for negotiation
+    XrNegotiateLoaderInfo loader_info = {};
+    loader_info.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
+    loader_info.structVersion = XR_LOADER_INFO_STRUCT_VERSION;
+    loader_info.structSize = sizeof(XrNegotiateLoaderInfo);
+    loader_info.minInterfaceVersion = 1;
+    loader_info.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    loader_info.minApiVersion = XR_MAKE_VERSION(1, 0, 0);
+    loader_info.maxApiVersion = XR_MAKE_VERSION(1, 0x3ff, 0xfff);  // Maximum allowed version for this major version.
+
+    // Set up the layer return structure
+    XrNegotiateApiLayerRequest api_layer_info = {};
+    api_layer_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
+    api_layer_info.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
+    api_layer_info.structSize = sizeof(XrNegotiateApiLayerRequest);
+
+    LoaderTimingSpan negotiate_span("API layer negotiation", manifest_file.LayerName());
+    XrResult res = negotiate(&loader_info, manifest_file.LayerName().c_str(), &api_layer_info);
+    if (XR_FAILED(res)) {
+        // Layers built against interface version 1 may reject the newer structure, so offer
+        // exactly what an older loader would before giving up on this layer.
+        loader_info.maxInterfaceVersion = 1;
+        api_layer_info = {};
+        api_layer_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
+        api_layer_info.structVersion = 1;
+        api_layer_info.structSize = offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch);
+        res = negotiate(&loader_info, manifest_file.LayerName().c_str(), &api_layer_info);
+    }
+    negotiate_span.End();
+    // If we supposedly succeeded, but got a nullptr for getInstanceProcAddr
+    // then something still went wrong, so return with an error.
+    if (XR_SUCCEEDED(res) && nullptr == api_layer_info.getInstanceProcAddr) {
+        std::string warning_message = "ApiLayerInterface::LoadApiLayers skipping layer ";
+        warning_message += manifest_file.LayerName();
+        warning_message += ", negotiation did not return a valid getInstanceProcAddr";
+        LoaderLogger::LogWarningMessage(openxr_command, warning_message);
+        res = XR_ERROR_FILE_CONTENTS_INVALID;
+    }
+    if (XR_FAILED(res)) {
+        load.result = res;
+        load.error_if_none_loaded = true;
+        std::ostringstream oss;
+        oss << "ApiLayerInterface::LoadApiLayers skipping layer " << manifest_file.LayerName()
+            << " due to failed negotiation with error " << res;
+        LoaderLogger::LogWarningMessage(openxr_command, oss.str());
+        LoaderPlatformLibraryClose(layer_library);
+        return;
+    }
+
+    if (LoaderLogger::IsMessageEnabled(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT)) {
+        std::ostringstream oss;
+        oss << "ApiLayerInterface::LoadApiLayers succeeded loading layer " << manifest_file.LayerName()
+            << " using interface version " << api_layer_info.layerInterfaceVersion << " and OpenXR API version "
+            << XR_VERSION_MAJOR(api_layer_info.layerApiVersion) << "." << XR_VERSION_MINOR(api_layer_info.layerApiVersion);
+        LoaderLogger::LogInfoMessage(openxr_command, oss.str());
+    }
+
+    // Grab the list of extensions this layer supports for easy filtering after the
+    // xrCreateInstance call
+    LoaderExtensionSet supported_extensions;
+    std::vector<XrExtensionProperties> extension_properties;
+    manifest_file.GetInstanceExtensionProperties(extension_properties);
+    for (XrExtensionProperties& ext_prop : extension_properties) {
+        supported_extensions.Add(ext_prop.extensionName);
+    }
+
+    PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch = nullptr;
+    if (api_layer_info.layerInterfaceVersion >= 2 && api_layer_info.structVersion >= 2) {
+        get_instance_proc_addr_batch = api_layer_info.getInstanceProcAddrBatch;
+    }
+
+    load.api_layer.reset(new ApiLayerInterface(manifest_file.LayerName(), layer_library, std::move(supported_extensions),
+                                               api_layer_info.getInstanceProcAddr, api_layer_info.createApiLayerInstance,
+                                               get_instance_proc_addr_batch));
+}
+}  // namespace
+
 XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uint32_t enabled_api_layer_count,
                                           const char* const* enabled_api_layer_names,
                                           std::vector<std::unique_ptr<ApiLayerInterface>>& api_layer_interfaces) {
@@ -260,101 +398,48 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
         }
     }
 
-    for (std::unique_ptr<ApiLayerManifestFile>& manifest_file : enabled_layer_manifest_files_in_init_order) {
-        LoaderPlatformLibraryHandle layer_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
-        if (nullptr == layer_library) {
-            if (!any_loaded) {
-                last_error = XR_ERROR_FILE_ACCESS_ERROR;
-            }
-            std::string library_message = LoaderPlatformLibraryOpenError(manifest_file->LibraryPath());
-            std::string warning_message = "ApiLayerInterface::LoadApiLayers skipping layer ";
-            warning_message += manifest_file->LayerName();
-            warning_message += ", failed to load with message \"";
-            warning_message += library_message;
-            warning_message += "\"";
-            LoaderLogger::LogWarningMessage(openxr_command, warning_message);
-            continue;
+    // Open and negotiate with the layers at the same time, since each layer is independent of the others until the chain is
+    // built.  Layers whose manifests name the same library share its globals once it is open, so they are loaded one after
+    // the other, in the order they are enabled, on the same thread.  The results, and the messages logged along the way, are
+    // then used in the order the layers are enabled, exactly as if the layers had been loaded one after the other.
+    std::vector<ApiLayerLoad> loads(enabled_layer_manifest_files_in_init_order.size());
+    std::vector<std::vector<size_t>> library_groups;
+    std::unordered_map<std::string, size_t> library_group_indices;
+    for (size_t index = 0; index < loads.size(); ++index) {
+        const std::string& library_path = enabled_layer_manifest_files_in_init_order[index]->LibraryPath();
+        std::string canonical_library_path;
+        if (!FileSysUtilsGetCanonicalPath(library_path, canonical_library_path)) {
+            canonical_library_path = library_path;
         }
-
-        // Get and settle on an layer interface version (using any provided name if required).
-        std::string function_name = manifest_file->GetFunctionName("xrNegotiateLoaderApiLayerInterface");
-        auto negotiate = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
-            LoaderPlatformLibraryGetProcAddr(layer_library, function_name));
-
-        if (nullptr == negotiate) {
-            std::ostringstream oss;
-            oss << "ApiLayerInterface::LoadApiLayers skipping layer " << manifest_file->LayerName()
-                << " because negotiation function " << function_name << " was not found";
-            LoaderLogger::LogErrorMessage(openxr_command, oss.str());
-            LoaderPlatformLibraryClose(layer_library);
-            last_error = XR_ERROR_API_LAYER_NOT_PRESENT;
-            continue;
+        auto inserted = library_group_indices.emplace(canonical_library_path, library_groups.size());
+        if (inserted.second) {
+            library_groups.emplace_back();
         }
-
-        // Loader info for negotiation
-        XrNegotiateLoaderInfo loader_info = {};
-        loader_info.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
-        loader_info.structVersion = XR_LOADER_INFO_STRUCT_VERSION;
-        loader_info.structSize = sizeof(XrNegotiateLoaderInfo);
-        loader_info.minInterfaceVersion = 1;
-        loader_info.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
-        loader_info.minApiVersion = XR_MAKE_VERSION(1, 0, 0);
-        loader_info.maxApiVersion = XR_MAKE_VERSION(1, 0x3ff, 0xfff);  // Maximum allowed version for this major version.
-
-        // Set up the layer return structure
-        XrNegotiateApiLayerRequest api_layer_info = {};
-        api_layer_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
-        api_layer_info.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
-        api_layer_info.structSize = sizeof(XrNegotiateApiLayerRequest);
-
-        XrResult res = negotiate(&loader_info, manifest_file->LayerName().c_str(), &api_layer_info);
-        // If we supposedly succeeded, but got a nullptr for getInstanceProcAddr
-        // then something still went wrong, so return with an error.
-        if (XR_SUCCEEDED(res) && nullptr == api_layer_info.getInstanceProcAddr) {
-            std::string warning_message = "ApiLayerInterface::LoadApiLayers skipping layer ";
-            warning_message += manifest_file->LayerName();
-            warning_message += ", negotiation did not return a valid getInstanceProcAddr";
-            LoaderLogger::LogWarningMessage(openxr_command, warning_message);
-            res = XR_ERROR_FILE_CONTENTS_INVALID;
-        }
-        if (XR_FAILED(res)) {
-            if (!any_loaded) {
-                last_error = res;
-            }
-            std::ostringstream oss;
-            oss << "ApiLayerInterface::LoadApiLayers skipping layer " << manifest_file->LayerName()
-                << " due to failed negotiation with error " << res;
-            LoaderLogger::LogWarningMessage(openxr_command, oss.str());
-            LoaderPlatformLibraryClose(layer_library);
-            continue;
-        }
-
-        {
-            std::ostringstream oss;
-            oss << "ApiLayerInterface::LoadApiLayers succeeded loading layer " << manifest_file->LayerName()
-                << " using interface version " << api_layer_info.layerInterfaceVersion << " and OpenXR API version "
-                << XR_VERSION_MAJOR(api_layer_info.layerApiVersion) << "." << XR_VERSION_MINOR(api_layer_info.layerApiVersion);
-            LoaderLogger::LogInfoMessage(openxr_command, oss.str());
+        library_groups[inserted.first->second].push_back(index);
+    }
+    LoaderTimingReport* timing_report = LoaderTimingReport::Current();
+    LoaderParallelFor(library_groups.size(), kMaxApiLayerLoadThreads, [&](size_t group) {
+        LoaderTimingThreadScope timing_scope(timing_report);
+        for (size_t index : library_groups[group]) {
+            ApiLayerLoad& load = loads[index];
+            load.log.Start();
+            LoadApiLayer(openxr_command, *enabled_layer_manifest_files_in_init_order[index], load);
+            load.log.Stop();
         }
-
-        // Grab the list of extensions this layer supports for easy filtering after the
-        // xrCreateInstance call
-        std::vector<std::string> supported_extensions;
-        std::vector<XrExtensionProperties> extension_properties;
-        manifest_file->GetInstanceExtensionProperties(extension_properties);
-        supported_extensions.reserve(extension_properties.size());
-        for (XrExtensionProperties& ext_prop : extension_properties) {
-            supported_extensions.emplace_back(ext_prop.extensionName);
+    });
+
+    for (ApiLayerLoad& load : loads) {
+        load.log.Replay(openxr_command);
+        if (load.api_layer) {
+            // Add this API layer to the vector
+            api_layer_interfaces.push_back(std::move(load.api_layer));
+
+            // If we load one, clear all errors.
+            any_loaded = true;
+            last_error = XR_SUCCESS;
+        } else if (!load.error_if_none_loaded || !any_loaded) {
+            last_error = load.result;
         }
-
-        // Add this API layer to the vector
-        api_layer_interfaces.emplace_back(new ApiLayerInterface(manifest_file->LayerName(), layer_library, supported_extensions,
-                                                                api_layer_info.getInstanceProcAddr,
-                                                                api_layer_info.createApiLayerInstance));
-
-        // If we load one, clear all errors.
-        any_loaded = true;
-        last_error = XR_SUCCESS;
     }
 
     // Set error here to preserve prior error behavior
@@ -371,29 +456,25 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
 }
 
 ApiLayerInterface::ApiLayerInterface(const std::string& layer_name, LoaderPlatformLibraryHandle layer_library,
-                                     std::vector<std::string>& supported_extensions,
-                                     PFN_xrGetInstanceProcAddr get_instance_proc_addr,
-                                     PFN_xrCreateApiLayerInstance create_api_layer_instance)
+                                     LoaderExtensionSet supported_extensions, PFN_xrGetInstanceProcAddr get_instance_proc_addr,
+                                     PFN_xrCreateApiLayerInstance create_api_layer_instance,
+                                     PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch)
     : _layer_name(layer_name),
       _layer_library(layer_library),
       _get_instance_proc_addr(get_instance_proc_addr),
       _create_api_layer_instance(create_api_layer_instance),
-      _supported_extensions(supported_extensions) {}
+      _get_instance_proc_addr_batch(get_instance_proc_addr_batch),
+      _supported_extensions(std::move(supported_extensions)) {}
 
 ApiLayerInterface::~ApiLayerInterface() {
-    std::string info_message = "ApiLayerInterface being destroyed for layer ";
-    info_message += _layer_name;
-    LoaderLogger::LogInfoMessage("", info_message);
+    if (LoaderLogger::IsMessageEnabled(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT)) {
+        std::string info_message = "ApiLayerInterface being destroyed for layer ";
+        info_message += _layer_name;
+        LoaderLogger::LogInfoMessage("", info_message);
+    }
     LoaderPlatformLibraryClose(_layer_library);
 }
 
-bool ApiLayerInterface::SupportsExtension(const std::string& extension_name) const {
-    bool found_prop = false;
-    for (const std::string& supported_extension : _supported_extensions) {
-        if (supported_extension == extension_name) {
-            found_prop = true;
-            break;
-        }
-    }
-    return found_prop;
+bool ApiLayerInterface::SupportsExtension(LoaderExtensionId id, const char* extension_name) const {
+    return _supported_extensions.Contains(id, extension_name);
 }
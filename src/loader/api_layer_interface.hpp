@@ -15,9 +15,11 @@
 
 #include <openxr/openxr.h>
 
+#include "loader_extension_set.hpp"
 #include "loader_platform.hpp"
 #include "loader_interfaces.h"
 
+class ApiLayerManifestFile;
 struct XrGeneratedDispatchTable;
 
 class ApiLayerInterface {
@@ -31,24 +33,31 @@ class ApiLayerInterface {
                                           XrApiLayerProperties* api_layer_properties);
     static XrResult GetInstanceExtensionProperties(const std::string& openxr_command, const char* layer_name,
                                                    std::vector<XrExtensionProperties>& extension_properties);
+    // Find the API layers whose instance extensions are reported when no API layer is named: the implicit API layers and the
+    // explicit ones enabled through XR_ENABLE_API_LAYERS.
+    static XrResult FindInstanceExtensionManifestFiles(std::vector<std::unique_ptr<ApiLayerManifestFile>>& manifest_files);
 
     ApiLayerInterface(const std::string& layer_name, LoaderPlatformLibraryHandle layer_library,
-                      std::vector<std::string>& supported_extensions, PFN_xrGetInstanceProcAddr get_instance_proc_addr,
-                      PFN_xrCreateApiLayerInstance create_api_layer_instance);
+                      LoaderExtensionSet supported_extensions, PFN_xrGetInstanceProcAddr get_instance_proc_addr,
+                      PFN_xrCreateApiLayerInstance create_api_layer_instance,
+                      PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch);
     virtual ~ApiLayerInterface();
 
     PFN_xrGetInstanceProcAddr GetInstanceProcAddrFuncPointer() { return _get_instance_proc_addr; }
     PFN_xrCreateApiLayerInstance GetCreateApiLayerInstanceFuncPointer() { return _create_api_layer_instance; }
+    PFN_xrGetInstanceProcAddrBatch GetInstanceProcAddrBatchFuncPointer() { return _get_instance_proc_addr_batch; }
 
     std::string LayerName() { return _layer_name; }
 
     // Generated methods
-    bool SupportsExtension(const std::string& extension_name) const;
+    // id must be LoaderLookupExtensionId(extension_name).
+    bool SupportsExtension(LoaderExtensionId id, const char* extension_name) const;
 
    private:
     std::string _layer_name;
     LoaderPlatformLibraryHandle _layer_library;
     PFN_xrGetInstanceProcAddr _get_instance_proc_addr;
     PFN_xrCreateApiLayerInstance _create_api_layer_instance;
-    std::vector<std::string> _supported_extensions;
+    PFN_xrGetInstanceProcAddrBatch _get_instance_proc_addr_batch;  // nullptr if the layer does not support it
+    LoaderExtensionSet _supported_extensions;
 };
@@ -0,0 +1,171 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "loader_command_statistics.hpp"
+
+#include "loader_environment.hpp"
+#include "platform_utils.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define OPENXR_COMMAND_STATISTICS_ENV_VAR "XR_LOADER_COMMAND_STATISTICS"
+
+namespace {
+
+// Counters for one thread.  Only the owning thread writes them, so increments are a relaxed load and
+// store rather than a locked read-modify-write; a report reads them from another thread with relaxed loads.
+struct ThreadCommandStatistics {
+    ThreadCommandStatistics()
+        : calls(new std::atomic<uint64_t>[kLoaderCommandStatisticsCount]()),
+          total_ns(new std::atomic<uint64_t>[kLoaderCommandStatisticsCount]()),
+          latency_buckets(
+              new std::atomic<uint64_t>[kLoaderCommandStatisticsCount * LoaderCommandStatistics::kLatencyBucketCount]()) {}
+
+    std::unique_ptr<std::atomic<uint64_t>[]> calls;
+    std::unique_ptr<std::atomic<uint64_t>[]> total_ns;
+    std::unique_ptr<std::atomic<uint64_t>[]> latency_buckets;
+};
+
+inline void AddToCounter(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline uint32_t LatencyBucket(uint64_t duration_ns) {
+    uint32_t bucket = 0;
+    while (duration_ns > 1 && bucket < LoaderCommandStatistics::kLatencyBucketCount - 1) {
+        duration_ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+// The counters of every thread that has called an instrumented trampoline.  The counters of a thread are
+// kept after it exits so that its calls are still reported, and the registry itself is never destroyed
+// so that threads still running during process exit have somewhere to write.
+class CommandStatisticsRegistry {
+   public:
+    static CommandStatisticsRegistry& Get() {
+        static CommandStatisticsRegistry* registry = new CommandStatisticsRegistry();
+        return *registry;
+    }
+
+    ThreadCommandStatistics* AddThread() {
+        std::unique_ptr<ThreadCommandStatistics> statistics(new ThreadCommandStatistics());
+        std::lock_guard<std::mutex> lock(_mutex);
+        _threads.push_back(std::move(statistics));
+        return _threads.back().get();
+    }
+
+    std::string FormatJson(const char* reason) {
+        const uint32_t bucket_count = LoaderCommandStatistics::kLatencyBucketCount;
+        std::vector<uint64_t> calls(kLoaderCommandStatisticsCount);
+        std::vector<uint64_t> total_ns(kLoaderCommandStatisticsCount);
+        std::vector<uint64_t> latency_buckets(kLoaderCommandStatisticsCount * bucket_count);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const auto& thread : _threads) {
+                for (uint32_t command = 0; command < kLoaderCommandStatisticsCount; ++command) {
+                    calls[command] += thread->calls[command].load(std::memory_order_relaxed);
+                    total_ns[command] += thread->total_ns[command].load(std::memory_order_relaxed);
+                }
+                for (uint32_t bucket = 0; bucket < kLoaderCommandStatisticsCount * bucket_count; ++bucket) {
+                    latency_buckets[bucket] += thread->latency_buckets[bucket].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Only commands that were called are listed.  Each histogram is a list of [log2 ns bucket, calls]
+        // pairs for the non-empty buckets.
+        std::ostringstream oss;
+        oss << "{\"reason\":\"" << reason << "\",\"commands\":[";
+        bool first_command = true;
+        for (uint32_t command = 0; command < kLoaderCommandStatisticsCount; ++command) {
+            if (calls[command] == 0) {
+                continue;
+            }
+            oss << (first_command ? "" : ",") << "{\"name\":\"" << kLoaderCommandStatisticsNames[command]
+                << "\",\"calls\":" << calls[command] << ",\"total_ns\":" << total_ns[command] << ",\"latency_log2_ns\":[";
+            bool first_bucket = true;
+            for (uint32_t bucket = 0; bucket < bucket_count; ++bucket) {
+                uint64_t count = latency_buckets[command * bucket_count + bucket];
+                if (count != 0) {
+                    oss << (first_bucket ? "" : ",") << "[" << bucket << "," << count << "]";
+                    first_bucket = false;
+                }
+            }
+            oss << "]}";
+            first_command = false;
+        }
+        oss << "]}";
+        return oss.str();
+    }
+
+   private:
+    CommandStatisticsRegistry() = default;
+
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<ThreadCommandStatistics>> _threads;
+};
+
+// Where the exit report goes, read when the hook is registered so that nothing reads the environment during
+// process exit.  Never destroyed, like the registry.
+std::string* g_exit_report_destination = nullptr;
+
+void WriteReport(const std::string& destination, const char* reason) {
+    std::string json = CommandStatisticsRegistry::Get().FormatJson(reason);
+    if (destination == "stderr") {
+        std::cerr << json << std::endl;
+    } else {
+        std::ofstream file(destination, std::ios::app);
+        file << json << std::endl;
+    }
+}
+
+void ReportAtExit() { WriteReport(*g_exit_report_destination, "exit"); }
+
+}  // namespace
+
+void LoaderCommandStatistics::Record(uint32_t command_index, uint64_t duration_ns) {
+    static thread_local ThreadCommandStatistics* statistics = nullptr;
+    if (statistics == nullptr) {
+        statistics = CommandStatisticsRegistry::Get().AddThread();
+    }
+    AddToCounter(statistics->calls[command_index], 1);
+    AddToCounter(statistics->total_ns[command_index], duration_ns);
+    AddToCounter(statistics->latency_buckets[command_index * kLatencyBucketCount + LatencyBucket(duration_ns)], 1);
+}
+
+void LoaderCommandStatistics::Report(const char* reason) {
+    std::string destination = LoaderEnvironment::GetSecure(OPENXR_COMMAND_STATISTICS_ENV_VAR);
+    if (destination.empty()) {
+        return;
+    }
+    WriteReport(destination, reason);
+}
+
+void LoaderCommandStatistics::RegisterExitReport() {
+    static std::mutex register_mutex;
+    std::lock_guard<std::mutex> lock(register_mutex);
+    if (g_exit_report_destination != nullptr) {
+        return;
+    }
+    std::string destination = LoaderEnvironment::GetSecure(OPENXR_COMMAND_STATISTICS_ENV_VAR);
+    if (destination.empty()) {
+        return;
+    }
+    g_exit_report_destination = new std::string(std::move(destination));
+    // Handlers registered with atexit run before the destructors of statics that were constructed earlier, and when a
+    // shared loader is unloaded, so the standard streams and the environment snapshot are still alive.
+    std::atexit(ReportAtExit);
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Per-command call counts and latency histograms for the generated loader trampolines.  This is only
+// built into the loader when BUILD_LOADER_WITH_COMMAND_STATISTICS is enabled, in which case
+// XR_LOADER_COMMAND_STATISTICS is defined and the trampolines are generated with a
+// LoaderCommandStatisticsScope.
+
+// Names of the instrumented commands, indexed by the statistics index used by each trampoline.
+// Generated in xr_generated_loader.cpp.
+extern const char* const kLoaderCommandStatisticsNames[];
+extern const uint32_t kLoaderCommandStatisticsCount;
+
+class LoaderCommandStatistics {
+   public:
+    // Latencies are counted in log2 nanosecond buckets: bucket b holds calls that took [2^b, 2^(b+1)) ns,
+    // and the last bucket also holds anything slower.
+    static const uint32_t kLatencyBucketCount = 32;
+
+    // Record one call to the command on the calling thread.
+    static void Record(uint32_t command_index, uint64_t duration_ns);
+
+    // Write everything recorded so far, summed over all threads, as one JSON line if the
+    // XR_LOADER_COMMAND_STATISTICS environment variable is set.  A value of "stderr" writes to
+    // the standard error stream, anything else is the path of a file to append to.
+    static void Report(const char* reason);
+
+    // Arrange for one more report, with the reason "exit", when the process exits or the loader is unloaded.
+    // Called when an instance is created.  The report goes where XR_LOADER_COMMAND_STATISTICS pointed when it was first
+    // set at one of these calls, and nothing is registered while it is unset.
+    static void RegisterExitReport();
+};
+
+// Times the enclosing trampoline and records it when the scope ends.
+class LoaderCommandStatisticsScope {
+   public:
+    explicit LoaderCommandStatisticsScope(uint32_t command_index)
+        : _command_index(command_index), _start(std::chrono::steady_clock::now()) {}
+    ~LoaderCommandStatisticsScope() {
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+        LoaderCommandStatistics::Record(_command_index, static_cast<uint64_t>(duration.count()));
+    }
+
+    LoaderCommandStatisticsScope(const LoaderCommandStatisticsScope&) = delete;
+    LoaderCommandStatisticsScope& operator=(const LoaderCommandStatisticsScope&) = delete;
+
+   private:
+    uint32_t _command_index;
+    std::chrono::steady_clock::time_point _start;
+};
@@ -14,32 +14,264 @@
 #include "api_layer_interface.hpp"
 #include "exception_handling.hpp"
 #include "hex_and_handles.h"
+#include "loader_environment.hpp"
+#include "loader_epoch.hpp"
 #include "loader_instance.hpp"
 #include "loader_logger_recorders.hpp"
 #include "loader_logger.hpp"
 #include "loader_platform.hpp"
+#include "loader_timing.hpp"
+#include "manifest_file.hpp"
+#include "platform_utils.hpp"
 #include "runtime_interface.hpp"
 #include "xr_generated_dispatch_table.h"
 #include "xr_generated_loader.hpp"
 
+#ifdef XR_LOADER_COMMAND_STATISTICS
+#include "loader_command_statistics.hpp"
+#endif  // XR_LOADER_COMMAND_STATISTICS
+
 #include <openxr/openxr.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 // Global loader lock to:
-//   1. Ensure ActiveLoaderInstance get and set operations are done atomically.
+//   1. Ensure ActiveLoaderInstance add and remove operations are done atomically with loading and unloading the runtime.
 //   2. Ensure RuntimeInterface isn't used to unload the runtime while the runtime is in use.
-std::mutex &GetGlobalLoaderMutex() {
-    static std::mutex loader_mutex;
+// Using the loaded runtime, and adding or removing instances that keep it loaded, only takes shared access.  Loading or
+// unloading the runtime takes exclusive access.  API layer manifest files are found and read without the lock.
+std::shared_timed_mutex &GetGlobalLoaderMutex() {
+    static std::shared_timed_mutex loader_mutex;
     return loader_mutex;
 }
 
+// Take shared access to the loader lock in loader_lock once the runtime is loaded, loading it first with exclusive access
+// if it is not.  loader_lock is left unlocked if the runtime cannot be loaded.
+static XrResult LockLoadedRuntime(const std::string &openxr_command, std::shared_lock<std::shared_timed_mutex> &loader_lock) {
+    for (;;) {
+        loader_lock = std::shared_lock<std::shared_timed_mutex>(GetGlobalLoaderMutex());
+        if (RuntimeInterface::IsLoaded()) {
+            return XR_SUCCESS;
+        }
+        loader_lock.unlock();
+
+        // Another thread may unload the runtime again between the two locks, in which case this tries again.
+        std::unique_lock<std::shared_timed_mutex> exclusive_lock(GetGlobalLoaderMutex());
+        XrResult result = RuntimeInterface::LoadRuntime(openxr_command);
+        if (XR_FAILED(result)) {
+            return result;
+        }
+    }
+}
+
+// Unloads the runtime a while after the last instance using it was destroyed, for XR_LOADER_RUNTIME_RESIDENCY.
+class RuntimeUnloadTimer {
+   public:
+    // Never destroyed, and its thread is detached, so that exit neither waits for the thread nor destroys the state it uses.
+    static RuntimeUnloadTimer &Get() {
+        static RuntimeUnloadTimer *timer = new RuntimeUnloadTimer();
+        // Destroyed at exit before the loader state the thread unloads, all of which exists by the time anything is scheduled.
+        static ExitNotifier exit_notifier{timer};
+        return *timer;
+    }
+
+    // Unload the runtime at deadline, unless an instance is using it by then.  Replaces any earlier deadline.  Returns false
+    // if the timer thread could not be started.
+    bool Schedule(std::chrono::steady_clock::time_point deadline) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_started) {
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+            try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+                std::thread([this]() { Run(); }).detach();
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+            } catch (const std::system_error &) {
+                return false;
+            }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+            _started = true;
+        }
+        _deadline = deadline;
+        _scheduled = true;
+        _wake.notify_one();
+        return true;
+    }
+
+   private:
+    struct ExitNotifier {
+        ~ExitNotifier() { timer->_exiting = true; }
+        RuntimeUnloadTimer *timer;
+    };
+
+    RuntimeUnloadTimer() = default;
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            if (!_scheduled) {
+                _wake.wait(lock);
+                continue;
+            }
+            _wake.wait_until(lock, _deadline);
+            if (!_scheduled || std::chrono::steady_clock::now() < _deadline) {
+                continue;
+            }
+            _scheduled = false;
+
+            // xrDestroyInstance holds the loader mutex while it schedules, so it is only taken without the timer's.
+            lock.unlock();
+            {
+                std::unique_lock<std::shared_timed_mutex> loader_lock(GetGlobalLoaderMutex());
+                if (!_exiting && !ActiveLoaderInstance::IsAvailable()) {
+                    RuntimeInterface::UnloadRuntime("");
+                }
+            }
+            LoaderEpoch::Reclaim();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::chrono::steady_clock::time_point _deadline;
+    bool _scheduled{false};
+    bool _started{false};
+    std::atomic<bool> _exiting{false};
+};
+
+// The instance extensions reported when no API layer is named: those of the enabled API layers, then those of the runtime,
+// then those the loader implements itself, each listed once.  The merged list is kept for as long as the runtime load (or
+// complete runtime manifest) and the API layer manifests it was made from stay the same, so repeated enumerations, such as
+// the two calls of the two-call idiom, copy it out instead of merging it again.
+class InstanceExtensionPropertiesCache {
+   public:
+    static InstanceExtensionPropertiesCache &Get() {
+        static InstanceExtensionPropertiesCache *cache = new InstanceExtensionPropertiesCache();
+        return *cache;
+    }
+
+    XrResult GetExtensionProperties(const std::string &openxr_command,
+                                    std::shared_ptr<const std::vector<XrExtensionProperties>> &extension_properties) {
+        std::vector<std::unique_ptr<ApiLayerManifestFile>> layer_manifest_files;
+        XrResult result = ApiLayerInterface::FindInstanceExtensionManifestFiles(layer_manifest_files);
+        if (XR_FAILED(result)) {
+            return result;
+        }
+        std::vector<XrExtensionProperties> runtime_extension_properties;
+        uint64_t runtime_load_id = 0;
+        uint64_t runtime_manifest_parse_id = 0;
+        bool must_load = false;
+        {
+            // Make sure the runtime isn't unloaded while its extensions are read.
+            std::shared_lock<std::shared_timed_mutex> loader_lock(GetGlobalLoaderMutex());
+            result = RuntimeInterface::GetRuntimeInstanceExtensionPropertiesWithoutLoading(
+                openxr_command, runtime_extension_properties, runtime_load_id, runtime_manifest_parse_id, must_load);
+        }
+        if (XR_SUCCEEDED(result) && must_load) {
+            std::unique_lock<std::shared_timed_mutex> loader_lock(GetGlobalLoaderMutex());
+            result = RuntimeInterface::GetRuntimeInstanceExtensionProperties(openxr_command, runtime_extension_properties,
+                                                                             runtime_load_id, runtime_manifest_parse_id);
+        }
+        if (XR_FAILED(result)) {
+            LoaderLogger::LogErrorMessage(openxr_command, "Failed to find default runtime with RuntimeInterface::LoadRuntime()");
+            return result;
+        }
+
+        std::vector<uint64_t> sources = {runtime_load_id, runtime_manifest_parse_id};
+        for (const std::unique_ptr<ApiLayerManifestFile> &manifest_file : layer_manifest_files) {
+            sources.push_back(manifest_file->ParseId());
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_merged == nullptr || sources != _sources) {
+            _merged = Merge(layer_manifest_files, runtime_extension_properties);
+            _sources = std::move(sources);
+        }
+        extension_properties = _merged;
+        return XR_SUCCESS;
+    }
+
+   private:
+    static std::shared_ptr<const std::vector<XrExtensionProperties>> Merge(
+        const std::vector<std::unique_ptr<ApiLayerManifestFile>> &layer_manifest_files,
+        const std::vector<XrExtensionProperties> &runtime_extension_properties) {
+        std::shared_ptr<std::vector<XrExtensionProperties>> merged = std::make_shared<std::vector<XrExtensionProperties>>();
+        for (const std::unique_ptr<ApiLayerManifestFile> &manifest_file : layer_manifest_files) {
+            manifest_file->GetInstanceExtensionProperties(*merged);
+        }
+        // Where the first entry for each extension is in merged.
+        std::unordered_map<std::string, size_t> index_by_name;
+        index_by_name.reserve(merged->size() + runtime_extension_properties.size());
+        for (size_t index = 0; index < merged->size(); ++index) {
+            index_by_name.emplace((*merged)[index].extensionName, index);
+        }
+
+        // The runtime's version of an extension is reported rather than that of an API layer.
+        for (const XrExtensionProperties &runtime_prop : runtime_extension_properties) {
+            auto found = index_by_name.emplace(runtime_prop.extensionName, merged->size());
+            if (found.second) {
+                merged->push_back(runtime_prop);
+            } else {
+                (*merged)[found.first->second].extensionVersion = runtime_prop.extensionVersion;
+            }
+        }
+
+        // These are extensions that the loader directly supports, reported with the loader version if it is newer.
+        for (const XrExtensionProperties &loader_prop : LoaderInstance::LoaderSpecificExtensions()) {
+            auto found = index_by_name.emplace(loader_prop.extensionName, merged->size());
+            if (found.second) {
+                merged->push_back(loader_prop);
+            } else if ((*merged)[found.first->second].extensionVersion < loader_prop.extensionVersion) {
+                (*merged)[found.first->second].extensionVersion = loader_prop.extensionVersion;
+            }
+        }
+        return merged;
+    }
+
+    std::mutex _mutex;
+    // The runtime load ID and runtime manifest parse ID, then the parse ID of each API layer manifest, _merged was made from.
+    std::vector<uint64_t> _sources;
+    std::shared_ptr<const std::vector<XrExtensionProperties>> _merged;
+};
+
+// Called with exclusive access to the loader mutex once no instance uses the runtime.  By default the runtime is unloaded
+// straight away.  XR_LOADER_RUNTIME_RESIDENCY can keep it loaded for the rest of the process ("process"), or for a number of
+// milliseconds, so that creating another instance does not have to load it again.
+static void ReleaseRuntime(const std::string &openxr_command) {
+    const std::string residency = LoaderEnvironment::GetSecure("XR_LOADER_RUNTIME_RESIDENCY");
+    if (residency == "process") {
+        return;
+    }
+    if (!residency.empty() && residency != "instance") {
+        char *end = nullptr;
+        const unsigned long milliseconds = strtoul(residency.c_str(), &end, 10);
+        if (residency[0] >= '0' && residency[0] <= '9' && *end == '\0') {
+            if (RuntimeUnloadTimer::Get().Schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds))) {
+                return;
+            }
+        } else {
+            LoaderLogger::LogWarningMessage(openxr_command, "XR_LOADER_RUNTIME_RESIDENCY value \"" + residency +
+                                                                "\" is not \"instance\", \"process\" or a number of "
+                                                                "milliseconds, unloading the runtime");
+        }
+    }
+    RuntimeInterface::UnloadRuntime(openxr_command);
+}
+
 // Prototypes for the debug utils calls used internally.
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderTrampolineCreateDebugUtilsMessengerEXT(
     XrInstance instance, const XrDebugUtilsMessengerCreateInfoEXT *createInfo, XrDebugUtilsMessengerEXT *messenger);
@@ -47,6 +279,8 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderTrampolineDestroyDebugUtilsMessenger
 
 // Terminal functions needed by xrCreateInstance.
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddr(XrInstance, const char *, PFN_xrVoidFunction *);
+static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddrBatch(XrInstance, uint32_t, const char *const *,
+                                                                           PFN_xrVoidFunction *);
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateInstance(const XrInstanceCreateInfo *, XrInstance *);
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateApiLayerInstance(const XrInstanceCreateInfo *,
                                                                          const struct XrApiLayerCreateInfo *, XrInstance *);
@@ -75,7 +309,11 @@ inline bool IsMissingNullTerminator(const char (&str)[max_length]) {
 #ifdef XR_KHR_LOADER_INIT_SUPPORT  // platforms that support XR_KHR_loader_init.
 XRAPI_ATTR XrResult XRAPI_CALL LoaderXrInitializeLoaderKHR(const XrLoaderInitInfoBaseHeaderKHR *loaderInitInfo) XRLOADER_ABI_TRY {
     LoaderLogger::LogVerboseMessage("xrInitializeLoaderKHR", "Entering loader trampoline");
-    return InitializeLoader(loaderInitInfo);
+    XrResult result = InitializeLoader(loaderInitInfo);
+    if (XR_SUCCEEDED(result)) {
+        RuntimeInterface::StartPreload();
+    }
+    return result;
 }
 XRLOADER_ABI_CATCH_FALLBACK
 #endif
@@ -84,9 +322,10 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrEnumerateApiLayerProperties(uint32
                                                                           uint32_t *propertyCountOutput,
                                                                           XrApiLayerProperties *properties) XRLOADER_ABI_TRY {
     LoaderLogger::LogVerboseMessage("xrEnumerateApiLayerProperties", "Entering loader trampoline");
-
-    // Make sure only one thread is attempting to read the JSON files at a time.
-    std::unique_lock<std::mutex> loader_lock(GetGlobalLoaderMutex());
+    // Look for manifest files with the environment as it is now.
+    LoaderEnvironment::Refresh();
+    LoaderTimingCommandScope timing_scope("xrEnumerateApiLayerProperties");
+    RuntimeInterface::StartPreload();
 
     XrResult result = ApiLayerInterface::GetApiLayerProperties("xrEnumerateApiLayerProperties", propertyCapacityInput,
                                                                propertyCountOutput, properties);
@@ -103,6 +342,10 @@ LoaderXrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t pro
                                              XrExtensionProperties *properties) XRLOADER_ABI_TRY {
     bool just_layer_properties = false;
     LoaderLogger::LogVerboseMessage("xrEnumerateInstanceExtensionProperties", "Entering loader trampoline");
+    // Look for manifest files with the environment as it is now.
+    LoaderEnvironment::Refresh();
+    LoaderTimingCommandScope timing_scope("xrEnumerateInstanceExtensionProperties");
+    RuntimeInterface::StartPreload();
 
     // "Independent of elementCapacityInput or elements parameters, elementCountOutput must be a valid pointer,
     // and the function sets elementCountOutput." - 2.11
@@ -115,26 +358,20 @@ LoaderXrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t pro
         just_layer_properties = true;
     }
 
-    std::vector<XrExtensionProperties> extension_properties = {};
+    std::shared_ptr<const std::vector<XrExtensionProperties>> extension_properties;
     XrResult result;
 
-    {
-        // Make sure the runtime isn't unloaded while this call is in progress.
-        std::unique_lock<std::mutex> loader_lock(GetGlobalLoaderMutex());
-
+    if (just_layer_properties) {
         // Get the layer extension properties
+        std::shared_ptr<std::vector<XrExtensionProperties>> layer_extension_properties =
+            std::make_shared<std::vector<XrExtensionProperties>>();
         result = ApiLayerInterface::GetInstanceExtensionProperties("xrEnumerateInstanceExtensionProperties", layerName,
-                                                                   extension_properties);
-        if (XR_SUCCEEDED(result) && !just_layer_properties) {
-            // If not specific to a layer, get the runtime extension properties
-            result = RuntimeInterface::LoadRuntime("xrEnumerateInstanceExtensionProperties");
-            if (XR_SUCCEEDED(result)) {
-                RuntimeInterface::GetRuntime().GetInstanceExtensionProperties(extension_properties);
-            } else {
-                LoaderLogger::LogErrorMessage("xrEnumerateInstanceExtensionProperties",
-                                              "Failed to find default runtime with RuntimeInterface::LoadRuntime()");
-            }
-        }
+                                                                   *layer_extension_properties);
+        extension_properties = std::move(layer_extension_properties);
+    } else {
+        // Otherwise get those of the enabled layers, the runtime and the loader.
+        result = InstanceExtensionPropertiesCache::Get().GetExtensionProperties("xrEnumerateInstanceExtensionProperties",
+                                                                                extension_properties);
     }
 
     if (XR_FAILED(result)) {
@@ -142,29 +379,7 @@ LoaderXrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t pro
         return result;
     }
 
-    // If this is not in reference to a specific layer, then add the loader-specific extension properties as well.
-    // These are extensions that the loader directly supports.
-    if (!just_layer_properties) {
-        for (const XrExtensionProperties &loader_prop : LoaderInstance::LoaderSpecificExtensions()) {
-            bool found_prop = false;
-            for (XrExtensionProperties &existing_prop : extension_properties) {
-                if (0 == strcmp(existing_prop.extensionName, loader_prop.extensionName)) {
-                    found_prop = true;
-                    // Use the loader version if it is newer
-                    if (existing_prop.extensionVersion < loader_prop.extensionVersion) {
-                        existing_prop.extensionVersion = loader_prop.extensionVersion;
-                    }
-                    break;
-                }
-            }
-            // Only add extensions not supported by the loader
-            if (!found_prop) {
-                extension_properties.push_back(loader_prop);
-            }
-        }
-    }
-
-    auto num_extension_properties = static_cast<uint32_t>(extension_properties.size());
+    auto num_extension_properties = static_cast<uint32_t>(extension_properties->size());
     if (propertyCapacityInput == 0) {
         *propertyCountOutput = num_extension_properties;
     } else if (nullptr != properties) {
@@ -181,14 +396,14 @@ LoaderXrEnumerateInstanceExtensionProperties(const char *layerName, uint32_t pro
             num_to_copy = propertyCapacityInput;
         }
         bool properties_valid = true;
-        for (uint32_t prop = 0; prop < propertyCapacityInput && prop < extension_properties.size(); ++prop) {
+        for (uint32_t prop = 0; prop < propertyCapacityInput && prop < extension_properties->size(); ++prop) {
             if (XR_TYPE_EXTENSION_PROPERTIES != properties[prop].type) {
                 properties_valid = false;
                 LoaderLogger::LogValidationErrorMessage("VUID-XrExtensionProperties-type-type",
                                                         "xrEnumerateInstanceExtensionProperties", "unknown type in properties");
             }
             if (properties_valid) {
-                properties[prop] = extension_properties[prop];
+                properties[prop] = (*extension_properties)[prop];
             }
         }
         if (!properties_valid) {
@@ -234,34 +449,33 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrCreateInstance(const XrInstanceCre
         return XR_ERROR_VALIDATION_FAILURE;
     }
 
-    // Make sure the ActiveLoaderInstance::IsAvailable check is done atomically with RuntimeInterface::LoadRuntime.
-    std::unique_lock<std::mutex> instance_lock(GetGlobalLoaderMutex());
-
-    // Check if there is already an XrInstance that is alive. If so, another instance cannot be created.
-    // The loader does not support multiple simultaneous instances because the loader is intended to be
-    // usable by apps using future OpenXR APIs (through xrGetInstanceProcAddr). Because the loader would
-    // not be aware of new handle types, it would not be able to look up the appropriate dispatch table
-    // in some cases.
-    if (ActiveLoaderInstance::IsAvailable()) {  // If there is an XrInstance already alive.
-        LoaderLogger::LogErrorMessage("xrCreateInstance", "Loader does not support simultaneous XrInstances");
-        return XR_ERROR_LIMIT_REACHED;
-    }
+    // Look for manifest files with the environment as it is now.
+    LoaderEnvironment::Refresh();
+    LoaderTimingCommandScope timing_scope("xrCreateInstance");
 
     std::vector<std::unique_ptr<ApiLayerInterface>> api_layer_interfaces;
     XrResult result;
 
-    // Make sure only one thread is attempting to read the JSON files and use the instance.
+    // Make sure the runtime is not unloaded by another instance being destroyed while this one is created.  The API layers are
+    // found and loaded without the lock, after which the runtime is loaded again if it was unloaded in the meantime.
+    std::shared_lock<std::shared_timed_mutex> instance_lock;
     {
         // Load the available runtime
-        result = RuntimeInterface::LoadRuntime("xrCreateInstance");
+        result = LockLoadedRuntime("xrCreateInstance", instance_lock);
         if (XR_FAILED(result)) {
             LoaderLogger::LogErrorMessage("xrCreateInstance", "Failed loading runtime information");
         } else {
+            instance_lock.unlock();
             // Load the appropriate layers
             result = ApiLayerInterface::LoadApiLayers("xrCreateInstance", info->enabledApiLayerCount, info->enabledApiLayerNames,
                                                       api_layer_interfaces);
             if (XR_FAILED(result)) {
                 LoaderLogger::LogErrorMessage("xrCreateInstance", "Failed loading layer information");
+            } else {
+                result = LockLoadedRuntime("xrCreateInstance", instance_lock);
+                if (XR_FAILED(result)) {
+                    LoaderLogger::LogErrorMessage("xrCreateInstance", "Failed loading runtime information");
+                }
             }
         }
     }
@@ -270,12 +484,15 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrCreateInstance(const XrInstanceCre
     LoaderInstance *loader_instance = nullptr;
     if (XR_SUCCEEDED(result)) {
         std::unique_ptr<LoaderInstance> owned_loader_instance;
-        result = LoaderInstance::CreateInstance(LoaderXrTermGetInstanceProcAddr, LoaderXrTermCreateInstance,
-                                                LoaderXrTermCreateApiLayerInstance, std::move(api_layer_interfaces), info,
-                                                &owned_loader_instance);
+        result = LoaderInstance::CreateInstance(LoaderXrTermGetInstanceProcAddr, LoaderXrTermGetInstanceProcAddrBatch,
+                                                LoaderXrTermCreateInstance, LoaderXrTermCreateApiLayerInstance,
+                                                std::move(api_layer_interfaces), info, &owned_loader_instance);
         if (XR_SUCCEEDED(result)) {
             loader_instance = owned_loader_instance.get();
-            result = ActiveLoaderInstance::Set(std::move(owned_loader_instance), "xrCreateInstance");
+            ActiveLoaderInstance::Add(std::move(owned_loader_instance));
+#ifdef XR_LOADER_COMMAND_STATISTICS
+            LoaderCommandStatistics::RegisterExitReport();
+#endif  // XR_LOADER_COMMAND_STATISTICS
         }
     }
 
@@ -301,10 +518,21 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrCreateInstance(const XrInstanceCre
     }
 
     if (XR_FAILED(result)) {
-        // Ensure the global loader instance and runtime are destroyed if something went wrong.
-        ActiveLoaderInstance::Remove();
-        RuntimeInterface::UnloadRuntime("xrCreateInstance");
+        // Ensure the loader instance, and the runtime if no other instance uses it, are destroyed if something went wrong.
+        if (loader_instance != nullptr) {
+            ActiveLoaderInstance::Remove(loader_instance);
+        }
+        if (instance_lock.owns_lock()) {
+            instance_lock.unlock();
+        }
+        {
+            std::unique_lock<std::shared_timed_mutex> loader_lock(GetGlobalLoaderMutex());
+            if (!ActiveLoaderInstance::IsAvailable()) {
+                ReleaseRuntime("xrCreateInstance");
+            }
+        }
         LoaderLogger::LogErrorMessage("xrCreateInstance", "xrCreateInstance failed");
+        LoaderEpoch::Reclaim();
     } else {
         *instance = loader_instance->GetInstanceHandle();
         LoaderLogger::LogVerboseMessage("xrCreateInstance", "Completed loader trampoline");
@@ -322,11 +550,12 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrDestroyInstance(XrInstance instanc
         return XR_ERROR_HANDLE_INVALID;
     }
 
-    // Make sure the runtime isn't unloaded while it is being used by xrEnumerateInstanceExtensionProperties.
-    std::unique_lock<std::mutex> loader_lock(GetGlobalLoaderMutex());
+    // Make sure the runtime isn't unloaded while the instance is destroyed through it.
+    std::shared_lock<std::shared_timed_mutex> loader_lock(GetGlobalLoaderMutex());
 
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrDestroyInstance");
+    XrResult result =
+        ActiveLoaderInstance::Get(XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(instance), &loader_instance, "xrDestroyInstance");
     if (XR_FAILED(result)) {
         return result;
     }
@@ -344,14 +573,31 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrDestroyInstance(XrInstance instanc
         LoaderLogger::LogErrorMessage("xrDestroyInstance", "Unknown error occurred calling down chain");
     }
 
-    // Get rid of the loader instance. This will make it possible to create another instance in the future.
-    ActiveLoaderInstance::Remove();
+    // Get rid of the loader instance and every handle that belonged to it.
+    ActiveLoaderInstance::Remove(loader_instance);
+
+#ifdef XR_LOADER_COMMAND_STATISTICS
+    LoaderCommandStatistics::Report("xrDestroyInstance");
+#endif  // XR_LOADER_COMMAND_STATISTICS
 
     // Lock the instance create/destroy mutex
     LoaderLogger::LogVerboseMessage("xrDestroyInstance", "Completed loader trampoline");
 
-    // Finally, unload the runtime if necessary
-    RuntimeInterface::UnloadRuntime("xrDestroyInstance");
+    // Finally, release the runtime if this was the last instance using it.  Another instance may have been created by the time
+    // the exclusive lock is taken, so it is checked again there.
+    if (!ActiveLoaderInstance::IsAvailable()) {
+        loader_lock.unlock();
+        std::unique_lock<std::shared_timed_mutex> exclusive_lock(GetGlobalLoaderMutex());
+        if (!ActiveLoaderInstance::IsAvailable()) {
+            ReleaseRuntime("xrDestroyInstance");
+        }
+    }
+
+    // Free the instance, and the runtime if it was unloaded, once calls still using them on other threads have returned.
+    if (loader_lock.owns_lock()) {
+        loader_lock.unlock();
+    }
+    LoaderEpoch::Reclaim();
 
     return XR_SUCCESS;
 }
@@ -418,7 +664,12 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateInstance(const XrInstanc
                                                 "something wrong with XrInstanceCreateInfo contents");
         return result;
     }
-    result = RuntimeInterface::GetRuntime().CreateInstance(createInfo, instance);
+    RuntimeInterface *runtime = RuntimeInterface::GetRuntime();
+    if (nullptr == runtime) {
+        // The runtime was unloaded on another thread.
+        return XR_ERROR_RUNTIME_UNAVAILABLE;
+    }
+    result = runtime->CreateInstance(createInfo, instance);
     LoaderLogger::LogVerboseMessage("xrCreateInstance", "Completed loader terminator");
     return result;
 }
@@ -433,41 +684,51 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateApiLayerInstance(const X
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermDestroyInstance(XrInstance instance) XRLOADER_ABI_TRY {
     LoaderLogger::LogVerboseMessage("xrDestroyInstance", "Entering loader terminator");
     LoaderLogger::GetInstance().RemoveLogRecordersForXrInstance(instance);
-    XrResult result = RuntimeInterface::GetRuntime().DestroyInstance(instance);
+    RuntimeInterface *runtime = RuntimeInterface::GetRuntime();
+    if (nullptr == runtime) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    XrResult result = runtime->DestroyInstance(instance);
     LoaderLogger::LogVerboseMessage("xrDestroyInstance", "Completed loader terminator");
     return result;
 }
 XRLOADER_ABI_CATCH_FALLBACK
 
+// Returns the loader terminator for the few instance commands that need one, or nullptr if the command
+// goes directly to the runtime version.
+static PFN_xrVoidFunction LoaderGetTerminatorFunction(const char *name) {
+    // NOTE: ActiveLoaderInstance cannot be used in this function because it is called before an instance is made active.
+    switch (LoaderLookupCommandId(name)) {
+        case LoaderCommandId::GetInstanceProcAddr:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermGetInstanceProcAddr);
+        case LoaderCommandId::CreateInstance:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateInstance);
+        case LoaderCommandId::DestroyInstance:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyInstance);
+        case LoaderCommandId::SetDebugUtilsObjectNameEXT:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSetDebugUtilsObjectNameEXT);
+        case LoaderCommandId::CreateDebugUtilsMessengerEXT:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateDebugUtilsMessengerEXT);
+        case LoaderCommandId::DestroyDebugUtilsMessengerEXT:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyDebugUtilsMessengerEXT);
+        case LoaderCommandId::SubmitDebugUtilsMessageEXT:
+            return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSubmitDebugUtilsMessageEXT);
+        default:
+            // xrCreateApiLayerInstance is not a registry command, so it is not in the generated table.
+            if (0 == strcmp(name, "xrCreateApiLayerInstance")) {
+                // Special layer version of xrCreateInstance terminator.  If we get called this by a layer,
+                // we simply re-direct the information back into the standard xrCreateInstance terminator.
+                return reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateApiLayerInstance);
+            }
+            return nullptr;
+    }
+}
+
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddr(XrInstance instance, const char *name,
                                                                       PFN_xrVoidFunction *function) XRLOADER_ABI_TRY {
     // A few instance commands need to go through a loader terminator.
     // Otherwise, go directly to the runtime version of the command if it exists.
-    // But first set the function pointer to NULL so that the fall-through below actually works.
-    *function = nullptr;
-
-    // NOTE: ActiveLoaderInstance cannot be used in this function because it is called before an instance is made active.
-
-    if (0 == strcmp(name, "xrGetInstanceProcAddr")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermGetInstanceProcAddr);
-    } else if (0 == strcmp(name, "xrCreateInstance")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateInstance);
-    } else if (0 == strcmp(name, "xrDestroyInstance")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyInstance);
-    } else if (0 == strcmp(name, "xrSetDebugUtilsObjectNameEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSetDebugUtilsObjectNameEXT);
-    } else if (0 == strcmp(name, "xrCreateDebugUtilsMessengerEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateDebugUtilsMessengerEXT);
-    } else if (0 == strcmp(name, "xrDestroyDebugUtilsMessengerEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermDestroyDebugUtilsMessengerEXT);
-    } else if (0 == strcmp(name, "xrSubmitDebugUtilsMessageEXT")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermSubmitDebugUtilsMessageEXT);
-    } else if (0 == strcmp(name, "xrCreateApiLayerInstance")) {
-        // Special layer version of xrCreateInstance terminator.  If we get called this by a layer,
-        // we simply re-direct the information back into the standard xrCreateInstance terminator.
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrTermCreateApiLayerInstance);
-    }
-
+    *function = LoaderGetTerminatorFunction(name);
     if (nullptr != *function) {
         return XR_SUCCESS;
     }
@@ -476,6 +737,24 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddr(XrInstance
 }
 XRLOADER_ABI_CATCH_FALLBACK
 
+static XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermGetInstanceProcAddrBatch(XrInstance instance, uint32_t nameCount,
+                                                                           const char *const *names,
+                                                                           PFN_xrVoidFunction *functions) XRLOADER_ABI_TRY {
+    // Ask the runtime for every command in one query, then substitute the loader terminators.
+    XrResult result = RuntimeInterface::GetInstanceProcAddrBatch(instance, nameCount, names, functions);
+    if (XR_FAILED(result)) {
+        return result;
+    }
+    for (uint32_t i = 0; i < nameCount; ++i) {
+        PFN_xrVoidFunction terminator = LoaderGetTerminatorFunction(names[i]);
+        if (nullptr != terminator) {
+            functions[i] = terminator;
+        }
+    }
+    return XR_SUCCESS;
+}
+XRLOADER_ABI_CATCH_FALLBACK
+
 // ---- Extension manual loader trampoline functions
 
 static XRAPI_ATTR XrResult XRAPI_CALL
@@ -488,13 +767,19 @@ LoaderTrampolineCreateDebugUtilsMessengerEXT(XrInstance instance, const XrDebugU
         return XR_ERROR_HANDLE_INVALID;
     }
 
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrCreateDebugUtilsMessengerEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(instance), &loader_instance,
+                                                "xrCreateDebugUtilsMessengerEXT");
     if (XR_FAILED(result)) {
         return result;
     }
 
     result = loader_instance->DispatchTable()->CreateDebugUtilsMessengerEXT(instance, createInfo, messenger);
+    if (XR_SUCCEEDED(result)) {
+        ActiveLoaderInstance::AddHandle(XR_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT, MakeHandleGeneric(*messenger), loader_instance,
+                                        XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(instance));
+    }
     LoaderLogger::LogVerboseMessage("xrCreateDebugUtilsMessengerEXT", "Completed loader trampoline");
     return result;
 }
@@ -511,13 +796,18 @@ XRLOADER_ABI_CATCH_BAD_ALLOC_OOM XRLOADER_ABI_CATCH_FALLBACK
         return XR_ERROR_HANDLE_INVALID;
     }
 
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrDestroyDebugUtilsMessengerEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT, MakeHandleGeneric(messenger),
+                                                &loader_instance, "xrDestroyDebugUtilsMessengerEXT");
     if (XR_FAILED(result)) {
         return result;
     }
 
     result = loader_instance->DispatchTable()->DestroyDebugUtilsMessengerEXT(messenger);
+    if (XR_SUCCEEDED(result)) {
+        ActiveLoaderInstance::RemoveHandle(XR_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT, MakeHandleGeneric(messenger));
+    }
     LoaderLogger::LogVerboseMessage("xrDestroyDebugUtilsMessengerEXT", "Completed loader trampoline");
     return result;
 }
@@ -537,8 +827,10 @@ LoaderTrampolineSessionBeginDebugUtilsLabelRegionEXT(XrSession session, const Xr
         return XR_ERROR_VALIDATION_FAILURE;
     }
 
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSessionBeginDebugUtilsLabelRegionEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_SESSION, MakeHandleGeneric(session), &loader_instance,
+                                                "xrSessionBeginDebugUtilsLabelRegionEXT");
     if (XR_FAILED(result)) {
         return result;
     }
@@ -557,8 +849,10 @@ static XRAPI_ATTR XrResult XRAPI_CALL LoaderTrampolineSessionEndDebugUtilsLabelR
         return XR_ERROR_HANDLE_INVALID;
     }
 
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSessionEndDebugUtilsLabelRegionEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_SESSION, MakeHandleGeneric(session), &loader_instance,
+                                                "xrSessionEndDebugUtilsLabelRegionEXT");
     if (XR_FAILED(result)) {
         return result;
     }
@@ -579,8 +873,10 @@ LoaderTrampolineSessionInsertDebugUtilsLabelEXT(XrSession session, const XrDebug
         return XR_ERROR_HANDLE_INVALID;
     }
 
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSessionInsertDebugUtilsLabelEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_SESSION, MakeHandleGeneric(session), &loader_instance,
+                                                "xrSessionInsertDebugUtilsLabelEXT");
     if (XR_FAILED(result)) {
         return result;
     }
@@ -606,8 +902,10 @@ XRLOADER_ABI_CATCH_FALLBACK
 // No-op trampoline needed for xrGetInstanceProcAddr. Work done in terminator.
 static XRAPI_ATTR XrResult XRAPI_CALL
 LoaderTrampolineSetDebugUtilsObjectNameEXT(XrInstance instance, const XrDebugUtilsObjectNameInfoEXT *nameInfo) XRLOADER_ABI_TRY {
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSetDebugUtilsObjectNameEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(instance), &loader_instance,
+                                                "xrSetDebugUtilsObjectNameEXT");
     if (XR_SUCCEEDED(result)) {
         result = loader_instance->DispatchTable()->SetDebugUtilsObjectNameEXT(instance, nameInfo);
     }
@@ -619,8 +917,10 @@ XRLOADER_ABI_CATCH_FALLBACK
 static XRAPI_ATTR XrResult XRAPI_CALL LoaderTrampolineSubmitDebugUtilsMessageEXT(
     XrInstance instance, XrDebugUtilsMessageSeverityFlagsEXT messageSeverity, XrDebugUtilsMessageTypeFlagsEXT messageTypes,
     const XrDebugUtilsMessengerCallbackDataEXT *callbackData) XRLOADER_ABI_TRY {
+    LoaderEpochGuard epoch_guard;
     LoaderInstance *loader_instance;
-    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrSubmitDebugUtilsMessageEXT");
+    XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(instance), &loader_instance,
+                                                "xrSubmitDebugUtilsMessageEXT");
     if (XR_SUCCEEDED(result)) {
         result =
             loader_instance->DispatchTable()->SubmitDebugUtilsMessageEXT(instance, messageSeverity, messageTypes, callbackData);
@@ -640,7 +940,13 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateDebugUtilsMessengerEXT(XrInstan
                                                 "xrCreateDebugUtilsMessengerEXT", "invalid messenger pointer");
         return XR_ERROR_VALIDATION_FAILURE;
     }
-    const XrGeneratedDispatchTable *dispatch_table = RuntimeInterface::GetDispatchTable(instance);
+    LoaderEpochGuard epoch_guard;
+    RuntimeInterface *runtime = RuntimeInterface::GetRuntime();
+    const XrGeneratedDispatchTable *dispatch_table = nullptr == runtime ? nullptr : runtime->GetDispatchTable(instance);
+    if (nullptr == dispatch_table) {
+        // The instance was destroyed on another thread.
+        return XR_ERROR_HANDLE_INVALID;
+    }
     XrResult result = XR_SUCCESS;
     // This extension is supported entirely by the loader which means the runtime may or may not support it.
     if (nullptr != dispatch_table->CreateDebugUtilsMessengerEXT) {
@@ -652,7 +958,7 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermCreateDebugUtilsMessengerEXT(XrInstan
     }
     if (XR_SUCCEEDED(result)) {
         LoaderLogger::GetInstance().AddLogRecorderForXrInstance(instance, MakeDebugUtilsLoaderLogRecorder(createInfo, *messenger));
-        RuntimeInterface::GetRuntime().TrackDebugMessenger(instance, *messenger);
+        runtime->TrackDebugMessenger(instance, *messenger);
     }
     LoaderLogger::LogVerboseMessage("xrCreateDebugUtilsMessengerEXT", "Completed loader terminator");
     return result;
@@ -661,10 +967,16 @@ XRLOADER_ABI_CATCH_FALLBACK
 
 XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermDestroyDebugUtilsMessengerEXT(XrDebugUtilsMessengerEXT messenger) XRLOADER_ABI_TRY {
     LoaderLogger::LogVerboseMessage("xrDestroyDebugUtilsMessengerEXT", "Entering loader terminator");
-    const XrGeneratedDispatchTable *dispatch_table = RuntimeInterface::GetDebugUtilsMessengerDispatchTable(messenger);
+    LoaderEpochGuard epoch_guard;
+    RuntimeInterface *runtime = RuntimeInterface::GetRuntime();
+    const XrGeneratedDispatchTable *dispatch_table =
+        nullptr == runtime ? nullptr : runtime->GetDebugUtilsMessengerDispatchTable(messenger);
+    if (nullptr == dispatch_table) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
     XrResult result = XR_SUCCESS;
     LoaderLogger::GetInstance().RemoveLogRecorder(MakeHandleGeneric(messenger));
-    RuntimeInterface::GetRuntime().ForgetDebugMessenger(messenger);
+    runtime->ForgetDebugMessenger(messenger);
     // This extension is supported entirely by the loader which means the runtime may or may not support it.
     if (nullptr != dispatch_table->DestroyDebugUtilsMessengerEXT) {
         result = dispatch_table->DestroyDebugUtilsMessengerEXT(messenger);
@@ -681,7 +993,12 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrTermSubmitDebugUtilsMessageEXT(
     XrInstance instance, XrDebugUtilsMessageSeverityFlagsEXT messageSeverity, XrDebugUtilsMessageTypeFlagsEXT messageTypes,
     const XrDebugUtilsMessengerCallbackDataEXT *callbackData) XRLOADER_ABI_TRY {
     LoaderLogger::LogVerboseMessage("xrSubmitDebugUtilsMessageEXT", "Entering loader terminator");
-    const XrGeneratedDispatchTable *dispatch_table = RuntimeInterface::GetDispatchTable(instance);
+    LoaderEpochGuard epoch_guard;
+    RuntimeInterface *runtime = RuntimeInterface::GetRuntime();
+    const XrGeneratedDispatchTable *dispatch_table = nullptr == runtime ? nullptr : runtime->GetDispatchTable(instance);
+    if (nullptr == dispatch_table) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
     XrResult result = XR_SUCCESS;
     if (nullptr != dispatch_table->SubmitDebugUtilsMessageEXT) {
         result = dispatch_table->SubmitDebugUtilsMessageEXT(instance, messageSeverity, messageTypes, callbackData);
@@ -698,7 +1015,12 @@ XRLOADER_ABI_CATCH_FALLBACK
 XRAPI_ATTR XrResult XRAPI_CALL
 LoaderXrTermSetDebugUtilsObjectNameEXT(XrInstance instance, const XrDebugUtilsObjectNameInfoEXT *nameInfo) XRLOADER_ABI_TRY {
     LoaderLogger::LogVerboseMessage("xrSetDebugUtilsObjectNameEXT", "Entering loader terminator");
-    const XrGeneratedDispatchTable *dispatch_table = RuntimeInterface::GetDispatchTable(instance);
+    LoaderEpochGuard epoch_guard;
+    RuntimeInterface *runtime = RuntimeInterface::GetRuntime();
+    const XrGeneratedDispatchTable *dispatch_table = nullptr == runtime ? nullptr : runtime->GetDispatchTable(instance);
+    if (nullptr == dispatch_table) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
     XrResult result = XR_SUCCESS;
     if (nullptr != dispatch_table->SetDebugUtilsObjectNameEXT) {
         result = dispatch_table->SetDebugUtilsObjectNameEXT(instance, nameInfo);
@@ -711,6 +1033,8 @@ XRLOADER_ABI_CATCH_FALLBACK
 
 XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance, const char *name,
                                                            PFN_xrVoidFunction *function) XRLOADER_ABI_TRY {
+    LoaderEpochGuard epoch_guard;
+
     // Initialize the function to nullptr in case it does not get caught in a known case
     *function = nullptr;
 
@@ -726,11 +1050,14 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance,
         return XR_ERROR_VALIDATION_FAILURE;
     }
 
+    const LoaderCommandId command_id = LoaderLookupCommandId(name);
+
     LoaderInstance *loader_instance = nullptr;
     if (instance == XR_NULL_HANDLE) {
         // Null instance is allowed for a few specific API entry points, otherwise return error
-        if (strcmp(name, "xrCreateInstance") != 0 && strcmp(name, "xrEnumerateApiLayerProperties") != 0 &&
-            strcmp(name, "xrEnumerateInstanceExtensionProperties") != 0 && strcmp(name, "xrInitializeLoaderKHR") != 0) {
+        if (command_id != LoaderCommandId::CreateInstance && command_id != LoaderCommandId::EnumerateApiLayerProperties &&
+            command_id != LoaderCommandId::EnumerateInstanceExtensionProperties &&
+            command_id != LoaderCommandId::InitializeLoaderKHR) {
             // TODO why is xrGetInstanceProcAddr not listed in here?
             std::string error_str = "XR_NULL_HANDLE for instance but query for ";
             error_str += name;
@@ -739,66 +1066,81 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance,
                                                     error_str);
             return XR_ERROR_HANDLE_INVALID;
         }
+        // Looking up these commands is usually the first thing an application does with the loader.
+        RuntimeInterface::StartPreload();
     } else {
-        // non null instance passed in, it should be our current instance
-        XrResult result = ActiveLoaderInstance::Get(&loader_instance, "xrGetInstanceProcAddr");
+        // non null instance passed in, it should be one of our active instances
+        XrResult result = ActiveLoaderInstance::Get(XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(instance), &loader_instance,
+                                                    "xrGetInstanceProcAddr");
         if (XR_FAILED(result)) {
             return result;
         }
-        if (loader_instance->GetInstanceHandle() != instance) {
-            return XR_ERROR_HANDLE_INVALID;
-        }
     }
 
-    // These functions must always go through the loader's implementation (trampoline).
-    if (strcmp(name, "xrGetInstanceProcAddr") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrGetInstanceProcAddr);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrInitializeLoaderKHR") == 0) {
+    bool is_debug_utils_command = false;
+    switch (command_id) {
+        // These functions must always go through the loader's implementation (trampoline).
+        case LoaderCommandId::GetInstanceProcAddr:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrGetInstanceProcAddr);
+            return XR_SUCCESS;
+        case LoaderCommandId::InitializeLoaderKHR:
 #ifdef XR_KHR_LOADER_INIT_SUPPORT
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrInitializeLoaderKHR);
-        return XR_SUCCESS;
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrInitializeLoaderKHR);
+            return XR_SUCCESS;
 #else
-        return XR_ERROR_FUNCTION_UNSUPPORTED;
+            return XR_ERROR_FUNCTION_UNSUPPORTED;
 #endif
-    } else if (strcmp(name, "xrEnumerateApiLayerProperties") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrEnumerateApiLayerProperties);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrEnumerateInstanceExtensionProperties") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrEnumerateInstanceExtensionProperties);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrCreateInstance") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrCreateInstance);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrDestroyInstance") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrDestroyInstance);
-        return XR_SUCCESS;
-    }
-
-    // XR_EXT_debug_utils is built into the loader and handled partly through the xrGetInstanceProcAddress terminator,
-    // but the check to see if the extension is enabled must be done here where ActiveLoaderInstance is safe to use.
-    if (*function == nullptr) {
-        if (strcmp(name, "xrCreateDebugUtilsMessengerEXT") == 0) {
+        case LoaderCommandId::EnumerateApiLayerProperties:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrEnumerateApiLayerProperties);
+            return XR_SUCCESS;
+        case LoaderCommandId::EnumerateInstanceExtensionProperties:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrEnumerateInstanceExtensionProperties);
+            return XR_SUCCESS;
+        case LoaderCommandId::CreateInstance:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrCreateInstance);
+            return XR_SUCCESS;
+        case LoaderCommandId::DestroyInstance:
+            *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrDestroyInstance);
+            return XR_SUCCESS;
+
+        // XR_EXT_debug_utils is built into the loader and handled partly through the xrGetInstanceProcAddress terminator,
+        // but the check to see if the extension is enabled must be done here where ActiveLoaderInstance is safe to use.
+        case LoaderCommandId::CreateDebugUtilsMessengerEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineCreateDebugUtilsMessengerEXT);
-        } else if (strcmp(name, "xrDestroyDebugUtilsMessengerEXT") == 0) {
+            is_debug_utils_command = true;
+            break;
+        case LoaderCommandId::DestroyDebugUtilsMessengerEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineDestroyDebugUtilsMessengerEXT);
-        } else if (strcmp(name, "xrSessionBeginDebugUtilsLabelRegionEXT") == 0) {
+            is_debug_utils_command = true;
+            break;
+        case LoaderCommandId::SessionBeginDebugUtilsLabelRegionEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineSessionBeginDebugUtilsLabelRegionEXT);
-        } else if (strcmp(name, "xrSessionEndDebugUtilsLabelRegionEXT") == 0) {
+            is_debug_utils_command = true;
+            break;
+        case LoaderCommandId::SessionEndDebugUtilsLabelRegionEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineSessionEndDebugUtilsLabelRegionEXT);
-        } else if (strcmp(name, "xrSessionInsertDebugUtilsLabelEXT") == 0) {
+            is_debug_utils_command = true;
+            break;
+        case LoaderCommandId::SessionInsertDebugUtilsLabelEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineSessionInsertDebugUtilsLabelEXT);
-        } else if (strcmp(name, "xrSetDebugUtilsObjectNameEXT") == 0) {
+            is_debug_utils_command = true;
+            break;
+        case LoaderCommandId::SetDebugUtilsObjectNameEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineSetDebugUtilsObjectNameEXT);
-        } else if (strcmp(name, "xrSubmitDebugUtilsMessageEXT") == 0) {
+            is_debug_utils_command = true;
+            break;
+        case LoaderCommandId::SubmitDebugUtilsMessageEXT:
             *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderTrampolineSubmitDebugUtilsMessageEXT);
-        }
+            is_debug_utils_command = true;
+            break;
+        default:
+            break;
+    }
 
-        if (*function != nullptr && !loader_instance->ExtensionIsEnabled("XR_EXT_debug_utils")) {
-            // The function matches one of the XR_EXT_debug_utils functions but the extension is not enabled.
-            *function = nullptr;
-            return XR_ERROR_FUNCTION_UNSUPPORTED;
-        }
+    if (is_debug_utils_command && !loader_instance->ExtensionIsEnabled(LoaderExtensionId::EXT_debug_utils)) {
+        // The function matches one of the XR_EXT_debug_utils functions but the extension is not enabled.
+        *function = nullptr;
+        return XR_ERROR_FUNCTION_UNSUPPORTED;
     }
 
     if (*function != nullptr) {
@@ -807,7 +1149,16 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance,
     }
 
     // If the function is not supported by the loader, call down to the next layer.
-    return loader_instance->GetInstanceProcAddr(name, function);
+    XrResult result = loader_instance->GetInstanceProcAddr(name, function);
+    if (XR_SUCCEEDED(result) && *function != nullptr) {
+        // Commands that create or destroy handles still go through the loader, so that it knows which instance owns every
+        // handle however the application reaches them.
+        PFN_xrVoidFunction handle_trampoline = LoaderGeneratedHandleTrampoline(command_id);
+        if (handle_trampoline != nullptr) {
+            *function = handle_trampoline;
+        }
+    }
+    return result;
 }
 XRLOADER_ABI_CATCH_FALLBACK
 
@@ -0,0 +1,118 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "loader_environment.hpp"
+
+#include "platform_utils.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+#define XR_LOADER_ENVIRONMENT_SNAPSHOT
+#endif
+
+#ifdef XR_LOADER_ENVIRONMENT_SNAPSHOT
+
+#if defined(XR_OS_APPLE)
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#else
+extern "C" char** environ;
+#endif
+
+namespace {
+struct EnvironmentSnapshot {
+    // Holds the first value of each name, which is the one getenv returns.
+    std::unordered_map<std::string, std::string> variables;
+    // Whether secure_getenv hides the environment from this process, as it does for a setuid or setgid program.  That is
+    // decided once for the whole process, so it is the same for every variable.
+    bool secure_hidden{false};
+};
+
+std::shared_ptr<const EnvironmentSnapshot> TakeSnapshot() {
+    std::shared_ptr<EnvironmentSnapshot> snapshot = std::make_shared<EnvironmentSnapshot>();
+    for (char** entry = environ; entry != nullptr && *entry != nullptr; ++entry) {
+        const char* separator = strchr(*entry, '=');
+        if (separator == nullptr) {
+            continue;
+        }
+        std::string name(*entry, static_cast<size_t>(separator - *entry));
+        if (snapshot->variables.empty()) {
+            snapshot->secure_hidden = detail::ImplGetSecureEnv(name.c_str()) == nullptr;
+        }
+        snapshot->variables.emplace(std::move(name), separator + 1);
+    }
+    return snapshot;
+}
+
+// Never destroyed, so that threads still reading the environment while the process exits find it intact.
+struct EnvironmentState {
+    static EnvironmentState& Get() {
+        static EnvironmentState* state = new EnvironmentState();
+        return *state;
+    }
+
+    std::shared_ptr<const EnvironmentSnapshot> GetSnapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!snapshot) {
+            snapshot = TakeSnapshot();
+        }
+        return snapshot;
+    }
+
+    std::mutex mutex;
+    std::shared_ptr<const EnvironmentSnapshot> snapshot;
+};
+
+// Looks up name, returning nullptr if it is not set.  The snapshot keeps the value alive.
+const std::string* FindVariable(const EnvironmentSnapshot& snapshot, const char* name) {
+    auto found = snapshot.variables.find(name);
+    return found == snapshot.variables.end() ? nullptr : &found->second;
+}
+}  // namespace
+
+void LoaderEnvironment::Refresh() {
+    std::shared_ptr<const EnvironmentSnapshot> snapshot = TakeSnapshot();
+    EnvironmentState& state = EnvironmentState::Get();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    // The old snapshot is released outside of the lock, by whichever reader holds it last.
+    std::swap(state.snapshot, snapshot);
+}
+
+std::string LoaderEnvironment::Get(const char* name) {
+    std::shared_ptr<const EnvironmentSnapshot> snapshot = EnvironmentState::Get().GetSnapshot();
+    const std::string* value = FindVariable(*snapshot, name);
+    return value == nullptr ? std::string() : *value;
+}
+
+std::string LoaderEnvironment::GetSecure(const char* name) {
+    std::shared_ptr<const EnvironmentSnapshot> snapshot = EnvironmentState::Get().GetSnapshot();
+    const std::string* value = snapshot->secure_hidden ? nullptr : FindVariable(*snapshot, name);
+    return value == nullptr ? std::string() : *value;
+}
+
+bool LoaderEnvironment::IsSet(const char* name) {
+    std::shared_ptr<const EnvironmentSnapshot> snapshot = EnvironmentState::Get().GetSnapshot();
+    return FindVariable(*snapshot, name) != nullptr;
+}
+
+#else  // !XR_LOADER_ENVIRONMENT_SNAPSHOT
+
+// Windows looks up environment variable names without regard to case, and other platforms have no environment for the
+// loader to read, so there is nothing to gain from a snapshot.
+void LoaderEnvironment::Refresh() {}
+
+std::string LoaderEnvironment::Get(const char* name) { return PlatformUtilsGetEnv(name); }
+
+std::string LoaderEnvironment::GetSecure(const char* name) { return PlatformUtilsGetSecureEnv(name); }
+
+bool LoaderEnvironment::IsSet(const char* name) { return PlatformUtilsGetEnvSet(name); }
+
+#endif  // XR_LOADER_ENVIRONMENT_SNAPSHOT
@@ -0,0 +1,26 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <string>
+
+// The environment variables the loader reads, such as XR_RUNTIME_JSON, XR_ENABLE_API_LAYERS, the XDG directories and the
+// enable_environment and disable_environment of every implicit API layer, are looked up in a snapshot of the environment
+// instead of searching the whole environment on every call.
+//
+// The snapshot is taken on first use and again by each call to Refresh, which the loader makes at the start of every
+// command that looks for runtime or API layer manifest files, so changes the application makes to the environment between
+// those commands are seen as before.  Platforms without a snapshot read the environment directly.
+class LoaderEnvironment {
+   public:
+    // Take a new snapshot of the environment.
+    static void Refresh();
+
+    // The same as PlatformUtilsGetEnv, PlatformUtilsGetSecureEnv and PlatformUtilsGetEnvSet, read from the snapshot.
+    static std::string Get(const char* name);
+    static std::string GetSecure(const char* name);
+    static bool IsSet(const char* name);
+};
@@ -0,0 +1,196 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "loader_epoch.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Epoch value of a thread that is not inside a pinned call.
+const uint64_t kUnpinned = 0;
+
+// Value of g_oldest_retired_epoch when no retired object is waiting to be deleted.  Lower than every pinned epoch.
+const uint64_t kNothingRetired = 0;
+
+// The epoch a thread is pinned at.  Records are never freed; the record of an exited thread is reused by a new one.
+struct EpochThreadRecord {
+    std::atomic<uint64_t> epoch{kUnpinned};
+    std::atomic<bool> in_use{true};
+    // Pin nesting depth, only touched by the owning thread.
+    uint32_t depth{0};
+    EpochThreadRecord* next{nullptr};
+};
+
+// Incremented by every retirement.  Starts above kUnpinned so that every pinned epoch is distinguishable from it.
+std::atomic<uint64_t> g_epoch{1};
+std::atomic<EpochThreadRecord*> g_thread_records{nullptr};
+thread_local EpochThreadRecord* g_this_thread_record = nullptr;
+// Epoch of the oldest retired object that is waiting to be deleted, or kNothingRetired.  A call pinned at this epoch or an
+// earlier one may be the last one holding it up, so it reclaims when it unpins.
+std::atomic<uint64_t> g_oldest_retired_epoch{kNothingRetired};
+// Set when a reclaim is wanted while another thread is running one, which then runs it.
+std::atomic<bool> g_reclaim_requested{false};
+// Set while the thread runs deleters, so that calls they make do not start a nested reclaim.
+thread_local bool g_this_thread_reclaiming = false;
+
+struct RetiredObject {
+    // Calls pinned at this epoch or earlier may still be using the object.
+    uint64_t epoch;
+    std::function<void()> deleter;
+};
+
+// Objects waiting to be deleted.  Never destroyed, so that threads still running during process exit can retire objects.
+struct RetiredObjects {
+    static RetiredObjects& Get() {
+        static RetiredObjects* retired_objects = new RetiredObjects();
+        return *retired_objects;
+    }
+
+    std::mutex mutex;
+    std::vector<RetiredObject> objects;
+    // Serializes reclaims, so deleters run in the order their objects were retired.  Only ever try-locked, so no thread
+    // waits for another's deleters.
+    std::mutex reclaim_mutex;
+};
+
+// Hands the record of a thread back for reuse when the thread exits.
+struct EpochThreadRecordRelease {
+    ~EpochThreadRecordRelease() {
+        if (record != nullptr) {
+            record->in_use.store(false, std::memory_order_release);
+        }
+    }
+    EpochThreadRecord* record{nullptr};
+};
+
+EpochThreadRecord* AcquireThreadRecord() {
+    EpochThreadRecord* record = nullptr;
+    for (EpochThreadRecord* unused = g_thread_records.load(std::memory_order_acquire); unused != nullptr; unused = unused->next) {
+        bool in_use = false;
+        if (!unused->in_use.load(std::memory_order_relaxed) &&
+            unused->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+            record = unused;
+            break;
+        }
+    }
+    if (record == nullptr) {
+        record = new EpochThreadRecord();
+        record->next = g_thread_records.load(std::memory_order_relaxed);
+        while (!g_thread_records.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {
+        }
+    }
+    static thread_local EpochThreadRecordRelease release;
+    release.record = record;
+    g_this_thread_record = record;
+    return record;
+}
+
+// Returns true if no thread is pinned at the epoch or an earlier one.
+bool PinnedCallsHaveReturned(uint64_t epoch) {
+    for (EpochThreadRecord* record = g_thread_records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+        uint64_t pinned = record->epoch.load(std::memory_order_acquire);
+        if (pinned != kUnpinned && pinned <= epoch) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Run the deleters of the objects no running call can still see, in the order they were retired.  Called with the reclaim
+// mutex held.
+void ReclaimUnusedObjects(RetiredObjects& retired_objects) {
+    std::vector<RetiredObject> objects;
+    {
+        std::lock_guard<std::mutex> lock(retired_objects.mutex);
+        objects.swap(retired_objects.objects);
+    }
+    // Pairs with the fence in Pin and the store in Unpin: a call this misses either cannot see the objects or checks
+    // g_oldest_retired_epoch after unpinning.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Objects are in retirement order, so once one is still in use every later one is kept too.
+    size_t reclaimed = 0;
+    g_this_thread_reclaiming = true;
+    while (reclaimed < objects.size() && PinnedCallsHaveReturned(objects[reclaimed].epoch)) {
+        objects[reclaimed].deleter();
+        ++reclaimed;
+    }
+    g_this_thread_reclaiming = false;
+
+    std::lock_guard<std::mutex> lock(retired_objects.mutex);
+    retired_objects.objects.insert(retired_objects.objects.begin(), std::make_move_iterator(objects.begin() + reclaimed),
+                                   std::make_move_iterator(objects.end()));
+    g_oldest_retired_epoch.store(retired_objects.objects.empty() ? kNothingRetired : retired_objects.objects.front().epoch,
+                                 std::memory_order_seq_cst);
+}
+
+// Reclaim on this thread, or leave it to the thread already reclaiming.
+void RequestReclaim() {
+    RetiredObjects& retired_objects = RetiredObjects::Get();
+    g_reclaim_requested.store(true, std::memory_order_seq_cst);
+    while (g_reclaim_requested.load(std::memory_order_seq_cst)) {
+        std::unique_lock<std::mutex> reclaim_lock(retired_objects.reclaim_mutex, std::try_to_lock);
+        if (!reclaim_lock.owns_lock()) {
+            // The thread holding the lock checks for the request after releasing it.
+            return;
+        }
+        g_reclaim_requested.store(false, std::memory_order_seq_cst);
+        ReclaimUnusedObjects(retired_objects);
+    }
+}
+
+}  // namespace
+
+void LoaderEpoch::Pin() {
+    EpochThreadRecord* record = g_this_thread_record;
+    if (record == nullptr) {
+        record = AcquireThreadRecord();
+    }
+    if (record->depth++ == 0) {
+        record->epoch.store(g_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        // Publish the pin before reading anything it protects.  Pairs with the fence in Reclaim: either Reclaim sees this
+        // pin, or this call sees every object retired before Reclaim started as already unreachable.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void LoaderEpoch::Unpin() {
+    EpochThreadRecord* record = g_this_thread_record;
+    if (--record->depth == 0) {
+        uint64_t pinned = record->epoch.load(std::memory_order_relaxed);
+        record->epoch.store(kUnpinned, std::memory_order_seq_cst);
+        // This call may have been the last one using a retired object.
+        if (pinned <= g_oldest_retired_epoch.load(std::memory_order_seq_cst) && !g_this_thread_reclaiming) {
+            RequestReclaim();
+        }
+    }
+}
+
+void LoaderEpoch::RetireDeleter(std::function<void()> deleter) {
+    RetiredObjects& retired_objects = RetiredObjects::Get();
+    std::lock_guard<std::mutex> lock(retired_objects.mutex);
+    // Calls that pin the incremented epoch start after the object became unreachable, so only earlier ones are waited for.
+    uint64_t epoch = g_epoch.fetch_add(1, std::memory_order_acq_rel);
+    if (g_oldest_retired_epoch.load(std::memory_order_relaxed) == kNothingRetired) {
+        g_oldest_retired_epoch.store(epoch, std::memory_order_seq_cst);
+    }
+    retired_objects.objects.push_back({epoch, std::move(deleter)});
+}
+
+void LoaderEpoch::Reclaim() {
+    EpochThreadRecord* this_thread_record = g_this_thread_record;
+    if ((this_thread_record != nullptr && this_thread_record->depth != 0) || g_this_thread_reclaiming) {
+        return;
+    }
+    RequestReclaim();
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+// Epoch-based reclamation for loader state that API calls read without taking a lock: LoaderInstance objects and their
+// API layer libraries, dispatch tables, the handle owner tables and the loaded runtime.
+//
+// A call that may read such state pins the current epoch with a LoaderEpochGuard for as long as it uses it.  Code that
+// removes an object from everything a new call could reach retires it instead of deleting it, and the retired object is
+// deleted once every call that was pinned when it was retired has returned.  Nothing waits for those calls: LoaderEpoch::Reclaim
+// deletes what it can right away, and the last of the calls still using an object deletes it when it unpins.
+class LoaderEpoch {
+   public:
+    // Pin and unpin the calling thread.  Pins nest, and only the outermost pin and unpin do any work.
+    static void Pin();
+    static void Unpin();
+
+    // Delete the object once no call that might still see it is running.  It must already be unreachable for new calls.
+    template <typename T>
+    static void Retire(std::unique_ptr<T> object) {
+        T* retired = object.release();
+        if (retired != nullptr) {
+            RetireDeleter([retired]() { delete retired; });
+        }
+    }
+
+    // Run, in the order they were retired, the deleters of the retired objects no running call can still see.  The rest, such
+    // as an instance a call blocked inside the runtime is using, are deleted by the thread whose call unpins last.  Never
+    // waits for other threads' calls, and does nothing when the calling thread is itself pinned.
+    static void Reclaim();
+
+   private:
+    static void RetireDeleter(std::function<void()> deleter);
+};
+
+// Pins the calling thread for the life of the scope.
+class LoaderEpochGuard {
+   public:
+    LoaderEpochGuard() { LoaderEpoch::Pin(); }
+    ~LoaderEpochGuard() { LoaderEpoch::Unpin(); }
+
+    LoaderEpochGuard(const LoaderEpochGuard&) = delete;
+    LoaderEpochGuard& operator=(const LoaderEpochGuard&) = delete;
+};
@@ -0,0 +1,25 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "loader_extension_set.hpp"
+
+#include <string>
+
+void LoaderExtensionSet::Add(const char* name) {
+    const LoaderExtensionId id = LoaderLookupExtensionId(name);
+    if (id == LoaderExtensionId::Unknown) {
+        _unknown.emplace(name);
+        return;
+    }
+    const auto index = static_cast<size_t>(id);
+    _known[index / kBitsPerWord] |= uint64_t{1} << (index % kBitsPerWord);
+}
+
+bool LoaderExtensionSet::Contains(LoaderExtensionId id, const char* name) const {
+    if (id != LoaderExtensionId::Unknown) {
+        return Contains(id);
+    }
+    return !_unknown.empty() && _unknown.count(name) != 0;
+}
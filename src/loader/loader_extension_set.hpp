@@ -0,0 +1,35 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include "xr_generated_loader_extensions.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+// A set of extension names.  Extensions in the registry the loader was built with are kept as one bit each, indexed by
+// LoaderExtensionId, so checking for one costs a single lookup of its name in a generated perfect hash table and a bit test.
+// Any other name, such as an extension newer than the loader, is kept in a hash set.
+class LoaderExtensionSet {
+   public:
+    void Add(const char* name);
+    bool Contains(const char* name) const { return Contains(LoaderLookupExtensionId(name), name); }
+    // For checking one name against several sets without looking it up each time: id must be LoaderLookupExtensionId(name).
+    bool Contains(LoaderExtensionId id, const char* name) const;
+    bool Contains(LoaderExtensionId id) const {
+        const auto index = static_cast<size_t>(id);
+        return id != LoaderExtensionId::Unknown && (_known[index / kBitsPerWord] & (uint64_t{1} << (index % kBitsPerWord))) != 0;
+    }
+
+   private:
+    static const size_t kBitsPerWord = 64;
+
+    std::array<uint64_t, (kLoaderExtensionIdCount + kBitsPerWord - 1) / kBitsPerWord> _known{};
+    std::unordered_set<std::string> _unknown;
+};
@@ -0,0 +1,184 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include "loader_epoch.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Extra data kept with each handle of a LoaderHandleMap that has none.
+struct LoaderHandleMapNoData {};
+
+// A map from non-null handles to pointer-sized values, for state that API calls look up on every call.  A handle may be
+// qualified by a kind, such as its object type, so that equal handles of different kinds are different keys.  Find takes no
+// lock and finishes in a bounded number of steps: it probes an open-addressed table that is kept at most half full.  A slot
+// is claimed for one key and keeps it for the life of the table, and a removed handle keeps its slot with a null value.  When
+// the table fills up it is rebuilt without the removed handles and the old one is retired through LoaderEpoch, so callers of
+// Find must be pinned.  Writers are serialized by a mutex, and only they see the Data stored with each handle.
+template <typename Value, typename Data = LoaderHandleMapNoData>
+class LoaderHandleMap {
+   public:
+    explicit LoaderHandleMap(size_t initial_capacity = kDefaultInitialCapacity)
+        : _initial_capacity(initial_capacity), _table(new Table(initial_capacity)) {}
+    ~LoaderHandleMap() { delete _table.load(std::memory_order_relaxed); }
+
+    LoaderHandleMap(const LoaderHandleMap&) = delete;
+    LoaderHandleMap& operator=(const LoaderHandleMap&) = delete;
+
+    // Returns a null value if the handle is not in the map.
+    Value Find(uint64_t handle, uint32_t kind = 0) const {
+        if (handle == 0) {
+            return Value{};
+        }
+        return _table.load(std::memory_order_acquire)->Find(handle, kind);
+    }
+
+    // Setting a null value removes the handle, and a non-null one also replaces its data.  Returns the value that was
+    // replaced, or a null value.
+    Value Exchange(uint64_t handle, Value value, uint32_t kind = 0, const Data& data = Data{}) {
+        if (handle == 0) {
+            return Value{};
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        Table* table = _table.load(std::memory_order_relaxed);
+        if (value != Value{} && (table->UsedSlots() + 1) * 2 > table->Capacity()) {
+            size_t live_entries = table->CopyLiveEntriesTo(nullptr);
+            size_t capacity = _initial_capacity;
+            while ((live_entries + 1) * 4 > capacity) {
+                capacity *= 2;
+            }
+            auto* rebuilt = new Table(capacity);
+            table->CopyLiveEntriesTo(rebuilt);
+            _table.store(rebuilt, std::memory_order_release);
+            LoaderEpoch::Retire(std::unique_ptr<Table>(table));
+            table = rebuilt;
+        }
+        return table->Exchange(handle, kind, value, data);
+    }
+
+    // Remove every handle for which predicate(handle, kind, value, data) returns true.
+    template <typename Predicate>
+    void RemoveIf(Predicate predicate) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _table.load(std::memory_order_relaxed)->RemoveIf(predicate);
+    }
+
+    // Remove every handle, passing each value removed to the function.
+    template <typename Function>
+    void Clear(Function function) {
+        RemoveIf([&](uint64_t, uint32_t, Value value, const Data&) {
+            function(value);
+            return true;
+        });
+    }
+
+   private:
+    class Table {
+       public:
+        explicit Table(size_t capacity) : _mask(capacity - 1), _slots(new Slot[capacity]()) {}
+
+        size_t Capacity() const { return _mask + 1; }
+        size_t UsedSlots() const { return _used_slots; }
+
+        Value Find(uint64_t handle, uint32_t kind) const {
+            for (size_t index = Hash(handle, kind) & _mask;; index = (index + 1) & _mask) {
+                const Slot& slot = _slots[index];
+                uint64_t slot_handle = slot.handle.load(std::memory_order_acquire);
+                if (slot_handle == 0) {
+                    return Value{};
+                }
+                if (slot_handle == handle && slot.kind.load(std::memory_order_relaxed) == kind) {
+                    return slot.value.load(std::memory_order_acquire);
+                }
+            }
+        }
+
+        // Adding a new handle claims an empty slot, which the caller must make sure exists.
+        Value Exchange(uint64_t handle, uint32_t kind, Value value, const Data& data) {
+            for (size_t index = Hash(handle, kind) & _mask;; index = (index + 1) & _mask) {
+                Slot& slot = _slots[index];
+                uint64_t slot_handle = slot.handle.load(std::memory_order_relaxed);
+                if (slot_handle == handle && slot.kind.load(std::memory_order_relaxed) == kind) {
+                    if (value != Value{}) {
+                        slot.data = data;
+                    }
+                    return slot.value.exchange(value, std::memory_order_acq_rel);
+                }
+                if (slot_handle == 0) {
+                    if (value != Value{}) {
+                        // Publish the handle last so a reader that finds it also sees the rest of the slot.
+                        slot.kind.store(kind, std::memory_order_relaxed);
+                        slot.value.store(value, std::memory_order_relaxed);
+                        slot.data = data;
+                        slot.handle.store(handle, std::memory_order_release);
+                        ++_used_slots;
+                    }
+                    return Value{};
+                }
+            }
+        }
+
+        // Copy the entries that still have a value into another table.
+        size_t CopyLiveEntriesTo(Table* table) const {
+            size_t live_entries = 0;
+            for (size_t index = 0; index <= _mask; ++index) {
+                const Slot& slot = _slots[index];
+                Value value = slot.value.load(std::memory_order_relaxed);
+                if (value != Value{}) {
+                    if (table != nullptr) {
+                        table->Exchange(slot.handle.load(std::memory_order_relaxed), slot.kind.load(std::memory_order_relaxed),
+                                        value, slot.data);
+                    }
+                    ++live_entries;
+                }
+            }
+            return live_entries;
+        }
+
+        template <typename Predicate>
+        void RemoveIf(Predicate& predicate) {
+            for (size_t index = 0; index <= _mask; ++index) {
+                Slot& slot = _slots[index];
+                Value value = slot.value.load(std::memory_order_relaxed);
+                if (value != Value{} && predicate(slot.handle.load(std::memory_order_relaxed),
+                                                  slot.kind.load(std::memory_order_relaxed), value, slot.data)) {
+                    slot.value.store(Value{}, std::memory_order_release);
+                }
+            }
+        }
+
+       private:
+        struct Slot {
+            std::atomic<uint64_t> handle;
+            std::atomic<uint32_t> kind;
+            std::atomic<Value> value;
+            Data data;
+        };
+
+        static size_t Hash(uint64_t handle, uint32_t kind) {
+            // Handles are frequently pointers or small counters, so mix the bits before masking.
+            uint64_t hash = handle ^ (static_cast<uint64_t>(kind) * 0x9E3779B97F4A7C15ULL);
+            hash ^= hash >> 33;
+            hash *= 0xFF51AFD7ED558CCDULL;
+            hash ^= hash >> 33;
+            return static_cast<size_t>(hash);
+        }
+
+        size_t _mask;
+        size_t _used_slots{0};
+        std::unique_ptr<Slot[]> _slots;
+    };
+
+    static const size_t kDefaultInitialCapacity = 16;
+
+    const size_t _initial_capacity;
+    std::mutex _mutex;
+    std::atomic<Table*> _table;
+};
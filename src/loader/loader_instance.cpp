@@ -15,14 +15,20 @@
 
 #include "api_layer_interface.hpp"
 #include "hex_and_handles.h"
+#include "loader_environment.hpp"
+#include "loader_epoch.hpp"
+#include "loader_handle_map.hpp"
 #include "loader_interfaces.h"
 #include "loader_logger.hpp"
+#include "loader_timing.hpp"
 #include "runtime_interface.hpp"
 #include "xr_generated_dispatch_table.h"
 #include "xr_generated_loader.hpp"
 
 #include <openxr/openxr.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <memory>
 #include <sstream>
@@ -31,36 +37,134 @@
 #include <vector>
 
 namespace {
-std::unique_ptr<LoaderInstance>& GetSetCurrentLoaderInstance() {
-    static std::unique_ptr<LoaderInstance> current_loader_instance;
-    return current_loader_instance;
-}
-}  // namespace
+// The handle a handle was created from, kept with it in the handle owner map.
+struct HandleParent {
+    XrObjectType parent_type{XR_OBJECT_TYPE_UNKNOWN};
+    uint64_t parent{0};
+};
 
-namespace ActiveLoaderInstance {
-XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name) {
-    if (GetSetCurrentLoaderInstance() != nullptr) {
-        LoaderLogger::LogErrorMessage(log_function_name, "Active XrInstance handle already exists");
-        return XR_ERROR_LIMIT_REACHED;
+class ActiveLoaderInstances {
+   public:
+    static ActiveLoaderInstances& Get() {
+        static ActiveLoaderInstances active_instances;
+        return active_instances;
     }
 
-    GetSetCurrentLoaderInstance() = std::move(loader_instance);
-    return XR_SUCCESS;
-}
+    void Add(std::unique_ptr<LoaderInstance> loader_instance) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        LoaderInstance* added = loader_instance.get();
+        _instances.push_back(std::move(loader_instance));
+        SetHandleOwnerLocked(XR_OBJECT_TYPE_INSTANCE, MakeHandleGeneric(added->GetInstanceHandle()), added);
+        UpdateOnlyInstanceLocked();
+    }
+
+    void Remove(LoaderInstance* loader_instance) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = std::find_if(_instances.begin(), _instances.end(),
+                               [&](const std::unique_ptr<LoaderInstance>& instance) { return instance.get() == loader_instance; });
+        if (it == _instances.end()) {
+            return;
+        }
+        // Make the instance unreachable before retiring it, since other threads may still be inside a call on it.
+        std::unique_ptr<LoaderInstance> removed = std::move(*it);
+        _instances.erase(it);
+        _handle_owners.RemoveIf(
+            [&](uint64_t, uint32_t, LoaderInstance* owner, const HandleParent&) { return owner == loader_instance; });
+        UpdateOnlyInstanceLocked();
+        LoaderEpoch::Retire(std::move(removed));
+    }
+
+    bool IsAvailable() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_instances.empty();
+    }
+
+    LoaderInstance* Find(XrObjectType handle_type, uint64_t handle) const {
+        LoaderInstance* owner = _handle_owners.Find(handle, static_cast<uint32_t>(handle_type));
+        if (owner == nullptr && handle_type != XR_OBJECT_TYPE_INSTANCE) {
+            // Every command that creates a handle goes through the loader, but an API layer may hand the application a
+            // handle it created itself.  Those are only usable while a single instance exists.
+            owner = _only_instance.load(std::memory_order_acquire);
+        }
+        return owner;
+    }
+
+    void SetHandleOwner(XrObjectType handle_type, uint64_t handle, LoaderInstance* owner, XrObjectType parent_type,
+                        uint64_t parent) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        SetHandleOwnerLocked(handle_type, handle, owner, parent_type, parent);
+    }
+
+    void RemoveHandleAndDescendants(XrObjectType handle_type, uint64_t handle) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _handle_owners.Exchange(handle, nullptr, static_cast<uint32_t>(handle_type));
+        // Destroying a handle implicitly destroys every handle created from it, directly or through other handles.
+        std::vector<HandleParent> parents{{handle_type, handle}};
+        while (!parents.empty()) {
+            const HandleParent removed = parents.back();
+            parents.pop_back();
+            _handle_owners.RemoveIf([&](uint64_t child, uint32_t child_type, LoaderInstance*, const HandleParent& parent) {
+                if (parent.parent != removed.parent || parent.parent_type != removed.parent_type) {
+                    return false;
+                }
+                parents.push_back({static_cast<XrObjectType>(child_type), child});
+                return true;
+            });
+        }
+    }
+
+   private:
+    // The handle owner map starts out larger than the default, since every session, space, swapchain and action set is in it.
+    static const size_t kInitialTableCapacity = 64;
+
+    ActiveLoaderInstances() : _handle_owners(kInitialTableCapacity) {}
+
+    void SetHandleOwnerLocked(XrObjectType handle_type, uint64_t handle, LoaderInstance* owner,
+                              XrObjectType parent_type = XR_OBJECT_TYPE_UNKNOWN, uint64_t parent = 0) {
+        _handle_owners.Exchange(handle, owner, static_cast<uint32_t>(handle_type), HandleParent{parent_type, parent});
+    }
+
+    void UpdateOnlyInstanceLocked() {
+        _only_instance.store(_instances.size() == 1 ? _instances.front().get() : nullptr, std::memory_order_release);
+    }
 
-XrResult Get(LoaderInstance** loader_instance, const char* log_function_name) {
-    *loader_instance = GetSetCurrentLoaderInstance().get();
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<LoaderInstance>> _instances;
+    // The LoaderInstance that owns each handle, keyed by the handle and its object type.
+    LoaderHandleMap<LoaderInstance*, HandleParent> _handle_owners;
+    std::atomic<LoaderInstance*> _only_instance{nullptr};
+};
+}  // namespace
+
+namespace ActiveLoaderInstance {
+void Add(std::unique_ptr<LoaderInstance> loader_instance) { ActiveLoaderInstances::Get().Add(std::move(loader_instance)); }
+
+XrResult Get(XrObjectType handle_type, uint64_t handle, LoaderInstance** loader_instance, const char* log_function_name) {
+    *loader_instance = ActiveLoaderInstances::Get().Find(handle_type, handle);
     if (*loader_instance == nullptr) {
-        LoaderLogger::LogErrorMessage(log_function_name, "No active XrInstance handle.");
+        LoaderLogger::LogErrorMessage(log_function_name, "No active XrInstance owns the handle " + Uint64ToHexString(handle));
         return XR_ERROR_HANDLE_INVALID;
     }
 
     return XR_SUCCESS;
 }
 
-bool IsAvailable() { return GetSetCurrentLoaderInstance() != nullptr; }
+bool IsAvailable() { return ActiveLoaderInstances::Get().IsAvailable(); }
+
+void AddHandle(XrObjectType handle_type, uint64_t handle, LoaderInstance* loader_instance, XrObjectType parent_type,
+               uint64_t parent) {
+    ActiveLoaderInstances::Get().SetHandleOwner(handle_type, handle, loader_instance, parent_type, parent);
+}
+
+void RemoveHandle(XrObjectType handle_type, uint64_t handle) {
+    ActiveLoaderInstances::Get().SetHandleOwner(handle_type, handle, nullptr, XR_OBJECT_TYPE_UNKNOWN, 0);
+}
+
+void RemoveHandleAndDescendants(XrObjectType handle_type, uint64_t handle) {
+    ActiveLoaderInstances::Get().RemoveHandleAndDescendants(handle_type, handle);
+}
 
-void Remove() { GetSetCurrentLoaderInstance().release(); }
+void Remove(LoaderInstance* loader_instance) { ActiveLoaderInstances::Get().Remove(loader_instance); }
 }  // namespace ActiveLoaderInstance
 
 // Extensions that are supported by the loader, but may not be supported
@@ -72,6 +176,8 @@ const std::array<XrExtensionProperties, 1>& LoaderInstance::LoaderSpecificExtens
 }
 
 namespace {
+const char* const kLazyDispatchEnvVar = "XR_LOADER_LAZY_DISPATCH";
+
 class InstanceCreateInfoManager {
    public:
     explicit InstanceCreateInfoManager(const XrInstanceCreateInfo* info) : original_create_info(info), modified_create_info(*info) {
@@ -135,6 +241,7 @@ class InstanceCreateInfoManager {
 
 // Factory method
 XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_proc_addr_term,
+                                        PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch_term,
                                         PFN_xrCreateInstance create_instance_term,
                                         PFN_xrCreateApiLayerInstance create_api_layer_instance_term,
                                         std::vector<std::unique_ptr<ApiLayerInterface>> api_layer_interfaces,
@@ -143,11 +250,20 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
 
     // Check the list of enabled extensions to make sure something supports them, and, if we do,
     // add it to the list of enabled extensions
+    // The caller holds the loader lock, which keeps the runtime loaded.
+    RuntimeInterface* runtime = RuntimeInterface::GetRuntime();
+    if (runtime == nullptr) {
+        LoaderLogger::LogErrorMessage("xrCreateInstance", "LoaderInstance::CreateInstance no runtime is loaded");
+        return XR_ERROR_RUNTIME_UNAVAILABLE;
+    }
+
     XrResult last_error = XR_SUCCESS;
     for (uint32_t ext = 0; ext < info->enabledExtensionCount; ++ext) {
         bool found = false;
+        // Look the name up once for all of the checks below.
+        const LoaderExtensionId ext_id = LoaderLookupExtensionId(info->enabledExtensionNames[ext]);
         // First check the runtime
-        if (RuntimeInterface::GetRuntime().SupportsExtension(info->enabledExtensionNames[ext])) {
+        if (runtime->SupportsExtension(ext_id, info->enabledExtensionNames[ext])) {
             found = true;
         }
         // Next check the loader
@@ -162,7 +278,7 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
         // Finally, check the enabled layers
         if (!found) {
             for (auto& layer_interface : api_layer_interfaces) {
-                if (layer_interface->SupportsExtension(info->enabledExtensionNames[ext])) {
+                if (layer_interface->SupportsExtension(ext_id, info->enabledExtensionNames[ext])) {
                     found = true;
                     break;
                 }
@@ -179,6 +295,7 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
 
     // Topmost means "closest to the application"
     PFN_xrGetInstanceProcAddr topmost_gipa = get_instance_proc_addr_term;
+    PFN_xrGetInstanceProcAddrBatch topmost_gipa_batch = get_instance_proc_addr_batch_term;
     XrInstance instance{XR_NULL_HANDLE};
 
     if (XR_SUCCEEDED(last_error)) {
@@ -189,7 +306,7 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
         if (info->enabledExtensionCount > 0) {
             std::vector<const char*> extensions_to_skip;
             for (const auto& ext : LoaderInstance::LoaderSpecificExtensions()) {
-                if (!RuntimeInterface::GetRuntime().SupportsExtension(ext.extensionName)) {
+                if (!runtime->SupportsExtension(LoaderLookupExtensionId(ext.extensionName), ext.extensionName)) {
                     extensions_to_skip.emplace_back(ext.extensionName);
                 }
             }
@@ -217,6 +334,7 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
                 // Collect current layer's function pointers
                 PFN_xrGetInstanceProcAddr cur_gipa_fp = (*layer_interface)->GetInstanceProcAddrFuncPointer();
                 PFN_xrCreateApiLayerInstance cur_cali_fp = (*layer_interface)->GetCreateApiLayerInstanceFuncPointer();
+                PFN_xrGetInstanceProcAddrBatch cur_gipa_batch_fp = (*layer_interface)->GetInstanceProcAddrBatchFuncPointer();
 
                 // Fill in layer info and link previous (lower) layer fxn pointers
                 strncpy(next_info_list[ni_index].layerName, (*layer_interface)->LayerName().c_str(),
@@ -225,11 +343,13 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
                 next_info_list[ni_index].next = topmost_nextinfo;
                 next_info_list[ni_index].nextGetInstanceProcAddr = topmost_gipa;
                 next_info_list[ni_index].nextCreateApiLayerInstance = topmost_cali_fp;
+                next_info_list[ni_index].nextGetInstanceProcAddrBatch = topmost_gipa_batch;
 
                 // Update saved pointers for next iteration
                 topmost_nextinfo = &next_info_list[ni_index];
                 topmost_gipa = cur_gipa_fp;
                 topmost_cali_fp = cur_cali_fp;
+                topmost_gipa_batch = cur_gipa_batch_fp;
                 ni_index--;
             }
 
@@ -243,7 +363,12 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
             api_layer_ci.nextInfo = next_info_list.get();
             //! @todo do we filter our create info extension list here?
             //! Think that actually each layer might need to filter...
-            last_error = topmost_cali_fp(modified_create_info, &api_layer_ci, &instance);
+            // The chain is called as the API layers set it up, whichever threads they call down on, so only the topmost API
+            // layer is timed here, and the runtime in RuntimeInterface::CreateInstance.
+            {
+                LoaderTimingSpan span("API layer xrCreateApiLayerInstance", api_layer_interfaces.front()->LayerName());
+                last_error = topmost_cali_fp(modified_create_info, &api_layer_ci, &instance);
+            }
 
         } else {
             // The loader's terminator is the topmost CreateInstance if there are no layers.
@@ -258,12 +383,14 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
     if (XR_SUCCEEDED(last_error)) {
         loader_instance->reset(new LoaderInstance(instance, info, topmost_gipa, std::move(api_layer_interfaces)));
 
-        std::ostringstream oss;
-        oss << "LoaderInstance::CreateInstance succeeded with ";
-        oss << (*loader_instance)->LayerInterfaces().size();
-        oss << " layers enabled and runtime interface - created instance = ";
-        oss << HandleToHexString((*loader_instance)->GetInstanceHandle());
-        LoaderLogger::LogInfoMessage("xrCreateInstance", oss.str());
+        if (LoaderLogger::IsMessageEnabled(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT)) {
+            std::ostringstream oss;
+            oss << "LoaderInstance::CreateInstance succeeded with ";
+            oss << (*loader_instance)->LayerInterfaces().size();
+            oss << " layers enabled and runtime interface - created instance = ";
+            oss << HandleToHexString((*loader_instance)->GetInstanceHandle());
+            LoaderLogger::LogInfoMessage("xrCreateInstance", oss.str());
+        }
     }
 
     return last_error;
@@ -273,17 +400,32 @@ XrResult LoaderInstance::GetInstanceProcAddr(const char* name, PFN_xrVoidFunctio
     return _topmost_gipa(_runtime_instance, name, function);
 }
 
+PFN_xrVoidFunction LoaderInstance::ResolveDispatchTableEntry(const char* name) {
+    PFN_xrVoidFunction function = nullptr;
+    if (XR_FAILED(_topmost_gipa(_runtime_instance, name, &function))) {
+        return nullptr;
+    }
+    return function;
+}
+
 LoaderInstance::LoaderInstance(XrInstance instance, const XrInstanceCreateInfo* create_info, PFN_xrGetInstanceProcAddr topmost_gipa,
                                std::vector<std::unique_ptr<ApiLayerInterface>> api_layer_interfaces)
     : _runtime_instance(instance),
       _topmost_gipa(topmost_gipa),
       _api_layer_interfaces(std::move(api_layer_interfaces)),
-      _dispatch_table(new XrGeneratedDispatchTable{}) {
+      _dispatch_table(new XrGeneratedDispatchTable{}),
+      _lazy_dispatch_table(new LoaderLazyDispatchTable{}) {
     for (uint32_t ext = 0; ext < create_info->enabledExtensionCount; ++ext) {
-        _enabled_extensions.push_back(create_info->enabledExtensionNames[ext]);
+        _enabled_extensions.Add(create_info->enabledExtensionNames[ext]);
     }
 
-    GeneratedXrPopulateDispatchTable(_dispatch_table.get(), instance, topmost_gipa);
+    // With XR_LOADER_LAZY_DISPATCH=1, most entries are only resolved when they are first called, on the thread that calls
+    // them, so creating an instance does not walk every command.  Otherwise they are all resolved here, as API layers and
+    // runtimes may expect.
+    LoaderGeneratedPopulateLazyDispatchTable(_lazy_dispatch_table.get(), _dispatch_table.get(), instance, topmost_gipa);
+    if (LoaderEnvironment::GetSecure(kLazyDispatchEnvVar) != "1") {
+        LoaderGeneratedResolveLazyDispatchTable(_lazy_dispatch_table.get(), instance, topmost_gipa);
+    }
 }
 
 LoaderInstance::~LoaderInstance() {
@@ -293,11 +435,3 @@ LoaderInstance::~LoaderInstance() {
     LoaderLogger::LogInfoMessage("xrDestroyInstance", oss.str());
 }
 
-bool LoaderInstance::ExtensionIsEnabled(const std::string& extension) {
-    for (std::string& cur_enabled : _enabled_extensions) {
-        if (cur_enabled == extension) {
-            return true;
-        }
-    }
-    return false;
-}
@@ -10,12 +10,14 @@
 #pragma once
 
 #include "extra_algorithms.h"
+#include "loader_extension_set.hpp"
 #include "loader_interfaces.h"
 
 #include <openxr/openxr.h>
 
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -24,28 +26,46 @@
 
 class ApiLayerInterface;
 struct XrGeneratedDispatchTable;
+struct LoaderLazyDispatchTable;
 class LoaderInstance;
 
-// Manage the single loader instance that is available.
+// Manage the loader instances that are alive, and which of them owns each handle created through the loader.
 namespace ActiveLoaderInstance {
-// Set the active loader instance. This will fail if there is already an active loader instance.
-XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name);
+// Take ownership of a newly created loader instance and record that it owns its XrInstance handle.
+void Add(std::unique_ptr<LoaderInstance> loader_instance);
 
-// Returns true if there is an active loader instance.
+// Returns true if there is at least one active loader instance.
 bool IsAvailable();
 
-// Get the active LoaderInstance.
-XrResult Get(LoaderInstance** loader_instance, const char* log_function_name);
+// Get the LoaderInstance that owns a handle.  Every command that creates or destroys a handle goes through the loader,
+// extension commands included, since xrGetInstanceProcAddr returns the loader's trampoline for them.  Handles the loader
+// still did not see being created, such as one an API layer made itself, belong to the only active instance if there is
+// exactly one.  The instance is only guaranteed to stay alive while the caller holds a LoaderEpochGuard or the global
+// loader mutex.
+XrResult Get(XrObjectType handle_type, uint64_t handle, LoaderInstance** loader_instance, const char* log_function_name);
 
-// Destroy the currently active LoaderInstance if there is one. This will make the loader able to create a new XrInstance if needed.
-void Remove();
+// Record that a handle created through a loader instance from the parent handle belongs to it.
+void AddHandle(XrObjectType handle_type, uint64_t handle, LoaderInstance* loader_instance, XrObjectType parent_type,
+               uint64_t parent);
+
+// Forget a handle that has been destroyed.
+void RemoveHandle(XrObjectType handle_type, uint64_t handle);
+
+// Forget a handle that has been destroyed, and every handle created from it, which were destroyed with it.
+void RemoveHandleAndDescendants(XrObjectType handle_type, uint64_t handle);
+
+// Forget a loader instance and every handle that belongs to it.  The instance is retired, and freed by
+// LoaderEpoch::Reclaim once no call is using it.
+void Remove(LoaderInstance* loader_instance);
 };  // namespace ActiveLoaderInstance
 
 // Manages information needed by the loader for an XrInstance, such as what extensions are available and the dispatch table.
 class LoaderInstance {
    public:
     // Factory method
-    static XrResult CreateInstance(PFN_xrGetInstanceProcAddr get_instance_proc_addr_term, PFN_xrCreateInstance create_instance_term,
+    static XrResult CreateInstance(PFN_xrGetInstanceProcAddr get_instance_proc_addr_term,
+                                   PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch_term,
+                                   PFN_xrCreateInstance create_instance_term,
                                    PFN_xrCreateApiLayerInstance create_api_layer_instance_term,
                                    std::vector<std::unique_ptr<ApiLayerInterface>> layer_interfaces,
                                    const XrInstanceCreateInfo* createInfo, std::unique_ptr<LoaderInstance>* loader_instance);
@@ -55,11 +75,15 @@ class LoaderInstance {
 
     XrInstance GetInstanceHandle() { return _runtime_instance; }
     const std::unique_ptr<XrGeneratedDispatchTable>& DispatchTable() { return _dispatch_table; }
+    LoaderLazyDispatchTable* LazyDispatchTable() { return _lazy_dispatch_table.get(); }
     std::vector<std::unique_ptr<ApiLayerInterface>>& LayerInterfaces() { return _api_layer_interfaces; }
-    bool ExtensionIsEnabled(const std::string& extension);
+    bool ExtensionIsEnabled(LoaderExtensionId extension) const { return _enabled_extensions.Contains(extension); }
     XrDebugUtilsMessengerEXT DefaultDebugUtilsMessenger() { return _messenger; }
     void SetDefaultDebugUtilsMessenger(XrDebugUtilsMessengerEXT messenger) { _messenger = messenger; }
     XrResult GetInstanceProcAddr(const char* name, PFN_xrVoidFunction* function);
+    // Resolve a lazily populated dispatch table entry through the topmost xrGetInstanceProcAddr.  Returns nullptr if the
+    // command is not available.
+    PFN_xrVoidFunction ResolveDispatchTableEntry(const char* name);
 
    private:
     LoaderInstance(XrInstance instance, const XrInstanceCreateInfo* createInfo, PFN_xrGetInstanceProcAddr topmost_gipa,
@@ -68,10 +92,11 @@ class LoaderInstance {
    private:
     XrInstance _runtime_instance{XR_NULL_HANDLE};
     PFN_xrGetInstanceProcAddr _topmost_gipa{nullptr};
-    std::vector<std::string> _enabled_extensions;
+    LoaderExtensionSet _enabled_extensions;
     std::vector<std::unique_ptr<ApiLayerInterface>> _api_layer_interfaces;
 
     std::unique_ptr<XrGeneratedDispatchTable> _dispatch_table;
+    std::unique_ptr<LoaderLazyDispatchTable> _lazy_dispatch_table;
     // Internal debug messenger created during xrCreateInstance
     XrDebugUtilsMessengerEXT _messenger{XR_NULL_HANDLE};
 };
@@ -11,6 +11,7 @@
 
 #include "extra_algorithms.h"
 #include "hex_and_handles.h"
+#include "loader_environment.hpp"
 #include "loader_logger_recorders.hpp"
 #include "platform_utils.hpp"
 
@@ -32,6 +33,35 @@ bool LoaderLogRecorder::LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT
     return false;
 }
 
+namespace {
+// The capture holding back the messages of this thread, if any.
+thread_local LoaderLogCapture* t_log_capture = nullptr;
+}  // namespace
+
+void LoaderLogCapture::Start() {
+    _outer = t_log_capture;
+    t_log_capture = this;
+    _active = true;
+}
+
+void LoaderLogCapture::Stop() {
+    if (_active) {
+        t_log_capture = _outer;
+        _outer = nullptr;
+        _active = false;
+    }
+}
+
+bool LoaderLogCapture::Replay(const std::string& command_name) {
+    bool exit_app = false;
+    for (const Message& message : _messages) {
+        exit_app |= LoaderLogger::GetInstance().LogMessage(message.severity, message.type, message.message_id, command_name,
+                                                           message.message, message.objects);
+    }
+    _messages.clear();
+    return exit_app;
+}
+
 // Utility functions for converting to/from XR_EXT_debug_utils values
 
 XrLoaderLogMessageSeverityFlags DebugUtilsSeveritiesToLoaderLogMessageSeverities(
@@ -99,7 +129,7 @@ XrDebugUtilsMessageTypeFlagsEXT LoaderLogMessageTypesToDebugUtilsMessageTypes(Xr
 }
 
 LoaderLogger::LoaderLogger() {
-    std::string debug_string = PlatformUtilsGetEnv("XR_LOADER_DEBUG");
+    std::string debug_string = LoaderEnvironment::Get("XR_LOADER_DEBUG");
 
     // Add an error logger by default so that we at least get errors out to std::cerr.
     // Normally we enable stderr output. But if the XR_LOADER_DEBUG environment variable is
@@ -119,7 +149,11 @@ LoaderLogger::LoaderLogger() {
 
     // If the environment variable to enable loader debugging is set, then enable the
     // appropriate logging out to std::cout.
-    if (!debug_string.empty()) {
+    if (debug_string == "timing") {
+        // Only the startup timing summaries, which are logged as performance information.
+        AddLogRecorder(MakeStdOutLoaderLogRecorder(nullptr, XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT,
+                                                   XR_LOADER_LOG_MESSAGE_TYPE_PERFORMANCE_BIT));
+    } else if (!debug_string.empty()) {
         XrLoaderLogMessageSeverityFlags debug_flags = {};
         if (debug_string == "error") {
             debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT;
@@ -132,19 +166,21 @@ LoaderLogger::LoaderLogger() {
             debug_flags = XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT |
                           XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT | XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT;
         }
-        AddLogRecorder(MakeStdOutLoaderLogRecorder(nullptr, debug_flags));
+        AddLogRecorder(MakeStdOutLoaderLogRecorder(nullptr, debug_flags, XR_LOADER_LOG_MESSAGE_TYPE_DEFAULT_BITS));
     }
 }
 
 void LoaderLogger::AddLogRecorder(std::unique_ptr<LoaderLogRecorder>&& recorder) {
     std::unique_lock<std::shared_timed_mutex> lock(_mutex);
     _recorders.push_back(std::move(recorder));
+    UpdateEnabledMessageMasks();
 }
 
 void LoaderLogger::AddLogRecorderForXrInstance(XrInstance instance, std::unique_ptr<LoaderLogRecorder>&& recorder) {
     std::unique_lock<std::shared_timed_mutex> lock(_mutex);
     _recordersByInstance[instance].insert(recorder->UniqueId());
     _recorders.emplace_back(std::move(recorder));
+    UpdateEnabledMessageMasks();
 }
 
 void LoaderLogger::RemoveLogRecorder(uint64_t unique_id) {
@@ -157,6 +193,7 @@ void LoaderLogger::RemoveLogRecorder(uint64_t unique_id) {
             messengersForInstance.erase(unique_id);
         }
     }
+    UpdateEnabledMessageMasks();
 }
 
 void LoaderLogger::RemoveLogRecordersForXrInstance(XrInstance instance) {
@@ -167,16 +204,37 @@ void LoaderLogger::RemoveLogRecordersForXrInstance(XrInstance instance) {
             return recorders.find(recorder->UniqueId()) != recorders.end();
         });
         _recordersByInstance.erase(instance);
+        UpdateEnabledMessageMasks();
+    }
+}
+
+void LoaderLogger::UpdateEnabledMessageMasks() {
+    XrLoaderLogMessageSeverityFlags severities = 0;
+    XrLoaderLogMessageTypeFlags types = 0;
+    for (const std::unique_ptr<LoaderLogRecorder>& recorder : _recorders) {
+        severities |= recorder->MessageSeverities();
+        types |= recorder->MessageTypes();
     }
+    _enabled_severities.store(severities, std::memory_order_relaxed);
+    _enabled_types.store(types, std::memory_order_relaxed);
 }
 
 bool LoaderLogger::LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
-                              const std::string& message_id, const std::string& command_name, const std::string& message,
+                              const char* message_id, const char* command_name, const char* message,
                               const std::vector<XrSdkLogObjectInfo>& objects) {
+    // Drop messages no recorder would accept before doing any work.
+    if (!IsMessageEnabled(message_severity, message_type)) {
+        return false;
+    }
+    if (t_log_capture != nullptr) {
+        t_log_capture->_messages.push_back({message_severity, message_type, message_id, message, objects});
+        return false;
+    }
+
     XrLoaderLogMessengerCallbackData callback_data = {};
-    callback_data.message_id = message_id.c_str();
-    callback_data.command_name = command_name.c_str();
-    callback_data.message = message.c_str();
+    callback_data.message_id = message_id;
+    callback_data.command_name = command_name;
+    callback_data.message = message;
 
     auto names_and_labels = data_.PopulateNamesAndLabels(objects);
     callback_data.objects = names_and_labels.sdk_objects.empty() ? nullptr : names_and_labels.sdk_objects.data();
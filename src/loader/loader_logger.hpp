@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -109,6 +110,45 @@ class LoaderLogRecorder {
     XrLoaderLogMessageTypeFlags _message_types;
 };
 
+// Holds back the messages logged on one thread between Start and Stop, so that they can be logged later on behalf of
+// another command.  Used for work done ahead of time on a background thread.
+class LoaderLogCapture {
+   public:
+    LoaderLogCapture() = default;
+    ~LoaderLogCapture() { Stop(); }
+
+    // Start holding back the messages logged on the calling thread.  Captures started while another one is active on the
+    // thread nest, and a message goes to the innermost one.
+    void Start();
+    // Stop holding back messages, handing the thread back to the capture active before Start.  Must be called on the thread
+    // that called Start, in the reverse order of the Start calls.
+    void Stop();
+    // Forget the messages held so far.
+    void Clear() { _messages.clear(); }
+    // Log the held messages, as if command_name had logged them, and forget them.  Must not be called while capturing.
+    bool Replay(const std::string& command_name);
+
+    // Non-copyable
+    LoaderLogCapture(const LoaderLogCapture&) = delete;
+    LoaderLogCapture& operator=(const LoaderLogCapture&) = delete;
+
+   private:
+    friend class LoaderLogger;
+
+    struct Message {
+        XrLoaderLogMessageSeverityFlagBits severity;
+        XrLoaderLogMessageTypeFlags type;
+        std::string message_id;
+        std::string message;
+        std::vector<XrSdkLogObjectInfo> objects;
+    };
+
+    bool _active{false};
+    // The capture that was active on the thread when this one was started.
+    LoaderLogCapture* _outer{nullptr};
+    std::vector<Message> _messages;
+};
+
 class LoaderLogger {
    public:
     static LoaderLogger& GetInstance() {
@@ -129,39 +169,79 @@ class LoaderLogger {
     void InsertLabel(XrSession session, const XrDebugUtilsLabelEXT* label_info);
     void DeleteSessionLabels(XrSession session);
 
+    //! Returns true if at least one recorder may accept a message of this severity and type.  This only reads an
+    //! atomic summary of the recorders, so callers can use it to skip building expensive messages.
+    static bool IsMessageEnabled(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type) {
+        const LoaderLogger& logger = GetInstance();
+        return (logger._enabled_severities.load(std::memory_order_relaxed) & message_severity) == message_severity &&
+               (logger._enabled_types.load(std::memory_order_relaxed) & message_type) == message_type;
+    }
+
     bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
-                    const std::string& message_id, const std::string& command_name, const std::string& message,
+                    const char* message_id, const char* command_name, const char* message,
                     const std::vector<XrSdkLogObjectInfo>& objects = {});
-    static bool LogErrorMessage(const std::string& command_name, const std::string& message,
+    bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
+                    const std::string& message_id, const std::string& command_name, const std::string& message,
+                    const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogMessage(message_severity, message_type, message_id.c_str(), command_name.c_str(), message.c_str(), objects);
+    }
+
+    // The const char* overloads let string literals reach the severity check without constructing a std::string,
+    // so disabled messages cost no allocation and no lock.
+    static bool LogErrorMessage(const char* command_name, const char* message,
                                 const std::vector<XrSdkLogObjectInfo>& objects = {}) {
         return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
                                         "OpenXR-Loader", command_name, message, objects);
     }
-    static bool LogWarningMessage(const std::string& command_name, const std::string& message,
+    static bool LogErrorMessage(const std::string& command_name, const std::string& message,
+                                const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogErrorMessage(command_name.c_str(), message.c_str(), objects);
+    }
+    static bool LogWarningMessage(const char* command_name, const char* message,
                                   const std::vector<XrSdkLogObjectInfo>& objects = {}) {
         return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
                                         "OpenXR-Loader", command_name, message, objects);
     }
-    static bool LogInfoMessage(const std::string& command_name, const std::string& message,
+    static bool LogWarningMessage(const std::string& command_name, const std::string& message,
+                                  const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogWarningMessage(command_name.c_str(), message.c_str(), objects);
+    }
+    static bool LogInfoMessage(const char* command_name, const char* message,
                                const std::vector<XrSdkLogObjectInfo>& objects = {}) {
         return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
                                         "OpenXR-Loader", command_name, message, objects);
     }
-    static bool LogVerboseMessage(const std::string& command_name, const std::string& message,
+    static bool LogInfoMessage(const std::string& command_name, const std::string& message,
+                               const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogInfoMessage(command_name.c_str(), message.c_str(), objects);
+    }
+    static bool LogVerboseMessage(const char* command_name, const char* message,
                                   const std::vector<XrSdkLogObjectInfo>& objects = {}) {
         return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_VERBOSE_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT,
                                         "OpenXR-Loader", command_name, message, objects);
     }
-    static bool LogValidationErrorMessage(const std::string& vuid, const std::string& command_name, const std::string& message,
+    static bool LogVerboseMessage(const std::string& command_name, const std::string& message,
+                                  const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogVerboseMessage(command_name.c_str(), message.c_str(), objects);
+    }
+    static bool LogValidationErrorMessage(const char* vuid, const char* command_name, const char* message,
                                           const std::vector<XrSdkLogObjectInfo>& objects = {}) {
         return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_ERROR_BIT, XR_LOADER_LOG_MESSAGE_TYPE_SPECIFICATION_BIT,
                                         vuid, command_name, message, objects);
     }
-    static bool LogValidationWarningMessage(const std::string& vuid, const std::string& command_name, const std::string& message,
+    static bool LogValidationErrorMessage(const std::string& vuid, const std::string& command_name, const std::string& message,
+                                          const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogValidationErrorMessage(vuid.c_str(), command_name.c_str(), message.c_str(), objects);
+    }
+    static bool LogValidationWarningMessage(const char* vuid, const char* command_name, const char* message,
                                             const std::vector<XrSdkLogObjectInfo>& objects = {}) {
         return GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_WARNING_BIT, XR_LOADER_LOG_MESSAGE_TYPE_SPECIFICATION_BIT,
                                         vuid, command_name, message, objects);
     }
+    static bool LogValidationWarningMessage(const std::string& vuid, const std::string& command_name, const std::string& message,
+                                            const std::vector<XrSdkLogObjectInfo>& objects = {}) {
+        return LogValidationWarningMessage(vuid.c_str(), command_name.c_str(), message.c_str(), objects);
+    }
 
     // Extension-specific logging functions
     bool LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT message_severity, XrDebugUtilsMessageTypeFlagsEXT message_type,
@@ -174,8 +254,15 @@ class LoaderLogger {
    private:
     LoaderLogger();
 
+    // Must be called with _mutex held exclusively whenever _recorders changes.
+    void UpdateEnabledMessageMasks();
+
     std::shared_timed_mutex _mutex;
 
+    // Union of the severities and types accepted by all recorders, used to reject messages without locking.
+    std::atomic<XrLoaderLogMessageSeverityFlags> _enabled_severities{0};
+    std::atomic<XrLoaderLogMessageTypeFlags> _enabled_types{0};
+
     // List of *all* available recorder objects (including created specifically for an Instance)
     std::vector<std::unique_ptr<LoaderLogRecorder>> _recorders;
 
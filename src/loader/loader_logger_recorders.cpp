@@ -15,6 +15,7 @@
 #include <openxr/openxr.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -72,13 +73,16 @@ void OutputMessageToStream(std::ostream& os, XrLoaderLogMessageSeverityFlagBits
 // With std::cout: Standard Output logger used with XR_LOADER_DEBUG
 class OstreamLoaderLogRecorder : public LoaderLogRecorder {
    public:
-    OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags);
+    OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                             XrLoaderLogMessageTypeFlags types = XR_LOADER_LOG_MESSAGE_TYPE_DEFAULT_BITS);
 
     bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
                     const XrLoaderLogMessengerCallbackData* callback_data) override;
 
    private:
     std::ostream& os_;
+    // Messages can be logged from several threads at once, and the stream may not be thread-safe.
+    std::mutex os_mutex_;
 };
 
 // Debug Utils logger used with XR_EXT_debug_utils
@@ -119,8 +123,9 @@ class DebuggerLoaderLogRecorder : public LoaderLogRecorder {
 #endif
 
 // Unified stdout/stderr logger
-OstreamLoaderLogRecorder::OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags)
-    : LoaderLogRecorder(XR_LOADER_LOG_STDOUT, user_data, flags, 0xFFFFFFFFUL), os_(os) {
+OstreamLoaderLogRecorder::OstreamLoaderLogRecorder(std::ostream& os, void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                   XrLoaderLogMessageTypeFlags types)
+    : LoaderLogRecorder(XR_LOADER_LOG_STDOUT, user_data, flags, types), os_(os) {
     // Automatically start
     Start();
 }
@@ -129,6 +134,7 @@ bool OstreamLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits mes
                                           XrLoaderLogMessageTypeFlags message_type,
                                           const XrLoaderLogMessengerCallbackData* callback_data) {
     if (_active && 0 != (_message_severities & message_severity) && 0 != (_message_types & message_type)) {
+        std::lock_guard<std::mutex> lock(os_mutex_);
         OutputMessageToStream(os_, message_severity, message_type, callback_data);
     }
 
@@ -259,8 +265,9 @@ bool DebuggerLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits me
 #endif
 }  // namespace
 
-std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags) {
-    std::unique_ptr<LoaderLogRecorder> recorder(new OstreamLoaderLogRecorder(std::cout, user_data, flags));
+std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                               XrLoaderLogMessageTypeFlags types) {
+    std::unique_ptr<LoaderLogRecorder> recorder(new OstreamLoaderLogRecorder(std::cout, user_data, flags, types));
     return recorder;
 }
 
@@ -19,7 +19,8 @@
 std::unique_ptr<LoaderLogRecorder> MakeStdErrLoaderLogRecorder(void* user_data);
 
 //! Standard Output logger used with XR_LOADER_DEBUG environment variable.
-std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags);
+std::unique_ptr<LoaderLogRecorder> MakeStdOutLoaderLogRecorder(void* user_data, XrLoaderLogMessageSeverityFlags flags,
+                                                               XrLoaderLogMessageTypeFlags types);
 
 #ifdef __ANDROID__
 //! Android liblog ("logcat") logger
@@ -0,0 +1,79 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Call work(index) once for every index below count, spread over thread_count threads including the calling thread, and
+// return once all of them are done.  Indices are handed out in increasing order, but may finish in any order.  With
+// thread_count of one or less everything runs on the calling thread, and if no extra thread can be started the calling
+// thread picks up all remaining work.  The first exception thrown by work stops further work from being handed out and is
+// rethrown here once every thread has finished.
+template <typename Work>
+void LoaderParallelFor(size_t count, size_t thread_count, Work &&work) {
+    if (thread_count > count) {
+        thread_count = count;
+    }
+    if (thread_count <= 1) {
+        for (size_t index = 0; index < count; ++index) {
+            work(index);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index{0};
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+    std::mutex exception_mutex;
+    std::exception_ptr exception;
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+    auto worker = [&]() {
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+        try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+            for (size_t index = next_index++; index < count; index = next_index++) {
+                work(index);
+            }
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+        } catch (...) {
+            // Stop handing out work, and rethrow the first exception on the calling thread.
+            next_index = count;
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+        }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+    try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+        while (threads.size() < thread_count - 1) {
+            threads.emplace_back(worker);
+        }
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+    } catch (const std::system_error &) {
+        // Carry on with the threads that did start.
+    }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+}
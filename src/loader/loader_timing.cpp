@@ -0,0 +1,112 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "loader_timing.hpp"
+
+#include "loader_environment.hpp"
+#include "loader_logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+// The report collecting on this thread, if any.
+thread_local LoaderTimingReport* t_timing_report = nullptr;
+
+double Milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+}  // namespace
+
+void LoaderTimingReport::Start() {
+    if (t_timing_report != nullptr) {
+        return;
+    }
+    // Nothing is timed unless the summary would be logged somewhere.
+    if (!LoaderLogger::IsMessageEnabled(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_PERFORMANCE_BIT) ||
+        LoaderEnvironment::Get("XR_LOADER_DEBUG") != "timing") {
+        return;
+    }
+    t_timing_report = this;
+    _active = true;
+    _started = true;
+    _start = std::chrono::steady_clock::now();
+}
+
+void LoaderTimingReport::Stop() {
+    if (_active) {
+        t_timing_report = nullptr;
+        _active = false;
+    }
+}
+
+void LoaderTimingReport::Clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _spans.clear();
+}
+
+void LoaderTimingReport::MoveToCurrent() {
+    std::vector<Span> spans;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        spans.swap(_spans);
+    }
+    LoaderTimingReport* current = t_timing_report;
+    if (current == nullptr || current == this) {
+        return;
+    }
+    for (Span& span : spans) {
+        current->Add(span.phase, std::move(span.detail), span.start, span.end);
+    }
+}
+
+void LoaderTimingReport::Log(const char* command_name) {
+    if (!_started) {
+        return;
+    }
+    _started = false;
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    std::vector<Span> spans;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        spans.swap(_spans);
+    }
+    // Spans from other threads, and from work done ahead of time, are added as they end, so put them back in order.
+    std::stable_sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.start < b.start; });
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3);
+    summary << "Startup timing, " << Milliseconds(end - _start) << " ms in total.  Each span is listed with its start "
+            << "relative to the command, then its duration:";
+    for (const Span& span : spans) {
+        summary << "\n    " << std::showpos << Milliseconds(span.start - _start) << std::noshowpos << " ms  "
+                << Milliseconds(span.end - span.start) << " ms  " << span.phase;
+        if (!span.detail.empty()) {
+            summary << ": " << span.detail;
+        }
+    }
+    LoaderLogger::GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_PERFORMANCE_BIT,
+                                           "OpenXR-Loader", command_name, summary.str().c_str());
+}
+
+LoaderTimingReport* LoaderTimingReport::Current() { return t_timing_report; }
+
+void LoaderTimingReport::Add(const char* phase, std::string detail, std::chrono::steady_clock::time_point start,
+                             std::chrono::steady_clock::time_point end) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _spans.push_back({phase, std::move(detail), start, end});
+}
+
+LoaderTimingThreadScope::LoaderTimingThreadScope(LoaderTimingReport* report) : _previous(t_timing_report) {
+    t_timing_report = report;
+}
+
+LoaderTimingThreadScope::~LoaderTimingThreadScope() { t_timing_report = _previous; }
@@ -0,0 +1,135 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Timing of the phases of loader startup: finding and parsing manifest files, opening and negotiating with API layer and
+// runtime libraries, and creating the instance through the API layers and the runtime.  When XR_LOADER_DEBUG is set to
+// "timing", the commands that do this work log a summary of the spans timed while they ran as a performance message.
+//
+// Spans go to the report collecting on the thread that times them.  With no report collecting, which is always the case
+// when timing is not enabled, a span only checks for one.
+class LoaderTimingReport {
+   public:
+    LoaderTimingReport() = default;
+    ~LoaderTimingReport() { Stop(); }
+
+    // Start collecting the spans timed on the calling thread, if timing is enabled and no report is collecting on the thread
+    // already.
+    void Start();
+    // Stop collecting.  Must be called on the thread that called Start.
+    void Stop();
+    // Forget the spans collected so far.
+    void Clear();
+    // Add the spans collected so far to the report collecting on the calling thread, if any, and forget them.  Used for work
+    // done ahead of time on a background thread.  Must not be called while collecting.
+    void MoveToCurrent();
+    // Log a summary of the spans collected since Start, as if command_name had logged it, and forget them.  Logs nothing if
+    // this report never collected.
+    void Log(const char* command_name);
+
+    // The report collecting on the calling thread, or nullptr.
+    static LoaderTimingReport* Current();
+
+    // Spans may be added from several threads at once.
+    void Add(const char* phase, std::string detail, std::chrono::steady_clock::time_point start,
+             std::chrono::steady_clock::time_point end);
+
+    // Non-copyable
+    LoaderTimingReport(const LoaderTimingReport&) = delete;
+    LoaderTimingReport& operator=(const LoaderTimingReport&) = delete;
+
+   private:
+    struct Span {
+        const char* phase;
+        std::string detail;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+
+    bool _active{false};
+    bool _started{false};
+    std::chrono::steady_clock::time_point _start;
+    std::mutex _mutex;
+    std::vector<Span> _spans;
+};
+
+// Collects the spans timed while an API command runs, and logs them as the command's summary when the scope ends.
+class LoaderTimingCommandScope {
+   public:
+    explicit LoaderTimingCommandScope(const char* command_name) : _command_name(command_name) { _report.Start(); }
+    ~LoaderTimingCommandScope() {
+        _report.Stop();
+        _report.Log(_command_name);
+    }
+
+    LoaderTimingCommandScope(const LoaderTimingCommandScope&) = delete;
+    LoaderTimingCommandScope& operator=(const LoaderTimingCommandScope&) = delete;
+
+   private:
+    const char* _command_name;
+    LoaderTimingReport _report;
+};
+
+// Sends the spans timed on the calling thread to report, which may be nullptr, for the life of the scope.  Used for work
+// that a thread collecting a report hands to other threads.
+class LoaderTimingThreadScope {
+   public:
+    explicit LoaderTimingThreadScope(LoaderTimingReport* report);
+    ~LoaderTimingThreadScope();
+
+    LoaderTimingThreadScope(const LoaderTimingThreadScope&) = delete;
+    LoaderTimingThreadScope& operator=(const LoaderTimingThreadScope&) = delete;
+
+   private:
+    LoaderTimingReport* _previous;
+};
+
+// Times the enclosing scope, or until End, as one span of phase, a string literal, with detail naming what the phase worked
+// on.  Details that take work to build should only be built and set when the span is Active.
+class LoaderTimingSpan {
+   public:
+    explicit LoaderTimingSpan(const char* phase) : _phase(phase), _report(LoaderTimingReport::Current()) {
+        if (_report != nullptr) {
+            _start = std::chrono::steady_clock::now();
+        }
+    }
+    LoaderTimingSpan(const char* phase, const char* detail) : LoaderTimingSpan(phase) {
+        if (_report != nullptr) {
+            _detail = detail;
+        }
+    }
+    LoaderTimingSpan(const char* phase, const std::string& detail) : LoaderTimingSpan(phase) {
+        if (_report != nullptr) {
+            _detail = detail;
+        }
+    }
+    ~LoaderTimingSpan() { End(); }
+
+    bool Active() const { return _report != nullptr; }
+    void SetDetail(std::string detail) { _detail = std::move(detail); }
+
+    void End() {
+        if (_report != nullptr) {
+            _report->Add(_phase, std::move(_detail), _start, std::chrono::steady_clock::now());
+            _report = nullptr;
+        }
+    }
+
+    LoaderTimingSpan(const LoaderTimingSpan&) = delete;
+    LoaderTimingSpan& operator=(const LoaderTimingSpan&) = delete;
+
+   private:
+    const char* _phase;
+    LoaderTimingReport* _report;
+    std::string _detail;
+    std::chrono::steady_clock::time_point _start;
+};
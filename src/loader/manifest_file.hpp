@@ -11,6 +11,7 @@
 
 #include <openxr/openxr.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -20,6 +21,11 @@ namespace Json {
 class Value;
 }
 
+struct ManifestFileCacheStats;
+struct FileSysUtilsFileStatus;
+class ManifestCacheRecordWriter;
+class ManifestCacheRecordReader;
+
 enum ManifestFileType {
     MANIFEST_TYPE_UNDEFINED = 0,
     MANIFEST_TYPE_RUNTIME,
@@ -42,8 +48,7 @@ struct ExtensionListing {
 // Base class responsible for finding and parsing manifest files.
 class ManifestFile {
    public:
-    // Non-copyable
-    ManifestFile(const ManifestFile &) = delete;
+    // Non-assignable, and only copied out of the manifest file cache
     ManifestFile &operator=(const ManifestFile &) = delete;
 
     ManifestFileType Type() const { return _type; }
@@ -51,16 +56,24 @@ class ManifestFile {
     const std::string &LibraryPath() const { return _library_path; }
     void GetInstanceExtensionProperties(std::vector<XrExtensionProperties> &props);
     const std::string &GetFunctionName(const std::string &func_name) const;
+    // Identifies this reading of the manifest file.  Copies taken from the manifest file cache share it, and it changes
+    // whenever the file is read again, so equal IDs mean equal contents.
+    uint64_t ParseId() const { return _parse_id; }
 
    protected:
     ManifestFile(ManifestFileType type, const std::string &filename, const std::string &library_path);
+    ManifestFile(const ManifestFile &) = default;
     void ParseCommon(Json::Value const &root_node);
+    // Save and restore the fields set by ParseCommon in a persistent manifest cache record.
+    void WriteCommon(ManifestCacheRecordWriter &writer) const;
+    bool ReadCommon(ManifestCacheRecordReader &reader);
     static bool IsValidJson(const Json::Value &root, JsonVersion &version);
 
    private:
     std::string _filename;
     ManifestFileType _type;
     std::string _library_path;
+    uint64_t _parse_id;
     std::vector<ExtensionListing> _instance_extensions;
     std::unordered_map<std::string, std::string> _functions_renamed;
 };
@@ -72,11 +85,21 @@ class RuntimeManifestFile : public ManifestFile {
     // Factory method
     static XrResult FindManifestFiles(std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files);
 
+    // True if the manifest declares that its "instance_extensions" are all of the runtime's instance extensions, so they can
+    // be listed without loading the runtime.
+    bool InstanceExtensionsComplete() const { return _instance_extensions_complete; }
+
    private:
     RuntimeManifestFile(const std::string &filename, const std::string &library_path);
-    static void CreateIfValid(const std::string &filename, std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files);
+    RuntimeManifestFile(const RuntimeManifestFile &) = default;
+    static void CreateIfValid(const std::string &filename, std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files,
+                              ManifestFileCacheStats &cache_stats);
     static void CreateIfValid(const Json::Value &root_node, const std::string &filename,
                               std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files);
+    std::string CacheRecord() const;
+    static std::unique_ptr<RuntimeManifestFile> FromCacheRecord(const std::string &filename, ManifestCacheRecordReader &reader);
+
+    bool _instance_extensions_complete{false};
 };
 
 // ApiLayerManifestFile class -
@@ -93,11 +116,29 @@ class ApiLayerManifestFile : public ManifestFile {
     ApiLayerManifestFile(ManifestFileType type, const std::string &filename, const std::string &layer_name,
                          const std::string &description, const JsonVersion &api_version, const uint32_t &implementation_version,
                          const std::string &library_path);
-    static void CreateIfValid(ManifestFileType type, const std::string &filename,
-                              std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files);
+    ApiLayerManifestFile(const ApiLayerManifestFile &) = default;
+    // Find a manifest file parsed before, in this process or an earlier one.  found_status is the status of the file read while
+    // searching for it, or null to read it here; status is set to the one used, and cacheable to whether it could be read.
+    static std::shared_ptr<const ApiLayerManifestFile> FindCached(ManifestFileType type, const std::string &filename,
+                                                                  const FileSysUtilsFileStatus *found_status,
+                                                                  FileSysUtilsFileStatus &status, bool &cacheable,
+                                                                  ManifestFileCacheStats &cache_stats);
+    // Parse a manifest file FindCached did not find, and cache it if cacheable.  Returns null if it is not valid.
+    static std::shared_ptr<const ApiLayerManifestFile> ParseAndCache(ManifestFileType type, const std::string &filename,
+                                                                     const FileSysUtilsFileStatus &status, bool cacheable);
+    // Add a copy of the manifest file to manifest_files, unless it is an implicit layer that is disabled.
+    static void AddIfEnabled(const ApiLayerManifestFile &manifest, std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files);
+    static std::unique_ptr<ApiLayerManifestFile> Parse(ManifestFileType type, const std::string &filename);
+    std::string CacheRecord() const;
+    static std::unique_ptr<ApiLayerManifestFile> FromCacheRecord(ManifestFileType type, const std::string &filename,
+                                                                 ManifestCacheRecordReader &reader);
+    // Implicit layers are enabled or disabled by environment variables, which are checked each time the layer is found.
+    bool IsEnabled() const;
 
     JsonVersion _api_version;
     std::string _layer_name;
     std::string _description;
     uint32_t _implementation_version;
+    std::string _enable_environment;
+    std::string _disable_environment;
 };
@@ -0,0 +1,410 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "manifest_json_reader.hpp"
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace {
+
+// Deeper documents are left to jsoncpp.
+const uint32_t kMaxDepth = 64;
+
+// Integers with more digits than this might not fit in a 64-bit integer, and are left to jsoncpp.
+const uint32_t kMaxIntegerDigits = 18;
+
+// Which members of an object are kept depends on where the object is in the manifest.
+enum class ManifestNode {
+    // The root object
+    Root,
+    // The "runtime" or "api_layer" object
+    Section,
+    // The "instance_extensions" array of a section
+    ExtensionList,
+    // An entry of the "instance_extensions" array
+    Extension,
+    // Any other value that is kept, which is kept completely
+    Kept,
+};
+
+// Returns true if the member is kept, and the kind of node its value is.
+bool KeepMember(ManifestNode parent, const char *name, size_t length, ManifestNode &child) {
+    auto is = [name, length](const char *expected) { return length == strlen(expected) && memcmp(name, expected, length) == 0; };
+    switch (parent) {
+        case ManifestNode::Root:
+            if (is("runtime") || is("api_layer")) {
+                child = ManifestNode::Section;
+                return true;
+            }
+            child = ManifestNode::Kept;
+            return is("file_format_version");
+        case ManifestNode::Section:
+            if (is("instance_extensions")) {
+                child = ManifestNode::ExtensionList;
+                return true;
+            }
+            child = ManifestNode::Kept;
+            return is("library_path") || is("name") || is("api_version") || is("implementation_version") || is("description") ||
+                   is("enable_environment") || is("disable_environment") || is("functions") ||
+                   is("instance_extensions_complete");
+        case ManifestNode::Extension:
+            child = ManifestNode::Kept;
+            return is("name") || is("extension_version");
+        default:
+            child = ManifestNode::Kept;
+            return true;
+    }
+}
+
+// Recursive descent over the JSON text.  Every read function returns false as soon as the text is not plain JSON, and a
+// null value pointer means the value is checked and skipped rather than stored.
+class ManifestJsonReader {
+   public:
+    ManifestJsonReader(const char *begin, const char *end) : _current(begin), _end(end) {}
+
+    bool ReadDocument(Json::Value &root) {
+        // jsoncpp skips a UTF-8 byte order mark too.
+        if (_end - _current >= 3 && memcmp(_current, "\xEF\xBB\xBF", 3) == 0) {
+            _current += 3;
+        }
+        SkipWhitespace();
+        if (_current == _end || *_current != '{' || !ReadValue(ManifestNode::Root, &root, 0)) {
+            return false;
+        }
+        SkipWhitespace();
+        return _current == _end;
+    }
+
+   private:
+    void SkipWhitespace() {
+        while (_current != _end && (*_current == ' ' || *_current == '\t' || *_current == '\n' || *_current == '\r')) {
+            ++_current;
+        }
+    }
+
+    bool Consume(char expected) {
+        SkipWhitespace();
+        if (_current == _end || *_current != expected) {
+            return false;
+        }
+        ++_current;
+        return true;
+    }
+
+    bool ReadValue(ManifestNode node, Json::Value *value, uint32_t depth) {
+        SkipWhitespace();
+        if (_current == _end || depth > kMaxDepth) {
+            return false;
+        }
+        switch (*_current) {
+            case '{':
+                return ReadObject(node, value, depth);
+            case '[':
+                return ReadArray(node, value, depth);
+            case '"':
+                return ReadStringValue(value);
+            case 't':
+                return ReadLiteral("true", Json::Value(true), value);
+            case 'f':
+                return ReadLiteral("false", Json::Value(false), value);
+            case 'n':
+                return ReadLiteral("null", Json::Value(), value);
+            default:
+                return ReadNumber(value);
+        }
+    }
+
+    bool ReadObject(ManifestNode node, Json::Value *value, uint32_t depth) {
+        ++_current;
+        if (value != nullptr) {
+            *value = Json::Value(Json::objectValue);
+        }
+        SkipWhitespace();
+        if (_current != _end && *_current == '}') {
+            ++_current;
+            return true;
+        }
+        for (;;) {
+            SkipWhitespace();
+            if (_current == _end || *_current != '"') {
+                return false;
+            }
+            // Member names are matched in place.  An escaped name might still decode to one of the kept names, so it is left
+            // to jsoncpp rather than decoded here.
+            const char *name_begin = nullptr;
+            const char *name_end = nullptr;
+            bool escaped = false;
+            if (!ScanString(name_begin, name_end, escaped) || (escaped && value != nullptr) || !Consume(':')) {
+                return false;
+            }
+            ManifestNode child = ManifestNode::Kept;
+            const size_t name_length = static_cast<size_t>(name_end - name_begin);
+            Json::Value *member = nullptr;
+            if (value != nullptr && KeepMember(node, name_begin, name_length, child)) {
+                member = &(*value)[std::string(name_begin, name_length)];
+            }
+            if (!ReadValue(child, member, depth + 1)) {
+                return false;
+            }
+            SkipWhitespace();
+            if (_current == _end) {
+                return false;
+            }
+            if (*_current == '}') {
+                ++_current;
+                return true;
+            }
+            if (*_current != ',') {
+                return false;
+            }
+            ++_current;
+        }
+    }
+
+    bool ReadArray(ManifestNode node, Json::Value *value, uint32_t depth) {
+        ++_current;
+        const ManifestNode element = node == ManifestNode::ExtensionList ? ManifestNode::Extension : ManifestNode::Kept;
+        if (value != nullptr) {
+            *value = Json::Value(Json::arrayValue);
+        }
+        SkipWhitespace();
+        if (_current != _end && *_current == ']') {
+            ++_current;
+            return true;
+        }
+        for (Json::ArrayIndex index = 0;; ++index) {
+            if (!ReadValue(element, value != nullptr ? &(*value)[index] : nullptr, depth + 1)) {
+                return false;
+            }
+            SkipWhitespace();
+            if (_current == _end) {
+                return false;
+            }
+            if (*_current == ']') {
+                ++_current;
+                return true;
+            }
+            if (*_current != ',') {
+                return false;
+            }
+            ++_current;
+        }
+    }
+
+    bool ReadLiteral(const char *literal, Json::Value literal_value, Json::Value *value) {
+        const size_t length = strlen(literal);
+        if (static_cast<size_t>(_end - _current) < length || memcmp(_current, literal, length) != 0) {
+            return false;
+        }
+        _current += length;
+        if (value != nullptr) {
+            *value = std::move(literal_value);
+        }
+        return true;
+    }
+
+    bool ReadNumber(Json::Value *value) {
+        const bool negative = _current != _end && *_current == '-';
+        if (negative) {
+            ++_current;
+        }
+        const char *digits_begin = _current;
+        while (_current != _end && *_current >= '0' && *_current <= '9') {
+            ++_current;
+        }
+        const size_t digit_count = static_cast<size_t>(_current - digits_begin);
+        if (digit_count == 0 || digit_count > kMaxIntegerDigits || (digit_count > 1 && *digits_begin == '0')) {
+            return false;
+        }
+        const bool has_fraction = _current != _end && *_current == '.';
+        if (has_fraction) {
+            ++_current;
+            const char *fraction_begin = _current;
+            while (_current != _end && *_current >= '0' && *_current <= '9') {
+                ++_current;
+            }
+            if (_current == fraction_begin) {
+                return false;
+            }
+        }
+        if (_current != _end && (*_current == 'e' || *_current == 'E')) {
+            return false;
+        }
+        if (value == nullptr) {
+            return true;
+        }
+        // Decoding fractions the same way as jsoncpp is left to jsoncpp.
+        if (has_fraction) {
+            return false;
+        }
+        Json::Value::LargestInt integer = 0;
+        for (const char *digit = digits_begin; digit != _current; ++digit) {
+            integer = integer * 10 + (*digit - '0');
+        }
+        *value = Json::Value(negative ? -integer : integer);
+        return true;
+    }
+
+    // Append the UTF-8 encoding of a code point.
+    static void AppendUtf8(uint32_t code_point, std::string &out) {
+        if (code_point < 0x80) {
+            out += static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+            out += static_cast<char>(0xC0 | (code_point >> 6));
+            out += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            out += static_cast<char>(0xE0 | (code_point >> 12));
+            out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code_point >> 18));
+            out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+    }
+
+    bool ReadHex4(uint32_t &code_unit) {
+        if (_end - _current < 4) {
+            return false;
+        }
+        code_unit = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = *_current++;
+            code_unit <<= 4;
+            if (c >= '0' && c <= '9') {
+                code_unit |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code_unit |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code_unit |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Check the string starting at the current opening quote and return the text between its quotes.
+    bool ScanString(const char *&contents_begin, const char *&contents_end, bool &escaped) {
+        contents_begin = _current + 1;
+        if (!DecodeString(nullptr)) {
+            return false;
+        }
+        contents_end = _current - 1;
+        escaped = memchr(contents_begin, '\\', static_cast<size_t>(contents_end - contents_begin)) != nullptr;
+        return true;
+    }
+
+    bool ReadStringValue(Json::Value *value) {
+        const char *quote = _current;
+        const char *contents_begin = nullptr;
+        const char *contents_end = nullptr;
+        bool escaped = false;
+        if (!ScanString(contents_begin, contents_end, escaped)) {
+            return false;
+        }
+        if (value == nullptr) {
+            return true;
+        }
+        if (!escaped) {
+            *value = Json::Value(contents_begin, contents_end);
+            return true;
+        }
+        std::string decoded;
+        _current = quote;
+        DecodeString(&decoded);
+        *value = Json::Value(decoded);
+        return true;
+    }
+
+    // Read a string starting at its opening quote.  The string is decoded into out unless it is null.
+    bool DecodeString(std::string *out) {
+        ++_current;
+        for (;;) {
+            const char *run_begin = _current;
+            while (_current != _end && *_current != '"' && *_current != '\\' && static_cast<unsigned char>(*_current) >= 0x20) {
+                ++_current;
+            }
+            if (out != nullptr) {
+                out->append(run_begin, _current);
+            }
+            if (_current == _end || static_cast<unsigned char>(*_current) < 0x20) {
+                return false;
+            }
+            if (*_current++ == '"') {
+                return true;
+            }
+            if (_current == _end) {
+                return false;
+            }
+            const char escape = *_current++;
+            char decoded = 0;
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    decoded = escape;
+                    break;
+                case 'b':
+                    decoded = '\b';
+                    break;
+                case 'f':
+                    decoded = '\f';
+                    break;
+                case 'n':
+                    decoded = '\n';
+                    break;
+                case 'r':
+                    decoded = '\r';
+                    break;
+                case 't':
+                    decoded = '\t';
+                    break;
+                case 'u': {
+                    uint32_t code_point = 0;
+                    if (!ReadHex4(code_point) || (code_point >= 0xDC00 && code_point <= 0xDFFF)) {
+                        return false;
+                    }
+                    if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                        uint32_t low_surrogate = 0;
+                        if (_end - _current < 2 || _current[0] != '\\' || _current[1] != 'u') {
+                            return false;
+                        }
+                        _current += 2;
+                        if (!ReadHex4(low_surrogate) || low_surrogate < 0xDC00 || low_surrogate > 0xDFFF) {
+                            return false;
+                        }
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                    }
+                    if (out != nullptr) {
+                        AppendUtf8(code_point, *out);
+                    }
+                    continue;
+                }
+                default:
+                    return false;
+            }
+            if (out != nullptr) {
+                *out += decoded;
+            }
+        }
+    }
+
+    const char *_current;
+    const char *_end;
+};
+
+}  // namespace
+
+bool ReadManifestJson(const char *begin, const char *end, Json::Value &root) {
+    ManifestJsonReader reader(begin, end);
+    return reader.ReadDocument(root);
+}
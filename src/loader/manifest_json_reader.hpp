@@ -0,0 +1,23 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace Json {
+class Value;
+}
+
+// Read the JSON text of a runtime or API layer manifest file into root, keeping only the members the loader looks at:
+// "file_format_version", and within "runtime" and "api_layer" the library path, name, versions, description, environment
+// variables, "functions", "instance_extensions_complete" and the name and version of each of the "instance_extensions".
+// Other members are checked for valid syntax and skipped without being stored.
+//
+// Only plain JSON whose root is an object is read.  Returns false for anything else, including comments, trailing commas,
+// numbers with exponents or more digits than a 64-bit integer safely holds, and lone UTF-16 surrogates.  jsoncpp may still
+// accept such a file, so the caller parses it with jsoncpp instead, which also provides the error message for a file that is
+// not valid.  For text this function accepts, root matches the jsoncpp result for every member that is kept.
+bool ReadManifestJson(const char *begin, const char *end, Json::Value &root);
@@ -0,0 +1,351 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#include "persistent_manifest_cache.hpp"
+
+#include "filesystem_utils.hpp"
+#include "loader_environment.hpp"
+#include "loader_logger.hpp"
+#include "platform_utils.hpp"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#if defined(XR_OS_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // defined(XR_OS_LINUX)
+
+void ManifestCacheRecordWriter::WriteUint32(uint32_t value) { _data.append(reinterpret_cast<const char *>(&value), sizeof(value)); }
+
+void ManifestCacheRecordWriter::WriteString(const std::string &value) {
+    WriteUint32(static_cast<uint32_t>(value.size()));
+    _data.append(value);
+}
+
+bool ManifestCacheRecordReader::ReadUint32(uint32_t &value) {
+    if (_size - _offset < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, _data + _offset, sizeof(value));
+    _offset += sizeof(value);
+    return true;
+}
+
+bool ManifestCacheRecordReader::ReadString(std::string &value) {
+    ManifestCacheRecordReader record;
+    if (!ReadRecord(record)) {
+        return false;
+    }
+    value.assign(record._data, record._size);
+    return true;
+}
+
+bool ManifestCacheRecordReader::ReadRecord(ManifestCacheRecordReader &record) {
+    uint32_t length = 0;
+    if (!ReadUint32(length) || _size - _offset < length) {
+        return false;
+    }
+    record = ManifestCacheRecordReader(_data + _offset, length);
+    _offset += length;
+    return true;
+}
+
+#if defined(XR_OS_LINUX)
+
+namespace {
+
+const char *const kManifestCacheEnvVar = "XR_LOADER_MANIFEST_CACHE";
+
+// Changed whenever the layout of the file or of a record changes, so that files written by other loader versions are ignored.
+const uint32_t kManifestCacheFormatVersion = 2;
+const char kManifestCacheMagic[8] = {'X', 'R', 'M', 'F', 'C', 'A', 'C', 'H'};
+// Read back as a different value by a loader with the other byte order.
+const uint32_t kManifestCacheByteOrder = 0x01020304;
+
+// File layout: the header, then entry_count entries.  Each entry is its size, then the type, status and filename of the
+// manifest file it was parsed from, then the record written by the manifest file class.
+struct ManifestCacheHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+using ManifestCacheKey = std::pair<uint32_t, std::string>;
+
+struct MappedEntry {
+    FileSysUtilsFileStatus status;
+    ManifestCacheRecordReader record;
+};
+
+struct PendingEntry {
+    FileSysUtilsFileStatus status;
+    std::string record;
+};
+
+// Never destroyed, and the cache files are never unmapped, so that records handed out stay valid until process exit.
+struct ManifestCacheState {
+    static ManifestCacheState &Get() {
+        static ManifestCacheState *state = new ManifestCacheState();
+        return *state;
+    }
+
+    std::mutex mutex;
+    // The cache file the entries below belong to.
+    std::string filename;
+    std::map<ManifestCacheKey, MappedEntry> mapped_entries;
+    std::map<ManifestCacheKey, PendingEntry> pending_entries;
+    bool dirty{false};
+};
+
+// $XDG_CACHE_HOME, or its default of $HOME/.cache.  Empty if neither is set.
+std::string GetCacheHome() {
+    std::string cache_home = LoaderEnvironment::GetSecure("XDG_CACHE_HOME");
+    if (cache_home.empty()) {
+        cache_home = LoaderEnvironment::GetSecure("HOME");
+        if (!cache_home.empty()) {
+            cache_home += "/.cache";
+        }
+    }
+    return cache_home;
+}
+
+void WriteStatus(ManifestCacheRecordWriter &writer, const FileSysUtilsFileStatus &status) {
+    const uint64_t values[4] = {status.device, status.inode, status.size, static_cast<uint64_t>(status.modified_time)};
+    for (uint64_t value : values) {
+        writer.WriteUint32(static_cast<uint32_t>(value));
+        writer.WriteUint32(static_cast<uint32_t>(value >> 32));
+    }
+}
+
+bool ReadStatus(ManifestCacheRecordReader &reader, FileSysUtilsFileStatus &status) {
+    uint64_t values[4];
+    for (uint64_t &value : values) {
+        uint32_t low = 0;
+        uint32_t high = 0;
+        if (!reader.ReadUint32(low) || !reader.ReadUint32(high)) {
+            return false;
+        }
+        value = (static_cast<uint64_t>(high) << 32) | low;
+    }
+    status.device = values[0];
+    status.inode = values[1];
+    status.size = values[2];
+    status.modified_time = static_cast<int64_t>(values[3]);
+    return true;
+}
+
+// Index the entries of a mapped cache file.  Returns false if any part of the file is invalid.
+bool ReadCacheFile(const char *data, size_t size, std::map<ManifestCacheKey, MappedEntry> &entries) {
+    ManifestCacheHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kManifestCacheMagic, sizeof(header.magic)) != 0 ||
+        header.format_version != kManifestCacheFormatVersion || header.byte_order != kManifestCacheByteOrder) {
+        return false;
+    }
+
+    ManifestCacheRecordReader file_reader(data + sizeof(header), size - sizeof(header));
+    for (uint32_t entry = 0; entry < header.entry_count; ++entry) {
+        ManifestCacheRecordReader entry_reader;
+        uint32_t type = 0;
+        std::string filename;
+        MappedEntry mapped_entry;
+        if (!file_reader.ReadRecord(entry_reader) || !entry_reader.ReadUint32(type) ||
+            !ReadStatus(entry_reader, mapped_entry.status) || !entry_reader.ReadString(filename) ||
+            !entry_reader.ReadRecord(mapped_entry.record) || !entry_reader.AtEnd()) {
+            return false;
+        }
+        entries[ManifestCacheKey(type, filename)] = mapped_entry;
+    }
+    return file_reader.AtEnd();
+}
+
+// Map the cache file and index its entries.  A file that is not owned by this user, is writable by anyone else, or is not
+// entirely valid is ignored.
+void LoadCacheFile(ManifestCacheState &state) {
+    int fd = open(state.filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_uid != geteuid() ||
+        (file_stat.st_mode & (S_IWGRP | S_IWOTH)) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        LoaderLogger::LogInfoMessage("", "PersistentManifestCache - ignoring unusable cache file " + state.filename);
+        return;
+    }
+    const size_t file_size = static_cast<size_t>(file_stat.st_size);
+    void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+
+    std::map<ManifestCacheKey, MappedEntry> entries;
+    if (!ReadCacheFile(static_cast<const char *>(mapping), file_size, entries)) {
+        munmap(mapping, file_size);
+        LoaderLogger::LogInfoMessage("", "PersistentManifestCache - ignoring invalid cache file " + state.filename);
+        return;
+    }
+    LoaderLogger::LogInfoMessage(
+        "", "PersistentManifestCache - loaded " + std::to_string(entries.size()) + " manifest files from " + state.filename);
+    state.mapped_entries.swap(entries);
+}
+
+// Make sure the state belongs to the cache file for the current environment.  Returns false if there is none.
+bool SelectCacheFile(ManifestCacheState &state) {
+    std::string cache_home = GetCacheHome();
+    if (cache_home.empty()) {
+        return false;
+    }
+    std::string filename = cache_home + "/openxr/manifest_cache.bin";
+    if (filename != state.filename) {
+        // Records of the previous file stay mapped, since they may still be in use.
+        state.filename = filename;
+        state.mapped_entries.clear();
+        state.pending_entries.clear();
+        state.dirty = false;
+        LoadCacheFile(state);
+    }
+    return true;
+}
+
+// Create a directory if it does not exist yet.
+bool MakeDirectory(const std::string &path) { return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST; }
+
+bool WriteFileContents(const std::string &filename, const std::string &contents) {
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t result = write(fd, contents.data() + written, contents.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return close(fd) == 0;
+}
+
+}  // namespace
+
+bool PersistentManifestCache::IsEnabled() { return LoaderEnvironment::GetSecure(kManifestCacheEnvVar) == "1"; }
+
+bool PersistentManifestCache::Find(ManifestFileType type, const std::string &filename, const FileSysUtilsFileStatus &status,
+                                   ManifestCacheRecordReader &record) {
+    if (!IsEnabled()) {
+        return false;
+    }
+    ManifestCacheState &state = ManifestCacheState::Get();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!SelectCacheFile(state)) {
+        return false;
+    }
+    auto found = state.mapped_entries.find(ManifestCacheKey(static_cast<uint32_t>(type), filename));
+    if (found == state.mapped_entries.end() || found->second.status != status) {
+        return false;
+    }
+    record = found->second.record;
+    return true;
+}
+
+void PersistentManifestCache::Store(ManifestFileType type, const std::string &filename, const FileSysUtilsFileStatus &status,
+                                    const std::string &record) {
+    if (!IsEnabled()) {
+        return;
+    }
+    ManifestCacheState &state = ManifestCacheState::Get();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!SelectCacheFile(state)) {
+        return;
+    }
+    state.pending_entries[ManifestCacheKey(static_cast<uint32_t>(type), filename)] = PendingEntry{status, record};
+    state.dirty = true;
+}
+
+void PersistentManifestCache::Flush() {
+    if (!IsEnabled()) {
+        return;
+    }
+    ManifestCacheState &state = ManifestCacheState::Get();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.dirty) {
+        return;
+    }
+    state.dirty = false;
+
+    // Keep the records of the previous file whose manifest files are unchanged, unless this process parsed them again.
+    std::map<ManifestCacheKey, PendingEntry> entries = state.pending_entries;
+    for (const auto &mapped_entry : state.mapped_entries) {
+        FileSysUtilsFileStatus status;
+        if (entries.count(mapped_entry.first) == 0 && FileSysUtilsGetFileStatus(mapped_entry.first.second, status) &&
+            status == mapped_entry.second.status) {
+            const ManifestCacheRecordReader &record = mapped_entry.second.record;
+            entries[mapped_entry.first] = PendingEntry{status, std::string(record.Data(), record.Size())};
+        }
+    }
+
+    ManifestCacheHeader header = {};
+    memcpy(header.magic, kManifestCacheMagic, sizeof(header.magic));
+    header.format_version = kManifestCacheFormatVersion;
+    header.byte_order = kManifestCacheByteOrder;
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    std::string contents(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &entry : entries) {
+        ManifestCacheRecordWriter entry_writer;
+        entry_writer.WriteUint32(entry.first.first);
+        WriteStatus(entry_writer, entry.second.status);
+        entry_writer.WriteString(entry.first.second);
+        entry_writer.WriteString(entry.second.record);
+        ManifestCacheRecordWriter file_writer;
+        file_writer.WriteString(entry_writer.Data());
+        contents += file_writer.Data();
+    }
+
+    // Write a private temporary file and rename it over the cache, so other processes only ever see a complete file.
+    std::string directory;
+    std::string temporary_filename = state.filename + "." + std::to_string(getpid()) + ".tmp";
+    if (!FileSysUtilsGetParentPath(state.filename, directory) || !MakeDirectory(GetCacheHome()) || !MakeDirectory(directory) ||
+        !WriteFileContents(temporary_filename, contents) || rename(temporary_filename.c_str(), state.filename.c_str()) != 0) {
+        unlink(temporary_filename.c_str());
+        LoaderLogger::LogWarningMessage("", "PersistentManifestCache - failed to write cache file " + state.filename);
+        return;
+    }
+    LoaderLogger::LogInfoMessage(
+        "", "PersistentManifestCache - wrote " + std::to_string(entries.size()) + " manifest files to " + state.filename);
+}
+
+#else  // !defined(XR_OS_LINUX)
+
+bool PersistentManifestCache::IsEnabled() { return false; }
+
+bool PersistentManifestCache::Find(ManifestFileType /* type */, const std::string & /* filename */,
+                                   const FileSysUtilsFileStatus & /* status */, ManifestCacheRecordReader & /* record */) {
+    return false;
+}
+
+void PersistentManifestCache::Store(ManifestFileType /* type */, const std::string & /* filename */,
+                                    const FileSysUtilsFileStatus & /* status */, const std::string & /* record */) {}
+
+void PersistentManifestCache::Flush() {}
+
+#endif  // defined(XR_OS_LINUX)
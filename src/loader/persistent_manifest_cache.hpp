@@ -0,0 +1,69 @@
+// Copyright (c) 2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include "filesystem_utils.hpp"
+#include "manifest_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Appends the fields of a parsed manifest file to a cache record.
+class ManifestCacheRecordWriter {
+   public:
+    void WriteUint32(uint32_t value);
+    void WriteString(const std::string &value);
+
+    const std::string &Data() const { return _data; }
+
+   private:
+    std::string _data;
+};
+
+// Reads the fields of a cache record back in the order they were written.  Every read fails instead of reading past the
+// end of the record, so a truncated or corrupt record is rejected rather than trusted.
+class ManifestCacheRecordReader {
+   public:
+    ManifestCacheRecordReader() = default;
+    ManifestCacheRecordReader(const char *data, size_t size) : _data(data), _size(size) {}
+
+    bool ReadUint32(uint32_t &value);
+    bool ReadString(std::string &value);
+    // Read a string written by ManifestCacheRecordWriter::WriteString as a nested record, without copying it.
+    bool ReadRecord(ManifestCacheRecordReader &record);
+    bool AtEnd() const { return _offset == _size; }
+
+    const char *Data() const { return _data; }
+    size_t Size() const { return _size; }
+
+   private:
+    const char *_data{nullptr};
+    size_t _size{0};
+    size_t _offset{0};
+};
+
+// Parsed manifest files kept on disk across process launches, in a single file under $XDG_CACHE_HOME/openxr.  The file
+// is mapped into memory the first time it is needed, and its records are only used while the manifest they were parsed
+// from is unchanged; the callers also check that the library a record names still exists.  Records parsed by this process
+// are written back, replacing the file atomically, by Flush.
+//
+// The cache is only used on Linux, when the XR_LOADER_MANIFEST_CACHE environment variable is set to 1.
+namespace PersistentManifestCache {
+// Returns true if the cache is enabled for this process.
+bool IsEnabled();
+
+// Find the record for a manifest file in the state described by status.  The record stays valid until process exit.
+bool Find(ManifestFileType type, const std::string &filename, const FileSysUtilsFileStatus &status,
+          ManifestCacheRecordReader &record);
+
+// Remember a newly parsed manifest file, to be written out by the next Flush.
+void Store(ManifestFileType type, const std::string &filename, const FileSysUtilsFileStatus &status, const std::string &record);
+
+// Write the cache file if anything was stored since it was last written.  Records of manifest files that changed or no
+// longer exist are dropped.
+void Flush();
+}  // namespace PersistentManifestCache
@@ -9,19 +9,28 @@
 
 #include "runtime_interface.hpp"
 
+#include "hex_and_handles.h"
 #include "manifest_file.hpp"
+#include "loader_environment.hpp"
+#include "loader_epoch.hpp"
 #include "loader_interfaces.h"
 #include "loader_logger.hpp"
 #include "loader_platform.hpp"
+#include "loader_timing.hpp"
+#include "platform_utils.hpp"
 #include "xr_generated_dispatch_table.h"
 
 #include <openxr/openxr.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <cstring>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -30,6 +39,12 @@
 #include <json/value.h>
 #endif  // XR_USE_PLATFORM_ANDROID
 
+#ifdef XR_LOADER_DIRECT_RUNTIME
+// Provided by the runtime library linked into the loader.
+extern "C" XRAPI_ATTR XrResult XRAPI_CALL xrNegotiateLoaderRuntimeInterface(const XrNegotiateLoaderInfo* loaderInfo,
+                                                                            XrNegotiateRuntimeRequest* runtimeRequest);
+#endif  // XR_LOADER_DIRECT_RUNTIME
+
 #ifdef XR_KHR_LOADER_INIT_SUPPORT
 namespace {
 /*!
@@ -131,9 +146,59 @@ XrResult GetPlatformRuntimeVirtualManifest(Json::Value& out_manifest) {
 }
 #endif  // XR_USE_PLATFORM_ANDROID
 
+namespace {
+
+#ifndef XR_LOADER_DIRECT_RUNTIME
+const char* const kPreloadRuntimeEnvVar = "XR_LOADER_PRELOAD_RUNTIME";
+#endif  // !XR_LOADER_DIRECT_RUNTIME
+
+// The runtime found and loaded ahead of time by RuntimeInterface::StartPreload.
+struct RuntimePreload {
+    std::once_flag start_once;
+    // Whether the thread was started, read once start_once has been passed.
+    bool started{false};
+
+    std::mutex mutex;
+    std::condition_variable finished_condition;
+    // Set by the thread once it has written everything below.
+    bool finished{false};
+    // Set by the LoadRuntime that takes what the thread loaded, so that no other uses it again.
+    bool used{false};
+
+    // False if the thread ran into an exception, which LoadRuntime runs into again and reports itself.
+    bool completed{false};
+    XrResult discovery_result{XR_ERROR_RUNTIME_UNAVAILABLE};
+    XrResult result{XR_ERROR_RUNTIME_UNAVAILABLE};
+    // The runtime manifest override the runtime was found with.
+    std::string runtime_json;
+    // The file name and library path of each runtime manifest found, in order.
+    std::vector<std::pair<std::string, std::string>> manifest_files;
+    std::unique_ptr<RuntimeInterface> runtime;
+    // The messages logged while finding the runtime manifest files and while loading the runtime, logged again for the
+    // command that uses the runtime.
+    LoaderLogCapture discovery_log;
+    LoaderLogCapture load_log;
+    // The startup phases timed on the thread, added to the report of the command that uses the runtime.
+    LoaderTimingReport timing;
+};
+
+RuntimePreload& GetRuntimePreload() {
+    // Never destroyed, since the thread is detached and may still be loading the runtime when the process exits.
+    static RuntimePreload* preload = new RuntimePreload();
+    return *preload;
+}
+
+// Counts the runtimes loaded, to tell each apart from those loaded before it.
+std::atomic<uint64_t> g_runtime_load_ids{0};
+
+}  // namespace
+
 XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_command,
-                                                   std::unique_ptr<RuntimeManifestFile>& manifest_file) {
+                                                   std::unique_ptr<RuntimeManifestFile>& manifest_file,
+                                                   std::unique_ptr<RuntimeInterface>& runtime) {
+    LoaderTimingSpan open_span("runtime library open", manifest_file->LibraryPath());
     LoaderPlatformLibraryHandle runtime_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+    open_span.End();
     if (nullptr == runtime_library) {
         std::string library_message = LoaderPlatformLibraryOpenError(manifest_file->LibraryPath());
         std::string warning_message = "RuntimeInterface::LoadRuntime skipping manifest file ";
@@ -144,6 +209,7 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
         LoaderLogger::LogErrorMessage(openxr_command, warning_message);
         return XR_ERROR_FILE_ACCESS_ERROR;
     }
+    bool forwarded_init_loader = false;
 #ifdef XR_KHR_LOADER_INIT_SUPPORT
     if (!LoaderInitData::instance().initialized()) {
         LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntime skipping manifest file " +
@@ -153,7 +219,6 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
         LoaderPlatformLibraryClose(runtime_library);
         return XR_ERROR_VALIDATION_FAILURE;
     }
-    bool forwardedInitLoader = false;
     {
         // If we have xrInitializeLoaderKHR exposed as an export, forward call to it.
         const auto function_name = manifest_file->GetFunctionName("xrInitializeLoaderKHR");
@@ -161,10 +226,12 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
             reinterpret_cast<PFN_xrInitializeLoaderKHR>(LoaderPlatformLibraryGetProcAddr(runtime_library, function_name));
         if (initLoader != nullptr) {
             // we found the entry point one way or another.
-            LoaderLogger::LogInfoMessage(openxr_command,
+            LoaderLogger::LogInfoMessage(openxr_command.c_str(),
                                          "RuntimeInterface::LoadRuntime forwarding xrInitializeLoaderKHR call to runtime before "
                                          "calling xrNegotiateLoaderRuntimeInterface.");
+            LoaderTimingSpan init_span("runtime xrInitializeLoaderKHR", manifest_file->LibraryPath());
             XrResult res = initLoader(LoaderInitData::instance().getParam());
+            init_span.End();
             if (!XR_SUCCEEDED(res)) {
                 LoaderLogger::LogErrorMessage(openxr_command,
                                               "RuntimeInterface::LoadRuntime forwarded call to xrInitializeLoaderKHR failed.");
@@ -172,7 +239,7 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
                 LoaderPlatformLibraryClose(runtime_library);
                 return res;
             }
-            forwardedInitLoader = true;
+            forwarded_init_loader = true;
         }
     }
 #endif
@@ -182,6 +249,14 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
     auto negotiate =
         reinterpret_cast<PFN_xrNegotiateLoaderRuntimeInterface>(LoaderPlatformLibraryGetProcAddr(runtime_library, function_name));
 
+    return NegotiateRuntime(openxr_command, "manifest file " + manifest_file->Filename(), runtime_library, negotiate,
+                            forwarded_init_loader, runtime);
+}
+
+XrResult RuntimeInterface::NegotiateRuntime(const std::string& openxr_command, const std::string& runtime_description,
+                                            LoaderPlatformLibraryHandle runtime_library,
+                                            PFN_xrNegotiateLoaderRuntimeInterface negotiate, bool forwarded_init_loader,
+                                            std::unique_ptr<RuntimeInterface>& runtime) {
     // Loader info for negotiation
     XrNegotiateLoaderInfo loader_info = {};
     loader_info.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
@@ -201,9 +276,21 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
     // Skip calling the negotiate function and fail if the function pointer
     // could not get loaded
     XrResult res = XR_ERROR_RUNTIME_FAILURE;
+    LoaderTimingSpan negotiate_span("runtime negotiation", runtime_description);
     if (nullptr != negotiate) {
         res = negotiate(&loader_info, &runtime_info);
+        if (XR_FAILED(res)) {
+            // Runtimes built against interface version 1 may reject the newer structure, so offer
+            // exactly what an older loader would before giving up on this runtime.
+            loader_info.maxInterfaceVersion = 1;
+            runtime_info = {};
+            runtime_info.structType = XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST;
+            runtime_info.structVersion = 1;
+            runtime_info.structSize = offsetof(XrNegotiateRuntimeRequest, getInstanceProcAddrBatch);
+            res = negotiate(&loader_info, &runtime_info);
+        }
     }
+    negotiate_span.End();
     // If we supposedly succeeded, but got a nullptr for GetInstanceProcAddr
     // then something still went wrong, so return with an error.
     if (XR_SUCCEEDED(res)) {
@@ -211,28 +298,28 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
         uint32_t runtime_minor = XR_VERSION_MINOR(runtime_info.runtimeApiVersion);
         uint32_t loader_major = XR_VERSION_MAJOR(XR_CURRENT_API_VERSION);
         if (nullptr == runtime_info.getInstanceProcAddr) {
-            std::string error_message = "RuntimeInterface::LoadRuntime skipping manifest file ";
-            error_message += manifest_file->Filename();
+            std::string error_message = "RuntimeInterface::LoadRuntime skipping ";
+            error_message += runtime_description;
             error_message += ", negotiation succeeded but returned NULL getInstanceProcAddr";
             LoaderLogger::LogErrorMessage(openxr_command, error_message);
             res = XR_ERROR_FILE_CONTENTS_INVALID;
         } else if (0 >= runtime_info.runtimeInterfaceVersion ||
                    XR_CURRENT_LOADER_RUNTIME_VERSION < runtime_info.runtimeInterfaceVersion) {
-            std::string error_message = "RuntimeInterface::LoadRuntime skipping manifest file ";
-            error_message += manifest_file->Filename();
+            std::string error_message = "RuntimeInterface::LoadRuntime skipping ";
+            error_message += runtime_description;
             error_message += ", negotiation succeeded but returned invalid interface version";
             LoaderLogger::LogErrorMessage(openxr_command, error_message);
             res = XR_ERROR_FILE_CONTENTS_INVALID;
         } else if (runtime_major != loader_major || (runtime_major == 0 && runtime_minor == 0)) {
-            std::string error_message = "RuntimeInterface::LoadRuntime skipping manifest file ";
-            error_message += manifest_file->Filename();
+            std::string error_message = "RuntimeInterface::LoadRuntime skipping ";
+            error_message += runtime_description;
             error_message += ", OpenXR version returned not compatible with this loader";
             LoaderLogger::LogErrorMessage(openxr_command, error_message);
             res = XR_ERROR_FILE_CONTENTS_INVALID;
         }
     }
 #ifdef XR_KHR_LOADER_INIT_SUPPORT
-    if (XR_SUCCEEDED(res) && !forwardedInitLoader) {
+    if (XR_SUCCEEDED(res) && !forwarded_init_loader) {
         // Forward initialize loader call, where possible and if we did not do so before.
         PFN_xrVoidFunction initializeVoid = nullptr;
         PFN_xrInitializeLoaderKHR initialize = nullptr;
@@ -250,57 +337,196 @@ XrResult RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_com
         }
         if (initialize != nullptr) {
             // we found the entry point one way or another.
-            LoaderLogger::LogInfoMessage(openxr_command,
+            LoaderLogger::LogInfoMessage(openxr_command.c_str(),
                                          "RuntimeInterface::LoadRuntime forwarding xrInitializeLoaderKHR call to runtime after "
                                          "calling xrNegotiateLoaderRuntimeInterface.");
+            LoaderTimingSpan init_span("runtime xrInitializeLoaderKHR", runtime_description);
             res = initialize(LoaderInitData::instance().getParam());
+            init_span.End();
             if (!XR_SUCCEEDED(res)) {
                 LoaderLogger::LogErrorMessage(openxr_command,
                                               "RuntimeInterface::LoadRuntime forwarded call to xrInitializeLoaderKHR failed.");
             }
         }
     }
-#endif
+#else   // !XR_KHR_LOADER_INIT_SUPPORT
+    (void)forwarded_init_loader;
+#endif  // XR_KHR_LOADER_INIT_SUPPORT
     if (XR_FAILED(res)) {
-        std::string warning_message = "RuntimeInterface::LoadRuntime skipping manifest file ";
-        warning_message += manifest_file->Filename();
+        std::string warning_message = "RuntimeInterface::LoadRuntime skipping ";
+        warning_message += runtime_description;
         warning_message += ", negotiation failed with error ";
         warning_message += std::to_string(res);
         LoaderLogger::LogErrorMessage(openxr_command, warning_message);
-        LoaderPlatformLibraryClose(runtime_library);
+        if (runtime_library != nullptr) {
+            LoaderPlatformLibraryClose(runtime_library);
+        }
         return res;
     }
 
-    std::string info_message = "RuntimeInterface::LoadRuntime succeeded loading runtime defined in manifest file ";
-    info_message += manifest_file->Filename();
-    info_message += " using interface version ";
-    info_message += std::to_string(runtime_info.runtimeInterfaceVersion);
-    info_message += " and OpenXR API version ";
-    info_message += std::to_string(XR_VERSION_MAJOR(runtime_info.runtimeApiVersion));
-    info_message += ".";
-    info_message += std::to_string(XR_VERSION_MINOR(runtime_info.runtimeApiVersion));
-    LoaderLogger::LogInfoMessage(openxr_command, info_message);
+    if (LoaderLogger::IsMessageEnabled(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_GENERAL_BIT)) {
+        std::string info_message = "RuntimeInterface::LoadRuntime succeeded loading runtime defined in ";
+        info_message += runtime_description;
+        info_message += " using interface version ";
+        info_message += std::to_string(runtime_info.runtimeInterfaceVersion);
+        info_message += " and OpenXR API version ";
+        info_message += std::to_string(XR_VERSION_MAJOR(runtime_info.runtimeApiVersion));
+        info_message += ".";
+        info_message += std::to_string(XR_VERSION_MINOR(runtime_info.runtimeApiVersion));
+        LoaderLogger::LogInfoMessage(openxr_command, info_message);
+    }
 
     // Use this runtime
-    GetInstance().reset(new RuntimeInterface(runtime_library, runtime_info.getInstanceProcAddr));
+    PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch = nullptr;
+    if (runtime_info.runtimeInterfaceVersion >= 2 && runtime_info.structVersion >= 2) {
+        get_instance_proc_addr_batch = runtime_info.getInstanceProcAddrBatch;
+    }
+    runtime.reset(new RuntimeInterface(runtime_library, runtime_info.getInstanceProcAddr, get_instance_proc_addr_batch));
 
     // Grab the list of extensions this runtime supports for easy filtering after the
     // xrCreateInstance call
-    std::vector<std::string> supported_extensions;
-    std::vector<XrExtensionProperties> extension_properties;
-    GetInstance()->GetInstanceExtensionProperties(extension_properties);
-    supported_extensions.reserve(extension_properties.size());
-    for (XrExtensionProperties ext_prop : extension_properties) {
-        supported_extensions.emplace_back(ext_prop.extensionName);
+    LoaderTimingSpan extensions_span("runtime instance extension query", runtime_description);
+    runtime->QueryInstanceExtensionProperties();
+    return XR_SUCCESS;
+}
+
+XrResult RuntimeInterface::LoadFirstRuntime(const std::string& openxr_command,
+                                            std::vector<std::unique_ptr<RuntimeManifestFile>>& manifest_files,
+                                            std::unique_ptr<RuntimeInterface>& runtime) {
+    XrResult last_error = XR_ERROR_RUNTIME_UNAVAILABLE;
+    for (std::unique_ptr<RuntimeManifestFile>& manifest_file : manifest_files) {
+        last_error = RuntimeInterface::TryLoadingSingleRuntime(openxr_command, manifest_file, runtime);
+        if (XR_SUCCEEDED(last_error)) {
+            break;
+        }
     }
-    GetInstance()->SetSupportedExtensions(supported_extensions);
+    return last_error;
+}
 
-    return XR_SUCCESS;
+void RuntimeInterface::StartPreload() {
+#ifdef XR_LOADER_DIRECT_RUNTIME
+    // The runtime is linked into the loader, so there is nothing to load ahead of time.
+#else   // !XR_LOADER_DIRECT_RUNTIME
+#ifdef XR_KHR_LOADER_INIT_SUPPORT
+    // The runtime cannot be loaded until xrInitializeLoaderKHR has been called, which starts the preload again.
+    if (!LoaderInitData::instance().initialized()) {
+        return;
+    }
+#endif  // XR_KHR_LOADER_INIT_SUPPORT
+    RuntimePreload& preload = GetRuntimePreload();
+    std::call_once(preload.start_once, [&preload]() {
+        if (LoaderEnvironment::GetSecure(kPreloadRuntimeEnvVar) != "1" || IsLoaded()) {
+            return;
+        }
+        auto load = [&preload]() {
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+            try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+                preload.timing.Start();
+                preload.runtime_json = LoaderEnvironment::GetSecure(OPENXR_RUNTIME_JSON_ENV_VAR);
+                std::vector<std::unique_ptr<RuntimeManifestFile>> manifest_files;
+                preload.discovery_log.Start();
+                preload.discovery_result = RuntimeManifestFile::FindManifestFiles(manifest_files);
+                preload.discovery_log.Stop();
+                XrResult result = preload.discovery_result;
+                if (XR_SUCCEEDED(result)) {
+                    for (const std::unique_ptr<RuntimeManifestFile>& manifest_file : manifest_files) {
+                        preload.manifest_files.emplace_back(manifest_file->Filename(), manifest_file->LibraryPath());
+                    }
+                    preload.load_log.Start();
+                    result = LoadFirstRuntime("", manifest_files, preload.runtime);
+                    preload.load_log.Stop();
+                }
+                preload.result = result;
+                preload.completed = true;
+                preload.timing.Stop();
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+            } catch (...) {
+                preload.discovery_log.Stop();
+                preload.load_log.Stop();
+                preload.timing.Stop();
+                preload.runtime.reset();
+            }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+            std::lock_guard<std::mutex> lock(preload.mutex);
+            preload.finished = true;
+            preload.finished_condition.notify_all();
+        };
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+        try {
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+            // Detached rather than joined at exit, where waiting for a runtime library to finish loading could hang.
+            std::thread(load).detach();
+            preload.started = true;
+#ifndef XRLOADER_DISABLE_EXCEPTION_HANDLING
+        } catch (const std::system_error&) {
+            // LoadRuntime loads the runtime itself.
+        }
+#endif  // !XRLOADER_DISABLE_EXCEPTION_HANDLING
+    });
+#endif  // XR_LOADER_DIRECT_RUNTIME
+}
+
+bool RuntimeInterface::UsePreloadedRuntime(const std::string& openxr_command,
+                                           const std::vector<std::unique_ptr<RuntimeManifestFile>>* manifest_files,
+                                           XrResult& result) {
+    RuntimePreload& preload = GetRuntimePreload();
+    // Waits for StartPreload on another thread to finish starting the preload, or stops one starting once the runtime has
+    // been loaded without it.
+    std::call_once(preload.start_once, []() {});
+    if (!preload.started) {
+        return false;
+    }
+    {
+        LoaderTimingSpan wait_span("runtime preload wait");
+        std::unique_lock<std::mutex> lock(preload.mutex);
+        preload.finished_condition.wait(lock, [&preload]() { return preload.finished; });
+        if (preload.used) {
+            return false;
+        }
+        preload.used = true;
+    }
+
+    // The preload loaded the runtime, or failed to, just as LoadRuntime would, unless where it looks for runtimes changed
+    // since.
+    std::unique_ptr<RuntimeInterface> runtime = std::move(preload.runtime);
+    bool same_runtime = preload.completed && preload.runtime_json == LoaderEnvironment::GetSecure(OPENXR_RUNTIME_JSON_ENV_VAR);
+    if (same_runtime && manifest_files != nullptr) {
+        same_runtime = XR_SUCCEEDED(preload.discovery_result) && preload.manifest_files.size() == manifest_files->size();
+        for (size_t index = 0; same_runtime && index < manifest_files->size(); ++index) {
+            same_runtime = preload.manifest_files[index].first == (*manifest_files)[index]->Filename() &&
+                           preload.manifest_files[index].second == (*manifest_files)[index]->LibraryPath();
+        }
+    }
+    if (!same_runtime) {
+        preload.discovery_log.Clear();
+        preload.load_log.Clear();
+        preload.timing.Clear();
+        return false;
+    }
+
+    // Log what LoadRuntime would have, leaving out finding the manifest files if it has already done that itself.
+    if (manifest_files == nullptr) {
+        preload.discovery_log.Replay("");
+        if (XR_FAILED(preload.discovery_result)) {
+            LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntimes - unknown error");
+        }
+    }
+    preload.discovery_log.Clear();
+    preload.load_log.Replay(openxr_command);
+    preload.timing.MoveToCurrent();
+    result = preload.result;
+    if (XR_SUCCEEDED(result)) {
+        GetInstance().store(runtime.release(), std::memory_order_release);
+    }
+    return true;
 }
 
-XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
+XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) { return LoadRuntime(openxr_command, nullptr); }
+
+XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command, std::unique_ptr<RuntimeManifestFile>* complete_manifest) {
     // If something's already loaded, we're done here.
-    if (GetInstance() != nullptr) {
+    if (GetInstance().load(std::memory_order_acquire) != nullptr) {
         return XR_SUCCESS;
     }
 #ifdef XR_KHR_LOADER_INIT_SUPPORT
@@ -312,21 +538,42 @@ XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
     }
 #endif  // XR_KHR_LOADER_INIT_SUPPORT
 
-    std::vector<std::unique_ptr<RuntimeManifestFile>> runtime_manifest_files = {};
-
-    // Find the available runtimes which we may need to report information for.
-    XrResult last_error = RuntimeManifestFile::FindManifestFiles(runtime_manifest_files);
-    if (XR_FAILED(last_error)) {
-        LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntimes - unknown error");
+#ifdef XR_LOADER_DIRECT_RUNTIME
+    // The runtime is linked into the loader, so there are no manifest files to find or libraries to open.
+    (void)complete_manifest;
+    std::unique_ptr<RuntimeInterface> runtime;
+    XrResult last_error = RuntimeInterface::NegotiateRuntime(openxr_command, "the directly linked runtime", nullptr,
+                                                             xrNegotiateLoaderRuntimeInterface, false, runtime);
+    if (XR_SUCCEEDED(last_error)) {
+        GetInstance().store(runtime.release(), std::memory_order_release);
+    }
+#else   // !XR_LOADER_DIRECT_RUNTIME
+    XrResult last_error = XR_SUCCESS;
+    if (complete_manifest == nullptr && UsePreloadedRuntime(openxr_command, nullptr, last_error)) {
+        // The preload loaded the runtime, or failed to, in place of finding and loading it here.
     } else {
-        last_error = XR_ERROR_RUNTIME_UNAVAILABLE;
-        for (std::unique_ptr<RuntimeManifestFile>& manifest_file : runtime_manifest_files) {
-            last_error = RuntimeInterface::TryLoadingSingleRuntime(openxr_command, manifest_file);
+        std::vector<std::unique_ptr<RuntimeManifestFile>> runtime_manifest_files = {};
+
+        // Find the available runtimes which we may need to report information for.
+        last_error = RuntimeManifestFile::FindManifestFiles(runtime_manifest_files);
+        if (XR_FAILED(last_error)) {
+            LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntimes - unknown error");
+        } else if (complete_manifest != nullptr && !runtime_manifest_files.empty() &&
+                   runtime_manifest_files.front()->InstanceExtensionsComplete()) {
+            // The first runtime is the one that would be loaded, unless its library fails to load.
+            *complete_manifest = std::move(runtime_manifest_files.front());
+            return XR_SUCCESS;
+        } else if (complete_manifest != nullptr && UsePreloadedRuntime(openxr_command, &runtime_manifest_files, last_error)) {
+            // The preload loaded the runtime, or failed to, from the same manifest files.
+        } else {
+            std::unique_ptr<RuntimeInterface> runtime;
+            last_error = LoadFirstRuntime(openxr_command, runtime_manifest_files, runtime);
             if (XR_SUCCEEDED(last_error)) {
-                break;
+                GetInstance().store(runtime.release(), std::memory_order_release);
             }
         }
     }
+#endif  // XR_LOADER_DIRECT_RUNTIME
 
     // Unsuccessful in loading any runtime, throw the runtime unavailable message.
     if (XR_FAILED(last_error)) {
@@ -338,53 +585,153 @@ XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
 }
 
 void RuntimeInterface::UnloadRuntime(const std::string& openxr_command) {
-    if (GetInstance()) {
-        LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface::UnloadRuntime - Unloading RuntimeInterface");
-        GetInstance().reset();
+    RuntimeInterface* runtime = GetInstance().exchange(nullptr, std::memory_order_acq_rel);
+    if (runtime != nullptr) {
+        LoaderLogger::LogInfoMessage(openxr_command.c_str(), "RuntimeInterface::UnloadRuntime - Unloading RuntimeInterface");
+        // Calls on other threads may still be running in the runtime library, so it is closed once they return.
+        LoaderEpoch::Retire(std::unique_ptr<RuntimeInterface>(runtime));
     }
 }
 
-XrResult RuntimeInterface::GetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
-    return GetInstance()->_get_instance_proc_addr(instance, name, function);
+std::atomic<RuntimeInterface*>& RuntimeInterface::GetInstance() {
+    // Still deletes a runtime that is loaded when the loader itself is unloaded.
+    struct LoadedRuntime {
+        ~LoadedRuntime() { delete runtime.load(std::memory_order_acquire); }
+        std::atomic<RuntimeInterface*> runtime{nullptr};
+    };
+    static LoadedRuntime loaded_runtime;
+    return loaded_runtime.runtime;
 }
 
-const XrGeneratedDispatchTable* RuntimeInterface::GetDispatchTable(XrInstance instance) {
-    XrGeneratedDispatchTable* table = nullptr;
-    std::lock_guard<std::mutex> mlock(GetInstance()->_dispatch_table_mutex);
-    auto it = GetInstance()->_dispatch_table_map.find(instance);
-    if (it != GetInstance()->_dispatch_table_map.end()) {
-        table = it->second.get();
+XrResult RuntimeInterface::GetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+    RuntimeInterface* runtime = GetInstance().load(std::memory_order_acquire);
+    if (runtime == nullptr) {
+        *function = nullptr;
+        return XR_ERROR_HANDLE_INVALID;
     }
-    return table;
+    return runtime->_get_instance_proc_addr(instance, name, function);
 }
 
-const XrGeneratedDispatchTable* RuntimeInterface::GetDebugUtilsMessengerDispatchTable(XrDebugUtilsMessengerEXT messenger) {
-    XrInstance runtime_instance = XR_NULL_HANDLE;
-    {
-        std::lock_guard<std::mutex> mlock(GetInstance()->_messenger_to_instance_mutex);
-        auto it = GetInstance()->_messenger_to_instance_map.find(messenger);
-        if (it != GetInstance()->_messenger_to_instance_map.end()) {
-            runtime_instance = it->second;
+XrResult RuntimeInterface::GetInstanceProcAddrBatch(XrInstance instance, uint32_t name_count, const char* const* names,
+                                                    PFN_xrVoidFunction* functions) {
+    RuntimeInterface* loaded_runtime = GetInstance().load(std::memory_order_acquire);
+    if (loaded_runtime == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    RuntimeInterface& runtime = *loaded_runtime;
+    if (runtime._get_instance_proc_addr_batch != nullptr) {
+        return runtime._get_instance_proc_addr_batch(instance, name_count, names, functions);
+    }
+    for (uint32_t i = 0; i < name_count; ++i) {
+        functions[i] = nullptr;
+        if (XR_FAILED(runtime._get_instance_proc_addr(instance, names[i], &functions[i]))) {
+            functions[i] = nullptr;
         }
     }
-    return GetDispatchTable(runtime_instance);
+    return XR_SUCCESS;
+}
+
+const XrGeneratedDispatchTable* RuntimeInterface::GetDispatchTable(XrInstance instance) const {
+    return _dispatch_table_map.Find(MakeHandleGeneric(instance));
+}
+
+const XrGeneratedDispatchTable* RuntimeInterface::GetDebugUtilsMessengerDispatchTable(XrDebugUtilsMessengerEXT messenger) const {
+    XrInstance runtime_instance = _messenger_to_instance_map.Find(MakeHandleGeneric(messenger));
+    return _dispatch_table_map.Find(MakeHandleGeneric(runtime_instance));
 }
 
-RuntimeInterface::RuntimeInterface(LoaderPlatformLibraryHandle runtime_library, PFN_xrGetInstanceProcAddr get_instance_proc_addr)
-    : _runtime_library(runtime_library), _get_instance_proc_addr(get_instance_proc_addr) {}
+RuntimeInterface::RuntimeInterface(LoaderPlatformLibraryHandle runtime_library, PFN_xrGetInstanceProcAddr get_instance_proc_addr,
+                                   PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch)
+    : _runtime_library(runtime_library),
+      _get_instance_proc_addr(get_instance_proc_addr),
+      _get_instance_proc_addr_batch(get_instance_proc_addr_batch),
+      _load_id(++g_runtime_load_ids) {}
 
 RuntimeInterface::~RuntimeInterface() {
-    std::string info_message = "RuntimeInterface being destroyed.";
-    LoaderLogger::LogInfoMessage("", info_message);
-    {
-        std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
-        _dispatch_table_map.clear();
+    LoaderLogger::LogInfoMessage("", "RuntimeInterface being destroyed.");
+    // The runtime is only destroyed once no call can still be using it.
+    _dispatch_table_map.Clear([](XrGeneratedDispatchTable* dispatch_table) { delete dispatch_table; });
+    if (_runtime_library != nullptr) {
+        LoaderPlatformLibraryClose(_runtime_library);
     }
-    LoaderPlatformLibraryClose(_runtime_library);
 }
 
-void RuntimeInterface::GetInstanceExtensionProperties(std::vector<XrExtensionProperties>& extension_properties) {
-    std::vector<XrExtensionProperties> runtime_extension_properties;
+void RuntimeInterface::GetLoadedInstanceExtensionProperties(std::vector<XrExtensionProperties>& extension_properties,
+                                                            uint64_t& load_id, uint64_t& manifest_parse_id) const {
+    extension_properties = _instance_extension_properties;
+    load_id = _load_id;
+    manifest_parse_id = 0;
+}
+
+void RuntimeInterface::GetManifestInstanceExtensionProperties(const std::string& openxr_command, RuntimeManifestFile& manifest,
+                                                              std::vector<XrExtensionProperties>& extension_properties,
+                                                              uint64_t& load_id, uint64_t& manifest_parse_id) {
+    LoaderLogger::LogInfoMessage(openxr_command, "RuntimeInterface::GetRuntimeInstanceExtensionProperties - using the instance "
+                                                 "extensions listed in manifest file " +
+                                                     manifest.Filename() + " without loading the runtime");
+    manifest.GetInstanceExtensionProperties(extension_properties);
+    load_id = 0;
+    manifest_parse_id = manifest.ParseId();
+}
+
+XrResult RuntimeInterface::GetRuntimeInstanceExtensionProperties(const std::string& openxr_command,
+                                                                 std::vector<XrExtensionProperties>& extension_properties,
+                                                                 uint64_t& load_id, uint64_t& manifest_parse_id) {
+    std::unique_ptr<RuntimeManifestFile> complete_manifest;
+    XrResult result = LoadRuntime(openxr_command, &complete_manifest);
+    if (XR_FAILED(result)) {
+        return result;
+    }
+    if (complete_manifest == nullptr) {
+        // LoadRuntime succeeded and the caller holds the loader lock, so the runtime stays loaded.
+        GetRuntime()->GetLoadedInstanceExtensionProperties(extension_properties, load_id, manifest_parse_id);
+    } else {
+        GetManifestInstanceExtensionProperties(openxr_command, *complete_manifest, extension_properties, load_id,
+                                               manifest_parse_id);
+    }
+    return XR_SUCCESS;
+}
+
+XrResult RuntimeInterface::GetRuntimeInstanceExtensionPropertiesWithoutLoading(
+    const std::string& openxr_command, std::vector<XrExtensionProperties>& extension_properties, uint64_t& load_id,
+    uint64_t& manifest_parse_id, bool& must_load) {
+    must_load = false;
+    const RuntimeInterface* runtime = GetInstance().load(std::memory_order_acquire);
+    if (runtime != nullptr) {
+        runtime->GetLoadedInstanceExtensionProperties(extension_properties, load_id, manifest_parse_id);
+        return XR_SUCCESS;
+    }
+#ifdef XR_LOADER_DIRECT_RUNTIME
+    (void)openxr_command;
+    must_load = true;
+    return XR_SUCCESS;
+#else  // !XR_LOADER_DIRECT_RUNTIME
+#ifdef XR_KHR_LOADER_INIT_SUPPORT
+    // LoadRuntime reports this.
+    if (!LoaderInitData::instance().initialized()) {
+        must_load = true;
+        return XR_SUCCESS;
+    }
+#endif  // XR_KHR_LOADER_INIT_SUPPORT
+    std::vector<std::unique_ptr<RuntimeManifestFile>> runtime_manifest_files;
+    XrResult result = RuntimeManifestFile::FindManifestFiles(runtime_manifest_files);
+    if (XR_FAILED(result)) {
+        // LoadRuntime would fail the same way, without trying a preloaded runtime.
+        LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntimes - unknown error");
+        LoaderLogger::LogErrorMessage(openxr_command, "RuntimeInterface::LoadRuntimes - failed to load a runtime");
+        return XR_ERROR_RUNTIME_UNAVAILABLE;
+    }
+    if (runtime_manifest_files.empty() || !runtime_manifest_files.front()->InstanceExtensionsComplete()) {
+        must_load = true;
+        return XR_SUCCESS;
+    }
+    GetManifestInstanceExtensionProperties(openxr_command, *runtime_manifest_files.front(), extension_properties, load_id,
+                                           manifest_parse_id);
+    return XR_SUCCESS;
+#endif  // XR_LOADER_DIRECT_RUNTIME
+}
+
+void RuntimeInterface::QueryInstanceExtensionProperties() {
     PFN_xrEnumerateInstanceExtensionProperties rt_xrEnumerateInstanceExtensionProperties;
     _get_instance_proc_addr(XR_NULL_HANDLE, "xrEnumerateInstanceExtensionProperties",
                             reinterpret_cast<PFN_xrVoidFunction*>(&rt_xrEnumerateInstanceExtensionProperties));
@@ -393,31 +740,16 @@ void RuntimeInterface::GetInstanceExtensionProperties(std::vector<XrExtensionPro
     // Get the count from the runtime
     rt_xrEnumerateInstanceExtensionProperties(nullptr, count, &count_output, nullptr);
     if (count_output > 0) {
-        runtime_extension_properties.resize(count_output);
+        _instance_extension_properties.resize(count_output);
         count = count_output;
-        for (XrExtensionProperties& ext_prop : runtime_extension_properties) {
+        for (XrExtensionProperties& ext_prop : _instance_extension_properties) {
             ext_prop.type = XR_TYPE_EXTENSION_PROPERTIES;
             ext_prop.next = nullptr;
         }
-        rt_xrEnumerateInstanceExtensionProperties(nullptr, count, &count_output, runtime_extension_properties.data());
-    }
-    size_t ext_count = runtime_extension_properties.size();
-    size_t props_count = extension_properties.size();
-    for (size_t ext = 0; ext < ext_count; ++ext) {
-        bool found = false;
-        for (size_t prop = 0; prop < props_count; ++prop) {
-            // If we find it, then make sure the spec version matches that of the runtime instead of the
-            // layer.
-            if (strcmp(extension_properties[prop].extensionName, runtime_extension_properties[ext].extensionName) == 0) {
-                // Make sure the spec version used is the runtime's
-                extension_properties[prop].extensionVersion = runtime_extension_properties[ext].extensionVersion;
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            extension_properties.push_back(runtime_extension_properties[ext]);
-        }
+        rt_xrEnumerateInstanceExtensionProperties(nullptr, count, &count_output, _instance_extension_properties.data());
+    }
+    for (const XrExtensionProperties& ext_prop : _instance_extension_properties) {
+        _supported_extensions.Add(ext_prop.extensionName);
     }
 }
 
@@ -426,13 +758,16 @@ XrResult RuntimeInterface::CreateInstance(const XrInstanceCreateInfo* info, XrIn
     bool create_succeeded = false;
     PFN_xrCreateInstance rt_xrCreateInstance;
     _get_instance_proc_addr(XR_NULL_HANDLE, "xrCreateInstance", reinterpret_cast<PFN_xrVoidFunction*>(&rt_xrCreateInstance));
+    LoaderTimingSpan create_span("runtime xrCreateInstance");
     res = rt_xrCreateInstance(info, instance);
+    create_span.End();
     if (XR_SUCCEEDED(res)) {
         create_succeeded = true;
         std::unique_ptr<XrGeneratedDispatchTable> dispatch_table(new XrGeneratedDispatchTable());
-        GeneratedXrPopulateDispatchTable(dispatch_table.get(), *instance, _get_instance_proc_addr);
-        std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
-        _dispatch_table_map[*instance] = std::move(dispatch_table);
+        GeneratedXrPopulateDispatchTableBatch(dispatch_table.get(), *instance, _get_instance_proc_addr,
+                                              _get_instance_proc_addr_batch);
+        LoaderEpoch::Retire(std::unique_ptr<XrGeneratedDispatchTable>(
+            _dispatch_table_map.Exchange(MakeHandleGeneric(*instance), dispatch_table.release())));
     }
 
     // If the failure occurred during the populate, clean up the instance we had picked up from the runtime
@@ -449,13 +784,9 @@ XrResult RuntimeInterface::CreateInstance(const XrInstanceCreateInfo* info, XrIn
 XrResult RuntimeInterface::DestroyInstance(XrInstance instance) {
     if (XR_NULL_HANDLE != instance) {
         // Destroy the dispatch table for this instance first
-        {
-            std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
-            auto map_iter = _dispatch_table_map.find(instance);
-            if (map_iter != _dispatch_table_map.end()) {
-                _dispatch_table_map.erase(map_iter);
-            }
-        }
+        // Terminators on other threads may still be using the table.
+        LoaderEpoch::Retire(
+            std::unique_ptr<XrGeneratedDispatchTable>(_dispatch_table_map.Exchange(MakeHandleGeneric(instance), nullptr)));
         // Now delete the instance
         PFN_xrDestroyInstance rt_xrDestroyInstance;
         _get_instance_proc_addr(instance, "xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction*>(&rt_xrDestroyInstance));
@@ -465,29 +796,14 @@ XrResult RuntimeInterface::DestroyInstance(XrInstance instance) {
 }
 
 bool RuntimeInterface::TrackDebugMessenger(XrInstance instance, XrDebugUtilsMessengerEXT messenger) {
-    std::lock_guard<std::mutex> mlock(_messenger_to_instance_mutex);
-    _messenger_to_instance_map[messenger] = instance;
+    _messenger_to_instance_map.Exchange(MakeHandleGeneric(messenger), instance);
     return true;
 }
 
 void RuntimeInterface::ForgetDebugMessenger(XrDebugUtilsMessengerEXT messenger) {
-    if (XR_NULL_HANDLE != messenger) {
-        std::lock_guard<std::mutex> mlock(_messenger_to_instance_mutex);
-        _messenger_to_instance_map.erase(messenger);
-    }
-}
-
-void RuntimeInterface::SetSupportedExtensions(std::vector<std::string>& supported_extensions) {
-    _supported_extensions = supported_extensions;
+    _messenger_to_instance_map.Exchange(MakeHandleGeneric(messenger), XR_NULL_HANDLE);
 }
 
-bool RuntimeInterface::SupportsExtension(const std::string& extension_name) {
-    bool found_prop = false;
-    for (const std::string& supported_extension : _supported_extensions) {
-        if (supported_extension == extension_name) {
-            found_prop = true;
-            break;
-        }
-    }
-    return found_prop;
+bool RuntimeInterface::SupportsExtension(LoaderExtensionId id, const char* extension_name) const {
+    return _supported_extensions.Contains(id, extension_name);
 }
@@ -9,10 +9,15 @@
 
 #pragma once
 
+#include "loader_extension_set.hpp"
+#include "loader_handle_map.hpp"
+#include "loader_interfaces.h"
 #include "loader_platform.hpp"
 
 #include <openxr/openxr.h>
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -43,15 +48,36 @@ class RuntimeInterface {
     // Helper functions for loading and unloading the runtime (but only when necessary)
     static XrResult LoadRuntime(const std::string& openxr_command);
     static void UnloadRuntime(const std::string& openxr_command);
-    static RuntimeInterface& GetRuntime() { return *(GetInstance().get()); }
+    // The loaded runtime, or nullptr if it has been unloaded.  Only guaranteed to stay alive while the caller holds a
+    // LoaderEpochGuard or the global loader mutex, so load it once and use that pointer for the whole call.
+    static RuntimeInterface* GetRuntime() { return GetInstance().load(std::memory_order_acquire); }
+    static bool IsLoaded() { return GetInstance().load(std::memory_order_acquire) != nullptr; }
+    // If XR_LOADER_PRELOAD_RUNTIME is set to 1, start finding and loading the runtime on a background thread, so that the next
+    // LoadRuntime only has to wait for it.  Only the first call does anything.
+    static void StartPreload();
+    // Get the runtime's instance extensions.  The runtime is loaded to ask it, unless it is not loaded yet and its manifest
+    // declares that it lists all of them with "instance_extensions_complete".  The list comes from either the runtime with
+    // load_id or the manifest with manifest_parse_id, and the other ID is set to 0; the same IDs always give the same list.
+    static XrResult GetRuntimeInstanceExtensionProperties(const std::string& openxr_command,
+                                                          std::vector<XrExtensionProperties>& extension_properties,
+                                                          uint64_t& load_id, uint64_t& manifest_parse_id);
+    // Like GetRuntimeInstanceExtensionProperties, but never loads the runtime, so it only needs shared access to the loader
+    // lock.  Sets must_load instead, and returns no extensions, if the runtime has to be loaded to ask it.
+    static XrResult GetRuntimeInstanceExtensionPropertiesWithoutLoading(const std::string& openxr_command,
+                                                                        std::vector<XrExtensionProperties>& extension_properties,
+                                                                        uint64_t& load_id, uint64_t& manifest_parse_id,
+                                                                        bool& must_load);
     static XrResult GetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+    static XrResult GetInstanceProcAddrBatch(XrInstance instance, uint32_t name_count, const char* const* names,
+                                             PFN_xrVoidFunction* functions);
 
-    // Get the direct dispatch table to this runtime, without API layers or loader terminators.
-    static const XrGeneratedDispatchTable* GetDispatchTable(XrInstance instance);
-    static const XrGeneratedDispatchTable* GetDebugUtilsMessengerDispatchTable(XrDebugUtilsMessengerEXT messenger);
+    // Get the direct dispatch table to this runtime, without API layers or loader terminators.  Returns nullptr if the
+    // instance has been destroyed.
+    const XrGeneratedDispatchTable* GetDispatchTable(XrInstance instance) const;
+    const XrGeneratedDispatchTable* GetDebugUtilsMessengerDispatchTable(XrDebugUtilsMessengerEXT messenger) const;
 
-    void GetInstanceExtensionProperties(std::vector<XrExtensionProperties>& extension_properties);
-    bool SupportsExtension(const std::string& extension_name);
+    // id must be LoaderLookupExtensionId(extension_name).
+    bool SupportsExtension(LoaderExtensionId id, const char* extension_name) const;
     XrResult CreateInstance(const XrInstanceCreateInfo* info, XrInstance* instance);
     XrResult DestroyInstance(XrInstance instance);
     bool TrackDebugMessenger(XrInstance instance, XrDebugUtilsMessengerEXT messenger);
@@ -65,20 +91,48 @@ class RuntimeInterface {
     RuntimeInterface& operator=(const RuntimeInterface&) = delete;
 
    private:
-    RuntimeInterface(LoaderPlatformLibraryHandle runtime_library, PFN_xrGetInstanceProcAddr get_instance_proc_addr);
-    void SetSupportedExtensions(std::vector<std::string>& supported_extensions);
-    static XrResult TryLoadingSingleRuntime(const std::string& openxr_command, std::unique_ptr<RuntimeManifestFile>& manifest_file);
-
-    static std::unique_ptr<RuntimeInterface>& GetInstance() {
-        static std::unique_ptr<RuntimeInterface> instance;
-        return instance;
-    }
+    RuntimeInterface(LoaderPlatformLibraryHandle runtime_library, PFN_xrGetInstanceProcAddr get_instance_proc_addr,
+                     PFN_xrGetInstanceProcAddrBatch get_instance_proc_addr_batch);
+    // Ask the runtime for its instance extensions, once when it is loaded.
+    void QueryInstanceExtensionProperties();
+    void GetLoadedInstanceExtensionProperties(std::vector<XrExtensionProperties>& extension_properties, uint64_t& load_id,
+                                              uint64_t& manifest_parse_id) const;
+    static void GetManifestInstanceExtensionProperties(const std::string& openxr_command, RuntimeManifestFile& manifest,
+                                                       std::vector<XrExtensionProperties>& extension_properties,
+                                                       uint64_t& load_id, uint64_t& manifest_parse_id);
+    // Like LoadRuntime, except that if complete_manifest is not null and the runtime manifest lists all of the runtime's
+    // instance extensions, the manifest is returned through it instead of loading the runtime.
+    static XrResult LoadRuntime(const std::string& openxr_command, std::unique_ptr<RuntimeManifestFile>* complete_manifest);
+    // Load the first of manifest_files whose runtime can be used, without making it the loaded runtime.
+    static XrResult LoadFirstRuntime(const std::string& openxr_command,
+                                     std::vector<std::unique_ptr<RuntimeManifestFile>>& manifest_files,
+                                     std::unique_ptr<RuntimeInterface>& runtime);
+    static XrResult TryLoadingSingleRuntime(const std::string& openxr_command, std::unique_ptr<RuntimeManifestFile>& manifest_file,
+                                            std::unique_ptr<RuntimeInterface>& runtime);
+    // Negotiate with a runtime, and create the interface to it in runtime if it can be used.  runtime_library may be nullptr
+    // for a runtime linked into the loader, and is closed if negotiation fails.  runtime_description names the runtime in log
+    // messages.
+    static XrResult NegotiateRuntime(const std::string& openxr_command, const std::string& runtime_description,
+                                     LoaderPlatformLibraryHandle runtime_library, PFN_xrNegotiateLoaderRuntimeInterface negotiate,
+                                     bool forwarded_init_loader, std::unique_ptr<RuntimeInterface>& runtime);
+    // Wait for the runtime started by StartPreload and, if it was looked for in the same place LoadRuntime would look, take
+    // its result, making the runtime the loaded one if it loaded.  manifest_files are the runtime manifests LoadRuntime found,
+    // if it has already looked.  Returns false, leaving result alone, if LoadRuntime has to load the runtime itself.
+    static bool UsePreloadedRuntime(const std::string& openxr_command,
+                                    const std::vector<std::unique_ptr<RuntimeManifestFile>>* manifest_files, XrResult& result);
+
+    // The loaded runtime, or nullptr.  An unloaded runtime is retired through LoaderEpoch rather than deleted, since calls on
+    // other threads may still be using it.
+    static std::atomic<RuntimeInterface*>& GetInstance();
 
     LoaderPlatformLibraryHandle _runtime_library;
     PFN_xrGetInstanceProcAddr _get_instance_proc_addr;
-    std::unordered_map<XrInstance, std::unique_ptr<XrGeneratedDispatchTable>> _dispatch_table_map;
-    std::mutex _dispatch_table_mutex;
-    std::unordered_map<XrDebugUtilsMessengerEXT, XrInstance> _messenger_to_instance_map;
-    std::mutex _messenger_to_instance_mutex;
-    std::vector<std::string> _supported_extensions;
+    PFN_xrGetInstanceProcAddrBatch _get_instance_proc_addr_batch;  // nullptr if the runtime does not support it
+    // Read by the loader terminators on every call.  The dispatch tables are owned by this object.
+    LoaderHandleMap<XrGeneratedDispatchTable*> _dispatch_table_map;
+    LoaderHandleMap<XrInstance> _messenger_to_instance_map;
+    // Identifies this load of the runtime, which is never reused by a later one.
+    uint64_t _load_id;
+    std::vector<XrExtensionProperties> _instance_extension_properties;
+    LoaderExtensionSet _supported_extensions;
 };
@@ -280,5 +280,25 @@ def main(argv):
         f.write(file_text)
         f.close()
 
+        # Valid JSON, older Negotiate
+        ####################################
+
+        # Only accept the interface version 1 negotiation structures
+        old_name = '_interface_version_1.json'
+        file_text  = '{\n'
+        file_text += '    "file_format_version": "%s",\n' % cur_runtime_json_version
+        file_text += '    "runtime": {\n'
+        file_text += '        "library_path": "%s",\n' % library_location
+        file_text += '        "functions": {\n'
+        file_text += '           "xrNegotiateLoaderRuntimeInterface":\n'
+        file_text += '               "TestRuntimeInterfaceVersion1NegotiateLoaderRuntimeInterface"\n'
+        file_text += '       }\n'
+        file_text += '    }\n'
+        file_text += '}\n'
+        old_file = output_file.replace(".json", old_name)
+        f = open(old_file, 'w')
+        f.write(file_text)
+        f.close()
+
 if __name__ == "__main__":
     main(sys.argv[1:])
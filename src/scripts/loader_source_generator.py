@@ -19,6 +19,7 @@
 from automatic_source_generator import (AutomaticSourceOutputGenerator,
                                         undecorate)
 from generator import write
+from utility_source_generator import DEFAULT_HOT_DISPATCH_COMMANDS
 
 # The following commands are manually implemented in the loader.
 MANUAL_LOADER_FUNCS = set((
@@ -47,6 +48,69 @@ EXTENSIONS_LOADER_IMPLEMENTS = [
 ]
 
 
+# FNV-1a parameters used to hash command and extension names for the
+# xrGetInstanceProcAddr and extension lookup tables, and the constants that mix
+# a bucket seed into the hash.  These must match LoaderNameHash and
+# LoaderNameHashSlot in the generated code.
+NAME_HASH_OFFSET_BASIS = 0x811c9dc5
+NAME_HASH_PRIME = 0x01000193
+SEED_MIX_MULTIPLIERS = (0x9e3779b1, 0x85ebca6b, 0xc2b2ae35)
+
+
+def nameHash(name):
+    name_hash = NAME_HASH_OFFSET_BASIS
+    for char in name.encode('utf-8'):
+        name_hash ^= char
+        name_hash = (name_hash * NAME_HASH_PRIME) & 0xffffffff
+    return name_hash
+
+
+# Mix a bucket seed into a name hash, so a name is only hashed once per lookup.
+def nameHashSlot(name_hash, seed):
+    slot = name_hash ^ ((seed * SEED_MIX_MULTIPLIERS[0]) & 0xffffffff)
+    slot ^= slot >> 16
+    slot = (slot * SEED_MIX_MULTIPLIERS[1]) & 0xffffffff
+    slot ^= slot >> 13
+    slot = (slot * SEED_MIX_MULTIPLIERS[2]) & 0xffffffff
+    slot ^= slot >> 16
+    return slot
+
+
+# Build a minimal perfect hash of the names using hash-and-displace:
+# names are first hashed into buckets, then each bucket (largest first)
+# searches for a seed that places all of its names into unused slots of a
+# power-of-two table.  Both the bucket and the slot come from the same name
+# hash, and both tables are a power of two so neither needs a division.
+# Returns the per-bucket seeds and the table slots (None for empty slots).
+def buildPerfectHash(names):
+    table_size = 1
+    while table_size * 4 < len(names) * 5:
+        table_size <<= 1
+    bucket_count = 1
+    while bucket_count * 4 < len(names):
+        bucket_count <<= 1
+    buckets = [[] for _ in range(bucket_count)]
+    for name in names:
+        buckets[nameHash(name) & (bucket_count - 1)].append(name)
+
+    seeds = [0] * bucket_count
+    slots = [None] * table_size
+    for bucket in sorted(range(bucket_count), key=lambda b: (-len(buckets[b]), b)):
+        if not buckets[bucket]:
+            continue
+        seed = 1
+        while True:
+            candidates = [nameHashSlot(nameHash(name), seed) & (table_size - 1) for name in buckets[bucket]]
+            if len(set(candidates)) == len(candidates) and all(slots[c] is None for c in candidates):
+                break
+            seed += 1
+            assert seed <= 0xffff, 'Unable to find a perfect hash seed for name bucket'
+        seeds[bucket] = seed
+        for name, slot in zip(buckets[bucket], candidates):
+            slots[slot] = name
+    return seeds, slots
+
+
 def generateErrorMessage(indent_level, vuid, cur_cmd, message, object_info):
     lines = []
     lines.append('LoaderLogger::LogValidationErrorMessage(')
@@ -73,6 +137,16 @@ def generateErrorMessage(indent_level, vuid, cur_cmd, message, object_info):
 class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
     """Generate loader source using XML element attributes from registry"""
 
+    # Record the name of every extension, including those the base class leaves
+    # out of its list of extensions.
+    #   self            the LoaderSourceOutputGenerator object
+    #   interface       the XML element for the feature
+    #   emit            whether the feature is emitted
+    def beginFeature(self, interface, emit):
+        AutomaticSourceOutputGenerator.beginFeature(self, interface, emit)
+        if not self.isCoreExtensionName(self.currentExtension) and self.currentExtension not in self.extension_names:
+            self.extension_names.append(self.currentExtension)
+
     def getProto(self, cur_cmd):
         # Make it a C calling convention and exported.
         return cur_cmd.cdecl.replace("XRAPI_ATTR", 'extern "C" LOADER_EXPORT XRAPI_ATTR')
@@ -98,10 +172,14 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
     #   gen_opts        the LoaderSourceGeneratorOptions object
     def beginFile(self, genOpts):
         AutomaticSourceOutputGenerator.beginFile(self, genOpts)
+        # Every extension in the registry, in registry order.
+        self.extension_names = []
         preamble = ''
 
         if self.genOpts.filename == 'xr_generated_loader.hpp':
             preamble += '#pragma once\n'
+            preamble += '#include <atomic>\n'
+            preamble += '#include <cstdint>\n'
             preamble += '#include <unordered_map>\n'
             preamble += '#include <thread>\n'
             preamble += '#include <mutex>\n\n'
@@ -111,14 +189,29 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             preamble += '#include "loader_interfaces.h"\n\n'
             preamble += '#include "loader_instance.hpp"\n\n'
             preamble += '#include "loader_platform.hpp"\n\n'
+            preamble += '#include "xr_generated_loader_commands.hpp"\n\n'
+
+        elif self.genOpts.filename in ('xr_generated_loader_commands.hpp', 'xr_generated_loader_extensions.hpp'):
+            preamble += '#pragma once\n'
+            preamble += '#include <cstdint>\n'
+
+        elif self.genOpts.filename == 'xr_generated_loader_lookup.cpp':
+            preamble += '#include "xr_generated_loader_commands.hpp"\n'
+            preamble += '#include "xr_generated_loader_extensions.hpp"\n\n'
+            preamble += '#include <cstdint>\n'
+            preamble += '#include <cstring>\n'
 
         elif self.genOpts.filename == 'xr_generated_loader.cpp':
-            preamble += '#include "xr_generated_loader.hpp"\n\n'
+            preamble += '#include "xr_generated_loader.hpp"\n'
+            preamble += '#include "xr_generated_loader_extensions.hpp"\n\n'
             preamble += '#include "api_layer_interface.hpp"\n'
             preamble += '#include "exception_handling.hpp"\n'
             preamble += '#include "hex_and_handles.h"\n'
+            preamble += '#include "loader_epoch.hpp"\n'
             preamble += '#include "loader_instance.hpp"\n'
             preamble += '#include "loader_logger.hpp"\n'
+            if self.commandStatisticsEnabled():
+                preamble += '#include "loader_command_statistics.hpp"\n'
             preamble += '#include "loader_platform.hpp"\n'
             preamble += '#include "runtime_interface.hpp"\n'
             preamble += '#include "xr_generated_dispatch_table.h"\n\n'
@@ -149,8 +242,23 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             file_data += '#ifdef __cplusplus\n'
             file_data += '} // extern "C"\n'
             file_data += '#endif\n'
+            file_data += self.outputLazyDispatchTablePrototype()
+
+        elif self.genOpts.filename == 'xr_generated_loader_commands.hpp':
+            file_data += self.outputLoaderCommandIds()
+
+        elif self.genOpts.filename == 'xr_generated_loader_extensions.hpp':
+            file_data += self.outputLoaderExtensionIds()
+
+        elif self.genOpts.filename == 'xr_generated_loader_lookup.cpp':
+            file_data += self.outputLoaderNameHash()
+            file_data += self.outputLoaderCommandLookup()
+            file_data += self.outputLoaderExtensionLookup()
 
         elif self.genOpts.filename == 'xr_generated_loader.cpp':
+            file_data += self.outputLazyDispatchTable()
+            if self.commandStatisticsEnabled():
+                file_data += self.outputCommandStatisticsNames()
             file_data += self.outputLoaderGeneratedFuncs()
 
         write(file_data, file=self.outFile)
@@ -180,17 +288,329 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
 
         return manual_funcs
 
-   # Output loader generated functions.  This has special cases for create and destroy commands
+    # Every command in the registry, core first, in registry order.
+    #   self            the LoaderSourceOutputGenerator object
+    def getAllCommandNames(self):
+        return [cur_cmd.name for cur_cmd in self.core_commands + self.ext_commands]
+
+    # Output the command identifier enumeration and the lookup prototype used by
+    # the loader's xrGetInstanceProcAddr implementations.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderCommandIds(self):
+        command_ids = '\n// Identifiers for every command in the registry, used to dispatch xrGetInstanceProcAddr\n'
+        command_ids += '// without walking a chain of string compares.\n'
+        command_ids += 'enum class LoaderCommandId : uint16_t {\n'
+        command_ids += '    Unknown = 0,\n'
+        for name in self.getAllCommandNames():
+            command_ids += '    %s,\n' % name[2:]
+        command_ids += '};\n\n'
+        command_ids += '// Returns the identifier for the command name, or LoaderCommandId::Unknown if the name\n'
+        command_ids += '// is not a command in the registry.\n'
+        command_ids += 'LoaderCommandId LoaderLookupCommandId(const char* name);\n'
+        return command_ids
+
+    # Output the hash function shared by the command and extension lookups.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderNameHash(self):
+        name_hash = '\nnamespace {\n'
+        name_hash += '// FNV-1a.\n'
+        name_hash += 'inline uint32_t LoaderNameHash(const char* name) {\n'
+        name_hash += '    uint32_t hash = 0x%xU;\n' % NAME_HASH_OFFSET_BASIS
+        name_hash += '    for (; *name != \'\\0\'; ++name) {\n'
+        name_hash += '        hash ^= static_cast<uint8_t>(*name);\n'
+        name_hash += '        hash *= 0x%08xU;\n' % NAME_HASH_PRIME
+        name_hash += '    }\n'
+        name_hash += '    return hash;\n'
+        name_hash += '}\n\n'
+        name_hash += '// Mix the seed of a name\'s bucket into its hash to find its slot in the table.\n'
+        name_hash += 'inline uint32_t LoaderNameHashSlot(uint32_t hash, uint32_t seed) {\n'
+        name_hash += '    uint32_t slot = hash ^ (seed * 0x%08xU);\n' % SEED_MIX_MULTIPLIERS[0]
+        name_hash += '    slot ^= slot >> 16;\n'
+        name_hash += '    slot *= 0x%08xU;\n' % SEED_MIX_MULTIPLIERS[1]
+        name_hash += '    slot ^= slot >> 13;\n'
+        name_hash += '    slot *= 0x%08xU;\n' % SEED_MIX_MULTIPLIERS[2]
+        name_hash += '    slot ^= slot >> 16;\n'
+        name_hash += '    return slot;\n'
+        name_hash += '}\n'
+        name_hash += '}  // namespace\n'
+        return name_hash
+
+    # Output a perfect hash table of the names and a lookup function that
+    # returns the identifier for a name.
+    #   self            the LoaderSourceOutputGenerator object
+    #   kind            the part of the type names that says what is looked up, such as Command
+    #   names           the names, in the same order as the identifiers
+    #   id_for_name     the enumerant of the identifier type for a name
+    #   first_names     names compared before hashing, since looking them up that way is cheaper than hashing
+    def outputLoaderPerfectHashLookup(self, kind, names, id_for_name, first_names=()):
+        seeds, slots = buildPerfectHash(names)
+        id_type = 'Loader%sId' % kind
+        entry_type = 'Loader%sHashEntry' % kind
+        bucket_mask = 'kLoader%sHashBucketMask' % kind
+        table_mask = 'kLoader%sHashTableMask' % kind
+        seed_table = 'kLoader%sHashSeeds' % kind
+        hash_table = 'kLoader%sHashTable' % kind
+
+        lookup = '\n// Perfect hash of all registry %s names, built at generation time.\n' % kind.lower()
+        lookup += 'namespace {\n'
+        lookup += 'struct %s {\n' % entry_type
+        lookup += '    const char* name;\n'
+        lookup += '    %s id;\n' % id_type
+        lookup += '};\n\n'
+        lookup += 'const uint32_t %s = 0x%x;\n' % (bucket_mask, len(seeds) - 1)
+        lookup += 'const uint32_t %s = 0x%x;\n\n' % (table_mask, len(slots) - 1)
+        lookup += 'const uint16_t %s[%s + 1] = {\n' % (seed_table, bucket_mask)
+        for start in range(0, len(seeds), 16):
+            lookup += '    %s,\n' % ', '.join(str(seed) for seed in seeds[start:start + 16])
+        lookup += '};\n\n'
+        lookup += 'const %s %s[%s + 1] = {\n' % (entry_type, hash_table, table_mask)
+        for name in slots:
+            if name is None:
+                lookup += '    {nullptr, %s::Unknown},\n' % id_type
+            else:
+                lookup += '    {"%s", %s::%s},\n' % (name, id_type, id_for_name(name))
+        lookup += '};\n'
+        lookup += '}  // namespace\n\n'
+        lookup += '%s LoaderLookup%sId(const char* name) {\n' % (id_type, kind)
+        if first_names:
+            lookup += '    // Looked up by almost every application, often many times, so compared before hashing.\n'
+        for name in first_names:
+            lookup += '    if (strcmp(name, "%s") == 0) {\n' % name
+            lookup += '        return %s::%s;\n' % (id_type, id_for_name(name))
+            lookup += '    }\n'
+        lookup += '    const uint32_t hash = LoaderNameHash(name);\n'
+        lookup += '    const uint32_t seed = %s[hash & %s];\n' % (seed_table, bucket_mask)
+        lookup += '    const %s& entry = %s[LoaderNameHashSlot(hash, seed) & %s];\n' % (entry_type, hash_table, table_mask)
+        lookup += '    if (entry.name != nullptr && strcmp(entry.name, name) == 0) {\n'
+        lookup += '        return entry.id;\n'
+        lookup += '    }\n'
+        lookup += '    return %s::Unknown;\n' % id_type
+        lookup += '}\n'
+        return lookup
+
+    # Output the perfect hash table and lookup function for the command identifiers.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderCommandLookup(self):
+        return self.outputLoaderPerfectHashLookup('Command', self.getAllCommandNames(), lambda name: name[2:],
+                                                  ('xrGetInstanceProcAddr',))
+
+    # Output the extension identifier enumeration and the lookup prototype used
+    # to keep sets of extensions as bitsets.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderExtensionIds(self):
+        extension_ids = '\n// Identifiers for every extension in the registry, used to keep sets of extensions as bitsets\n'
+        extension_ids += '// instead of lists of names.\n'
+        extension_ids += 'enum class LoaderExtensionId : uint16_t {\n'
+        extension_ids += '    Unknown = 0,\n'
+        for name in self.extension_names:
+            extension_ids += '    %s,\n' % name[3:]
+        extension_ids += '};\n\n'
+        extension_ids += '// One more than the largest extension identifier.\n'
+        extension_ids += 'const uint16_t kLoaderExtensionIdCount = %d;\n\n' % (len(self.extension_names) + 1)
+        extension_ids += '// Returns the identifier for the extension name, or LoaderExtensionId::Unknown if the name\n'
+        extension_ids += '// is not an extension in the registry.\n'
+        extension_ids += 'LoaderExtensionId LoaderLookupExtensionId(const char* name);\n'
+        return extension_ids
+
+    # Output the perfect hash table and lookup function for the extension identifiers.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderExtensionLookup(self):
+        return self.outputLoaderPerfectHashLookup('Extension', self.extension_names, lambda name: name[3:])
+
+    # The commands that create or destroy a handle.  xrGetInstanceProcAddr returns the loader's
+    # trampoline for these, extension commands included, so that the loader records which
+    # instance owns every handle however the application reaches the command.
+    #   self            the LoaderSourceOutputGenerator object
+    def getHandleTrackingCommands(self):
+        return [cur_cmd for cur_cmd in self.core_commands + self.ext_commands
+                if cur_cmd.name not in MANUAL_LOADER_FUNCS and cur_cmd.ext_name not in EXTENSIONS_LOADER_IMPLEMENTS and
+                (cur_cmd.is_create_connect or cur_cmd.is_destroy_disconnect) and
+                cur_cmd.params[0].is_handle and cur_cmd.params[-1].is_handle]
+
+    # Whether a handle tracking command creates its handle rather than destroying it.  The registry marks
+    # xrDestroySpatialAnchorStoreConnectionMSFT as a "connect" command by its name, so go by whether the handle
+    # is returned through a pointer.
+    #   self            the LoaderSourceOutputGenerator object
+    #   cmd             the handle tracking command
+    def isHandleCreateCommand(self, cmd):
+        last_param = cmd.params[-1]
+        return self.paramPointerCount(last_param.cdecl, last_param.type, last_param.name) > 0
+
+    # The commands that are called through the lazily resolved dispatch table: those with a
+    # generated trampoline.  The frequently called ones come first, as they do in
+    # XrGeneratedDispatchTable, followed by the rest in registry order.
+    #   self            the LoaderSourceOutputGenerator object
+    def getLazyDispatchCommands(self):
+        lazy_commands = [cur_cmd for cur_cmd in self.core_commands if cur_cmd.name not in MANUAL_LOADER_FUNCS]
+        lazy_commands += [cur_cmd for cur_cmd in self.getHandleTrackingCommands() if cur_cmd not in lazy_commands]
+        hot_names = getattr(self.genOpts, 'hotDispatchCommands', None)
+        if hot_names is None:
+            hot_names = DEFAULT_HOT_DISPATCH_COMMANDS
+        hot_commands = [cur_cmd for name in hot_names for cur_cmd in lazy_commands if cur_cmd.name == name]
+        hot_commands = [cur_cmd for index, cur_cmd in enumerate(hot_commands) if cur_cmd not in hot_commands[:index]]
+        return hot_commands + [cur_cmd for cur_cmd in lazy_commands if cur_cmd not in hot_commands]
+
+    # Output the lazily resolved dispatch table and the prototype for populating it.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLazyDispatchTablePrototype(self):
+        proto = '\n// Dispatch table entries for the commands the generated trampolines call.  Each entry starts out as a stub that\n'
+        proto += '// resolves the command the first time it is called and stores it over itself, while other threads may be calling\n'
+        proto += '// through the same entry, so the entries are atomic.\n'
+        proto += 'struct LoaderLazyDispatchTable {\n'
+        for cur_cmd in self.getLazyDispatchCommands():
+            if cur_cmd.protect_value:
+                proto += '#if %s\n' % cur_cmd.protect_string
+            proto += '    std::atomic<PFN_%s> %s;\n' % (cur_cmd.name, cur_cmd.name[2:])
+            if cur_cmd.protect_value:
+                proto += '#endif // %s\n' % cur_cmd.protect_string
+        proto += '};\n\n'
+        proto += '// Fill in the lazily resolved dispatch table with its stubs, and resolve the entries of the dispatch table the\n'
+        proto += '// loader itself checks or calls directly through get_inst_proc_addr.\n'
+        proto += 'void LoaderGeneratedPopulateLazyDispatchTable(LoaderLazyDispatchTable* lazy_table, XrGeneratedDispatchTable* table,\n'
+        proto += '                                               XrInstance instance, PFN_xrGetInstanceProcAddr get_inst_proc_addr);\n\n'
+        proto += '// Resolve every entry of the lazily resolved dispatch table now through get_inst_proc_addr, as a loader that does not\n'
+        proto += '// resolve them lazily does while creating the instance.  An entry that is not found keeps its stub.\n'
+        proto += 'void LoaderGeneratedResolveLazyDispatchTable(LoaderLazyDispatchTable* lazy_table, XrInstance instance,\n'
+        proto += '                                             PFN_xrGetInstanceProcAddr get_inst_proc_addr);\n\n'
+        proto += '// The loader\'s trampoline for a command that creates or destroys a handle, which records or forgets the instance that\n'
+        proto += '// owns the handle, or nullptr for any other command.\n'
+        proto += 'PFN_xrVoidFunction LoaderGeneratedHandleTrampoline(LoaderCommandId command_id);\n'
+        return proto
+
+    # The loader tests some dispatch table entries against nullptr, or calls them
+    # from its own terminators, so those must hold the real function pointer.
+    #   self            the LoaderSourceOutputGenerator object
+    #   cur_cmd         the command being placed in the table
+    def isEagerDispatchEntry(self, cur_cmd):
+        return cur_cmd.name in MANUAL_LOADER_FUNCS or cur_cmd.ext_name in EXTENSIONS_LOADER_IMPLEMENTS
+
+    # Output a resolver stub for every lazily resolved dispatch table entry, and the
+    # function that fills the lazily resolved table with them.  Each stub looks up the
+    # real function through the active instance's topmost xrGetInstanceProcAddr, stores
+    # it over itself in the table, and then forwards the call.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLazyDispatchTable(self):
+        stubs = '\n// Dispatch table entries that resolve themselves on first use\n'
+        populate = '\nvoid LoaderGeneratedPopulateLazyDispatchTable(LoaderLazyDispatchTable* lazy_table, XrGeneratedDispatchTable* table,\n'
+        populate += '                                               XrInstance instance, PFN_xrGetInstanceProcAddr get_inst_proc_addr) {\n'
+        populate += '    // Nothing else can see the tables yet.\n'
+        populate += '    table->GetInstanceProcAddr = get_inst_proc_addr;\n'
+
+        for cur_cmd in self.core_commands + self.ext_commands:
+            if cur_cmd.name == 'xrGetInstanceProcAddr' or not self.isEagerDispatchEntry(cur_cmd):
+                continue
+            if cur_cmd.protect_value:
+                populate += '#if %s\n' % cur_cmd.protect_string
+            populate += '    (get_inst_proc_addr(instance, "%s", reinterpret_cast<PFN_xrVoidFunction*>(&table->%s)));\n' % (
+                cur_cmd.name, cur_cmd.name[2:])
+            if cur_cmd.protect_value:
+                populate += '#endif // %s\n' % cur_cmd.protect_string
+
+        for cur_cmd in self.getLazyDispatchCommands():
+            # Remove 'xr' from proto name
+            base_name = cur_cmd.name[2:]
+            stub_name = 'LoaderLazyResolve%s' % base_name
+
+            if cur_cmd.protect_value:
+                populate += '#if %s\n' % cur_cmd.protect_string
+                stubs += '#if %s\n' % cur_cmd.protect_string
+            populate += '    lazy_table->%s.store(%s, std::memory_order_relaxed);\n' % (base_name, stub_name)
+            if cur_cmd.protect_value:
+                populate += '#endif // %s\n' % cur_cmd.protect_string
+
+            decl = cur_cmd.cdecl.replace('XRAPI_ATTR', 'static XRAPI_ATTR').replace(' %s(' % cur_cmd.name, ' %s(' % stub_name)
+            stubs += decl.replace(';', ' {\n')
+            stubs += '    LoaderInstance* loader_instance;\n'
+            stubs += '    XrResult result = %s;\n' % self.genActiveLoaderInstanceGet(cur_cmd)
+            stubs += '    if (XR_FAILED(result)) {\n'
+            stubs += '        return result;\n'
+            stubs += '    }\n'
+            stubs += '    auto function = reinterpret_cast<PFN_%s>(loader_instance->ResolveDispatchTableEntry("%s"));\n' % (
+                cur_cmd.name, cur_cmd.name)
+            stubs += '    if (function == nullptr) {\n'
+            stubs += '        return XR_ERROR_FUNCTION_UNSUPPORTED;\n'
+            stubs += '    }\n'
+            stubs += '    // Threads racing to resolve the same entry all store the same function.\n'
+            stubs += '    loader_instance->LazyDispatchTable()->%s.store(function, std::memory_order_release);\n' % base_name
+            stubs += '    return function(%s);\n' % ', '.join(param.name for param in cur_cmd.params)
+            stubs += '}\n'
+            if cur_cmd.protect_value:
+                stubs += '#endif // %s\n' % cur_cmd.protect_string
+            stubs += '\n'
+
+        populate += '}\n'
+
+        resolve = '\nnamespace {\n'
+        resolve += '// Store the function get_inst_proc_addr finds for name in entry, or leave the entry as it is if there is none.\n'
+        resolve += 'template <typename Function>\n'
+        resolve += 'void LoaderResolveLazyDispatchEntry(std::atomic<Function>& entry, XrInstance instance,\n'
+        resolve += '                                    PFN_xrGetInstanceProcAddr get_inst_proc_addr, const char* name) {\n'
+        resolve += '    PFN_xrVoidFunction function = nullptr;\n'
+        resolve += '    if (XR_SUCCEEDED(get_inst_proc_addr(instance, name, &function)) && function != nullptr) {\n'
+        resolve += '        entry.store(reinterpret_cast<Function>(function), std::memory_order_relaxed);\n'
+        resolve += '    }\n'
+        resolve += '}\n'
+        resolve += '}  // namespace\n\n'
+        resolve += 'void LoaderGeneratedResolveLazyDispatchTable(LoaderLazyDispatchTable* lazy_table, XrInstance instance,\n'
+        resolve += '                                             PFN_xrGetInstanceProcAddr get_inst_proc_addr) {\n'
+        resolve += '    // Nothing else can see the table yet.\n'
+        for cur_cmd in self.getLazyDispatchCommands():
+            if cur_cmd.protect_value:
+                resolve += '#if %s\n' % cur_cmd.protect_string
+            resolve += '    LoaderResolveLazyDispatchEntry(lazy_table->%s, instance, get_inst_proc_addr, "%s");\n' % (
+                cur_cmd.name[2:], cur_cmd.name)
+            if cur_cmd.protect_value:
+                resolve += '#endif // %s\n' % cur_cmd.protect_string
+        resolve += '}\n'
+        return stubs + populate + resolve
+
+    # True if the trampolines should be instrumented with per-command call statistics.
+    #   self            the LoaderSourceOutputGenerator object
+    def commandStatisticsEnabled(self):
+        return getattr(self.genOpts, 'commandStatistics', False)
+
+    # The commands with a generated trampoline, in the order used for their statistics index.
+    #   self            the LoaderSourceOutputGenerator object
+    def getTrampolineCommandNames(self):
+        return [cur_cmd.name for cur_cmd in self.core_commands if cur_cmd.name not in MANUAL_LOADER_FUNCS]
+
+    # Generate the call that looks up the LoaderInstance owning the first parameter of a command.
+    #   self            the LoaderSourceOutputGenerator object
+    #   cur_cmd         the command whose first parameter is a handle
+    def genActiveLoaderInstanceGet(self, cur_cmd):
+        first_param = cur_cmd.params[0]
+        return 'ActiveLoaderInstance::Get(%s, MakeHandleGeneric(%s), &loader_instance, "%s")' % (
+            self.genXrObjectType(first_param.type), first_param.name, cur_cmd.name)
+
+    # Output the names of the instrumented trampolines, indexed by statistics index.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputCommandStatisticsNames(self):
+        names = self.getTrampolineCommandNames()
+        statistics_names = '\n// Names of the instrumented trampolines, indexed by LoaderCommandStatisticsScope index\n'
+        statistics_names += 'extern const char* const kLoaderCommandStatisticsNames[] = {\n'
+        for name in names:
+            statistics_names += '    "%s",\n' % name
+        statistics_names += '};\n'
+        statistics_names += 'extern const uint32_t kLoaderCommandStatisticsCount = %d;\n' % len(names)
+        return statistics_names
+
+    # Output loader generated functions.  This has special cases for create and destroy commands
     # since we have to associate the created objects with the original instance during the create,
     # and then remove that association in the delete.
     #   self            the LoaderSourceOutputGenerator object
     def outputLoaderGeneratedFuncs(self):
         generated_funcs = '\n// Automatically generated instance trampolines and terminators\n'
+        statistics_index = 0
+        handle_tracking_commands = self.getHandleTrackingCommands()
+        # Destroying a handle of these types also destroys the handles created from it.
+        parent_handle_types = set(handle.parent for handle in self.api_handles if handle.parent)
 
-        for cur_cmd in self.core_commands:
+        for cur_cmd in self.core_commands + [cur_cmd for cur_cmd in handle_tracking_commands if cur_cmd in self.ext_commands]:
 
             if cur_cmd.name in MANUAL_LOADER_FUNCS:
                 continue
+            is_core = cur_cmd in self.core_commands
+            tracks_handle = cur_cmd in handle_tracking_commands
 
             # Remove 'xr' from proto name
             base_name = cur_cmd.name[2:]
@@ -229,7 +649,7 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
                         first_handle_name = self.getFirstHandleName(param)
 
                         tramp_variable_defines += '    LoaderInstance* loader_instance;\n'
-                        tramp_variable_defines += '    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "%s");\n' % (cur_cmd.name)
+                        tramp_variable_defines += '    XrResult result = %s;\n' % self.genActiveLoaderInstanceGet(cur_cmd)
                         tramp_variable_defines += '    if (XR_SUCCEEDED(result)) {\n'
 
                         # These should be mutually exclusive - verify it.
@@ -261,37 +681,82 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
                                         values=param.values))
                 count = count + 1
 
-            if cur_cmd.protect_value:
-                generated_funcs += '#if %s\n' % cur_cmd.protect_string
-            decl = self.getProto(cur_cmd).replace(";", " XRLOADER_ABI_TRY {\n")
-
-            generated_funcs += decl
-            generated_funcs += tramp_variable_defines
+            body = ''
+            # Keep the instance, its layers and the runtime from being freed while the call uses them.
+            body += '    LoaderEpochGuard epoch_guard;\n'
+            body += tramp_variable_defines
 
             if has_return:
-                generated_funcs += '        result = '
+                body += '        result = '
             else:
-                generated_funcs += '        '
-
-            generated_funcs += 'loader_instance->DispatchTable()->'
-            generated_funcs += base_name
-            generated_funcs += '('
-            count = 0
-            for param in tramp_param_replace:
-                if count > 0:
-                    generated_funcs += ', '
-                generated_funcs += param.name
-                count = count + 1
-            generated_funcs += ');\n'
-
-            generated_funcs += '    }\n'
+                body += '        '
+
+            body += 'loader_instance->LazyDispatchTable()->'
+            body += base_name
+            body += '.load(std::memory_order_acquire)('
+            body += ', '.join(param.name for param in tramp_param_replace)
+            body += ');\n'
+
+            # Record which instance owns a handle created through it, and forget it once destroyed.
+            if tracks_handle:
+                first_param = cur_cmd.params[0]
+                last_param = cur_cmd.params[-1]
+                body += '        if (XR_SUCCEEDED(result)) {\n'
+                if self.isHandleCreateCommand(cur_cmd):
+                    body += '            ActiveLoaderInstance::AddHandle(%s, MakeHandleGeneric(*%s), loader_instance,\n' % (
+                        self.genXrObjectType(last_param.type), last_param.name)
+                    body += '                                            %s, MakeHandleGeneric(%s));\n' % (
+                        self.genXrObjectType(first_param.type), first_param.name)
+                elif last_param.type in parent_handle_types:
+                    body += '            ActiveLoaderInstance::RemoveHandleAndDescendants(%s, MakeHandleGeneric(%s));\n' % (
+                        self.genXrObjectType(last_param.type), last_param.name)
+                else:
+                    body += '            ActiveLoaderInstance::RemoveHandle(%s, MakeHandleGeneric(%s));\n' % (
+                        self.genXrObjectType(last_param.type), last_param.name)
+                body += '        }\n'
+
+            body += '    }\n'
 
             if has_return:
-                generated_funcs += '    return result;\n'
+                body += '    return result;\n'
 
-            generated_funcs += '}\nXRLOADER_ABI_CATCH_FALLBACK\n'
+            if cur_cmd.protect_value:
+                generated_funcs += '#if %s\n' % cur_cmd.protect_string
+
+            if tracks_handle:
+                # The body lives in a trampoline of the loader's own, which xrGetInstanceProcAddr can hand out without
+                # referring to an exported symbol the application may have replaced.
+                tracking_name = 'LoaderGenTrampoline%s' % base_name
+                decl = cur_cmd.cdecl.replace('XRAPI_ATTR', 'static XRAPI_ATTR').replace(' %s(' % cur_cmd.name, ' %s(' % tracking_name)
+                generated_funcs += decl.replace(';', ' XRLOADER_ABI_TRY {\n')
+                generated_funcs += body
+                generated_funcs += '}\nXRLOADER_ABI_CATCH_FALLBACK\n\n'
+                body = '    return %s(%s);\n' % (tracking_name, ', '.join(param.name for param in tramp_param_replace))
+
+            if is_core:
+                decl = self.getProto(cur_cmd).replace(";", " XRLOADER_ABI_TRY {\n")
+                generated_funcs += decl
+                if self.commandStatisticsEnabled():
+                    generated_funcs += '    LoaderCommandStatisticsScope statistics_scope(%d);\n' % statistics_index
+                statistics_index += 1
+                generated_funcs += body
+                generated_funcs += '}\nXRLOADER_ABI_CATCH_FALLBACK\n'
 
             if cur_cmd.protect_value:
                 generated_funcs += '#endif // %s\n' % cur_cmd.protect_string
             generated_funcs += '\n'
+
+        generated_funcs += 'PFN_xrVoidFunction LoaderGeneratedHandleTrampoline(LoaderCommandId command_id) {\n'
+        generated_funcs += '    switch (command_id) {\n'
+        for cur_cmd in handle_tracking_commands:
+            if cur_cmd.protect_value:
+                generated_funcs += '#if %s\n' % cur_cmd.protect_string
+            generated_funcs += '        case LoaderCommandId::%s:\n' % cur_cmd.name[2:]
+            generated_funcs += '            return reinterpret_cast<PFN_xrVoidFunction>(LoaderGenTrampoline%s);\n' % cur_cmd.name[2:]
+            if cur_cmd.protect_value:
+                generated_funcs += '#endif // %s\n' % cur_cmd.protect_string
+        generated_funcs += '        default:\n'
+        generated_funcs += '            return nullptr;\n'
+        generated_funcs += '    }\n'
+        generated_funcs += '}\n'
         return generated_funcs
@@ -215,6 +215,10 @@ def makeGenOpts(args):
             emitExtensions    = emitExtensionsPat)
         ]
 
+    # Both dispatch table files must agree on the hot command list, and so must the loader's lazily resolved table.
+    for dispatch_table_file in ('xr_generated_dispatch_table.h', 'xr_generated_dispatch_table.c'):
+        genOpts[dispatch_table_file][1].hotDispatchCommands = args.hotDispatchCommands
+
     genOpts['xr_generated_loader.hpp'] = [
           LoaderSourceOutputGenerator,
           AutomaticSourceGeneratorOptions(
@@ -263,6 +267,83 @@ def makeGenOpts(args):
             alignFuncParam    = 48)
         ]
 
+    genOpts['xr_generated_loader_extensions.hpp'] = [
+          LoaderSourceOutputGenerator,
+          AutomaticSourceGeneratorOptions(
+            conventions       = conventions,
+            filename          = 'xr_generated_loader_extensions.hpp',
+            directory         = directory,
+            apiname           = 'openxr',
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'openxr',
+            addExtensions     = None,
+            removeExtensions  = None,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + xrPrefixStrings,
+            protectFeature    = False,
+            protectProto      = '#ifndef',
+            protectProtoStr   = 'XR_NO_PROTOTYPES',
+            apicall           = 'XRAPI_ATTR ',
+            apientry          = 'XRAPI_CALL ',
+            apientryp         = 'XRAPI_PTR *',
+            alignFuncParam    = 48)
+        ]
+
+    genOpts['xr_generated_loader_commands.hpp'] = [
+          LoaderSourceOutputGenerator,
+          AutomaticSourceGeneratorOptions(
+            conventions       = conventions,
+            filename          = 'xr_generated_loader_commands.hpp',
+            directory         = directory,
+            apiname           = 'openxr',
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'openxr',
+            addExtensions     = None,
+            removeExtensions  = None,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + xrPrefixStrings,
+            protectFeature    = False,
+            protectProto      = '#ifndef',
+            protectProtoStr   = 'XR_NO_PROTOTYPES',
+            apicall           = 'XRAPI_ATTR ',
+            apientry          = 'XRAPI_CALL ',
+            apientryp         = 'XRAPI_PTR *',
+            alignFuncParam    = 48)
+        ]
+
+    genOpts['xr_generated_loader_lookup.cpp'] = [
+          LoaderSourceOutputGenerator,
+          AutomaticSourceGeneratorOptions(
+            conventions       = conventions,
+            filename          = 'xr_generated_loader_lookup.cpp',
+            directory         = directory,
+            apiname           = 'openxr',
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'openxr',
+            addExtensions     = None,
+            removeExtensions  = None,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + xrPrefixStrings,
+            protectFeature    = False,
+            protectProto      = '#ifndef',
+            protectProtoStr   = 'XR_NO_PROTOTYPES',
+            apicall           = 'XRAPI_ATTR ',
+            apientry          = 'XRAPI_CALL ',
+            apientryp         = 'XRAPI_PTR *',
+            alignFuncParam    = 48)
+        ]
+
+    # Both loader files must agree on whether the trampolines are instrumented.
+    for loader_file in ('xr_generated_loader.hpp', 'xr_generated_loader.cpp'):
+        genOpts[loader_file][1].commandStatistics = args.commandStatistics
+        genOpts[loader_file][1].hotDispatchCommands = args.hotDispatchCommands
+
     # Source files generated for the api_dump layer
     genOpts['xr_generated_api_dump.cpp'] = [
           ApiDumpOutputGenerator,
@@ -431,12 +512,19 @@ if __name__ == '__main__':
                         help='Specify target')
     parser.add_argument('-quiet', action='store_true', default=False,
                         help='Suppress script output during normal execution.')
+    parser.add_argument('-hotDispatchCommands', action='store',
+                        default=None,
+                        help='Comma-separated list of commands to place first in the generated dispatch table')
+    parser.add_argument('-commandStatistics', action='store_true', default=False,
+                        help='Instrument the generated loader trampolines with per-command call statistics')
 
     args = parser.parse_args()
 
     # This splits arguments which are space-separated lists
     args.feature = [name for arg in args.feature for name in arg.split()]
     args.extension = [name for arg in args.extension for name in arg.split()]
+    if args.hotDispatchCommands is not None:
+        args.hotDispatchCommands = [name for name in args.hotDispatchCommands.split(',') if name]
 
     # Load & parse registry
     reg = Registry()
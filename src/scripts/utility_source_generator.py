@@ -20,6 +20,26 @@
 from automatic_source_generator import AutomaticSourceOutputGenerator
 from generator import write
 
+# Commands called every frame by a typical application.  These are placed at the
+# start of the generated dispatch table so that the entries used by the frame loop
+# share as few cache lines as possible.  The list can be replaced at build time
+# with the -hotDispatchCommands option of src_genxr.py.
+DEFAULT_HOT_DISPATCH_COMMANDS = [
+    'xrWaitFrame',
+    'xrBeginFrame',
+    'xrEndFrame',
+    'xrLocateViews',
+    'xrLocateSpace',
+    'xrSyncActions',
+    'xrGetActionStateBoolean',
+    'xrGetActionStateFloat',
+    'xrGetActionStateVector2f',
+    'xrGetActionStatePose',
+    'xrAcquireSwapchainImage',
+    'xrWaitSwapchainImage',
+    'xrReleaseSwapchainImage',
+]
+
 # UtilitySourceOutputGenerator - subclass of AutomaticSourceOutputGenerator.
 
 
@@ -52,6 +72,7 @@ class UtilitySourceOutputGenerator(AutomaticSourceOutputGenerator):
         elif self.genOpts.filename == 'xr_generated_dispatch_table.c':
             preamble += '#include "xr_generated_dispatch_table.h"\n'
 
+        preamble += '#include "loader_interfaces.h"\n'
         preamble += '#include "xr_dependencies.h"\n'
         preamble += '#include <openxr/openxr.h>\n'
         preamble += '#include <openxr/openxr_platform.h>\n\n'
@@ -72,6 +93,7 @@ class UtilitySourceOutputGenerator(AutomaticSourceOutputGenerator):
             file_data += self.outputDispatchPrototypes()
         elif self.genOpts.filename == 'xr_generated_dispatch_table.c':
             file_data += self.outputDispatchTableHelper()
+            file_data += self.outputDispatchTableBatchHelper()
         else:
             raise RuntimeError("Unknown filename! " + self.genOpts.filename)
 
@@ -93,50 +115,80 @@ class UtilitySourceOutputGenerator(AutomaticSourceOutputGenerator):
         table_helper += 'void GeneratedXrPopulateDispatchTable(struct XrGeneratedDispatchTable *table,\n'
         table_helper += '                                      XrInstance instance,\n'
         table_helper += '                                      PFN_xrGetInstanceProcAddr get_inst_proc_addr);\n'
+        table_helper += '\n'
+        table_helper += '// Prototype for dispatch table helper function using a batched query, which falls back to\n'
+        table_helper += '// GeneratedXrPopulateDispatchTable if get_inst_proc_addr_batch is NULL or fails.\n'
+        table_helper += 'void GeneratedXrPopulateDispatchTableBatch(struct XrGeneratedDispatchTable *table,\n'
+        table_helper += '                                           XrInstance instance,\n'
+        table_helper += '                                           PFN_xrGetInstanceProcAddr get_inst_proc_addr,\n'
+        table_helper += '                                           PFN_xrGetInstanceProcAddrBatch get_inst_proc_addr_batch);\n'
         return table_helper
 
+    # Return the commands in dispatch table order as (section comment, command) pairs.
+    # The hot commands come first, followed by all remaining core commands and then the
+    # extension commands, each in registry order.  A new section comment is only given
+    # when the group changes.
+    #   self            the UtilitySourceOutputGenerator object
+    def getDispatchTableCommands(self):
+        hot_names = getattr(self.genOpts, 'hotDispatchCommands', None)
+        if hot_names is None:
+            hot_names = DEFAULT_HOT_DISPATCH_COMMANDS
+        all_commands = self.core_commands + self.ext_commands
+        commands_by_name = dict((cur_cmd.name, cur_cmd) for cur_cmd in all_commands)
+
+        ordered_commands = []
+        hot_commands = set()
+        for name in hot_names:
+            # Skip unknown or repeated names so that a hot list can be shared between
+            # registry versions, but say so, since a misspelled name would otherwise
+            # leave the table in registry order without any sign of why.
+            if name not in commands_by_name:
+                self.logMsg('warn', 'Hot dispatch command %s is not a command in the registry, ignoring it' % name)
+            elif name not in hot_commands:
+                hot_commands.add(name)
+                comment = '' if ordered_commands else '\n    // ---- Frequently called commands, grouped at the start of the table\n'
+                ordered_commands.append((comment, commands_by_name[name]))
+
+        cur_extension_name = ''
+        for cur_cmd in all_commands:
+            if cur_cmd.name in hot_commands:
+                continue
+            # If we've switched to a new "feature" print out a comment on what it is.  Usually,
+            # this is a group of core commands or a group of commands in an extension.
+            comment = ''
+            if cur_cmd.ext_name != cur_extension_name:
+                if self.isCoreExtensionName(cur_cmd.ext_name):
+                    comment = '\n    // ---- Core %s commands\n' % cur_cmd.ext_name[11:].replace("_", ".")
+                else:
+                    comment = '\n    // ---- %s extension commands\n' % cur_cmd.ext_name
+                cur_extension_name = cur_cmd.ext_name
+            ordered_commands.append((comment, cur_cmd))
+        return ordered_commands
+
     # Write out a C-style structure used to store the Dispatch table information
     #   self            the ApiDumpOutputGenerator object
     def outputDispatchTable(self):
-        commands = []
         table = ''
-        cur_extension_name = ''
 
         table += '// Generated dispatch table\n'
         table += 'struct XrGeneratedDispatchTable {\n'
 
-        # Loop through both core commands, and extension commands
-        # Outputting the core commands first, and then the extension commands.
-        for x in range(0, 2):
-            if x == 0:
-                commands = self.core_commands
-            else:
-                commands = self.ext_commands
-
-            for cur_cmd in commands:
-                # If we've switched to a new "feature" print out a comment on what it is.  Usually,
-                # this is a group of core commands or a group of commands in an extension.
-                if cur_cmd.ext_name != cur_extension_name:
-                    if self.isCoreExtensionName(cur_cmd.ext_name):
-                        table += '\n    // ---- Core %s commands\n' % cur_cmd.ext_name[11:].replace(
-                            "_", ".")
-                    else:
-                        table += '\n    // ---- %s extension commands\n' % cur_cmd.ext_name
-                    cur_extension_name = cur_cmd.ext_name
-
-                # Remove 'xr' from proto name
-                base_name = cur_cmd.name[2:]
-
-                # If a protect statement exists, use it.
-                if cur_cmd.protect_value:
-                    table += '#if %s\n' % cur_cmd.protect_string
-
-                # Write out each command using it's function pointer for each command
-                table += '    PFN_%s %s;\n' % (cur_cmd.name, base_name)
-
-                # If a protect statement exists, wrap it up.
-                if cur_cmd.protect_value:
-                    table += '#endif // %s\n' % cur_cmd.protect_string
+        for comment, cur_cmd in self.getDispatchTableCommands():
+            table += comment
+
+            # Remove 'xr' from proto name
+            base_name = cur_cmd.name[2:]
+
+            # If a protect statement exists, use it.
+            if cur_cmd.protect_value:
+                table += '#if %s\n' % cur_cmd.protect_string
+
+            # Write out each command using it's function pointer for each command
+            table += '    PFN_%s %s;\n' % (cur_cmd.name, base_name)
+
+            # If a protect statement exists, wrap it up.
+            if cur_cmd.protect_value:
+                table += '#endif // %s\n' % cur_cmd.protect_string
         table += '};\n\n'
         return table
 
@@ -144,56 +196,92 @@ class UtilitySourceOutputGenerator(AutomaticSourceOutputGenerator):
     # an instance handle and a corresponding xrGetInstanceProcAddr command.
     #   self            the ApiDumpOutputGenerator object
     def outputDispatchTableHelper(self):
-        commands = []
         table_helper = ''
-        cur_extension_name = ''
 
         table_helper += '// Helper function to populate an instance dispatch table\n'
         table_helper += 'void GeneratedXrPopulateDispatchTable(struct XrGeneratedDispatchTable *table,\n'
         table_helper += '                                      XrInstance instance,\n'
         table_helper += '                                      PFN_xrGetInstanceProcAddr get_inst_proc_addr) {\n'
 
-        # Loop through both core commands, and extension commands
-        # Outputting the core commands first, and then the extension commands.
-        for x in range(0, 2):
-            if x == 0:
-                commands = self.core_commands
+        # Fill in the table in the same order as the structure.  A section comment is
+        # held back until the first command in that section that is actually filled in.
+        pending_comment = ''
+        for comment, cur_cmd in self.getDispatchTableCommands():
+            if comment:
+                pending_comment = comment
+
+            # If the command is only manually implemented in the loader,
+            # it is not needed anywhere else, so skip it.
+            if cur_cmd.name in self.no_trampoline_or_terminator:
+                continue
+
+            table_helper += pending_comment
+            pending_comment = ''
+
+            # Remove 'xr' from proto name
+            base_name = cur_cmd.name[2:]
+
+            if cur_cmd.protect_value:
+                table_helper += '#if %s\n' % cur_cmd.protect_string
+
+            if cur_cmd.name == 'xrGetInstanceProcAddr':
+                # If the command we're filling in is the xrGetInstanceProcAddr command, use
+                # the one passed into this helper function.
+                table_helper += '    table->GetInstanceProcAddr = get_inst_proc_addr;\n'
             else:
-                commands = self.ext_commands
-
-            for cur_cmd in commands:
-                # If the command is only manually implemented in the loader,
-                # it is not needed anywhere else, so skip it.
-                if cur_cmd.name in self.no_trampoline_or_terminator:
-                    continue
-
-                # If we've switched to a new "feature" print out a comment on what it is.  Usually,
-                # this is a group of core commands or a group of commands in an extension.
-                if cur_cmd.ext_name != cur_extension_name:
-                    if self.isCoreExtensionName(cur_cmd.ext_name):
-                        table_helper += '\n    // ---- Core %s commands\n' % cur_cmd.ext_name[11:].replace(
-                            "_", ".")
-                    else:
-                        table_helper += '\n    // ---- %s extension commands\n' % cur_cmd.ext_name
-                    cur_extension_name = cur_cmd.ext_name
-
-                # Remove 'xr' from proto name
-                base_name = cur_cmd.name[2:]
-
-                if cur_cmd.protect_value:
-                    table_helper += '#if %s\n' % cur_cmd.protect_string
-
-                if cur_cmd.name == 'xrGetInstanceProcAddr':
-                    # If the command we're filling in is the xrGetInstanceProcAddr command, use
-                    # the one passed into this helper function.
-                    table_helper += '    table->GetInstanceProcAddr = get_inst_proc_addr;\n'
-                else:
-                    # Otherwise, fill in the dispatch table with an xrGetInstanceProcAddr call
-                    # to the appropriate command.
-                    table_helper += '    (get_inst_proc_addr(instance, "%s", (PFN_xrVoidFunction*)&table->%s));\n' % (
-                        cur_cmd.name, base_name)
+                # Otherwise, fill in the dispatch table with an xrGetInstanceProcAddr call
+                # to the appropriate command.
+                table_helper += '    (get_inst_proc_addr(instance, "%s", (PFN_xrVoidFunction*)&table->%s));\n' % (
+                    cur_cmd.name, base_name)
 
-                if cur_cmd.protect_value:
-                    table_helper += '#endif // %s\n' % cur_cmd.protect_string
+            if cur_cmd.protect_value:
+                table_helper += '#endif // %s\n' % cur_cmd.protect_string
+        table_helper += '}\n\n'
+        return table_helper
+
+    # Write out the helper function that will populate a dispatch table using a
+    # single batched query of every command, in the same order as the structure.
+    #   self            the UtilitySourceOutputGenerator object
+    def outputDispatchTableBatchHelper(self):
+        names = ''
+        assignments = ''
+        for _, cur_cmd in self.getDispatchTableCommands():
+            # The xrGetInstanceProcAddr command is the one passed in, and commands only
+            # manually implemented in the loader are not needed anywhere else.
+            if cur_cmd.name == 'xrGetInstanceProcAddr' or cur_cmd.name in self.no_trampoline_or_terminator:
+                continue
+
+            # Remove 'xr' from proto name
+            base_name = cur_cmd.name[2:]
+
+            if cur_cmd.protect_value:
+                names += '#if %s\n' % cur_cmd.protect_string
+                assignments += '#if %s\n' % cur_cmd.protect_string
+            names += '        "%s",\n' % cur_cmd.name
+            assignments += '    table->%s = (PFN_%s)functions[index++];\n' % (base_name, cur_cmd.name)
+            if cur_cmd.protect_value:
+                names += '#endif // %s\n' % cur_cmd.protect_string
+                assignments += '#endif // %s\n' % cur_cmd.protect_string
+
+        table_helper = ''
+        table_helper += '// Helper function to populate an instance dispatch table with one batched query\n'
+        table_helper += 'void GeneratedXrPopulateDispatchTableBatch(struct XrGeneratedDispatchTable *table,\n'
+        table_helper += '                                           XrInstance instance,\n'
+        table_helper += '                                           PFN_xrGetInstanceProcAddr get_inst_proc_addr,\n'
+        table_helper += '                                           PFN_xrGetInstanceProcAddrBatch get_inst_proc_addr_batch) {\n'
+        table_helper += '    static const char *const names[] = {\n'
+        table_helper += names
+        table_helper += '    };\n'
+        table_helper += '    PFN_xrVoidFunction functions[sizeof(names) / sizeof(names[0])];\n'
+        table_helper += '    uint32_t index = 0;\n'
+        table_helper += '\n'
+        table_helper += '    if (NULL == get_inst_proc_addr_batch ||\n'
+        table_helper += '        XR_FAILED(get_inst_proc_addr_batch(instance, (uint32_t)(sizeof(names) / sizeof(names[0])), names, functions))) {\n'
+        table_helper += '        GeneratedXrPopulateDispatchTable(table, instance, get_inst_proc_addr);\n'
+        table_helper += '        return;\n'
+        table_helper += '    }\n'
+        table_helper += '\n'
+        table_helper += '    table->GetInstanceProcAddr = get_inst_proc_addr;\n'
+        table_helper += assignments
         table_helper += '}\n\n'
         return table_helper
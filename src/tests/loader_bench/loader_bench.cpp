@@ -0,0 +1,828 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem_utils.hpp"
+#include "loader_interfaces.h"
+#include "loader_platform.hpp"
+#include "loader_test_utils.hpp"
+#include "manifest_json_reader.hpp"
+#include "xr_generated_dispatch_table.h"
+#include "xr_generated_loader_commands.hpp"
+
+#include <json/json.h>
+
+#include "xr_dependencies.h"
+#include <openxr/openxr.h>
+
+#if defined(XR_OS_WINDOWS)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Add some judicious char savers
+using std::cout;
+using std::endl;
+
+// Filter out the loader's messages to std::cerr if this is defined to 1.  This allows a
+// clean output for the benchmark.
+#define FILTER_OUT_LOADER_ERRORS 1
+
+namespace {
+
+enum LoaderBenchOutputFormat { OUTPUT_FORMAT_TEXT = 0, OUTPUT_FORMAT_JSON, OUTPUT_FORMAT_CSV };
+
+struct LoaderBenchResult {
+    std::string group;
+    std::string name;
+    uint32_t iterations;
+    double ns_per_call;
+};
+
+std::vector<LoaderBenchResult> g_results;
+
+// How the loader finds the runtime, so results from a loader built with OPENXR_DIRECT_RUNTIME can be told apart
+// from those of the default build that reads the runtime manifest and opens the runtime library.
+#ifdef XR_LOADER_DIRECT_RUNTIME
+const char* const kRuntimeMode = "direct";
+#else
+const char* const kRuntimeMode = "manifest";
+#endif
+
+// All iteration counts are scaled by this, so a quick run can be requested from the command line.
+double g_iteration_scale = 1.0;
+
+const uint32_t kGipaIterations = 1000000;
+const uint32_t kTrampolineIterations = 1000000;
+const uint32_t kCreateDestroyIterations = 500;
+const uint32_t kEnumerateIterations = 20;
+const uint32_t kUncachedEnumerateIterations = 10;
+const uint32_t kManifestParseIterations = 20000;
+const uint32_t kConcurrentEnumerateIterations = 200;
+const uint32_t kConcurrentCallIterations = 200000;
+const uint32_t kDispatchTablePopulateIterations = 2000;
+
+// Number of API layers between the application and the runtime for the trampoline benchmarks.
+const uint32_t kLayerChainLengths[] = {0, 1, 8};
+
+// Number of layer manifests found in XR_API_LAYER_PATH for the enumeration benchmarks.
+const uint32_t kManifestCounts[] = {1, 10, 100, 1000};
+
+// Number of threads calling into the loader at the same time for the concurrent benchmarks.
+const uint32_t kConcurrentThreadCounts[] = {1, 2, 4, 8};
+
+// Number of instance extensions, each with a list of entry points the loader does not read, in the manifests parsed by the
+// manifest parsing benchmarks.
+const uint32_t kManifestExtensionCounts[] = {0, 4, 32};
+
+const char* const kScratchDirectory = "loader_bench_scratch";
+
+// Names queried through xrGetInstanceProcAddr.  They cover the start and end of the
+// loader's former strcmp chains, a debug utils command, a command resolved by the
+// runtime and a name that is not a command at all.
+const char* const kGipaNames[] = {
+    "xrGetInstanceProcAddr",
+    "xrDestroyInstance",
+    "xrSubmitDebugUtilsMessageEXT",
+    "xrSessionInsertDebugUtilsLabelEXT",
+    "xrGetSystem",
+    "xrNotARealCommand",
+};
+
+// Copy of the string compare chain xrGetInstanceProcAddr used to walk before the
+// generated command lookup, to compare against the generated lookup it was replaced by.
+// Returns the command if the loader's trampoline handles it itself, and Unknown otherwise.
+LoaderCommandId StrcmpChainTrampolineLookup(const char* name) {
+    if (strcmp(name, "xrGetInstanceProcAddr") == 0) {
+        return LoaderCommandId::GetInstanceProcAddr;
+    } else if (strcmp(name, "xrInitializeLoaderKHR") == 0) {
+        return LoaderCommandId::InitializeLoaderKHR;
+    } else if (strcmp(name, "xrEnumerateApiLayerProperties") == 0) {
+        return LoaderCommandId::EnumerateApiLayerProperties;
+    } else if (strcmp(name, "xrEnumerateInstanceExtensionProperties") == 0) {
+        return LoaderCommandId::EnumerateInstanceExtensionProperties;
+    } else if (strcmp(name, "xrCreateInstance") == 0) {
+        return LoaderCommandId::CreateInstance;
+    } else if (strcmp(name, "xrDestroyInstance") == 0) {
+        return LoaderCommandId::DestroyInstance;
+    } else if (strcmp(name, "xrCreateDebugUtilsMessengerEXT") == 0) {
+        return LoaderCommandId::CreateDebugUtilsMessengerEXT;
+    } else if (strcmp(name, "xrDestroyDebugUtilsMessengerEXT") == 0) {
+        return LoaderCommandId::DestroyDebugUtilsMessengerEXT;
+    } else if (strcmp(name, "xrSessionBeginDebugUtilsLabelRegionEXT") == 0) {
+        return LoaderCommandId::SessionBeginDebugUtilsLabelRegionEXT;
+    } else if (strcmp(name, "xrSessionEndDebugUtilsLabelRegionEXT") == 0) {
+        return LoaderCommandId::SessionEndDebugUtilsLabelRegionEXT;
+    } else if (strcmp(name, "xrSessionInsertDebugUtilsLabelEXT") == 0) {
+        return LoaderCommandId::SessionInsertDebugUtilsLabelEXT;
+    } else if (strcmp(name, "xrSetDebugUtilsObjectNameEXT") == 0) {
+        return LoaderCommandId::SetDebugUtilsObjectNameEXT;
+    } else if (strcmp(name, "xrSubmitDebugUtilsMessageEXT") == 0) {
+        return LoaderCommandId::SubmitDebugUtilsMessageEXT;
+    }
+    return LoaderCommandId::Unknown;
+}
+
+// The same decision made the way xrGetInstanceProcAddr makes it now, through the generated
+// perfect hash the loader is built with.
+LoaderCommandId PerfectHashTrampolineLookup(const char* name) {
+    const LoaderCommandId command_id = LoaderLookupCommandId(name);
+    switch (command_id) {
+        case LoaderCommandId::GetInstanceProcAddr:
+        case LoaderCommandId::InitializeLoaderKHR:
+        case LoaderCommandId::EnumerateApiLayerProperties:
+        case LoaderCommandId::EnumerateInstanceExtensionProperties:
+        case LoaderCommandId::CreateInstance:
+        case LoaderCommandId::DestroyInstance:
+        case LoaderCommandId::CreateDebugUtilsMessengerEXT:
+        case LoaderCommandId::DestroyDebugUtilsMessengerEXT:
+        case LoaderCommandId::SessionBeginDebugUtilsLabelRegionEXT:
+        case LoaderCommandId::SessionEndDebugUtilsLabelRegionEXT:
+        case LoaderCommandId::SessionInsertDebugUtilsLabelEXT:
+        case LoaderCommandId::SetDebugUtilsObjectNameEXT:
+        case LoaderCommandId::SubmitDebugUtilsMessageEXT:
+            return command_id;
+        default:
+            return LoaderCommandId::Unknown;
+    }
+}
+
+uint32_t ScaledIterations(uint32_t iterations) {
+    auto scaled = static_cast<uint32_t>(iterations * g_iteration_scale);
+    return scaled > 0 ? scaled : 1;
+}
+
+// Run the functor the given number of times and record the average cost of a call in nanoseconds.
+template <typename Functor>
+void RunBenchmark(const std::string& group, const std::string& name, uint32_t iterations, Functor&& functor) {
+    iterations = ScaledIterations(iterations);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        functor();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns_per_call = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations;
+    g_results.push_back({group, name, iterations, ns_per_call});
+}
+
+// Like RunBenchmark, but call setup before each call of the functor without timing it.
+template <typename Setup, typename Functor>
+void RunBenchmarkWithSetup(const std::string& group, const std::string& name, uint32_t iterations, Setup&& setup,
+                           Functor&& functor) {
+    iterations = ScaledIterations(iterations);
+    std::chrono::steady_clock::duration elapsed{0};
+    for (uint32_t i = 0; i < iterations; ++i) {
+        setup(i);
+        auto start = std::chrono::steady_clock::now();
+        functor();
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+    double ns_per_call = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations;
+    g_results.push_back({group, name, iterations, ns_per_call});
+}
+
+bool MakeDirectory(const std::string& path) {
+    if (FileSysUtilsIsDirectory(path)) {
+        return true;
+    }
+#if defined(XR_OS_WINDOWS)
+    return 0 == _mkdir(path.c_str());
+#else
+    return 0 == mkdir(path.c_str(), 0755);
+#endif
+}
+
+std::string JsonEscape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool CopyFile(const std::string& source, const std::string& destination) {
+    std::ifstream in(source, std::ios::binary);
+    std::ofstream out(destination, std::ios::binary | std::ios::trunc);
+    if (!in || !out) {
+        return false;
+    }
+    out << in.rdbuf();
+    return static_cast<bool>(out);
+}
+
+bool WriteLayerManifest(const std::string& filename, const std::string& layer_name, const std::string& library_path,
+                        const std::string& description = "loader_bench layer") {
+    std::ofstream out(filename, std::ios::trunc);
+    out << "{\n"
+        << "    \"file_format_version\": \"1.0.0\",\n"
+        << "    \"api_layer\": {\n"
+        << "        \"name\": \"" << layer_name << "\",\n"
+        << "        \"library_path\": \"" << JsonEscape(library_path) << "\",\n"
+        << "        \"api_version\": \"1.0\",\n"
+        << "        \"implementation_version\": \"1\",\n"
+        << "        \"description\": \"" << JsonEscape(description) << "\"\n"
+        << "    }\n"
+        << "}\n";
+    return static_cast<bool>(out);
+}
+
+std::string ScratchPath(const std::string& child) {
+    std::string combined;
+    FileSysUtilsCombinePaths(kScratchDirectory, child, combined);
+    return combined;
+}
+
+// Each layer in a chain needs its own copy of the test layer library, since the layer keeps its
+// per-instance state in globals and the same library can only be loaded once.  Returns the
+// directory holding the manifests and fills in the value for XR_ENABLE_API_LAYERS, and, if given, the library of each layer.
+bool SetUpLayerChain(uint32_t layer_count, std::string& layer_path, std::string& enabled_layers,
+                     std::vector<std::string>* library_paths = nullptr) {
+    layer_path = ScratchPath("chain_" + std::to_string(layer_count));
+    if (!MakeDirectory(layer_path)) {
+        return false;
+    }
+    std::string library_name;
+    std::string source_library = LOADER_BENCH_TEST_LAYER_LIBRARY;
+    size_t last_separator = source_library.find_last_of("/\\");
+    library_name = last_separator == std::string::npos ? source_library : source_library.substr(last_separator + 1);
+
+    enabled_layers.clear();
+    for (uint32_t layer = 0; layer < layer_count; ++layer) {
+        std::string layer_name = "XR_APILAYER_bench_chain_" + std::to_string(layer);
+        std::string library_path, manifest_path, absolute_library_path;
+        FileSysUtilsCombinePaths(layer_path, std::to_string(layer) + "_" + library_name, library_path);
+        FileSysUtilsCombinePaths(layer_path, layer_name + ".json", manifest_path);
+        if (!CopyFile(source_library, library_path) || !FileSysUtilsGetAbsolutePath(library_path, absolute_library_path) ||
+            !WriteLayerManifest(manifest_path, layer_name, absolute_library_path)) {
+            return false;
+        }
+        if (library_paths != nullptr) {
+            library_paths->push_back(absolute_library_path);
+        }
+        if (!enabled_layers.empty()) {
+            enabled_layers += TEST_PATH_SEPARATOR;
+        }
+        enabled_layers += layer_name;
+    }
+    return true;
+}
+
+// Synthetic manifests all point at the one test layer library; they are only parsed, never loaded.
+bool SetUpSyntheticManifests(uint32_t manifest_count, std::string& layer_path,
+                             const std::string& description = "loader_bench layer") {
+    layer_path = ScratchPath("manifests_" + std::to_string(manifest_count));
+    if (!MakeDirectory(layer_path)) {
+        return false;
+    }
+    for (uint32_t manifest = 0; manifest < manifest_count; ++manifest) {
+        std::string layer_name = "XR_APILAYER_bench_synthetic_" + std::to_string(manifest);
+        std::string manifest_path;
+        FileSysUtilsCombinePaths(layer_path, layer_name + ".json", manifest_path);
+        if (!WriteLayerManifest(manifest_path, layer_name, LOADER_BENCH_TEST_LAYER_LIBRARY, description)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SetLayerEnvironment(const std::string& layer_path, const std::string& enabled_layers) {
+    if (enabled_layers.empty()) {
+        LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+        LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+    } else {
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", enabled_layers);
+    }
+}
+
+XrResult CreateBenchInstance(XrInstance* instance, bool enable_debug_utils) {
+    XrInstanceCreateInfo create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+    strcpy(create_info.applicationInfo.applicationName, "Loader Bench");
+    create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+    const char* debug_utils_extension = XR_EXT_DEBUG_UTILS_EXTENSION_NAME;
+    if (enable_debug_utils) {
+        create_info.enabledExtensionCount = 1;
+        create_info.enabledExtensionNames = &debug_utils_extension;
+    }
+    return xrCreateInstance(&create_info, instance);
+}
+
+void BenchGetInstanceProcAddr() {
+    XrInstance instance = XR_NULL_HANDLE;
+    if (XR_FAILED(CreateBenchInstance(&instance, true))) {
+        cout << "Unable to create an instance on the test runtime, skipping xrGetInstanceProcAddr" << endl;
+        return;
+    }
+
+    // The two lookups are timed on the same names, and must agree on every one of them for the comparison to mean anything.
+    volatile int sink = 0;
+    for (const char* name : kGipaNames) {
+        if (StrcmpChainTrampolineLookup(name) != PerfectHashTrampolineLookup(name)) {
+            cout << "The command lookups disagree on " << name << ", skipping the lookup comparison" << endl;
+            break;
+        }
+        RunBenchmark("command_lookup_strcmp_chain", name, kGipaIterations,
+                     [&]() { sink = sink + static_cast<int>(StrcmpChainTrampolineLookup(name)); });
+        RunBenchmark("command_lookup_perfect_hash", name, kGipaIterations,
+                     [&]() { sink = sink + static_cast<int>(PerfectHashTrampolineLookup(name)); });
+    }
+
+    // The whole of xrGetInstanceProcAddr, which also finds the instance and asks the runtime for commands the loader does not
+    // handle itself.
+    for (const char* name : kGipaNames) {
+        PFN_xrVoidFunction function = nullptr;
+        RunBenchmark("xrGetInstanceProcAddr", name, kGipaIterations,
+                     [&]() { sink = sink + static_cast<int>(xrGetInstanceProcAddr(instance, name, &function)); });
+    }
+
+    xrDestroyInstance(instance);
+}
+
+void BenchTrampolines() {
+    for (uint32_t layer_count : kLayerChainLengths) {
+        std::string layer_path, enabled_layers;
+        if (!SetUpLayerChain(layer_count, layer_path, enabled_layers)) {
+            cout << "Unable to set up a chain of " << layer_count << " layers, skipping" << endl;
+            continue;
+        }
+        SetLayerEnvironment(layer_path, enabled_layers);
+
+        const std::string layers_suffix = "/" + std::to_string(layer_count) + "_layers";
+        RunBenchmark("xrCreateInstance+xrDestroyInstance", "instance" + layers_suffix, kCreateDestroyIterations, [&]() {
+            XrInstance instance = XR_NULL_HANDLE;
+            if (XR_SUCCEEDED(CreateBenchInstance(&instance, false))) {
+                xrDestroyInstance(instance);
+            }
+        });
+
+        XrInstance instance = XR_NULL_HANDLE;
+        if (XR_FAILED(CreateBenchInstance(&instance, false))) {
+            cout << "Unable to create an instance with " << layer_count << " layers, skipping" << endl;
+            SetLayerEnvironment("", "");
+            continue;
+        }
+
+        XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+        system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+        XrSystemId system_id = XR_NULL_SYSTEM_ID;
+        RunBenchmark("trampoline", "xrGetSystem" + layers_suffix, kTrampolineIterations,
+                     [&]() { xrGetSystem(instance, &system_get_info, &system_id); });
+
+        XrSystemProperties system_properties{XR_TYPE_SYSTEM_PROPERTIES};
+        RunBenchmark("trampoline", "xrGetSystemProperties" + layers_suffix, kTrampolineIterations,
+                     [&]() { xrGetSystemProperties(instance, system_id, &system_properties); });
+
+        xrDestroyInstance(instance);
+        SetLayerEnvironment("", "");
+    }
+}
+
+// The runtime's xrCreateInstance, called at the bottom of the chain built by BenchDispatchTablePopulation.
+PFN_xrCreateInstance g_chain_runtime_create_instance = nullptr;
+
+XRAPI_ATTR XrResult XRAPI_CALL ChainTermCreateApiLayerInstance(const XrInstanceCreateInfo* info,
+                                                               const XrApiLayerCreateInfo* /* apiLayerInfo */,
+                                                               XrInstance* instance) {
+    return g_chain_runtime_create_instance(info, instance);
+}
+
+// Fill in a dispatch table through the topmost xrGetInstanceProcAddr of a chain of API layers, one command at a time, and
+// with one batched query.  The chain is built here from copies of the test layer on top of the test runtime, the way the
+// loader builds it but without the loader's own terminators, so that only the dispatch table population is timed.
+void BenchDispatchTablePopulation() {
+    LoaderPlatformLibraryHandle runtime_library = LoaderPlatformLibraryOpen(LOADER_BENCH_TEST_RUNTIME_LIBRARY);
+    if (runtime_library == nullptr) {
+        cout << "Unable to open the test runtime, skipping dispatch table population" << endl;
+        return;
+    }
+    XrNegotiateLoaderInfo loader_info{};
+    loader_info.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
+    loader_info.structVersion = XR_LOADER_INFO_STRUCT_VERSION;
+    loader_info.structSize = sizeof(XrNegotiateLoaderInfo);
+    loader_info.minInterfaceVersion = 1;
+    loader_info.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    loader_info.minApiVersion = XR_MAKE_VERSION(1, 0, 0);
+    loader_info.maxApiVersion = XR_MAKE_VERSION(1, 0x3ff, 0xfff);
+
+    XrNegotiateRuntimeRequest runtime_request{};
+    runtime_request.structType = XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST;
+    runtime_request.structVersion = XR_RUNTIME_INFO_STRUCT_VERSION;
+    runtime_request.structSize = sizeof(XrNegotiateRuntimeRequest);
+    auto negotiate_runtime = reinterpret_cast<PFN_xrNegotiateLoaderRuntimeInterface>(
+        LoaderPlatformLibraryGetProcAddr(runtime_library, "xrNegotiateLoaderRuntimeInterface"));
+    // The test runtime reports an error for any query without an instance, but still returns xrCreateInstance.
+    if (negotiate_runtime != nullptr && XR_SUCCEEDED(negotiate_runtime(&loader_info, &runtime_request))) {
+        runtime_request.getInstanceProcAddr(XR_NULL_HANDLE, "xrCreateInstance",
+                                            reinterpret_cast<PFN_xrVoidFunction*>(&g_chain_runtime_create_instance));
+    }
+    if (g_chain_runtime_create_instance == nullptr) {
+        cout << "Unable to negotiate with the test runtime, skipping dispatch table population" << endl;
+        LoaderPlatformLibraryClose(runtime_library);
+        return;
+    }
+
+    for (uint32_t layer_count : kLayerChainLengths) {
+        std::string layer_path, enabled_layers;
+        std::vector<std::string> library_paths;
+        if (!SetUpLayerChain(layer_count, layer_path, enabled_layers, &library_paths)) {
+            cout << "Unable to set up a chain of " << layer_count << " layers, skipping" << endl;
+            continue;
+        }
+
+        // Link the layers from the bottom up, as LoaderInstance::CreateInstance does.
+        std::vector<LoaderPlatformLibraryHandle> layer_libraries;
+        std::vector<XrApiLayerNextInfo> next_infos(layer_count);
+        PFN_xrGetInstanceProcAddr topmost_gipa = runtime_request.getInstanceProcAddr;
+        PFN_xrGetInstanceProcAddrBatch topmost_gipa_batch = runtime_request.getInstanceProcAddrBatch;
+        PFN_xrCreateApiLayerInstance topmost_create = ChainTermCreateApiLayerInstance;
+        XrApiLayerNextInfo* topmost_next_info = nullptr;
+        bool linked = true;
+        for (uint32_t layer = layer_count; linked && layer-- > 0;) {
+            LoaderPlatformLibraryHandle layer_library = LoaderPlatformLibraryOpen(library_paths[layer]);
+            auto negotiate_layer =
+                layer_library == nullptr ? nullptr
+                                         : reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(LoaderPlatformLibraryGetProcAddr(
+                                               layer_library, "xrNegotiateLoaderApiLayerInterface"));
+            const std::string layer_name = "XR_APILAYER_bench_chain_" + std::to_string(layer);
+            XrNegotiateApiLayerRequest layer_request{};
+            layer_request.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
+            layer_request.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
+            layer_request.structSize = sizeof(XrNegotiateApiLayerRequest);
+            if (layer_library != nullptr) {
+                layer_libraries.push_back(layer_library);
+            }
+            if (negotiate_layer == nullptr || XR_FAILED(negotiate_layer(&loader_info, layer_name.c_str(), &layer_request))) {
+                linked = false;
+                break;
+            }
+            XrApiLayerNextInfo& next_info = next_infos[layer];
+            next_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO;
+            next_info.structVersion = XR_API_LAYER_NEXT_INFO_STRUCT_VERSION;
+            next_info.structSize = sizeof(XrApiLayerNextInfo);
+            strncpy(next_info.layerName, layer_name.c_str(), XR_MAX_API_LAYER_NAME_SIZE - 1);
+            next_info.layerName[XR_MAX_API_LAYER_NAME_SIZE - 1] = '\0';
+            next_info.next = topmost_next_info;
+            next_info.nextGetInstanceProcAddr = topmost_gipa;
+            next_info.nextCreateApiLayerInstance = topmost_create;
+            next_info.nextGetInstanceProcAddrBatch = topmost_gipa_batch;
+            topmost_next_info = &next_info;
+            topmost_gipa = layer_request.getInstanceProcAddr;
+            topmost_gipa_batch = layer_request.getInstanceProcAddrBatch;
+            topmost_create = layer_request.createApiLayerInstance;
+        }
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrInstanceCreateInfo create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy(create_info.applicationInfo.applicationName, "Loader Bench");
+        create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        XrResult result = XR_ERROR_INITIALIZATION_FAILED;
+        if (linked && layer_count == 0) {
+            result = g_chain_runtime_create_instance(&create_info, &instance);
+        } else if (linked) {
+            XrApiLayerCreateInfo api_layer_info{};
+            api_layer_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO;
+            api_layer_info.structVersion = XR_API_LAYER_CREATE_INFO_STRUCT_VERSION;
+            api_layer_info.structSize = sizeof(XrApiLayerCreateInfo);
+            api_layer_info.nextInfo = topmost_next_info;
+            result = topmost_create(&create_info, &api_layer_info, &instance);
+        }
+
+        if (XR_FAILED(result)) {
+            cout << "Unable to create an instance through " << layer_count << " layers, skipping" << endl;
+        } else {
+            const std::string layers_name = std::to_string(layer_count) + "_layers";
+            XrGeneratedDispatchTable table{};
+            RunBenchmark("dispatch_table_population", "one_at_a_time/" + layers_name, kDispatchTablePopulateIterations,
+                         [&]() { GeneratedXrPopulateDispatchTable(&table, instance, topmost_gipa); });
+            RunBenchmark("dispatch_table_population", "batch/" + layers_name, kDispatchTablePopulateIterations,
+                         [&]() { GeneratedXrPopulateDispatchTableBatch(&table, instance, topmost_gipa, topmost_gipa_batch); });
+            if (table.DestroyInstance != nullptr) {
+                table.DestroyInstance(instance);
+            }
+        }
+        for (LoaderPlatformLibraryHandle layer_library : layer_libraries) {
+            LoaderPlatformLibraryClose(layer_library);
+        }
+    }
+    LoaderPlatformLibraryClose(runtime_library);
+}
+
+// Creating and destroying instances in a loop, with each XR_LOADER_RUNTIME_RESIDENCY policy for when the runtime is unloaded
+// after the last instance is destroyed.
+void BenchRuntimeResidency() {
+    const char* const residencies[] = {"instance", "process", "1000"};
+    for (const char* residency : residencies) {
+        LoaderTestSetEnvironmentVariable("XR_LOADER_RUNTIME_RESIDENCY", residency);
+        RunBenchmark("runtime_residency", residency, kCreateDestroyIterations, [&]() {
+            XrInstance instance = XR_NULL_HANDLE;
+            if (XR_SUCCEEDED(CreateBenchInstance(&instance, false))) {
+                xrDestroyInstance(instance);
+            }
+        });
+    }
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_RUNTIME_RESIDENCY");
+
+    // Unload the runtime that was kept resident, so later benchmarks start the same way with or without this one.
+    XrInstance instance = XR_NULL_HANDLE;
+    if (XR_SUCCEEDED(CreateBenchInstance(&instance, false))) {
+        xrDestroyInstance(instance);
+    }
+}
+
+void BenchEnumerateApiLayers() {
+    for (uint32_t manifest_count : kManifestCounts) {
+        std::string layer_path;
+        if (!SetUpSyntheticManifests(manifest_count, layer_path)) {
+            cout << "Unable to write " << manifest_count << " layer manifests, skipping" << endl;
+            continue;
+        }
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+
+        // Both benchmarks time the one call that asks for the count, so that the cached and uncached numbers compare.
+        RunBenchmark("xrEnumerateApiLayerProperties", std::to_string(manifest_count) + "_manifests", kEnumerateIterations, [&]() {
+            uint32_t count = 0;
+            xrEnumerateApiLayerProperties(0, &count, nullptr);
+        });
+
+        // Rewrite every manifest before each call, alternating descriptions of different lengths so each file changes size,
+        // so that discovery has to parse them all again instead of using the loader's manifest cache.
+        RunBenchmarkWithSetup(
+            "xrEnumerateApiLayerProperties", std::to_string(manifest_count) + "_manifests_uncached", kUncachedEnumerateIterations,
+            [&](uint32_t iteration) {
+                SetUpSyntheticManifests(manifest_count, layer_path, iteration % 2 == 0 ? "rewritten layer" : "loader_bench layer");
+            },
+            [&]() {
+                uint32_t count = 0;
+                xrEnumerateApiLayerProperties(0, &count, nullptr);
+            });
+
+        LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+    }
+}
+
+// Enumerate the API layers and instance extensions on several threads at once.  Each thread makes the same number of
+// enumerations, and the result is the wall time divided by all of them.  It can only drop with more threads on a machine with
+// as many cores.
+void BenchConcurrentEnumeration() {
+    const uint32_t manifest_count = 100;
+    std::string layer_path;
+    if (!SetUpSyntheticManifests(manifest_count, layer_path)) {
+        cout << "Unable to write " << manifest_count << " layer manifests, skipping" << endl;
+        return;
+    }
+    LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+
+    auto enumerate = []() {
+        uint32_t count = 0;
+        std::vector<XrApiLayerProperties> layer_properties;
+        xrEnumerateApiLayerProperties(0, &count, nullptr);
+        layer_properties.resize(count, {XR_TYPE_API_LAYER_PROPERTIES});
+        xrEnumerateApiLayerProperties(count, &count, layer_properties.data());
+        std::vector<XrExtensionProperties> extension_properties;
+        xrEnumerateInstanceExtensionProperties(nullptr, 0, &count, nullptr);
+        extension_properties.resize(count, {XR_TYPE_EXTENSION_PROPERTIES});
+        xrEnumerateInstanceExtensionProperties(nullptr, count, &count, extension_properties.data());
+    };
+    // Load the runtime first, as an application's first enumeration would.
+    enumerate();
+
+    for (uint32_t thread_count : kConcurrentThreadCounts) {
+        const uint32_t iterations = ScaledIterations(kConcurrentEnumerateIterations);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t thread = 0; thread < thread_count; ++thread) {
+            threads.emplace_back([&]() {
+                for (uint32_t i = 0; i < iterations; ++i) {
+                    enumerate();
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        const uint32_t total_iterations = iterations * thread_count;
+        double ns_per_call =
+            static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / total_iterations;
+        g_results.push_back({"concurrent_enumeration", std::to_string(manifest_count) + "_manifests_" +
+                                                           std::to_string(thread_count) + "_threads",
+                             total_iterations, ns_per_call});
+    }
+
+    LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+}
+
+// Submit debug utils messages on one instance from several threads at once.  The loader terminator looks up the runtime
+// dispatch table for the instance on every call, so this measures contention on that lookup.  The result is the wall time
+// divided by all of the calls, as for the concurrent enumeration benchmarks.
+void BenchConcurrentDebugUtils() {
+    XrInstance instance = XR_NULL_HANDLE;
+    if (XR_FAILED(CreateBenchInstance(&instance, true))) {
+        cout << "Unable to create an instance on the test runtime, skipping concurrent xrSubmitDebugUtilsMessageEXT" << endl;
+        return;
+    }
+    PFN_xrSubmitDebugUtilsMessageEXT submit_message = nullptr;
+    if (XR_FAILED(xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT",
+                                        reinterpret_cast<PFN_xrVoidFunction*>(&submit_message)))) {
+        cout << "Unable to get xrSubmitDebugUtilsMessageEXT, skipping" << endl;
+        xrDestroyInstance(instance);
+        return;
+    }
+
+    XrDebugUtilsMessengerCallbackDataEXT callback_data{XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT};
+    callback_data.messageId = "loader_bench";
+    callback_data.functionName = "BenchConcurrentDebugUtils";
+    callback_data.message = "loader_bench message";
+    for (uint32_t thread_count : kConcurrentThreadCounts) {
+        const uint32_t iterations = ScaledIterations(kConcurrentCallIterations);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t thread = 0; thread < thread_count; ++thread) {
+            threads.emplace_back([&]() {
+                for (uint32_t i = 0; i < iterations; ++i) {
+                    submit_message(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT,
+                                   XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callback_data);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        const uint32_t total_iterations = iterations * thread_count;
+        double ns_per_call =
+            static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / total_iterations;
+        g_results.push_back(
+            {"concurrent_calls", "xrSubmitDebugUtilsMessageEXT_" + std::to_string(thread_count) + "_threads", total_iterations,
+             ns_per_call});
+    }
+
+    xrDestroyInstance(instance);
+}
+
+// A layer manifest with extensions whose entry point lists are skipped by the loader's parser.
+std::string SyntheticManifestText(uint32_t extension_count) {
+    std::ostringstream text;
+    text << "{\n"
+         << "    \"file_format_version\": \"1.0.0\",\n"
+         << "    \"api_layer\": {\n"
+         << "        \"name\": \"XR_APILAYER_bench_parse\",\n"
+         << "        \"library_path\": \"" << JsonEscape(LOADER_BENCH_TEST_LAYER_LIBRARY) << "\",\n"
+         << "        \"api_version\": \"1.0\",\n"
+         << "        \"implementation_version\": \"1\",\n"
+         << "        \"description\": \"loader_bench layer\",\n"
+         << "        \"instance_extensions\": [";
+    for (uint32_t extension = 0; extension < extension_count; ++extension) {
+        text << (extension == 0 ? "\n" : ",\n") << "            {\n"
+             << "                \"name\": \"XR_EXT_bench_extension_" << extension << "\",\n"
+             << "                \"extension_version\": \"1\",\n"
+             << "                \"entrypoints\": [\"xrBenchFunctionA" << extension << "\", \"xrBenchFunctionB" << extension
+             << "\"]\n"
+             << "            }";
+    }
+    text << "\n        ]\n"
+         << "    }\n"
+         << "}\n";
+    return text.str();
+}
+
+// Parse a manifest already in memory with the loader's manifest parser and with jsoncpp, which the loader used to parse every
+// manifest with and still falls back to.
+void BenchManifestParsing() {
+    for (uint32_t extension_count : kManifestExtensionCounts) {
+        const std::string text = SyntheticManifestText(extension_count);
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+        const std::string name = std::to_string(extension_count) + "_extensions_" + std::to_string(text.size()) + "_bytes";
+
+        RunBenchmark("manifest_parse_ReadManifestJson", name, kManifestParseIterations, [&]() {
+            Json::Value root;
+            ReadManifestJson(begin, end, root);
+        });
+
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        RunBenchmark("manifest_parse_jsoncpp", name, kManifestParseIterations, [&]() {
+            Json::Value root;
+            std::string errors;
+            reader->parse(begin, end, &root, &errors);
+        });
+    }
+}
+
+void ReportResults(LoaderBenchOutputFormat format) {
+    switch (format) {
+        case OUTPUT_FORMAT_JSON:
+            cout << "{\n    \"runtime\": \"" << kRuntimeMode << "\",\n    \"results\": [\n";
+            for (size_t i = 0; i < g_results.size(); ++i) {
+                const LoaderBenchResult& result = g_results[i];
+                cout << "        {\"group\": \"" << JsonEscape(result.group) << "\", \"name\": \"" << JsonEscape(result.name)
+                     << "\", \"iterations\": " << result.iterations << ", \"ns_per_call\": " << std::fixed << std::setprecision(1)
+                     << result.ns_per_call << "}" << (i + 1 < g_results.size() ? "," : "") << "\n";
+            }
+            cout << "    ]\n}" << endl;
+            break;
+        case OUTPUT_FORMAT_CSV:
+            cout << "runtime,group,name,iterations,ns_per_call" << endl;
+            for (const LoaderBenchResult& result : g_results) {
+                cout << kRuntimeMode << "," << result.group << "," << result.name << "," << result.iterations << ","
+                     << std::fixed << std::setprecision(1) << result.ns_per_call << endl;
+            }
+            break;
+        default:
+            cout << "Starting loader_bench" << endl << "---------------------" << endl;
+            cout << "    Runtime: " << kRuntimeMode << endl;
+            for (const LoaderBenchResult& result : g_results) {
+                cout << "    " << std::left << std::setw(36) << result.group << std::setw(40) << result.name << std::right
+                     << std::fixed << std::setprecision(1) << std::setw(14) << result.ns_per_call << " ns/call" << endl;
+            }
+            break;
+    }
+}
+
+void PrintUsage() {
+    cout << "Usage: loader_bench [--json | --csv] [--scale <factor>]" << endl
+         << "    --json            Output results as JSON" << endl
+         << "    --csv             Output results as CSV" << endl
+         << "    --scale <factor>  Multiply all iteration counts by factor (e.g. 0.01 for a quick run)" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    LoaderBenchOutputFormat format = OUTPUT_FORMAT_TEXT;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--json") == 0) {
+            format = OUTPUT_FORMAT_JSON;
+        } else if (strcmp(argv[arg], "--csv") == 0) {
+            format = OUTPUT_FORMAT_CSV;
+        } else if (strcmp(argv[arg], "--scale") == 0 && arg + 1 < argc) {
+            g_iteration_scale = atof(argv[++arg]);
+        } else {
+            PrintUsage();
+            return -1;
+        }
+    }
+
+    if (!MakeDirectory(kScratchDirectory)) {
+        cout << "Unable to create " << kScratchDirectory << endl;
+        return -1;
+    }
+
+#if FILTER_OUT_LOADER_ERRORS == 1
+    // Re-direct std::cerr to a string since some benchmarked paths intentionally cause errors
+    // and we don't want it polluting the output stream.
+    std::stringstream buffer;
+    std::streambuf* original_cerr = nullptr;
+    original_cerr = std::cerr.rdbuf(buffer.rdbuf());
+#endif
+
+    LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", LOADER_BENCH_RESOURCES_DIR "/runtimes/test_runtime.json");
+
+    BenchGetInstanceProcAddr();
+    BenchTrampolines();
+    BenchDispatchTablePopulation();
+    BenchRuntimeResidency();
+    BenchEnumerateApiLayers();
+    BenchConcurrentEnumeration();
+    BenchConcurrentDebugUtils();
+    BenchManifestParsing();
+
+    LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+
+#if FILTER_OUT_LOADER_ERRORS == 1
+    // Restore std::cerr to the original buffer
+    std::cerr.rdbuf(original_cerr);
+#endif
+
+    ReportResults(format);
+    return 0;
+}
@@ -20,25 +20,49 @@
 // Author: Dave Houlton <daveh@lunarg.com>
 //
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <regex>
 #include <sstream>
 #include <cstring>
+#include <thread>
 #include <vector>
 
 #include "filesystem_utils.hpp"
 #include "loader_test_utils.hpp"
+#include "manifest_json_reader.hpp"
 
 #include "hex_and_handles.h"
+#include "loader_platform.hpp"
 
 #include "xr_dependencies.h"
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 
+#include "loader_interfaces.h"
+
 #ifdef XR_USE_GRAPHICS_API_D3D11
 #include "d3d11.h"
 #endif
 
+#include <json/json.h>
+
+#include <memory>
 #include <type_traits>
+
+#if defined(XR_OS_LINUX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif  // defined(XR_OS_LINUX)
+
 static_assert(sizeof(XrStructureType) == 4, "This should be a 32-bit enum");
 
 // Add some judicious char savers
@@ -53,6 +77,8 @@ enum LoaderTestGraphicsApiToUse { GRAPHICS_API_UNKONWN = 0, GRAPHICS_API_OPENGL,
 LoaderTestGraphicsApiToUse g_graphics_api_to_use = GRAPHICS_API_UNKONWN;
 bool g_debug_utils_exists = false;
 bool g_has_installed_runtime = false;
+// Path loader_test was run with, to run it again as a child process.
+std::string g_program_path;
 
 void CleanupEnvironmentVariables() {
     LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
@@ -384,6 +410,12 @@ void TestEnumInstanceExtensions(uint32_t& total, uint32_t& passed, uint32_t& ski
                         out_extension_value = 0;
                         local_total++;
                         cout << "        JSON " << cur_file << " extension enum count query (" << subtest_name << "): ";
+#ifdef XR_LOADER_DIRECT_RUNTIME
+                        // The runtime linked into the loader is used whatever the manifest says.
+                        cout << "Skipped" << endl;
+                        local_skipped++;
+                        continue;
+#endif  // XR_LOADER_DIRECT_RUNTIME
                         test_result =
                             xrEnumerateInstanceExtensionProperties(nullptr, in_extension_value, &out_extension_value, nullptr);
                         if (XR_SUCCEEDED(test_result)) {
@@ -551,135 +583,2331 @@ void TestEnumInstanceExtensions(uint32_t& total, uint32_t& passed, uint32_t& ski
         local_passed++;                                          \
     }
 
-#define TEST_NOT_EQUAL(test, expected, cout_string)              \
-    local_total++;                                               \
-    if (expected == (test)) {                                    \
-        cout << "        " << cout_string << ": Failed" << endl; \
-        local_failed++;                                          \
-    } else {                                                     \
-        cout << "        " << cout_string << ": Passed" << endl; \
-        local_passed++;                                          \
+#define TEST_NOT_EQUAL(test, expected, cout_string)              \
+    local_total++;                                               \
+    if (expected == (test)) {                                    \
+        cout << "        " << cout_string << ": Failed" << endl; \
+        local_failed++;                                          \
+    } else {                                                     \
+        cout << "        " << cout_string << ": Passed" << endl; \
+        local_passed++;                                          \
+    }
+
+#define TEST_FAIL(cout_string) \
+    local_total++;             \
+    local_failed++;            \
+    cout << "        " << cout_string << ": Failed" << endl;
+
+// Test creating and destroying an OpenXR instance through the loader.
+DEFINE_TEST(TestCreateDestroyInstance) {
+    INIT_TEST(TestCreateDestroyInstance)
+
+    try {
+        XrResult expected_result = XR_SUCCESS;
+        char valid_layer_to_enable[] = "XR_APILAYER_LUNARG_api_dump";
+        char invalid_layer_to_enable[] = "XrApiLayer_invalid_layer_test";
+        char invalid_extension_to_enable[] = "XR_KHR_fake_ext1";
+        const char* const valid_layer_name_array[1] = {valid_layer_to_enable};
+        const char* const invalid_layer_name_array[1] = {invalid_layer_to_enable};
+        const char* valid_extension_name_array[1];
+        const char* const invalid_extension_name_array[1] = {invalid_extension_to_enable};
+        XrApplicationInfo application_info = {};
+        strcpy(application_info.applicationName, "Loader Test");
+        application_info.applicationVersion = 688;
+        strcpy(application_info.engineName, "Infinite Improbability Drive");
+        application_info.engineVersion = 42;
+        application_info.apiVersion = XR_CURRENT_API_VERSION;
+
+        std::string current_path;
+        std::string layer_path;
+
+        // Ensure using installed runtime
+        LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+
+        // Convert relative test layer path to absolute, set envar
+        FileSysUtilsGetCurrentPath(layer_path);
+        layer_path =
+            layer_path + TEST_DIRECTORY_SYMBOL + ".." + TEST_DIRECTORY_SYMBOL + ".." + TEST_DIRECTORY_SYMBOL + "api_layers";
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+
+        // Look to see if the runtime supports any extensions, if it does, use the first one in this test.
+        bool missing_extensions = true;
+
+        // Make API dump write to a file, when loaded
+        LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_out.txt");
+
+        for (uint32_t test_num = 0; test_num < 6; ++test_num) {
+            XrInstance instance = XR_NULL_HANDLE;
+            XrResult create_result = XR_ERROR_VALIDATION_FAILURE;
+            std::string current_test_string;
+            XrInstanceCreateInfo instance_create_info = {};
+            instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+            instance_create_info.applicationInfo = application_info;
+
+            switch (test_num) {
+                // Test 0 - Basic, plain-vanilla xrCreateInstance
+                case 0:
+                    current_test_string = "Simple xrCreateInstance";
+                    expected_result = XR_SUCCESS;
+                    break;
+                // Test 1 - xrCreateInstance with a valid layer
+                case 1:
+                    current_test_string = "xrCreateInstance with a single valid layer";
+                    expected_result = XR_SUCCESS;
+                    instance_create_info.enabledApiLayerCount = 1;
+                    instance_create_info.enabledApiLayerNames = valid_layer_name_array;
+                    break;
+                // Test 2 - xrCreateInstance with an invalid layer
+                case 2:
+                    current_test_string = "xrCreateInstance with a single invalid layer";
+                    expected_result = XR_ERROR_API_LAYER_NOT_PRESENT;
+                    instance_create_info.enabledApiLayerCount = 1;
+                    instance_create_info.enabledApiLayerNames = invalid_layer_name_array;
+                    break;
+                // Test 3 - xrCreateInstance with a valid extension
+                case 3:
+                    if (missing_extensions) {
+                        continue;
+                    }
+                    current_test_string = "xrCreateInstance with a single valid extension";
+                    expected_result = XR_SUCCESS;
+                    instance_create_info.enabledExtensionCount = 1;
+                    instance_create_info.enabledExtensionNames = valid_extension_name_array;
+                    break;
+                // Test 4 - xrCreateInstance with an invalid extension
+                case 4:
+                    if (missing_extensions) {
+                        continue;
+                    }
+                    current_test_string = "xrCreateInstance with a single invalid extension";
+                    expected_result = XR_ERROR_EXTENSION_NOT_PRESENT;
+                    instance_create_info.enabledExtensionCount = 1;
+                    instance_create_info.enabledExtensionNames = invalid_extension_name_array;
+                    break;
+                // Test 5 - xrCreateInstance with everything
+                case 5:
+                    if (missing_extensions) {
+                        continue;
+                    }
+                    current_test_string = "xrCreateInstance with app info, valid layer, and a valid extension";
+                    expected_result = XR_SUCCESS;
+                    instance_create_info.enabledApiLayerCount = 1;
+                    instance_create_info.enabledApiLayerNames = valid_layer_name_array;
+                    instance_create_info.enabledExtensionCount = 1;
+                    instance_create_info.enabledExtensionNames = valid_extension_name_array;
+                    break;
+            }
+
+            // Try create instance and look for the correct return
+            std::string cur_message = current_test_string + " - xrCreateInstance";
+            create_result = xrCreateInstance(&instance_create_info, &instance);
+            TEST_EQUAL(create_result, expected_result, cur_message)
+
+            // If the expected return was a success, clean up the created instance
+            if (XR_SUCCEEDED(create_result)) {
+                cur_message = current_test_string + " - xrDestroyInstance";
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, cur_message)
+            }
+        }
+
+        // Make sure DestroyInstance with a NULL handle gives correct error
+        TEST_EQUAL(xrDestroyInstance(XR_NULL_HANDLE), XR_ERROR_HANDLE_INVALID, "xrDestroyInstance(XR_NULL_HANDLE)")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestCreateDestroyInstance)
+}
+
+// Test at least one XrInstance function not directly implemented in the loader's manual code section.
+// This is to make sure that the automatic instance functions work.
+DEFINE_TEST(TestGetSystem) {
+    INIT_TEST(TestGetSystem)
+
+    try {
+        std::string current_path;
+        std::string layer_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) || !FileSysUtilsCombinePaths(current_path, "../../api_layers", layer_path)) {
+            TEST_FAIL("Unable to set API layer path")
+            TEST_REPORT(TestGetSystem)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrApplicationInfo application_info = {};
+        strcpy(application_info.applicationName, "Loader Test");
+        application_info.applicationVersion = 688;
+        strcpy(application_info.engineName, "Infinite Improbability Drive");
+        application_info.engineVersion = 42;
+        application_info.apiVersion = XR_CURRENT_API_VERSION;
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        instance_create_info.applicationInfo = application_info;
+
+        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Creating instance")
+
+        XrSystemGetInfo system_get_info = {};
+        system_get_info.type = XR_TYPE_SYSTEM_GET_INFO;
+        system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+
+        XrSystemId systemId;
+        TEST_EQUAL(xrGetSystem(instance, &system_get_info, &systemId), XR_SUCCESS, "xrGetSystem");
+
+        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestGetSystem)
+}
+
+// Test that runtimes negotiating either loader interface version work, with and without an API layer between them and
+// the loader.  The test runtime's version 1 entry point rejects the newer negotiation structures, like a runtime built
+// before the batched xrGetInstanceProcAddr query was added.
+DEFINE_TEST(TestNegotiateInterfaceVersions) {
+    INIT_TEST(TestNegotiateInterfaceVersions)
+
+    try {
+        std::string current_path;
+        std::string runtime_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes", runtime_path)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestNegotiateInterfaceVersions)
+            return;
+        }
+
+        const char* const runtime_files[] = {"test_runtime.json", "test_runtime_interface_version_1.json"};
+        for (const char* runtime_file : runtime_files) {
+            std::string runtime_json;
+            FileSysUtilsCombinePaths(runtime_path, runtime_file, runtime_json);
+            LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+
+            for (uint32_t test = 0; test < 2; ++test) {
+                std::string subtest_name = std::string(runtime_file) + (test == 0 ? " with no API layers" : " with an API layer");
+                if (test == 0) {
+                    LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                    LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+                } else {
+                    LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                    LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+                }
+
+                XrInstance instance = XR_NULL_HANDLE;
+                XrInstanceCreateInfo instance_create_info = {};
+                instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+                strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+                instance_create_info.applicationInfo.applicationVersion = 688;
+                instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+                TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Creating instance " + subtest_name)
+                if (instance == XR_NULL_HANDLE) {
+                    continue;
+                }
+
+                XrSystemGetInfo system_get_info = {};
+                system_get_info.type = XR_TYPE_SYSTEM_GET_INFO;
+                system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                TEST_EQUAL(xrGetSystem(instance, &system_get_info, &system_id), XR_SUCCESS, "xrGetSystem " + subtest_name)
+                TEST_EQUAL(system_id, static_cast<XrSystemId>(1), "System ID " + subtest_name)
+
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance " + subtest_name)
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestNegotiateInterfaceVersions)
+}
+
+// Returns the library_path of a test manifest, whose node is "runtime" or "api_layer".
+static std::string TestManifestLibraryPath(const std::string& manifest_path, const char* node) {
+    std::ifstream manifest_file(manifest_path);
+    Json::Value manifest;
+    manifest_file >> manifest;
+    return manifest[node]["library_path"].asString();
+}
+
+// Stands in for the version 2 members of a negotiation request, which a version 1 request does not include.
+static XRAPI_ATTR XrResult XRAPI_CALL UntouchedGetInstanceProcAddrBatch(XrInstance, uint32_t, const char* const*,
+                                                                          PFN_xrVoidFunction*) {
+    return XR_ERROR_RUNTIME_FAILURE;
+}
+
+// Test that the test layer and runtime accept the negotiation structures of a loader built against interface version 1,
+// which passes the shorter version 1 request and only offers interface version 1.
+DEFINE_TEST(TestNegotiateVersion1Loader) {
+    INIT_TEST(TestNegotiateVersion1Loader)
+
+    try {
+        XrNegotiateLoaderInfo loader_info = {};
+        loader_info.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
+        loader_info.structVersion = XR_LOADER_INFO_STRUCT_VERSION;
+        loader_info.structSize = sizeof(XrNegotiateLoaderInfo);
+        loader_info.minInterfaceVersion = 1;
+        loader_info.maxInterfaceVersion = 1;
+        loader_info.minApiVersion = XR_MAKE_VERSION(1, 0, 0);
+        loader_info.maxApiVersion = XR_MAKE_VERSION(1, 0x3ff, 0xfff);
+
+        // The version 2 members lie past the end of a version 1 request, so they must be left alone.
+        const PFN_xrGetInstanceProcAddrBatch untouched = UntouchedGetInstanceProcAddrBatch;
+
+        LoaderPlatformLibraryHandle layer_library =
+            LoaderPlatformLibraryOpen(TestManifestLibraryPath("resources/layers/XrApiLayer_test.json", "api_layer"));
+        if (nullptr == layer_library) {
+            TEST_FAIL("Unable to open the test API layer library")
+        } else {
+            auto negotiate = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
+                LoaderPlatformLibraryGetProcAddr(layer_library, "xrNegotiateLoaderApiLayerInterface"));
+            XrNegotiateApiLayerRequest layer_request = {};
+            layer_request.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
+            layer_request.structVersion = 1;
+            layer_request.structSize = offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch);
+            layer_request.getInstanceProcAddrBatch = untouched;
+            TEST_EQUAL(negotiate(&loader_info, "XR_APILAYER_test", &layer_request), XR_SUCCESS, "API layer negotiation")
+            TEST_EQUAL(layer_request.layerInterfaceVersion, 1U, "API layer interface version")
+            TEST_EQUAL(layer_request.getInstanceProcAddrBatch == untouched, true, "API layer version 2 members untouched")
+            LoaderPlatformLibraryClose(layer_library);
+        }
+
+        LoaderPlatformLibraryHandle runtime_library =
+            LoaderPlatformLibraryOpen(TestManifestLibraryPath("resources/runtimes/test_runtime.json", "runtime"));
+        if (nullptr == runtime_library) {
+            TEST_FAIL("Unable to open the test runtime library")
+        } else {
+            auto negotiate = reinterpret_cast<PFN_xrNegotiateLoaderRuntimeInterface>(
+                LoaderPlatformLibraryGetProcAddr(runtime_library, "xrNegotiateLoaderRuntimeInterface"));
+            XrNegotiateRuntimeRequest runtime_request = {};
+            runtime_request.structType = XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST;
+            runtime_request.structVersion = 1;
+            runtime_request.structSize = offsetof(XrNegotiateRuntimeRequest, getInstanceProcAddrBatch);
+            runtime_request.getInstanceProcAddrBatch = untouched;
+            TEST_EQUAL(negotiate(&loader_info, &runtime_request), XR_SUCCESS, "Runtime negotiation")
+            TEST_EQUAL(runtime_request.runtimeInterfaceVersion, 1U, "Runtime interface version")
+            TEST_EQUAL(runtime_request.getInstanceProcAddrBatch == untouched, true, "Runtime version 2 members untouched")
+            LoaderPlatformLibraryClose(runtime_library);
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Output results for this test
+    TEST_REPORT(TestNegotiateVersion1Loader)
+}
+
+// Create an instance of the test runtime, returning XR_NULL_HANDLE on failure.
+static XrInstance CreateTestRuntimeInstance() {
+    XrInstance instance = XR_NULL_HANDLE;
+    XrInstanceCreateInfo instance_create_info = {};
+    instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+    instance_create_info.applicationInfo.applicationVersion = 688;
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+    if (XR_FAILED(xrCreateInstance(&instance_create_info, &instance))) {
+        return XR_NULL_HANDLE;
+    }
+    return instance;
+}
+
+// Test that the loader asks the API layers for every command while creating an instance, unless XR_LOADER_LAZY_DISPATCH is set
+// to 1, when it asks for each command the first time it is called.  Either way, a command that nothing supports fails with
+// XR_ERROR_FUNCTION_UNSUPPORTED.
+DEFINE_TEST(TestDispatchPopulation) {
+    INIT_TEST(TestDispatchPopulation)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestDispatchPopulation)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+
+        // The loader opens the same library, so this counts the loader's requests.
+        LoaderPlatformLibraryHandle layer_library =
+            LoaderPlatformLibraryOpen(TestManifestLibraryPath("resources/layers/XrApiLayer_test.json", "api_layer"));
+        using PFN_TestLayerGetInstanceProcAddrCount = uint32_t (*)(const char*);
+        PFN_TestLayerGetInstanceProcAddrCount get_count = nullptr;
+        if (layer_library != nullptr) {
+            get_count = reinterpret_cast<PFN_TestLayerGetInstanceProcAddrCount>(
+                LoaderPlatformLibraryGetProcAddr(layer_library, "TestLayerGetInstanceProcAddrCount"));
+        }
+        if (get_count == nullptr) {
+            TEST_FAIL("Unable to open the test API layer library")
+        } else {
+            for (uint32_t test = 0; test < 2; ++test) {
+                const bool lazy = test == 1;
+                const std::string subtest_name = lazy ? " with XR_LOADER_LAZY_DISPATCH=1" : " by default";
+                if (lazy) {
+                    LoaderTestSetEnvironmentVariable("XR_LOADER_LAZY_DISPATCH", "1");
+                } else {
+                    LoaderTestUnsetEnvironmentVariable("XR_LOADER_LAZY_DISPATCH");
+                }
+
+                const uint32_t count_before_create = get_count("xrGetSystem");
+                XrInstance instance = CreateTestRuntimeInstance();
+                TEST_NOT_EQUAL(instance, XR_NULL_HANDLE, "xrCreateInstance" + subtest_name)
+                if (instance == XR_NULL_HANDLE) {
+                    continue;
+                }
+                // Looked up once, either while creating the instance or when first called.
+                const uint32_t expected_create_count = lazy ? 0 : 1;
+                const uint32_t expected_call_count = 1 - expected_create_count;
+                const uint32_t count_after_create = get_count("xrGetSystem");
+                TEST_EQUAL(count_after_create - count_before_create, expected_create_count,
+                           "xrGetSystem looked up by xrCreateInstance" + subtest_name)
+
+                XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+                system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                TEST_EQUAL(xrGetSystem(instance, &system_get_info, &system_id), XR_SUCCESS, "First xrGetSystem" + subtest_name)
+                TEST_EQUAL(xrGetSystem(instance, &system_get_info, &system_id), XR_SUCCESS, "Second xrGetSystem" + subtest_name)
+                TEST_EQUAL(get_count("xrGetSystem") - count_after_create, expected_call_count,
+                           "xrGetSystem looked up by calling it" + subtest_name)
+
+                // The test runtime does not implement xrPollEvent.
+                XrEventDataBuffer event_data{XR_TYPE_EVENT_DATA_BUFFER};
+                TEST_EQUAL(xrPollEvent(instance, &event_data), XR_ERROR_FUNCTION_UNSUPPORTED,
+                           "Unsupported xrPollEvent" + subtest_name)
+
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "xrDestroyInstance" + subtest_name)
+            }
+        }
+        if (layer_library != nullptr) {
+            LoaderPlatformLibraryClose(layer_library);
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_LAZY_DISPATCH");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestDispatchPopulation)
+}
+
+// Returns true if calls on the instance reach the runtime on that same instance.  The test runtime reports the
+// instance a system was queried on as its vendor ID.
+static bool InstanceDispatchesToItself(XrInstance instance) {
+    XrSystemGetInfo system_get_info = {};
+    system_get_info.type = XR_TYPE_SYSTEM_GET_INFO;
+    system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+    XrSystemId system_id = XR_NULL_SYSTEM_ID;
+    if (XR_FAILED(xrGetSystem(instance, &system_get_info, &system_id))) {
+        return false;
+    }
+    XrSystemProperties system_properties = {};
+    system_properties.type = XR_TYPE_SYSTEM_PROPERTIES;
+    if (XR_FAILED(xrGetSystemProperties(instance, system_id, &system_properties))) {
+        return false;
+    }
+    return system_properties.vendorId == static_cast<uint32_t>(MakeHandleGeneric(instance));
+}
+
+// Test that several instances can be alive at once, each dispatching to its own runtime instance, both when they are
+// created one after another and when they are created, used and destroyed on several threads at the same time.
+DEFINE_TEST(TestMultipleInstances) {
+    INIT_TEST(TestMultipleInstances)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestMultipleInstances)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name = test == 0 ? " with no API layers" : " with an API layer";
+            if (test == 0) {
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            XrInstance first_instance = CreateTestRuntimeInstance();
+            XrInstance second_instance = CreateTestRuntimeInstance();
+            TEST_NOT_EQUAL(first_instance, XR_NULL_HANDLE, "Creating first instance" + subtest_name)
+            TEST_NOT_EQUAL(second_instance, XR_NULL_HANDLE, "Creating second instance" + subtest_name)
+            if (first_instance != XR_NULL_HANDLE && second_instance != XR_NULL_HANDLE) {
+                TEST_EQUAL(InstanceDispatchesToItself(first_instance), true, "First instance dispatch" + subtest_name)
+                TEST_EQUAL(InstanceDispatchesToItself(second_instance), true, "Second instance dispatch" + subtest_name)
+
+                TEST_EQUAL(xrDestroyInstance(first_instance), XR_SUCCESS, "Destroying first instance" + subtest_name)
+                TEST_EQUAL(InstanceDispatchesToItself(second_instance), true,
+                           "Second instance dispatch after destroying the first" + subtest_name)
+                XrSystemGetInfo system_get_info = {};
+                system_get_info.type = XR_TYPE_SYSTEM_GET_INFO;
+                system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                TEST_EQUAL(xrGetSystem(first_instance, &system_get_info, &system_id), XR_ERROR_HANDLE_INVALID,
+                           "xrGetSystem on the destroyed first instance" + subtest_name)
+                TEST_EQUAL(xrDestroyInstance(second_instance), XR_SUCCESS, "Destroying second instance" + subtest_name)
+            }
+
+            const uint32_t thread_count = 8;
+            const uint32_t instances_per_thread = 16;
+            const uint32_t calls_per_instance = 32;
+            std::atomic<uint32_t> failures{0};
+            std::vector<std::thread> threads;
+            for (uint32_t thread = 0; thread < thread_count; ++thread) {
+                threads.emplace_back([&]() {
+                    for (uint32_t instance_index = 0; instance_index < instances_per_thread; ++instance_index) {
+                        XrInstance instance = CreateTestRuntimeInstance();
+                        if (instance == XR_NULL_HANDLE) {
+                            ++failures;
+                            continue;
+                        }
+                        for (uint32_t call = 0; call < calls_per_instance; ++call) {
+                            if (!InstanceDispatchesToItself(instance)) {
+                                ++failures;
+                            }
+                        }
+                        if (XR_FAILED(xrDestroyInstance(instance))) {
+                            ++failures;
+                        }
+                    }
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            TEST_EQUAL(failures.load(), 0u, "Concurrent instances" + subtest_name)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestMultipleInstances)
+}
+
+// Test that handles created through function pointers from xrGetInstanceProcAddr, extension commands included, can be
+// used with the exported commands while another instance is alive, and that handles destroyed along with their parent
+// are forgotten.
+DEFINE_TEST(TestHandleOwnership) {
+    INIT_TEST(TestHandleOwnership)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestHandleOwnership)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name = test == 0 ? " with no API layers" : " with an API layer";
+            if (test == 0) {
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            // With a second instance alive, the loader cannot fall back to the only instance for a handle it missed.
+            XrInstance instance = CreateTestRuntimeInstance();
+            XrInstance other_instance = CreateTestRuntimeInstance();
+            TEST_NOT_EQUAL(instance, XR_NULL_HANDLE, "Creating instance" + subtest_name)
+            TEST_NOT_EQUAL(other_instance, XR_NULL_HANDLE, "Creating other instance" + subtest_name)
+            if (instance == XR_NULL_HANDLE || other_instance == XR_NULL_HANDLE) {
+                continue;
+            }
+
+            PFN_xrCreateReferenceSpace create_reference_space = nullptr;
+            PFN_xrCreateSpatialAnchorSpaceMSFT create_anchor_space = nullptr;
+            TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrCreateReferenceSpace",
+                                             reinterpret_cast<PFN_xrVoidFunction*>(&create_reference_space)),
+                       XR_SUCCESS, "xrGetInstanceProcAddr for xrCreateReferenceSpace" + subtest_name)
+            TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrCreateSpatialAnchorSpaceMSFT",
+                                             reinterpret_cast<PFN_xrVoidFunction*>(&create_anchor_space)),
+                       XR_SUCCESS, "xrGetInstanceProcAddr for xrCreateSpatialAnchorSpaceMSFT" + subtest_name)
+
+            XrSessionCreateInfo session_create_info{XR_TYPE_SESSION_CREATE_INFO};
+            session_create_info.systemId = 1;
+            XrSession session = XR_NULL_HANDLE;
+            TEST_EQUAL(xrCreateSession(instance, &session_create_info, &session), XR_SUCCESS, "xrCreateSession" + subtest_name)
+            if (create_reference_space != nullptr && create_anchor_space != nullptr && session != XR_NULL_HANDLE) {
+                XrReferenceSpaceCreateInfo reference_space_create_info{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+                reference_space_create_info.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+                reference_space_create_info.poseInReferenceSpace.orientation.w = 1.0f;
+                XrSpace reference_space = XR_NULL_HANDLE;
+                TEST_EQUAL(create_reference_space(session, &reference_space_create_info, &reference_space), XR_SUCCESS,
+                           "Creating a reference space through xrGetInstanceProcAddr" + subtest_name)
+
+                XrSpatialAnchorSpaceCreateInfoMSFT anchor_space_create_info{XR_TYPE_SPATIAL_ANCHOR_SPACE_CREATE_INFO_MSFT};
+                anchor_space_create_info.poseInAnchorSpace.orientation.w = 1.0f;
+                XrSpace anchor_space = XR_NULL_HANDLE;
+                TEST_EQUAL(create_anchor_space(session, &anchor_space_create_info, &anchor_space), XR_SUCCESS,
+                           "Creating a space with an extension command" + subtest_name)
+
+                XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+                TEST_EQUAL(xrLocateSpace(anchor_space, reference_space, 1, &location), XR_SUCCESS,
+                           "xrLocateSpace on the extension space" + subtest_name)
+                TEST_EQUAL(xrDestroySpace(reference_space), XR_SUCCESS, "xrDestroySpace on the reference space" + subtest_name)
+
+                // Destroying the session destroys the spaces created from it, so the loader forgets them.
+                TEST_EQUAL(xrDestroySession(session), XR_SUCCESS, "xrDestroySession" + subtest_name)
+                TEST_EQUAL(xrLocateSpace(anchor_space, anchor_space, 1, &location), XR_ERROR_HANDLE_INVALID,
+                           "xrLocateSpace on a space destroyed with its session" + subtest_name)
+            }
+
+            TEST_EQUAL(xrDestroyInstance(other_instance), XR_SUCCESS, "Destroying other instance" + subtest_name)
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance" + subtest_name)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestHandleOwnership)
+}
+
+// Test that calls made on other threads while an instance is destroyed either complete or report an invalid handle.
+// The instance is the only one alive, so its API layers and the runtime are unloaded while those calls are running.
+DEFINE_TEST(TestConcurrentCallsDuringDestroy) {
+    INIT_TEST(TestConcurrentCallsDuringDestroy)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestConcurrentCallsDuringDestroy)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name = test == 0 ? " with no API layers" : " with an API layer";
+            if (test == 0) {
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            const uint32_t rounds = 32;
+            const uint32_t thread_count = 4;
+            const uint32_t calls_before_destroy = 64;
+            std::atomic<uint32_t> failures{0};
+            for (uint32_t round = 0; round < rounds; ++round) {
+                XrInstance instance = CreateTestRuntimeInstance();
+                if (instance == XR_NULL_HANDLE) {
+                    ++failures;
+                    continue;
+                }
+
+                std::atomic<uint32_t> calls{0};
+                std::atomic<bool> destroy_started{false};
+                std::atomic<bool> destroyed{false};
+                std::vector<std::thread> threads;
+                for (uint32_t thread = 0; thread < thread_count; ++thread) {
+                    threads.emplace_back([&]() {
+                        // Keep calling until a call made after xrDestroyInstance returned has been rejected.
+                        for (;;) {
+                            // Sampled before the calls: if set, both calls started after xrDestroyInstance returned.
+                            bool was_destroyed = destroyed.load();
+                            XrSystemProperties system_properties = {};
+                            system_properties.type = XR_TYPE_SYSTEM_PROPERTIES;
+                            XrResult result = xrGetSystemProperties(instance, 1, &system_properties);
+                            PFN_xrVoidFunction function = nullptr;
+                            XrResult gipa_result = xrGetInstanceProcAddr(instance, "xrGetSystem", &function);
+                            ++calls;
+                            // Sampled after the calls: if not set, both calls finished before xrDestroyInstance started.
+                            bool was_destroy_started = destroy_started.load();
+                            if (result == XR_SUCCESS) {
+                                if (system_properties.vendorId != static_cast<uint32_t>(MakeHandleGeneric(instance))) {
+                                    ++failures;
+                                }
+                            } else if (result != XR_ERROR_HANDLE_INVALID || !was_destroy_started) {
+                                ++failures;
+                            }
+                            if (gipa_result != XR_SUCCESS && (gipa_result != XR_ERROR_HANDLE_INVALID || !was_destroy_started)) {
+                                ++failures;
+                            }
+                            if (was_destroyed) {
+                                if (result != XR_ERROR_HANDLE_INVALID || gipa_result != XR_ERROR_HANDLE_INVALID) {
+                                    ++failures;
+                                }
+                                break;
+                            }
+                        }
+                    });
+                }
+
+                while (calls.load() < thread_count * calls_before_destroy) {
+                    std::this_thread::yield();
+                }
+                destroy_started = true;
+                if (XR_FAILED(xrDestroyInstance(instance))) {
+                    ++failures;
+                }
+                destroyed = true;
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+            }
+            TEST_EQUAL(failures.load(), 0u, "Calls during xrDestroyInstance" + subtest_name)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestConcurrentCallsDuringDestroy)
+}
+
+// Test that instances can be created and destroyed while a call on another instance is blocked inside the runtime, which
+// keeps the instances destroyed meanwhile from being freed until it returns.
+DEFINE_TEST(TestDestroyDuringBlockedCall) {
+    INIT_TEST(TestDestroyDuringBlockedCall)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestDestroyDuringBlockedCall)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name = test == 0 ? " with no API layers" : " with an API layer";
+            if (test == 0) {
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            XrInstance instance = CreateTestRuntimeInstance();
+            TEST_NOT_EQUAL(instance, XR_NULL_HANDLE, "Creating instance" + subtest_name)
+            if (instance == XR_NULL_HANDLE) {
+                continue;
+            }
+            XrSessionCreateInfo session_create_info{XR_TYPE_SESSION_CREATE_INFO};
+            session_create_info.systemId = 1;
+            XrSession session = XR_NULL_HANDLE;
+            TEST_EQUAL(xrCreateSession(instance, &session_create_info, &session), XR_SUCCESS, "xrCreateSession" + subtest_name)
+            if (session == XR_NULL_HANDLE) {
+                xrDestroyInstance(instance);
+                continue;
+            }
+
+            // The test runtime's xrWaitFrame blocks until xrBeginFrame, and xrRequestExitSession reports when it is blocked.
+            XrResult wait_result = XR_ERROR_RUNTIME_FAILURE;
+            std::thread waiter([&]() {
+                XrFrameState frame_state{XR_TYPE_FRAME_STATE};
+                wait_result = xrWaitFrame(session, nullptr, &frame_state);
+            });
+            while (xrRequestExitSession(session) != XR_SUCCESS) {
+                std::this_thread::yield();
+            }
+
+            const uint32_t instance_count = 8;
+            uint32_t failures = 0;
+            for (uint32_t index = 0; index < instance_count; ++index) {
+                XrInstance other_instance = CreateTestRuntimeInstance();
+                if (other_instance == XR_NULL_HANDLE) {
+                    ++failures;
+                    continue;
+                }
+                XrSystemProperties system_properties{XR_TYPE_SYSTEM_PROPERTIES};
+                if (xrGetSystemProperties(other_instance, 1, &system_properties) != XR_SUCCESS ||
+                    xrDestroyInstance(other_instance) != XR_SUCCESS) {
+                    ++failures;
+                }
+            }
+            TEST_EQUAL(failures, 0u, "Creating and destroying instances during a blocked call" + subtest_name)
+
+            TEST_EQUAL(xrBeginFrame(session, nullptr), XR_SUCCESS, "Releasing the blocked call" + subtest_name)
+            waiter.join();
+            TEST_EQUAL(wait_result, XR_SUCCESS, "Blocked call" + subtest_name)
+
+            TEST_EQUAL(xrDestroySession(session), XR_SUCCESS, "xrDestroySession" + subtest_name)
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance" + subtest_name)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestDestroyDuringBlockedCall)
+}
+
+// Create an instance of the test runtime with the given extensions enabled, returning the xrCreateInstance result.
+static XrResult CreateTestRuntimeInstanceWithExtensions(const std::vector<const char*>& extensions, XrInstance& instance) {
+    instance = XR_NULL_HANDLE;
+    XrInstanceCreateInfo instance_create_info = {};
+    instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+    instance_create_info.applicationInfo.applicationVersion = 688;
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+    instance_create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    instance_create_info.enabledExtensionNames = extensions.data();
+    return xrCreateInstance(&instance_create_info, &instance);
+}
+
+// Test that requested instance extensions are checked against both the registry extensions the loader knows by ID and
+// the names it does not know, whether they come from the runtime, an API layer or the loader itself.
+DEFINE_TEST(TestInstanceExtensionSupport) {
+    INIT_TEST(TestInstanceExtensionSupport)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestInstanceExtensionSupport)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+        LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+
+        struct ExtensionCase {
+            const char* extension;
+            bool enable_layer;
+            XrResult expected;
+        };
+        const ExtensionCase cases[] = {
+            {"XR_KHR_fake_ext1", false, XR_SUCCESS},
+            {"XR_KHR_fake_ext3", false, XR_ERROR_EXTENSION_NOT_PRESENT},
+            {"XR_KHR_fake_ext3", true, XR_SUCCESS},
+            {"XR_KHR_composition_layer_cube", false, XR_ERROR_EXTENSION_NOT_PRESENT},
+            {"XR_KHR_composition_layer_cube", true, XR_ERROR_EXTENSION_NOT_PRESENT},
+        };
+        for (const ExtensionCase& test_case : cases) {
+            std::string subtest_name = std::string(" enabling ") + test_case.extension +
+                                       (test_case.enable_layer ? " with an API layer" : " with no API layers");
+            if (test_case.enable_layer) {
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            } else {
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+            }
+            XrInstance instance = XR_NULL_HANDLE;
+            TEST_EQUAL(CreateTestRuntimeInstanceWithExtensions({test_case.extension}, instance), test_case.expected,
+                       "xrCreateInstance" + subtest_name)
+            if (instance != XR_NULL_HANDLE) {
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "xrDestroyInstance" + subtest_name)
+            }
+        }
+
+        // The loader implements XR_EXT_debug_utils itself, and only exposes its commands when it is enabled.
+        LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+        for (uint32_t test = 0; test < 2; ++test) {
+            const bool enable_debug_utils = test == 1;
+            std::string subtest_name = enable_debug_utils ? " with XR_EXT_debug_utils enabled" : " without XR_EXT_debug_utils";
+            std::vector<const char*> extensions = {"XR_KHR_fake_ext1"};
+            if (enable_debug_utils) {
+                extensions.push_back(XR_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            }
+            XrInstance instance = XR_NULL_HANDLE;
+            TEST_EQUAL(CreateTestRuntimeInstanceWithExtensions(extensions, instance), XR_SUCCESS, "xrCreateInstance" + subtest_name)
+            if (instance != XR_NULL_HANDLE) {
+                PFN_xrVoidFunction function = nullptr;
+                XrResult expected_result = XR_ERROR_FUNCTION_UNSUPPORTED;
+                if (enable_debug_utils) {
+                    expected_result = XR_SUCCESS;
+                }
+                TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT", &function), expected_result,
+                           "xrGetInstanceProcAddr(xrSubmitDebugUtilsMessageEXT)" + subtest_name)
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "xrDestroyInstance" + subtest_name)
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestInstanceExtensionSupport)
+}
+
+static XrBool32 XRAPI_PTR IgnoreDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT /*messageSeverity*/,
+                                                  XrDebugUtilsMessageTypeFlagsEXT /*messageTypes*/,
+                                                  const XrDebugUtilsMessengerCallbackDataEXT* /*callbackData*/,
+                                                  void* /*userData*/) {
+    return XR_FALSE;
+}
+
+// Test that the debug utils commands the loader implements keep finding their instance and messengers while other
+// instances and messengers are created and destroyed on another thread, which grows and rebuilds the tables they are
+// looked up in.
+DEFINE_TEST(TestConcurrentDebugUtilsLookups) {
+    INIT_TEST(TestConcurrentDebugUtilsLookups)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestConcurrentDebugUtilsLookups)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+        LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+
+        const std::vector<const char*> extensions = {XR_EXT_DEBUG_UTILS_EXTENSION_NAME};
+        XrInstance instance = XR_NULL_HANDLE;
+        TEST_EQUAL(CreateTestRuntimeInstanceWithExtensions(extensions, instance), XR_SUCCESS, "xrCreateInstance")
+        PFN_xrSubmitDebugUtilsMessageEXT submit_message = nullptr;
+        PFN_xrCreateDebugUtilsMessengerEXT create_messenger = nullptr;
+        PFN_xrDestroyDebugUtilsMessengerEXT destroy_messenger = nullptr;
+        if (instance != XR_NULL_HANDLE) {
+            xrGetInstanceProcAddr(instance, "xrSubmitDebugUtilsMessageEXT", reinterpret_cast<PFN_xrVoidFunction*>(&submit_message));
+            xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT",
+                                  reinterpret_cast<PFN_xrVoidFunction*>(&create_messenger));
+            xrGetInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT",
+                                  reinterpret_cast<PFN_xrVoidFunction*>(&destroy_messenger));
+        }
+        if (submit_message == nullptr || create_messenger == nullptr || destroy_messenger == nullptr) {
+            TEST_FAIL("Unable to get the XR_EXT_debug_utils commands")
+        } else {
+            XrDebugUtilsMessengerCallbackDataEXT callback_data = {};
+            callback_data.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+            callback_data.messageId = "TestConcurrentDebugUtilsLookups";
+            callback_data.functionName = "TestConcurrentDebugUtilsLookups";
+            callback_data.message = "Submitted while other handles come and go";
+
+            const uint32_t thread_count = 4;
+            std::atomic<bool> done{false};
+            std::atomic<uint32_t> submit_failures{0};
+            std::vector<std::thread> threads;
+            for (uint32_t thread = 0; thread < thread_count; ++thread) {
+                threads.emplace_back([&]() {
+                    while (!done.load()) {
+                        if (submit_message(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT,
+                                           XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callback_data) != XR_SUCCESS) {
+                            ++submit_failures;
+                        }
+                    }
+                });
+            }
+
+            XrDebugUtilsMessengerCreateInfoEXT messenger_create_info = {};
+            messenger_create_info.type = XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+            messenger_create_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+            messenger_create_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+            messenger_create_info.userCallback = IgnoreDebugUtilsMessage;
+
+            // Enough of each handle to outgrow the initial tables several times, destroying some along the way.
+            const uint32_t messenger_count = 200;
+            uint32_t messenger_failures = 0;
+            std::vector<XrDebugUtilsMessengerEXT> messengers;
+            for (uint32_t i = 0; i < messenger_count; ++i) {
+                XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+                if (create_messenger(instance, &messenger_create_info, &messenger) != XR_SUCCESS) {
+                    ++messenger_failures;
+                    continue;
+                }
+                messengers.push_back(messenger);
+                if (i % 3 == 0) {
+                    if (destroy_messenger(messengers.front()) != XR_SUCCESS) {
+                        ++messenger_failures;
+                    }
+                    messengers.erase(messengers.begin());
+                }
+            }
+            for (XrDebugUtilsMessengerEXT messenger : messengers) {
+                if (destroy_messenger(messenger) != XR_SUCCESS) {
+                    ++messenger_failures;
+                }
+            }
+            TEST_EQUAL(messenger_failures, 0u, "Creating and destroying messengers while messages are submitted")
+
+            const uint32_t instance_count = 40;
+            uint32_t instance_failures = 0;
+            std::vector<XrInstance> other_instances;
+            for (uint32_t i = 0; i < instance_count; ++i) {
+                XrInstance other_instance = XR_NULL_HANDLE;
+                if (CreateTestRuntimeInstanceWithExtensions(extensions, other_instance) != XR_SUCCESS) {
+                    ++instance_failures;
+                    continue;
+                }
+                other_instances.push_back(other_instance);
+                if (i % 3 == 0) {
+                    if (xrDestroyInstance(other_instances.front()) != XR_SUCCESS) {
+                        ++instance_failures;
+                    }
+                    other_instances.erase(other_instances.begin());
+                }
+            }
+            for (XrInstance other_instance : other_instances) {
+                if (xrDestroyInstance(other_instance) != XR_SUCCESS) {
+                    ++instance_failures;
+                }
+            }
+            TEST_EQUAL(instance_failures, 0u, "Creating and destroying instances while messages are submitted")
+
+            done = true;
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            TEST_EQUAL(submit_failures.load(), 0u, "xrSubmitDebugUtilsMessageEXT on other threads")
+
+            // A destroyed messenger is no longer found.
+            XrDebugUtilsMessengerEXT messenger = XR_NULL_HANDLE;
+            TEST_EQUAL(create_messenger(instance, &messenger_create_info, &messenger), XR_SUCCESS,
+                       "xrCreateDebugUtilsMessengerEXT")
+            TEST_EQUAL(destroy_messenger(messenger), XR_SUCCESS, "xrDestroyDebugUtilsMessengerEXT")
+            TEST_EQUAL(destroy_messenger(messenger), XR_ERROR_HANDLE_INVALID, "xrDestroyDebugUtilsMessengerEXT a second time")
+        }
+        if (instance != XR_NULL_HANDLE) {
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "xrDestroyInstance")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestConcurrentDebugUtilsLookups)
+}
+
+// Enumerate the explicit API layers and return the description of the only one found, or an empty string if there is not
+// exactly one.
+static std::string OnlyApiLayerDescription() {
+    uint32_t layer_count = 0;
+    if (XR_FAILED(xrEnumerateApiLayerProperties(0, &layer_count, nullptr)) || layer_count != 1) {
+        return "";
+    }
+    XrApiLayerProperties layer_props = {XR_TYPE_API_LAYER_PROPERTIES, nullptr, {0}, 0, 0, {0}};
+    if (XR_FAILED(xrEnumerateApiLayerProperties(1, &layer_count, &layer_props))) {
+        return "";
+    }
+    return layer_props.description;
+}
+
+// Test that an API layer manifest is read again after it changes, even though the loader keeps the manifests it has parsed.
+DEFINE_TEST(TestManifestFileCache) {
+    INIT_TEST(TestManifestFileCache)
+
+    try {
+        const std::string manifest_filename = "resources/manifest_cache/XrApiLayer_test.json";
+        std::string manifest_contents;
+        {
+            std::ifstream original("resources/layers/XrApiLayer_test.json");
+            std::stringstream original_contents;
+            original_contents << original.rdbuf();
+            manifest_contents = original_contents.str();
+        }
+        const std::string original_description = "Test_description";
+        const std::string::size_type description_offset = manifest_contents.find(original_description);
+        if (description_offset == std::string::npos) {
+            TEST_FAIL("Unable to read the test layer manifest")
+            TEST_REPORT(TestManifestFileCache)
+            return;
+        }
+
+        // Each version has a different size, so the change is seen even if the modification time does not move.
+        auto write_manifest = [&](const std::string& description) {
+            std::string contents = manifest_contents;
+            contents.replace(description_offset, original_description.size(), description);
+            std::ofstream manifest(manifest_filename, std::ios::trunc);
+            manifest << contents;
+        };
+
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/manifest_cache");
+
+        write_manifest("First version");
+        TEST_EQUAL(OnlyApiLayerDescription(), std::string("First version"), "Layer description after the first read")
+        TEST_EQUAL(OnlyApiLayerDescription(), std::string("First version"), "Layer description from the cache")
+
+        write_manifest("Second, longer version");
+        TEST_EQUAL(OnlyApiLayerDescription(), std::string("Second, longer version"),
+                   "Layer description after the manifest changed")
+
+        // Point the manifest at a copy of the layer library next to it, then remove the copy: the layer is dropped even
+        // though the manifest itself has not changed since it was cached.
+        const std::string library_copy_filename = "resources/manifest_cache/XrApiLayer_test_copy";
+        {
+            std::ifstream library(TestManifestLibraryPath("resources/layers/XrApiLayer_test.json", "api_layer"), std::ios::binary);
+            std::ofstream library_copy(library_copy_filename, std::ios::binary | std::ios::trunc);
+            library_copy << library.rdbuf();
+        }
+        {
+            Json::Value manifest_root;
+            std::istringstream manifest_stream(manifest_contents);
+            manifest_stream >> manifest_root;
+            manifest_root["api_layer"]["library_path"] = "./XrApiLayer_test_copy";
+            manifest_root["api_layer"]["description"] = "Library copy";
+            std::ofstream manifest(manifest_filename, std::ios::trunc);
+            manifest << manifest_root;
+        }
+        TEST_EQUAL(OnlyApiLayerDescription(), std::string("Library copy"), "Layer description with a copy of the library")
+        TEST_EQUAL(OnlyApiLayerDescription(), std::string("Library copy"), "Layer description from the cache")
+        std::remove(library_copy_filename.c_str());
+        TEST_EQUAL(OnlyApiLayerDescription(), std::string(), "Layer description after the library was removed")
+
+        std::remove(manifest_filename.c_str());
+        uint32_t layer_count = 0;
+        xrEnumerateApiLayerProperties(0, &layer_count, nullptr);
+        TEST_EQUAL(layer_count, 0u, "Layer count after the manifest was removed")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestFileCache)
+}
+
+// Enumerate the instance extensions with the two-call idiom and return the version of extension_name, or 0 if it is not
+// listed.
+static uint32_t InstanceExtensionVersion(const char* extension_name) {
+    uint32_t extension_count = 0;
+    if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr))) {
+        return 0;
+    }
+    std::vector<XrExtensionProperties> extension_properties(extension_count, {XR_TYPE_EXTENSION_PROPERTIES});
+    if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, extension_count, &extension_count,
+                                                         extension_properties.data()))) {
+        return 0;
+    }
+    for (const XrExtensionProperties& extension_property : extension_properties) {
+        if (strcmp(extension_property.extensionName, extension_name) == 0) {
+            return extension_property.extensionVersion;
+        }
+    }
+    return 0;
+}
+
+// Test that the merged list of instance extensions follows changes to the API layer manifests and to the enabled API layers.
+DEFINE_TEST(TestInstanceExtensionPropertiesCache) {
+    INIT_TEST(TestInstanceExtensionPropertiesCache)
+
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestInstanceExtensionPropertiesCache)
+            return;
+        }
+        const std::string manifest_filename = "resources/manifest_cache/XrApiLayer_test.json";
+        std::string manifest_contents;
+        {
+            std::ifstream original("resources/layers/XrApiLayer_test.json");
+            std::stringstream original_contents;
+            original_contents << original.rdbuf();
+            manifest_contents = original_contents.str();
+        }
+        const std::string original_version = "\"42\"";
+        const std::string::size_type version_offset = manifest_contents.find(original_version);
+        if (version_offset == std::string::npos) {
+            TEST_FAIL("Unable to read the test layer manifest")
+            TEST_REPORT(TestInstanceExtensionPropertiesCache)
+            return;
+        }
+        auto write_manifest = [&](const std::string& version) {
+            std::string contents = manifest_contents;
+            contents.replace(version_offset, original_version.size(), "\"" + version + "\"");
+            std::ofstream manifest(manifest_filename, std::ios::trunc);
+            manifest << contents;
+        };
+
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/manifest_cache");
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+
+        write_manifest("42");
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext3"), 42u, "API layer extension version")
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext3"), 42u, "API layer extension version enumerated again")
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext2"), 3u, "Runtime version of an extension the API layer also has")
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext1"), 57u, "Runtime extension version")
+        TEST_NOT_EQUAL(InstanceExtensionVersion(XR_EXT_DEBUG_UTILS_EXTENSION_NAME), 0u, "Loader extension")
+
+        write_manifest("4242");
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext3"), 4242u, "API layer extension version after the manifest changed")
+
+        LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext3"), 0u, "API layer extension after the API layer was disabled")
+        TEST_EQUAL(InstanceExtensionVersion("XR_KHR_fake_ext1"), 57u, "Runtime extension after the API layer was disabled")
+
+        std::remove(manifest_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestInstanceExtensionPropertiesCache)
+}
+
+// The members of a jsoncpp manifest document that ReadManifestJson keeps, written out independently of the reader.
+static Json::Value KeptManifestMembers(const Json::Value& value, const std::string& node) {
+    static const std::vector<std::pair<std::string, std::vector<std::string>>> kept_members = {
+        {"root", {"file_format_version", "runtime", "api_layer"}},
+        {"section",
+         {"library_path", "name", "api_version", "implementation_version", "description", "enable_environment",
+          "disable_environment", "functions", "instance_extensions", "instance_extensions_complete"}},
+        {"extension", {"name", "extension_version"}},
+    };
+    if (node == "extension_list" && value.isArray()) {
+        Json::Value kept(Json::arrayValue);
+        for (const Json::Value& extension : value) {
+            kept.append(KeptManifestMembers(extension, "extension"));
+        }
+        return kept;
+    }
+    for (const auto& kept_node : kept_members) {
+        if (kept_node.first != node || !value.isObject()) {
+            continue;
+        }
+        Json::Value kept(Json::objectValue);
+        for (const std::string& member : kept_node.second) {
+            if (!value.isMember(member)) {
+                continue;
+            }
+            std::string child = "value";
+            if (member == "runtime" || member == "api_layer") {
+                child = "section";
+            } else if (member == "instance_extensions") {
+                child = "extension_list";
+            }
+            kept[member] = KeptManifestMembers(value[member], child);
+        }
+        return kept;
+    }
+    return value;
+}
+
+// Returns true if ReadManifestJson reads the text, after checking that jsoncpp also reads it and keeps the same values.
+static bool CompareManifestJsonReaders(const std::string& text, bool& agree) {
+    Json::Value fast_root;
+    const bool fast_read = ReadManifestJson(text.data(), text.data() + text.size(), fast_root);
+
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value jsoncpp_root;
+    std::string errors;
+    const bool jsoncpp_read = reader->parse(text.data(), text.data() + text.size(), &jsoncpp_root, &errors);
+
+    agree = !fast_read || (jsoncpp_read && KeptManifestMembers(jsoncpp_root, "root") == fast_root);
+    return fast_read;
+}
+
+// Test the manifest parser against jsoncpp, which reads any manifest the parser turns down.
+DEFINE_TEST(TestManifestJsonReader) {
+    INIT_TEST(TestManifestJsonReader)
+
+    try {
+        const std::string layer_prefix = R"({"file_format_version": "1.0.0", "api_layer": {"name": "XR_APILAYER_test", )"
+                                         R"("library_path": "libtest.so", "api_version": "1.0", "implementation_version": )";
+        // Plain JSON that the parser reads itself.
+        const std::vector<std::string> plain = {
+            layer_prefix + R"("1", "description": "Test"}})",
+            "\xEF\xBB\xBF" + layer_prefix + "\"1\"}}",
+            " \r\n\t" + layer_prefix + "\"1\"}} \r\n\t",
+            R"({"file_format_version": "1.0.0", "runtime": {"library_path": "a\\b\/c\"d\n\t\u00e9\u20ac\ud83d\ude00"}})",
+            R"({"file_format_version": "1.0.0", "runtime": {"library_path": "libruntime.so", "functions": )"
+            R"({"xrNegotiateLoaderRuntimeInterface": "xrNegotiate"}, "unknown": [1, -2.5, true, null, {"x": [[]]}]}})",
+            layer_prefix + R"("1", "instance_extensions": [{"name": "XR_EXT_a", "extension_version": 1, "entrypoints": )"
+                           R"(["xrA"]}, {"name": "XR_EXT_b", "extension_version": "2"}, 3]}})",
+            layer_prefix + R"("1", "disable_environment": "DISABLE", "enable_environment": "ENABLE"}})",
+            layer_prefix + R"("1", "description": "First", "description": "Second"}, "api_layer": {}})",
+            R"({"file_format_version": 0, "runtime": {"name": -0, "api_version": 999999999999999999, )"
+            R"("description": -999999999999999999}})",
+            R"({"unknown": {"nested": [{"deeper": "\u0041\ud800\udc00"}, -0.125, 1.0, false]}, "runtime": []})",
+            "{\"runtime\": {\"name\": \"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\"}}",
+            "{}",
+            "{\"runtime\": \"string\", \"api_layer\": 5}",
+        };
+        // Text that the parser leaves to jsoncpp, whether or not jsoncpp accepts it.
+        const std::vector<std::string> left_to_jsoncpp = {
+            "",
+            "   ",
+            "[]",
+            "\"string\"",
+            "{",
+            "{\"runtime\": {}",
+            "{\"runtime\": {}}}",
+            "{\"runtime\": {}} x",
+            "{\"runtime\": {},}",
+            "{\"runtime\": [1, 2,]}",
+            "{// comment\n\"runtime\": {}}",
+            "{\"runtime\": {} /* comment */}",
+            "{'runtime': {}}",
+            "{runtime: {}}",
+            "{\"runtime\" {}}",
+            "{\"runtime\": {\"name\": 01}}",
+            "{\"runtime\": {\"name\": 1e5}}",
+            "{\"runtime\": {\"name\": 1.5}}",
+            "{\"runtime\": {\"name\": 1.}}",
+            "{\"runtime\": {\"name\": -}}",
+            "{\"runtime\": {\"name\": +1}}",
+            "{\"runtime\": {\"name\": 9999999999999999999}}",
+            "{\"unknown\": 1e999}",
+            "{\"runtime\": {\"name\": tru}}",
+            "{\"runtime\": {\"name\": NaN}}",
+            "{\"runtime\": {\"name\": \"\\x\"}}",
+            "{\"runtime\": {\"name\": \"\\u12\"}}",
+            "{\"runtime\": {\"name\": \"\\ud800\"}}",
+            "{\"runtime\": {\"name\": \"\\udc00\"}}",
+            "{\"runtime\": {\"name\": \"\\ud800\\u0041\"}}",
+            "{\"runtime\": {\"name\": \"tab\there\"}}",
+            "{\"runtime\": {\"name\": \"unterminated}}",
+            "{\"runtime\": {\"\\u006eame\": \"escaped member name\"}}",
+            "{\"runtime\": {\"name\": \"a\"} \"api_layer\": {}}",
+            std::string("{\"runtime\": {}}\0", 16),
+            std::string(100, '[') + std::string(100, ']'),
+            "{\"unknown\": " + std::string(100, '[') + std::string(100, ']') + "}",
+        };
+
+        for (size_t i = 0; i < plain.size(); ++i) {
+            bool agree = false;
+            TEST_EQUAL(CompareManifestJsonReaders(plain[i], agree), true, "Plain JSON " + std::to_string(i) + " read")
+            TEST_EQUAL(agree, true, "Plain JSON " + std::to_string(i) + " matches jsoncpp")
+        }
+        for (size_t i = 0; i < left_to_jsoncpp.size(); ++i) {
+            bool agree = false;
+            TEST_EQUAL(CompareManifestJsonReaders(left_to_jsoncpp[i], agree), false,
+                       "Other JSON " + std::to_string(i) + " left to jsoncpp")
+            TEST_EQUAL(agree, true, "Other JSON " + std::to_string(i) + " matches jsoncpp")
+        }
+
+        // The manifests written for the tests are plain JSON, apart from the "badjson" ones, some of which have trailing commas
+        // or fractional numbers.
+        for (const std::string& directory : {std::string("resources/layers"), std::string("resources/runtimes")}) {
+            std::vector<std::string> files;
+            FileSysUtilsFindFilesInPath(directory, files);
+            for (const std::string& file : files) {
+                if (file.size() < 5 || file.compare(file.size() - 5, 5, ".json") != 0) {
+                    continue;
+                }
+                std::ifstream manifest(directory + "/" + file, std::ios::binary);
+                std::stringstream contents;
+                contents << manifest.rdbuf();
+                bool agree = false;
+                const bool read = CompareManifestJsonReaders(contents.str(), agree);
+                if (file.find("badjson") == std::string::npos) {
+                    TEST_EQUAL(read, true, "Manifest " + file + " read")
+                }
+                TEST_EQUAL(agree, true, "Manifest " + file + " matches jsoncpp")
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Output results for this test
+    TEST_REPORT(TestManifestJsonReader)
+}
+
+#if defined(XR_OS_LINUX)
+// Run loader_test to print the description of the only API layer, as a new process would see it.  Returns an empty string if
+// it could not be run.
+static std::string ChildApiLayerDescription() {
+    const std::string output_filename = "resources/manifest_cache/description.txt";
+    const std::string command = g_program_path + " --api-layer-description > " + output_filename + " 2>&1";
+    if (std::system(command.c_str()) != 0) {
+        return "";
+    }
+    std::ifstream output_file(output_filename);
+    std::string description;
+    std::getline(output_file, description);
+    output_file.close();
+    std::remove(output_filename.c_str());
+    return description;
+}
+
+// Rewrite a file in place with contents of the same size, keeping its inode and modification time, so that only its contents
+// tell it apart from the version a cache record was made from.
+static bool RewriteKeepingStatus(const std::string& filename, const std::string& contents) {
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) != contents.size()) {
+        return false;
+    }
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+        file << contents;
+        if (!file) {
+            return false;
+        }
+    }
+    const struct timespec times[2] = {file_stat.st_atim, file_stat.st_mtim};
+    return utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0;
+}
+
+// Test that API layer manifests are written to the persistent manifest cache when it is enabled, that later processes read
+// them from it until the manifest changes, and that cache files that cannot be trusted are ignored.
+DEFINE_TEST(TestPersistentManifestCache) {
+    INIT_TEST(TestPersistentManifestCache)
+
+    std::string cache_home;
+    std::string cache_directory;
+    std::string cache_filename;
+    const std::string manifest_filename = "resources/manifest_cache/XrApiLayer_test.json";
+    const std::string library_copy_filename = "resources/manifest_cache/XrApiLayer_test_copy";
+
+    try {
+        std::string current_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/manifest_cache/cache_home", cache_home) ||
+            !FileSysUtilsCombinePaths(cache_home, "openxr", cache_directory) ||
+            !FileSysUtilsCombinePaths(cache_directory, "manifest_cache.bin", cache_filename)) {
+            TEST_FAIL("Unable to set cache path")
+            TEST_REPORT(TestPersistentManifestCache)
+            return;
+        }
+        std::string manifest_contents;
+        {
+            std::ifstream original("resources/layers/XrApiLayer_test.json");
+            std::stringstream original_contents;
+            original_contents << original.rdbuf();
+            manifest_contents = original_contents.str();
+        }
+        const std::string original_description = "Test_description";
+        const std::string::size_type description_offset = manifest_contents.find(original_description);
+        if (description_offset == std::string::npos) {
+            TEST_FAIL("Unable to read the test layer manifest")
+            TEST_REPORT(TestPersistentManifestCache)
+            return;
+        }
+        // Same size as the original, so that only the contents of the manifest change.
+        std::string same_size_contents = manifest_contents;
+        same_size_contents.replace(description_offset, original_description.size(), "Xest_description");
+        std::string edited_contents = manifest_contents;
+        edited_contents.replace(description_offset, original_description.size(), "Edited description");
+
+        LoaderTestSetEnvironmentVariable("XR_LOADER_MANIFEST_CACHE", "1");
+        LoaderTestSetEnvironmentVariable("XDG_CACHE_HOME", cache_home);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/manifest_cache");
+
+        // Write the manifest and a cache file holding it, then change the manifest's contents without changing anything the
+        // cache checks, so that the description tells whether the manifest was read from the cache or parsed.
+        auto prepare_stale_cache = [&]() {
+            std::remove(cache_filename.c_str());
+            {
+                std::ofstream manifest(manifest_filename, std::ios::binary | std::ios::trunc);
+                manifest << manifest_contents;
+            }
+            return ChildApiLayerDescription() == original_description &&
+                   RewriteKeepingStatus(manifest_filename, same_size_contents);
+        };
+
+        TEST_EQUAL(prepare_stale_cache(), true, "Writing the cache file")
+        std::string cache_magic(8, '\0');
+        {
+            std::ifstream cache_file(cache_filename, std::ios::binary);
+            cache_file.read(&cache_magic[0], cache_magic.size());
+        }
+        TEST_EQUAL(cache_magic, std::string("XRMFCACH"), "Cache file written")
+        TEST_EQUAL(ChildApiLayerDescription(), original_description, "Layer description read from the cache")
+
+        // Editing the manifest changes its size and modification time.
+        {
+            std::ofstream manifest(manifest_filename, std::ios::binary | std::ios::trunc);
+            manifest << edited_contents;
+        }
+        TEST_EQUAL(ChildApiLayerDescription(), std::string("Edited description"), "Layer description after editing the manifest")
+        TEST_EQUAL(ChildApiLayerDescription(), std::string("Edited description"), "Edited layer description read again")
+
+        // A cache file cut short is ignored as a whole.
+        struct stat cache_stat;
+        TEST_EQUAL(prepare_stale_cache() && stat(cache_filename.c_str(), &cache_stat) == 0 &&
+                       truncate(cache_filename.c_str(), cache_stat.st_size - 1) == 0,
+                   true, "Truncating the cache file")
+        TEST_EQUAL(ChildApiLayerDescription(), std::string("Xest_description"), "Truncated cache file ignored")
+
+        // So is one that anyone else could have written.
+        TEST_EQUAL(prepare_stale_cache() && chmod(cache_filename.c_str(), 0620) == 0, true, "Making the cache file group-writable")
+        TEST_EQUAL(ChildApiLayerDescription(), std::string("Xest_description"), "Group-writable cache file ignored")
+
+        if (geteuid() == 0) {
+            TEST_EQUAL(prepare_stale_cache() && chown(cache_filename.c_str(), 1, static_cast<gid_t>(-1)) == 0, true,
+                       "Giving the cache file to another user")
+            TEST_EQUAL(ChildApiLayerDescription(), std::string("Xest_description"), "Cache file of another user ignored")
+        } else {
+            // Only root can give a file away.
+            cout << "        Cache file of another user: Skipped" << endl;
+            local_total++;
+            local_skipped++;
+        }
+
+        // A record whose library has been removed since it was written is not used, even though the manifest is unchanged.
+        {
+            std::ifstream library(TestManifestLibraryPath("resources/layers/XrApiLayer_test.json", "api_layer"), std::ios::binary);
+            std::ofstream library_copy(library_copy_filename, std::ios::binary | std::ios::trunc);
+            library_copy << library.rdbuf();
+        }
+        {
+            Json::Value manifest_root;
+            std::istringstream manifest_stream(manifest_contents);
+            manifest_stream >> manifest_root;
+            manifest_root["api_layer"]["library_path"] = "./XrApiLayer_test_copy";
+            manifest_root["api_layer"]["description"] = "Library copy";
+            std::remove(cache_filename.c_str());
+            std::ofstream manifest(manifest_filename, std::ios::trunc);
+            manifest << manifest_root;
+        }
+        TEST_EQUAL(ChildApiLayerDescription(), std::string("Library copy"), "Layer with a copy of the library written to the cache")
+        std::remove(library_copy_filename.c_str());
+        TEST_NOT_EQUAL(ChildApiLayerDescription(), std::string("Library copy"), "Cache record of a removed library ignored")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    std::remove(manifest_filename.c_str());
+    std::remove(library_copy_filename.c_str());
+    std::remove(cache_filename.c_str());
+    rmdir(cache_directory.c_str());
+    rmdir(cache_home.c_str());
+    TEST_EQUAL(FileSysUtilsPathExists(cache_home), false, "Cache directory removed")
+    CleanupEnvironmentVariables();
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_MANIFEST_CACHE");
+    LoaderTestUnsetEnvironmentVariable("XDG_CACHE_HOME");
+
+    // Output results for this test
+    TEST_REPORT(TestPersistentManifestCache)
+}
+#endif  // defined(XR_OS_LINUX)
+
+#if defined(XR_OS_LINUX)
+// Run loader_test under "strace -c" to enumerate the API layers the given number of times, and return the number of system
+// calls it made.
+static bool CountEnumerationSystemCalls(uint32_t enumerations, uint64_t& calls) {
+    const std::string summary_filename = "resources/manifest_scan/strace_summary.txt";
+    const std::string command = "strace -f -c -o " + summary_filename + " " + g_program_path + " --enumerate-api-layers " +
+                                std::to_string(enumerations) + " > /dev/null 2>&1";
+    if (std::system(command.c_str()) != 0) {
+        return false;
+    }
+    // The calls column is right aligned under its heading, so the total is the number that ends where the heading does.
+    std::ifstream summary(summary_filename);
+    std::string line;
+    std::string::size_type calls_end = std::string::npos;
+    while (std::getline(summary, line)) {
+        const std::string::size_type heading = line.find("calls");
+        if (calls_end == std::string::npos && heading != std::string::npos && line.find("syscall") != std::string::npos) {
+            calls_end = heading + 5;
+        } else if (calls_end != std::string::npos && line.size() > calls_end &&
+                   line.compare(line.size() - 5, 5, "total") == 0) {
+            const std::string::size_type calls_begin = line.find_last_of(' ', calls_end - 1);
+            calls = std::stoull(line.substr(calls_begin + 1, calls_end - calls_begin - 1));
+            std::remove(summary_filename.c_str());
+            return true;
+        }
+    }
+    return false;
+}
+
+// Test that searching a directory of API layer manifests takes about one system call per manifest once the manifests have
+// been parsed, now that the directory scan reads the status of each file while listing the directory.  strace is needed to
+// count the calls, so the test is skipped where it is not installed or cannot trace processes.
+DEFINE_TEST(TestDirectoryScanSyscalls) {
+    INIT_TEST(TestDirectoryScanSyscalls)
+
+    const uint32_t manifest_count = 64;
+    const uint32_t repeated_enumerations = 10;
+    // Calls per search other than those for each manifest, such as for the search paths that do not exist.
+    const uint64_t calls_per_search = 32;
+
+    try {
+        // strace may be installed but unable to trace, such as where ptrace is not permitted.
+        if (std::system("strace -f -o /dev/null true > /dev/null 2>&1") != 0) {
+            cout << "        strace not found or unable to trace: Skipped" << endl;
+            local_total++;
+            local_skipped++;
+            TEST_REPORT(TestDirectoryScanSyscalls)
+            return;
+        }
+
+        std::string manifest_contents;
+        {
+            std::ifstream original("resources/layers/XrApiLayer_test.json");
+            std::stringstream original_contents;
+            original_contents << original.rdbuf();
+            manifest_contents = original_contents.str();
+        }
+        const std::string original_name = "\"XR_APILAYER_test\"";
+        const std::string::size_type name_offset = manifest_contents.find(original_name);
+        if (name_offset == std::string::npos) {
+            TEST_FAIL("Unable to read the test layer manifest")
+            TEST_REPORT(TestDirectoryScanSyscalls)
+            return;
+        }
+        for (uint32_t manifest = 0; manifest < manifest_count; ++manifest) {
+            std::string contents = manifest_contents;
+            contents.replace(name_offset, original_name.size(), "\"XR_APILAYER_test_scan_" + std::to_string(manifest) + "\"");
+            std::ofstream out("resources/manifest_scan/XrApiLayer_test_scan_" + std::to_string(manifest) + ".json",
+                              std::ios::trunc);
+            out << contents;
+        }
+
+        // A relative path, since it used to cost a lookup of the current directory for every manifest.
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/manifest_scan");
+
+        // The first search parses the manifests, so only the calls made by the searches after it are compared.
+        uint64_t first_calls = 0;
+        uint64_t repeated_calls = 0;
+        if (!CountEnumerationSystemCalls(1, first_calls) ||
+            !CountEnumerationSystemCalls(1 + repeated_enumerations, repeated_calls) || repeated_calls < first_calls) {
+            // The enumeration itself is tested elsewhere; here a failed strace run only means the calls could not be counted.
+            cout << "        Unable to count system calls with strace: Skipped" << endl;
+            local_total++;
+            local_skipped++;
+        } else {
+            const uint64_t calls_per_enumeration = (repeated_calls - first_calls) / repeated_enumerations;
+            cout << "        " << calls_per_enumeration << " system calls per search of " << manifest_count << " manifests"
+                 << endl;
+            TEST_EQUAL(calls_per_enumeration <= manifest_count + calls_per_search, true, "System calls per manifest search")
+        }
+
+        for (uint32_t manifest = 0; manifest < manifest_count; ++manifest) {
+            std::remove(("resources/manifest_scan/XrApiLayer_test_scan_" + std::to_string(manifest) + ".json").c_str());
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestDirectoryScanSyscalls)
+}
+#endif  // defined(XR_OS_LINUX)
+
+#if defined(XR_OS_LINUX) && !defined(XR_LOADER_DIRECT_RUNTIME)
+// Test that loading the runtime on a background thread with XR_LOADER_PRELOAD_RUNTIME gives the same result and log messages
+// as loading it in xrCreateInstance.  The preload only happens once per process, so each case runs loader_test again.
+DEFINE_TEST(TestRuntimePreload) {
+    INIT_TEST(TestRuntimePreload)
+
+    try {
+        const std::string output_filename = "resources/runtime_preload_output.txt";
+        auto create_instance_in_child = [&](bool preload, std::string& output) {
+            if (preload) {
+                LoaderTestSetEnvironmentVariable("XR_LOADER_PRELOAD_RUNTIME", "1");
+            } else {
+                LoaderTestUnsetEnvironmentVariable("XR_LOADER_PRELOAD_RUNTIME");
+            }
+            const std::string command = g_program_path + " --create-instance > " + output_filename + " 2>&1";
+            if (std::system(command.c_str()) != 0) {
+                return false;
+            }
+            std::ifstream output_file(output_filename);
+            std::stringstream output_contents;
+            output_contents << output_file.rdbuf();
+            // Handles and addresses differ from one run to the next.
+            output = std::regex_replace(output_contents.str(), std::regex("0x[0-9a-f]+"), "0x");
+            std::remove(output_filename.c_str());
+            return true;
+        };
+
+        std::string current_path;
+        if (!FileSysUtilsGetCurrentPath(current_path)) {
+            TEST_FAIL("Unable to get the current path")
+            TEST_REPORT(TestRuntimePreload)
+            return;
+        }
+        // Whether or not the runtime loads, the same messages down to info show that it was loaded only once.
+        struct PreloadedRuntime {
+            std::string manifest;
+            XrResult result;
+        };
+        const std::vector<PreloadedRuntime> runtimes = {
+            {"test_runtime.json", XR_SUCCESS},
+            {"test_runtime_badnegotiate_always.json", XR_ERROR_RUNTIME_UNAVAILABLE},
+        };
+        for (const PreloadedRuntime& runtime : runtimes) {
+            std::string runtime_json;
+            FileSysUtilsCombinePaths(current_path, "resources/runtimes/" + runtime.manifest, runtime_json);
+            LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+            LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", "info");
+
+            std::string preload_output;
+            std::string synchronous_output;
+            if (!create_instance_in_child(true, preload_output) || !create_instance_in_child(false, synchronous_output)) {
+                TEST_FAIL("Unable to run loader_test to create an instance with " + runtime.manifest)
+                continue;
+            }
+            const std::string result_line = "xrCreateInstance result " + std::to_string(runtime.result);
+            TEST_EQUAL(preload_output.find(result_line) != std::string::npos, true,
+                       "xrCreateInstance result with a preloaded " + runtime.manifest)
+            TEST_EQUAL(preload_output, synchronous_output, "Loader messages with a preloaded " + runtime.manifest)
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_PRELOAD_RUNTIME");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestRuntimePreload)
+}
+#endif  // defined(XR_OS_LINUX) && !defined(XR_LOADER_DIRECT_RUNTIME)
+
+#if defined(XR_OS_LINUX)
+// Test that XR_LOADER_RUNTIME_RESIDENCY decides when the runtime is unloaded after the last instance is destroyed.  The
+// runtime stays loaded until the process exits once it is no longer unloaded, so each case runs loader_test again.
+DEFINE_TEST(TestRuntimeResidency) {
+    INIT_TEST(TestRuntimeResidency)
+
+    try {
+        const std::string output_filename = "resources/runtime_residency_output.txt";
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestRuntimeResidency)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", "info");
+
+        struct ResidencyCase {
+            const char* residency;
+            uint32_t wait_milliseconds;
+            bool unloaded;
+        };
+        const std::vector<ResidencyCase> residency_cases = {
+            {"", 0, true},
+            {"instance", 0, true},
+            {"process", 500, false},
+            {"60000", 500, false},
+            {"50", 2000, true},
+            {"not a duration", 0, true},
+        };
+        for (const ResidencyCase& residency_case : residency_cases) {
+            const std::string residency = residency_case.residency;
+            if (residency.empty()) {
+                LoaderTestUnsetEnvironmentVariable("XR_LOADER_RUNTIME_RESIDENCY");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_LOADER_RUNTIME_RESIDENCY", residency);
+            }
+            const std::string command = g_program_path + " --create-instance " +
+                                        std::to_string(residency_case.wait_milliseconds) + " > " + output_filename + " 2>&1";
+            if (std::system(command.c_str()) != 0) {
+                TEST_FAIL("Unable to run loader_test to create an instance with residency \"" + residency + "\"")
+                continue;
+            }
+            std::ifstream output_file(output_filename);
+            std::stringstream output_contents;
+            output_contents << output_file.rdbuf();
+            const std::string output = output_contents.str();
+            std::remove(output_filename.c_str());
+
+            // Only an unload before the child stopped waiting counts, not one while the process exits.
+            const std::string::size_type unloaded = output.find("Unloading RuntimeInterface");
+            const std::string::size_type waited = output.find("Waited ");
+            TEST_EQUAL(output.find("xrCreateInstance result 0") != std::string::npos, true,
+                       "xrCreateInstance with residency \"" + residency + "\"")
+            TEST_EQUAL(unloaded != std::string::npos && unloaded < waited, residency_case.unloaded,
+                       "Runtime unloaded with residency \"" + residency + "\"")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_RUNTIME_RESIDENCY");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestRuntimeResidency)
+}
+
+// Test that XR_LOADER_DEBUG=timing logs a summary of the startup phases of each command, and that no other debug level
+// does.  The loader reads XR_LOADER_DEBUG once per process, so each case runs loader_test again.
+DEFINE_TEST(TestStartupTiming) {
+    INIT_TEST(TestStartupTiming)
+
+    try {
+        const std::string output_filename = "resources/startup_timing_output.txt";
+        std::string current_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestStartupTiming)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+
+        struct TimingCase {
+            const char* debug_level;
+            bool timed;
+        };
+        const std::vector<TimingCase> timing_cases = {
+            {"timing", true},
+            {"all", false},
+        };
+        const std::vector<std::string> create_instance_phases = {
+#ifndef XR_LOADER_DIRECT_RUNTIME
+            "manifest search: runtime",
+            "runtime library open: ",
+#endif  // !XR_LOADER_DIRECT_RUNTIME
+            "runtime negotiation: ",
+            "manifest parse: 0 files for implicit API layers",
+            "API layer library open: XR_APILAYER_test",
+            "API layer negotiation: XR_APILAYER_test",
+            "API layer xrCreateApiLayerInstance: XR_APILAYER_test",
+            "runtime xrCreateInstance",
+        };
+        for (const TimingCase& timing_case : timing_cases) {
+            const std::string debug_level = timing_case.debug_level;
+            LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", debug_level);
+            const std::string command = g_program_path + " --create-instance > " + output_filename + " 2>&1";
+            if (std::system(command.c_str()) != 0) {
+                TEST_FAIL("Unable to run loader_test to create an instance with XR_LOADER_DEBUG=" + debug_level)
+                continue;
+            }
+            std::ifstream output_file(output_filename);
+            std::stringstream output_contents;
+            output_contents << output_file.rdbuf();
+            const std::string output = output_contents.str();
+            std::remove(output_filename.c_str());
+
+            TEST_EQUAL(output.find("xrCreateInstance result 0") != std::string::npos, true,
+                       "xrCreateInstance with XR_LOADER_DEBUG=" + debug_level)
+            TEST_EQUAL(output.find("Startup timing") != std::string::npos, timing_case.timed,
+                       "Startup timing logged with XR_LOADER_DEBUG=" + debug_level)
+            if (!timing_case.timed) {
+                continue;
+            }
+            // Only the summary is logged, not the other messages of the same severity.
+            TEST_EQUAL(output.find("Info [GENERAL"), std::string::npos, "Other info messages with XR_LOADER_DEBUG=timing")
+            TEST_EQUAL(output.find("[PERF | xrEnumerateApiLayerProperties | OpenXR-Loader] : Startup timing") != std::string::npos,
+                       true, "xrEnumerateApiLayerProperties startup timing")
+            const std::string::size_type create_instance_summary =
+                output.find("[PERF | xrCreateInstance | OpenXR-Loader] : Startup timing");
+            TEST_EQUAL(create_instance_summary != std::string::npos, true, "xrCreateInstance startup timing")
+            if (create_instance_summary != std::string::npos) {
+                for (const std::string& phase : create_instance_phases) {
+                    TEST_EQUAL(output.find(phase, create_instance_summary) != std::string::npos, true,
+                               "xrCreateInstance startup timing of \"" + phase + "\"")
+                }
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestStartupTiming)
+}
+#endif  // defined(XR_OS_LINUX)
+
+#if defined(XR_OS_LINUX)
+// Test that API layers that are slow to negotiate are loaded at the same time, and that the chain, the result and the log
+// messages are the same as when they are loaded one after the other.  Each layer is a copy of the test layer library that
+// sleeps for the number of milliseconds at the end of its name before negotiating.
+DEFINE_TEST(TestParallelApiLayerLoading) {
+    INIT_TEST(TestParallelApiLayerLoading)
+
+    try {
+        const std::string layer_directory = "resources/parallel_layers/";
+        const std::string output_filename = "resources/parallel_layers_output.txt";
+        std::string current_path;
+        std::string runtime_json;
+        std::string library_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestParallelApiLayerLoading)
+            return;
+        }
+        {
+            std::ifstream manifest_file("resources/layers/XrApiLayer_test.json");
+            Json::Value manifest;
+            manifest_file >> manifest;
+            library_path = manifest["api_layer"]["library_path"].asString();
+        }
+
+        // Each layer gets its own copy of the library, so that no two of them share anything.
+        struct ParallelLayer {
+            std::string name;
+            // The negotiation function, or nullptr for a layer whose library is not a library.
+            const char* function;
+            bool loads;
+        };
+        const std::vector<ParallelLayer> layers = {
+            {"XR_APILAYER_test_delay_400", "TestLayerDelayedNegotiateLoaderApiLayerInterface", true},
+            {"XR_APILAYER_test_delay_300", "TestLayerDelayedNegotiateLoaderApiLayerInterface", true},
+            {"XR_APILAYER_test_fail_0", "TestlayerAlwaysFailNegotiateLoaderApiLayerInterface", false},
+            {"XR_APILAYER_test_delay_200", "TestLayerDelayedNegotiateLoaderApiLayerInterface", true},
+            {"XR_APILAYER_test_delay_100", "TestLayerDelayedNegotiateLoaderApiLayerInterface", true},
+            {"XR_APILAYER_test_broken_0", nullptr, false},
+        };
+        const uint32_t serial_milliseconds = 400 + 300 + 200 + 100;
+        for (const ParallelLayer& layer : layers) {
+            const std::string library_name = "lib" + layer.name + ".so";
+            std::ofstream library_copy(layer_directory + library_name, std::ios::binary | std::ios::trunc);
+            if (layer.function != nullptr) {
+                std::ifstream library(library_path, std::ios::binary);
+                library_copy << library.rdbuf();
+            } else {
+                library_copy << "Not a library\n";
+            }
+            std::ofstream manifest(layer_directory + layer.name + ".json", std::ios::trunc);
+            manifest << "{\"file_format_version\": \"1.0.0\", \"api_layer\": {\"name\": \"" << layer.name
+                     << "\", \"library_path\": \"./" << library_name
+                     << "\", \"api_version\": \"1.0\", \"implementation_version\": \"1\", \"description\": \"Test_description\"";
+            if (layer.function != nullptr) {
+                manifest << ", \"functions\": {\"xrNegotiateLoaderApiLayerInterface\": \"" << layer.function << "\"}";
+            }
+            manifest << "}}\n";
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_directory);
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", "info");
+
+        struct LayerCase {
+            std::vector<uint32_t> enabled;
+            XrResult result;
+        };
+        const std::vector<LayerCase> layer_cases = {
+            // The failures are ignored once an earlier layer has loaded.
+            {{0, 1, 2, 3, 4, 5}, XR_SUCCESS},
+            // With no layer loaded, the last failure decides the result.
+            {{2, 5}, XR_ERROR_FILE_ACCESS_ERROR},
+            {{5, 2}, XR_ERROR_INITIALIZATION_FAILED},
+        };
+        for (const LayerCase& layer_case : layer_cases) {
+            std::string enabled_layers;
+            for (uint32_t layer : layer_case.enabled) {
+                enabled_layers += (enabled_layers.empty() ? "" : ":") + layers[layer].name;
+            }
+            LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", enabled_layers);
+
+            const std::string command = g_program_path + " --create-instance > " + output_filename + " 2>&1";
+            const auto start = std::chrono::steady_clock::now();
+            if (std::system(command.c_str()) != 0) {
+                TEST_FAIL("Unable to run loader_test to create an instance with layers " + enabled_layers)
+                continue;
+            }
+            const auto milliseconds =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            std::ifstream output_file(output_filename);
+            std::stringstream output_contents;
+            output_contents << output_file.rdbuf();
+            const std::string output = output_contents.str();
+            std::remove(output_filename.c_str());
+
+            TEST_EQUAL(output.find("xrCreateInstance result " + std::to_string(layer_case.result)) != std::string::npos, true,
+                       "xrCreateInstance result with layers " + enabled_layers)
+
+            // Every layer is logged in the order it is enabled, whichever finished first.
+            std::string::size_type previous = 0;
+            bool in_order = true;
+            for (uint32_t layer : layer_case.enabled) {
+                const std::string message =
+                    (layers[layer].loads ? "succeeded loading layer " : "skipping layer ") + layers[layer].name;
+                const std::string::size_type found = output.find(message, previous);
+                if (found == std::string::npos) {
+                    in_order = false;
+                    break;
+                }
+                previous = found;
+            }
+            TEST_EQUAL(in_order, true, "Layer messages in order with layers " + enabled_layers)
+            if (layer_case.result == XR_SUCCESS) {
+                TEST_EQUAL(milliseconds < serial_milliseconds, true, "Layers loaded at the same time")
+            }
+        }
+
+        for (const ParallelLayer& layer : layers) {
+            std::remove((layer_directory + "lib" + layer.name + ".so").c_str());
+            std::remove((layer_directory + layer.name + ".json").c_str());
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
     }
 
-#define TEST_FAIL(cout_string) \
-    local_total++;             \
-    local_failed++;            \
-    cout << "        " << cout_string << ": Failed" << endl;
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    CleanupEnvironmentVariables();
 
-// Test creating and destroying an OpenXR instance through the loader.
-DEFINE_TEST(TestCreateDestroyInstance) {
-    INIT_TEST(TestCreateDestroyInstance)
+    // Output results for this test
+    TEST_REPORT(TestParallelApiLayerLoading)
+}
 
+// Test that API layers whose manifests name the same library are loaded one after the other, while a layer with a library
+// of its own is still loaded at the same time as them.  Each layer sleeps for the number of milliseconds at the end of its
+// name before negotiating.  The test layer keeps one dispatch table per instance, so only one copy of it can be in a chain,
+// and the second layer sharing its library fails negotiation once it has slept.
+DEFINE_TEST(TestSharedLibraryApiLayerLoading) {
+    INIT_TEST(TestSharedLibraryApiLayerLoading)
+
+    const std::string layer_directory = "resources/parallel_layers/";
+    struct SharedLayer {
+        std::string name;
+        std::string library_name;
+        const char* function;
+        bool loads;
+    };
+    const std::vector<SharedLayer> layers = {
+        {"XR_APILAYER_test_shared_300", "libXR_APILAYER_test_shared.so", "TestLayerDelayedNegotiateLoaderApiLayerInterface", true},
+        {"XR_APILAYER_test_shared_200", "libXR_APILAYER_test_shared.so", "TestLayerDelayedFailNegotiateLoaderApiLayerInterface",
+         false},
+        {"XR_APILAYER_test_own_400", "libXR_APILAYER_test_own.so", "TestLayerDelayedNegotiateLoaderApiLayerInterface", true},
+    };
     try {
-        XrResult expected_result = XR_SUCCESS;
-        char valid_layer_to_enable[] = "XR_APILAYER_LUNARG_api_dump";
-        char invalid_layer_to_enable[] = "XrApiLayer_invalid_layer_test";
-        char invalid_extension_to_enable[] = "XR_KHR_fake_ext1";
-        const char* const valid_layer_name_array[1] = {valid_layer_to_enable};
-        const char* const invalid_layer_name_array[1] = {invalid_layer_to_enable};
-        const char* valid_extension_name_array[1];
-        const char* const invalid_extension_name_array[1] = {invalid_extension_to_enable};
-        XrApplicationInfo application_info = {};
-        strcpy(application_info.applicationName, "Loader Test");
-        application_info.applicationVersion = 688;
-        strcpy(application_info.engineName, "Infinite Improbability Drive");
-        application_info.engineVersion = 42;
-        application_info.apiVersion = XR_CURRENT_API_VERSION;
-
+        const std::string output_filename = "resources/shared_layers_output.txt";
         std::string current_path;
-        std::string layer_path;
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestSharedLibraryApiLayerLoading)
+            return;
+        }
+        const std::string library_path = TestManifestLibraryPath("resources/layers/XrApiLayer_test.json", "api_layer");
+
+        std::string enabled_layers;
+        for (const SharedLayer& layer : layers) {
+            {
+                std::ifstream library(library_path, std::ios::binary);
+                std::ofstream library_copy(layer_directory + layer.library_name, std::ios::binary | std::ios::trunc);
+                library_copy << library.rdbuf();
+            }
+            std::ofstream manifest(layer_directory + layer.name + ".json", std::ios::trunc);
+            manifest << "{\"file_format_version\": \"1.0.0\", \"api_layer\": {\"name\": \"" << layer.name
+                     << "\", \"library_path\": \"./" << layer.library_name
+                     << "\", \"api_version\": \"1.0\", \"implementation_version\": \"1\", \"description\": \"Test_description\""
+                     << ", \"functions\": {\"xrNegotiateLoaderApiLayerInterface\": \"" << layer.function << "\"}}}\n";
+            enabled_layers += (enabled_layers.empty() ? "" : ":") + layer.name;
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_directory);
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", enabled_layers);
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", "info");
+
+        const std::string command = g_program_path + " --create-instance > " + output_filename + " 2>&1";
+        const auto start = std::chrono::steady_clock::now();
+        if (std::system(command.c_str()) != 0) {
+            TEST_FAIL("Unable to run loader_test to create an instance with layers " + enabled_layers)
+        } else {
+            const auto milliseconds =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            std::ifstream output_file(output_filename);
+            std::stringstream output_contents;
+            output_contents << output_file.rdbuf();
+            const std::string output = output_contents.str();
+            output_file.close();
+            std::remove(output_filename.c_str());
+
+            TEST_EQUAL(output.find("xrCreateInstance result " + std::to_string(XR_SUCCESS)) != std::string::npos, true,
+                       "xrCreateInstance result with layers sharing a library")
+            for (const SharedLayer& layer : layers) {
+                const std::string message = (layer.loads ? "succeeded loading layer " : "skipping layer ") + layer.name;
+                TEST_EQUAL(output.find(message) != std::string::npos, true, "Negotiated with " + layer.name)
+            }
+            TEST_EQUAL(milliseconds >= 300 + 200, true, "Layers sharing a library loaded one after the other")
+            TEST_EQUAL(milliseconds < 300 + 200 + 400, true, "Layer with its own library loaded at the same time")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
 
-        // Ensure using installed runtime
-        LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+    // Cleanup
+    for (const SharedLayer& layer : layers) {
+        std::remove((layer_directory + layer.library_name).c_str());
+        std::remove((layer_directory + layer.name + ".json").c_str());
+    }
+    LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    CleanupEnvironmentVariables();
 
-        // Convert relative test layer path to absolute, set envar
-        FileSysUtilsGetCurrentPath(layer_path);
-        layer_path =
-            layer_path + TEST_DIRECTORY_SYMBOL + ".." + TEST_DIRECTORY_SYMBOL + ".." + TEST_DIRECTORY_SYMBOL + "api_layers";
-        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+    // Output results for this test
+    TEST_REPORT(TestSharedLibraryApiLayerLoading)
+}
 
-        // Look to see if the runtime supports any extensions, if it does, use the first one in this test.
-        bool missing_extensions = true;
+// Test that the messages logged while parsing API layer manifests come out in the order the manifests were found, even when
+// enough of them need parsing for the loader to parse them on several threads.
+DEFINE_TEST(TestManifestParseLogOrder) {
+    INIT_TEST(TestManifestParseLogOrder)
 
-        // Make API dump write to a file, when loaded
-        LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_out.txt");
+    const std::string manifest_directory = "resources/parallel_layers";
+    const uint32_t manifest_count = 64;
+    try {
+        const std::string output_filename = "resources/parse_order_output.txt";
+        // Every manifest names a library that does not exist, so each one logs an error naming its file.
+        for (uint32_t manifest = 0; manifest < manifest_count; ++manifest) {
+            const std::string name = "XR_APILAYER_test_parse_order_" + std::to_string(manifest);
+            std::ofstream out(manifest_directory + "/" + name + ".json", std::ios::trunc);
+            out << "{\"file_format_version\": \"1.0.0\", \"api_layer\": {\"name\": \"" << name << "\", \"library_path\": \"./lib"
+                << name << ".so\", \"api_version\": \"1.0\", \"implementation_version\": \"1\"}}\n";
+        }
+        std::vector<FileSysUtilsDirectoryEntry> entries;
+        TEST_EQUAL(FileSysUtilsScanDirectory(manifest_directory, ".json", entries), true, "Listing the manifests")
+
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", manifest_directory);
+        LoaderTestSetEnvironmentVariable("XR_LOADER_DEBUG", "error");
+        const std::string command = g_program_path + " --enumerate-api-layers 1 > " + output_filename + " 2>&1";
+        TEST_EQUAL(std::system(command.c_str()), 0, "Running loader_test to enumerate the API layers")
+        std::ifstream output_file(output_filename);
+        std::stringstream output_contents;
+        output_contents << output_file.rdbuf();
+        const std::string output = output_contents.str();
+        output_file.close();
+        std::remove(output_filename.c_str());
+
+        // The search lists the directory the same way, so it finds the manifests in this order.
+        std::string::size_type previous = 0;
+        uint32_t in_order = 0;
+        for (const FileSysUtilsDirectoryEntry& entry : entries) {
+            const std::string::size_type found = output.find("/" + entry.name + " library ", previous);
+            if (found == std::string::npos) {
+                break;
+            }
+            previous = found;
+            ++in_order;
+        }
+        TEST_EQUAL(in_order, manifest_count, "Manifest messages in the order the manifests were found")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
 
-        for (uint32_t test_num = 0; test_num < 6; ++test_num) {
-            XrInstance instance = XR_NULL_HANDLE;
-            XrResult create_result = XR_ERROR_VALIDATION_FAILURE;
-            std::string current_test_string;
-            XrInstanceCreateInfo instance_create_info = {};
-            instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
-            instance_create_info.applicationInfo = application_info;
+    // Cleanup
+    for (uint32_t manifest = 0; manifest < manifest_count; ++manifest) {
+        std::remove((manifest_directory + "/XR_APILAYER_test_parse_order_" + std::to_string(manifest) + ".json").c_str());
+    }
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_DEBUG");
+    CleanupEnvironmentVariables();
 
-            switch (test_num) {
-                // Test 0 - Basic, plain-vanilla xrCreateInstance
-                case 0:
-                    current_test_string = "Simple xrCreateInstance";
-                    expected_result = XR_SUCCESS;
-                    break;
-                // Test 1 - xrCreateInstance with a valid layer
-                case 1:
-                    current_test_string = "xrCreateInstance with a single valid layer";
-                    expected_result = XR_SUCCESS;
-                    instance_create_info.enabledApiLayerCount = 1;
-                    instance_create_info.enabledApiLayerNames = valid_layer_name_array;
-                    break;
-                // Test 2 - xrCreateInstance with an invalid layer
-                case 2:
-                    current_test_string = "xrCreateInstance with a single invalid layer";
-                    expected_result = XR_ERROR_API_LAYER_NOT_PRESENT;
-                    instance_create_info.enabledApiLayerCount = 1;
-                    instance_create_info.enabledApiLayerNames = invalid_layer_name_array;
-                    break;
-                // Test 3 - xrCreateInstance with a valid extension
-                case 3:
-                    if (missing_extensions) {
-                        continue;
-                    }
-                    current_test_string = "xrCreateInstance with a single valid extension";
-                    expected_result = XR_SUCCESS;
-                    instance_create_info.enabledExtensionCount = 1;
-                    instance_create_info.enabledExtensionNames = valid_extension_name_array;
-                    break;
-                // Test 4 - xrCreateInstance with an invalid extension
-                case 4:
-                    if (missing_extensions) {
-                        continue;
-                    }
-                    current_test_string = "xrCreateInstance with a single invalid extension";
-                    expected_result = XR_ERROR_EXTENSION_NOT_PRESENT;
-                    instance_create_info.enabledExtensionCount = 1;
-                    instance_create_info.enabledExtensionNames = invalid_extension_name_array;
-                    break;
-                // Test 5 - xrCreateInstance with everything
-                case 5:
-                    if (missing_extensions) {
-                        continue;
-                    }
-                    current_test_string = "xrCreateInstance with app info, valid layer, and a valid extension";
-                    expected_result = XR_SUCCESS;
-                    instance_create_info.enabledApiLayerCount = 1;
-                    instance_create_info.enabledApiLayerNames = valid_layer_name_array;
-                    instance_create_info.enabledExtensionCount = 1;
-                    instance_create_info.enabledExtensionNames = valid_extension_name_array;
-                    break;
-            }
+    // Output results for this test
+    TEST_REPORT(TestManifestParseLogOrder)
+}
 
-            // Try create instance and look for the correct return
-            std::string cur_message = current_test_string + " - xrCreateInstance";
-            create_result = xrCreateInstance(&instance_create_info, &instance);
-            TEST_EQUAL(create_result, expected_result, cur_message)
+// Enumerate the API layers and instance extensions with the two-call idiom, returning their names in order.
+static std::vector<std::string> EnumeratedLayerAndExtensionNames() {
+    std::vector<std::string> names;
+    uint32_t layer_count = 0;
+    if (XR_FAILED(xrEnumerateApiLayerProperties(0, &layer_count, nullptr))) {
+        return {"xrEnumerateApiLayerProperties failed"};
+    }
+    std::vector<XrApiLayerProperties> layer_properties(layer_count, {XR_TYPE_API_LAYER_PROPERTIES});
+    if (XR_FAILED(xrEnumerateApiLayerProperties(layer_count, &layer_count, layer_properties.data()))) {
+        return {"xrEnumerateApiLayerProperties failed"};
+    }
+    for (const XrApiLayerProperties& layer_property : layer_properties) {
+        names.emplace_back(layer_property.layerName);
+    }
+    uint32_t extension_count = 0;
+    if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr))) {
+        return {"xrEnumerateInstanceExtensionProperties failed"};
+    }
+    std::vector<XrExtensionProperties> extension_properties(extension_count, {XR_TYPE_EXTENSION_PROPERTIES});
+    if (XR_FAILED(xrEnumerateInstanceExtensionProperties(nullptr, extension_count, &extension_count,
+                                                         extension_properties.data()))) {
+        return {"xrEnumerateInstanceExtensionProperties failed"};
+    }
+    for (const XrExtensionProperties& extension_property : extension_properties) {
+        names.emplace_back(extension_property.extensionName);
+    }
+    return names;
+}
 
-            // If the expected return was a success, clean up the created instance
-            if (XR_SUCCEEDED(create_result)) {
-                cur_message = current_test_string + " - xrDestroyInstance";
-                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, cur_message)
+// Test that API layers and instance extensions can be enumerated on several threads at once with the same results, and that
+// enumerating does not wait for an xrCreateInstance that is still negotiating with an API layer.
+DEFINE_TEST(TestConcurrentEnumeration) {
+    INIT_TEST(TestConcurrentEnumeration)
+
+    try {
+        const std::string layer_directory = "resources/parallel_layers/";
+        const std::string layer_name = "XR_APILAYER_test_blocked";
+        // Only reached if something hangs, so that the test fails rather than waiting forever.
+        const uint32_t hang_milliseconds = 10000;
+        std::string current_path;
+        std::string runtime_json;
+        std::string library_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestConcurrentEnumeration)
+            return;
+        }
+        {
+            std::ifstream manifest_file("resources/layers/XrApiLayer_test.json");
+            Json::Value manifest;
+            manifest_file >> manifest;
+            library_path = manifest["api_layer"]["library_path"].asString();
+        }
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+        LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+
+        const std::vector<std::string> expected_names = EnumeratedLayerAndExtensionNames();
+        TEST_EQUAL(std::find(expected_names.begin(), expected_names.end(), "XR_KHR_fake_ext3") != expected_names.end(), true,
+                   "API layer extension enumerated")
+
+        const uint32_t thread_count = 8;
+        const uint32_t enumerations_per_thread = 50;
+        std::atomic<uint32_t> mismatches{0};
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 0; thread < thread_count; ++thread) {
+            threads.emplace_back([&]() {
+                for (uint32_t enumeration = 0; enumeration < enumerations_per_thread; ++enumeration) {
+                    if (EnumeratedLayerAndExtensionNames() != expected_names) {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        TEST_EQUAL(mismatches.load(), 0u, "Enumerations on several threads at once")
+
+        // An instance whose API layer does not finish negotiating until the enumerations on the other threads have finished.
+        const std::string library_name = "lib" + layer_name + ".so";
+        {
+            std::ofstream library_copy(layer_directory + library_name, std::ios::binary | std::ios::trunc);
+            std::ifstream library(library_path, std::ios::binary);
+            library_copy << library.rdbuf();
+            std::ofstream manifest(layer_directory + layer_name + ".json", std::ios::trunc);
+            manifest << "{\"file_format_version\": \"1.0.0\", \"api_layer\": {\"name\": \"" << layer_name
+                     << "\", \"library_path\": \"./" << library_name
+                     << "\", \"api_version\": \"1.0\", \"implementation_version\": \"1\", \"description\": \"Test_description\", "
+                        "\"functions\": {\"xrNegotiateLoaderApiLayerInterface\": "
+                        "\"TestLayerBlockedNegotiateLoaderApiLayerInterface\"}}}\n";
+        }
+        // The loader opens the same library, so this shares its state with the negotiation.
+        LoaderPlatformLibraryHandle layer_library = LoaderPlatformLibraryOpen(layer_directory + library_name);
+        using PFN_TestLayerWaitForBlockedNegotiate = XrResult (*)(uint32_t);
+        using PFN_TestLayerReleaseBlockedNegotiate = void (*)();
+        PFN_TestLayerWaitForBlockedNegotiate wait_for_negotiate = nullptr;
+        PFN_TestLayerReleaseBlockedNegotiate release_negotiate = nullptr;
+        if (layer_library != nullptr) {
+            wait_for_negotiate = reinterpret_cast<PFN_TestLayerWaitForBlockedNegotiate>(
+                LoaderPlatformLibraryGetProcAddr(layer_library, "TestLayerWaitForBlockedNegotiate"));
+            release_negotiate = reinterpret_cast<PFN_TestLayerReleaseBlockedNegotiate>(
+                LoaderPlatformLibraryGetProcAddr(layer_library, "TestLayerReleaseBlockedNegotiate"));
+        }
+        if (wait_for_negotiate == nullptr || release_negotiate == nullptr) {
+            TEST_FAIL("Unable to load " + layer_name)
+        } else {
+            LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_directory);
+            LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", layer_name);
+            const std::vector<std::string> blocked_layer_names = EnumeratedLayerAndExtensionNames();
+
+            std::atomic<bool> instance_created{false};
+            std::thread create_thread([&]() {
+                XrInstance instance = CreateTestRuntimeInstance();
+                if (instance != XR_NULL_HANDLE) {
+                    instance_created = true;
+                    xrDestroyInstance(instance);
+                }
+            });
+            const bool negotiating = wait_for_negotiate(hang_milliseconds) == XR_SUCCESS;
+            TEST_EQUAL(negotiating, true, "xrCreateInstance negotiates with " + layer_name)
+
+            std::mutex finished_mutex;
+            std::condition_variable finished_condition;
+            uint32_t finished_count = 0;
+            threads.clear();
+            if (negotiating) {
+                for (uint32_t thread = 0; thread < thread_count; ++thread) {
+                    threads.emplace_back([&]() {
+                        if (EnumeratedLayerAndExtensionNames() != blocked_layer_names) {
+                            ++mismatches;
+                        }
+                        std::lock_guard<std::mutex> lock(finished_mutex);
+                        ++finished_count;
+                        finished_condition.notify_all();
+                    });
+                }
+                bool finished_while_negotiating = false;
+                {
+                    std::unique_lock<std::mutex> lock(finished_mutex);
+                    finished_while_negotiating = finished_condition.wait_for(
+                        lock, std::chrono::milliseconds(hang_milliseconds), [&]() { return finished_count == thread_count; });
+                }
+                TEST_EQUAL(finished_while_negotiating, true, "Enumerations do not wait for xrCreateInstance")
+                TEST_EQUAL(instance_created.load(), false, "xrCreateInstance still negotiating during the enumerations")
             }
+            release_negotiate();
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            create_thread.join();
+            TEST_EQUAL(instance_created.load(), true, "Creating an instance with a blocked API layer")
+            TEST_EQUAL(mismatches.load(), 0u, "Enumerations while an instance is created")
+        }
+        if (layer_library != nullptr) {
+            LoaderPlatformLibraryClose(layer_library);
         }
 
-        // Make sure DestroyInstance with a NULL handle gives correct error
-        TEST_EQUAL(xrDestroyInstance(XR_NULL_HANDLE), XR_ERROR_HANDLE_INVALID, "xrDestroyInstance(XR_NULL_HANDLE)")
+        std::remove((layer_directory + "lib" + layer_name + ".so").c_str());
+        std::remove((layer_directory + layer_name + ".json").c_str());
     } catch (...) {
         TEST_FAIL("Exception triggered during test, automatic failure")
     }
@@ -688,45 +2916,201 @@ DEFINE_TEST(TestCreateDestroyInstance) {
     CleanupEnvironmentVariables();
 
     // Output results for this test
-    TEST_REPORT(TestCreateDestroyInstance)
+    TEST_REPORT(TestConcurrentEnumeration)
 }
+#endif  // defined(XR_OS_LINUX)
 
-// Test at least one XrInstance function not directly implemented in the loader's manual code section.
-// This is to make sure that the automatic instance functions work.
-DEFINE_TEST(TestGetSystem) {
-    INIT_TEST(TestGetSystem)
+#if defined(XR_OS_LINUX) && defined(XR_LOADER_COMMAND_STATISTICS)
+// Test that a loader built with BUILD_LOADER_WITH_COMMAND_STATISTICS counts the trampoline calls of a process, reporting
+// them when an instance is destroyed and again when the process exits.  The counts are for the whole process, so the calls
+// are made by running loader_test again.
+DEFINE_TEST(TestCommandStatistics) {
+    INIT_TEST(TestCommandStatistics)
 
     try {
+        const std::string statistics_filename = "resources/command_statistics.json";
+        const std::string output_filename = "resources/command_statistics_output.txt";
         std::string current_path;
-        std::string layer_path;
-        if (!FileSysUtilsGetCurrentPath(current_path) || !FileSysUtilsCombinePaths(current_path, "../../api_layers", layer_path)) {
-            TEST_FAIL("Unable to set API layer path")
-            TEST_REPORT(TestGetSystem)
+        std::string runtime_json;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            TEST_FAIL("Unable to set runtime path")
+            TEST_REPORT(TestCommandStatistics)
             return;
         }
-        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+        LoaderTestSetEnvironmentVariable("XR_LOADER_COMMAND_STATISTICS", statistics_filename);
+        std::remove(statistics_filename.c_str());
+
+        const uint32_t get_system_calls = 5;
+        const std::string command =
+            g_program_path + " --command-statistics " + std::to_string(get_system_calls) + " > " + output_filename + " 2>&1";
+        TEST_EQUAL(std::system(command.c_str()), 0, "Running loader_test to make the calls")
+        LoaderTestUnsetEnvironmentVariable("XR_LOADER_COMMAND_STATISTICS");
+        std::remove(output_filename.c_str());
+
+        // One report from xrDestroyInstance and one from the exit hook, with the same counts as nothing was called between.
+        std::vector<Json::Value> reports;
+        {
+            std::ifstream statistics_file(statistics_filename);
+            std::string line;
+            while (std::getline(statistics_file, line)) {
+                Json::CharReaderBuilder builder;
+                std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+                Json::Value report;
+                std::string errors;
+                if (!reader->parse(line.data(), line.data() + line.size(), &report, &errors)) {
+                    TEST_FAIL("Unable to parse the report \"" + line + "\"")
+                    continue;
+                }
+                reports.push_back(report);
+            }
+        }
+        std::remove(statistics_filename.c_str());
+        TEST_EQUAL(reports.size(), static_cast<size_t>(2), "Number of reports")
+        const char* const reasons[] = {"xrDestroyInstance", "exit"};
+        for (size_t index = 0; index < reports.size() && index < 2; ++index) {
+            const std::string reason = reasons[index];
+            TEST_EQUAL(reports[index]["reason"].asString(), reason, "Reason of report " + std::to_string(index))
+
+            uint64_t get_system_reported = 0;
+            bool histograms_match = true;
+            for (const Json::Value& statistics : reports[index]["commands"]) {
+                const uint64_t calls = statistics["calls"].asUInt64();
+                if (statistics["name"].asString() == "xrGetSystem") {
+                    get_system_reported = calls;
+                }
+                uint64_t histogram_calls = 0;
+                for (const Json::Value& bucket : statistics["latency_log2_ns"]) {
+                    histogram_calls += bucket[1].asUInt64();
+                }
+                histograms_match = histograms_match && histogram_calls == calls;
+            }
+            TEST_EQUAL(get_system_reported, static_cast<uint64_t>(get_system_calls),
+                       "xrGetSystem calls in the " + reason + " report")
+            TEST_EQUAL(histograms_match, true, "Latency histograms add up to the calls in the " + reason + " report")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_COMMAND_STATISTICS");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestCommandStatistics)
+}
+#endif  // defined(XR_OS_LINUX) && defined(XR_LOADER_COMMAND_STATISTICS)
+
+#ifndef XR_LOADER_DIRECT_RUNTIME
+// Test that the instance extensions of a runtime whose manifest lists all of them are enumerated without loading its library.
+DEFINE_TEST(TestRuntimeManifestInstanceExtensions) {
+    INIT_TEST(TestRuntimeManifestInstanceExtensions)
+
+    try {
+        const std::string manifest_filename = "resources/runtime_instance_extensions.json";
+        // The library does not exist, so any call that needs the runtime fails.
+        auto write_manifest = [&](bool instance_extensions_complete) {
+            std::ofstream manifest(manifest_filename, std::ios::trunc);
+            manifest << "{\n"
+                        "    \"file_format_version\": \"1.0.0\",\n"
+                        "    \"runtime\": {\n"
+                        "        \"library_path\": \"libXrRuntime_not_installed.so\",\n"
+                        "        \"instance_extensions_complete\": "
+                     << (instance_extensions_complete ? "true" : "false")
+                     << ",\n"
+                        "        \"instance_extensions\": [\n"
+                        "            {\"name\": \"XR_TEST_manifest_extension_a\", \"extension_version\": \"3\"},\n"
+                        "            {\"name\": \"XR_TEST_manifest_extension_b\", \"extension_version\": \"1\"}\n"
+                        "        ]\n"
+                        "    }\n"
+                        "}\n";
+        };
+
+        CleanupEnvironmentVariables();
+        ForceLoaderUnloadRuntime();
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", manifest_filename);
+
+        write_manifest(true);
+        uint32_t ext_count = 0;
+        XrResult result = xrEnumerateInstanceExtensionProperties(nullptr, 0, &ext_count, nullptr);
+        TEST_EQUAL(result, XR_SUCCESS, "xrEnumerateInstanceExtensionProperties count from the manifest")
+        std::vector<XrExtensionProperties> properties(ext_count, {XR_TYPE_EXTENSION_PROPERTIES});
+        result = xrEnumerateInstanceExtensionProperties(nullptr, ext_count, &ext_count, properties.data());
+        TEST_EQUAL(result, XR_SUCCESS, "xrEnumerateInstanceExtensionProperties properties from the manifest")
+        uint32_t extension_a_version = 0;
+        uint32_t extension_b_version = 0;
+        for (const XrExtensionProperties& property : properties) {
+            if (strcmp(property.extensionName, "XR_TEST_manifest_extension_a") == 0) {
+                extension_a_version = property.extensionVersion;
+            } else if (strcmp(property.extensionName, "XR_TEST_manifest_extension_b") == 0) {
+                extension_b_version = property.extensionVersion;
+            }
+        }
+        TEST_EQUAL(extension_a_version, 3u, "Version of the first extension listed in the manifest")
+        TEST_EQUAL(extension_b_version, 1u, "Version of the second extension listed in the manifest")
 
+        // Creating an instance still needs the runtime library.
         XrInstance instance = XR_NULL_HANDLE;
-        XrApplicationInfo application_info = {};
-        strcpy(application_info.applicationName, "Loader Test");
-        application_info.applicationVersion = 688;
-        strcpy(application_info.engineName, "Infinite Improbability Drive");
-        application_info.engineVersion = 42;
-        application_info.apiVersion = XR_CURRENT_API_VERSION;
-        XrInstanceCreateInfo instance_create_info = {};
-        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
-        instance_create_info.applicationInfo = application_info;
+        XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.applicationVersion = 688;
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        result = xrCreateInstance(&instance_create_info, &instance);
+        TEST_EQUAL(result, XR_ERROR_RUNTIME_UNAVAILABLE, "xrCreateInstance with a runtime library that does not exist")
+        if (XR_SUCCEEDED(result)) {
+            xrDestroyInstance(instance);
+        }
 
-        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Creating instance")
+        // Without "instance_extensions_complete" the runtime has to be loaded to ask it.
+        write_manifest(false);
+        result = xrEnumerateInstanceExtensionProperties(nullptr, 0, &ext_count, nullptr);
+        TEST_EQUAL(result, XR_ERROR_RUNTIME_UNAVAILABLE, "xrEnumerateInstanceExtensionProperties without the manifest flag")
 
-        XrSystemGetInfo system_get_info = {};
-        system_get_info.type = XR_TYPE_SYSTEM_GET_INFO;
-        system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+        std::remove(manifest_filename.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
 
-        XrSystemId systemId;
-        TEST_EQUAL(xrGetSystem(instance, &system_get_info, &systemId), XR_SUCCESS, "xrGetSystem");
+    // Cleanup
+    CleanupEnvironmentVariables();
 
-        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance")
+    // Output results for this test
+    TEST_REPORT(TestRuntimeManifestInstanceExtensions)
+}
+#endif  // !XR_LOADER_DIRECT_RUNTIME
+
+#ifdef XR_LOADER_DIRECT_RUNTIME
+// With the test runtime linked into the loader, no runtime manifest is needed, and API layers still sit between the
+// application and the runtime.
+DEFINE_TEST(TestDirectRuntime) {
+    INIT_TEST(TestDirectRuntime)
+
+    try {
+        LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", "resources/runtimes/not_a_runtime.json");
+
+        for (uint32_t test = 0; test < 2; ++test) {
+            std::string subtest_name = test == 0 ? " with no API layers" : " with an API layer";
+            if (test == 0) {
+                LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+                LoaderTestUnsetEnvironmentVariable("XR_API_LAYER_PATH");
+            } else {
+                LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+                LoaderTestSetEnvironmentVariable("XR_ENABLE_API_LAYERS", "XR_APILAYER_test");
+            }
+
+            uint32_t extension_count = 0;
+            TEST_EQUAL(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extension_count, nullptr), XR_SUCCESS,
+                       "Enumerating runtime extensions" + subtest_name)
+
+            XrInstance instance = CreateTestRuntimeInstance();
+            TEST_NOT_EQUAL(instance, XR_NULL_HANDLE, "Creating instance" + subtest_name)
+            if (instance != XR_NULL_HANDLE) {
+                TEST_EQUAL(InstanceDispatchesToItself(instance), true, "Instance dispatch" + subtest_name)
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance" + subtest_name)
+            }
+        }
     } catch (...) {
         TEST_FAIL("Exception triggered during test, automatic failure")
     }
@@ -735,8 +3119,9 @@ DEFINE_TEST(TestGetSystem) {
     CleanupEnvironmentVariables();
 
     // Output results for this test
-    TEST_REPORT(TestGetSystem)
+    TEST_REPORT(TestDirectRuntime)
 }
+#endif  // XR_LOADER_DIRECT_RUNTIME
 
 // Test at least one non-XrInstance function to make sure that the automatic non-instance functions work.
 DEFINE_TEST(TestCreateDestroySession) {
@@ -2098,9 +4483,62 @@ int main(int argc, char* argv[]) {
     uint32_t total_skipped = 0;
     uint32_t total_failed = 0;
 
-    // Unused for now.
-    (void)argc;
-    (void)argv;
+#if defined(XR_OS_LINUX)
+    // Run by TestDirectoryScanSyscalls, which counts the system calls made to search for API layers.
+    if (argc == 3 && strcmp(argv[1], "--enumerate-api-layers") == 0) {
+        for (int enumeration = atoi(argv[2]); enumeration > 0; --enumeration) {
+            uint32_t layer_count = 0;
+            xrEnumerateApiLayerProperties(0, &layer_count, nullptr);
+        }
+        return 0;
+    }
+    // Run by TestPersistentManifestCache, which looks at where a new process gets the API layer manifest from.
+    if (argc == 2 && strcmp(argv[1], "--api-layer-description") == 0) {
+        cout << OnlyApiLayerDescription() << endl;
+        return 0;
+    }
+    // Run by TestRuntimePreload, which compares the results of loading the runtime with and without a preload, and by
+    // TestRuntimeResidency, which looks at when the runtime is unloaded after waiting the given number of milliseconds.
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "--create-instance") == 0) {
+        uint32_t layer_count = 0;
+        xrEnumerateApiLayerProperties(0, &layer_count, nullptr);
+        XrInstance instance = XR_NULL_HANDLE;
+        XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.applicationVersion = 688;
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        XrResult result = xrCreateInstance(&instance_create_info, &instance);
+        cout << "xrCreateInstance result " << result << endl;
+        if (XR_SUCCEEDED(result)) {
+            xrDestroyInstance(instance);
+        }
+        if (argc == 3) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(atoi(argv[2])));
+            cout << "Waited " << argv[2] << " ms" << endl;
+        }
+        return 0;
+    }
+    // Run by TestCommandStatistics, which checks the reported counts of the trampoline calls made here.
+    if (argc == 3 && strcmp(argv[1], "--command-statistics") == 0) {
+        XrInstance instance = XR_NULL_HANDLE;
+        XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.applicationVersion = 688;
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        if (XR_FAILED(xrCreateInstance(&instance_create_info, &instance))) {
+            return 1;
+        }
+        XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+        system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+        for (int call = atoi(argv[2]); call > 0; --call) {
+            XrSystemId system_id = XR_NULL_SYSTEM_ID;
+            xrGetSystem(instance, &system_get_info, &system_id);
+        }
+        xrDestroyInstance(instance);
+        return 0;
+    }
+#endif  // defined(XR_OS_LINUX)
+    g_program_path = argc > 0 ? argv[0] : "";
 
 #if FILTER_OUT_LOADER_ERRORS == 1
     // Re-direct std::cerr to a string since we're intentionally causing errors and we don't
@@ -2112,10 +4550,48 @@ int main(int argc, char* argv[]) {
 
     cout << "Starting loader_test" << endl << "--------------------" << endl;
 
+#ifdef XR_LOADER_DIRECT_RUNTIME
+    // The runtime linked into the loader is the test runtime, which cannot run the active runtime tests.
+    g_has_installed_runtime = false;
+#else   // !XR_LOADER_DIRECT_RUNTIME
     g_has_installed_runtime = DetectInstalledRuntime();
+#endif  // XR_LOADER_DIRECT_RUNTIME
 
     TestEnumLayers(total_tests, total_passed, total_skipped, total_failed);
     TestEnumInstanceExtensions(total_tests, total_passed, total_skipped, total_failed);
+    TestNegotiateInterfaceVersions(total_tests, total_passed, total_skipped, total_failed);
+    TestNegotiateVersion1Loader(total_tests, total_passed, total_skipped, total_failed);
+    TestDispatchPopulation(total_tests, total_passed, total_skipped, total_failed);
+    TestMultipleInstances(total_tests, total_passed, total_skipped, total_failed);
+    TestHandleOwnership(total_tests, total_passed, total_skipped, total_failed);
+    TestConcurrentCallsDuringDestroy(total_tests, total_passed, total_skipped, total_failed);
+    TestDestroyDuringBlockedCall(total_tests, total_passed, total_skipped, total_failed);
+    TestInstanceExtensionSupport(total_tests, total_passed, total_skipped, total_failed);
+    TestConcurrentDebugUtilsLookups(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestFileCache(total_tests, total_passed, total_skipped, total_failed);
+    TestInstanceExtensionPropertiesCache(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestJsonReader(total_tests, total_passed, total_skipped, total_failed);
+#if defined(XR_OS_LINUX)
+    TestPersistentManifestCache(total_tests, total_passed, total_skipped, total_failed);
+    TestDirectoryScanSyscalls(total_tests, total_passed, total_skipped, total_failed);
+    TestRuntimeResidency(total_tests, total_passed, total_skipped, total_failed);
+    TestStartupTiming(total_tests, total_passed, total_skipped, total_failed);
+    TestParallelApiLayerLoading(total_tests, total_passed, total_skipped, total_failed);
+    TestSharedLibraryApiLayerLoading(total_tests, total_passed, total_skipped, total_failed);
+    TestManifestParseLogOrder(total_tests, total_passed, total_skipped, total_failed);
+    TestConcurrentEnumeration(total_tests, total_passed, total_skipped, total_failed);
+#if defined(XR_LOADER_COMMAND_STATISTICS)
+    TestCommandStatistics(total_tests, total_passed, total_skipped, total_failed);
+#endif  // defined(XR_LOADER_COMMAND_STATISTICS)
+#endif  // defined(XR_OS_LINUX)
+#ifdef XR_LOADER_DIRECT_RUNTIME
+    TestDirectRuntime(total_tests, total_passed, total_skipped, total_failed);
+#else   // !XR_LOADER_DIRECT_RUNTIME
+    TestRuntimeManifestInstanceExtensions(total_tests, total_passed, total_skipped, total_failed);
+#if defined(XR_OS_LINUX)
+    TestRuntimePreload(total_tests, total_passed, total_skipped, total_failed);
+#endif  // defined(XR_OS_LINUX)
+#endif  // XR_LOADER_DIRECT_RUNTIME
 
     if (g_has_installed_runtime) {
         cout << "Installed XR runtime detected - doing active runtime tests" << endl;
@@ -19,9 +19,16 @@
 // Author: Mark Young <marky@lunarg.com>
 //
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
 
 #include "xr_dependencies.h"
 #include <openxr/openxr.h>
@@ -37,7 +44,28 @@
 #endif
 
 extern "C" {
-std::map<XrInstance, PFN_xrGetInstanceProcAddr> g_next_gipa_map;
+// Next functions in the chain for each instance.  The system commands are intercepted and passed
+// straight through so that the cost of an API layer shows up in trampoline benchmarks.
+struct LayerTestNextDispatch {
+    PFN_xrGetInstanceProcAddr getInstanceProcAddr;
+    PFN_xrGetInstanceProcAddrBatch getInstanceProcAddrBatch;
+    PFN_xrGetSystem getSystem;
+    PFN_xrGetSystemProperties getSystemProperties;
+};
+std::map<XrInstance, LayerTestNextDispatch> g_next_dispatch_map;
+// Instances may be created, used and destroyed on several threads at once.
+std::mutex g_next_dispatch_mutex;
+
+// Copy out the next functions for an instance, returning false if the instance is unknown.
+static bool LayerTestGetNextDispatch(XrInstance instance, LayerTestNextDispatch *next_dispatch) {
+    std::lock_guard<std::mutex> lock(g_next_dispatch_mutex);
+    auto it = g_next_dispatch_map.find(instance);
+    if (it == std::end(g_next_dispatch_map)) {
+        return false;
+    }
+    *next_dispatch = it->second;
+    return true;
+}
 
 XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrCreateInstance(const XrInstanceCreateInfo * /* info */, XrInstance * /* instance */) {
     // In a layer, LayerTestXrCreateApiLayerInstance is called instead of this function. This should not be called.
@@ -46,41 +74,115 @@ XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrCreateInstance(const XrInstanceCreateI
 
 XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrDestroyInstance(XrInstance instance) {
     // Call down to the next xrDestroyInstance.
+    LayerTestNextDispatch next_dispatch;
+    if (!LayerTestGetNextDispatch(instance, &next_dispatch)) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
     PFN_xrVoidFunction nextDestroyInstance{nullptr};
-    XrResult res = g_next_gipa_map[instance](instance, "xrDestroyInstance", &nextDestroyInstance);
+    XrResult res = next_dispatch.getInstanceProcAddr(instance, "xrDestroyInstance", &nextDestroyInstance);
     if (XR_SUCCEEDED(res)) {
         res = reinterpret_cast<PFN_xrDestroyInstance>(nextDestroyInstance)(instance);
     }
 
     if (XR_SUCCEEDED(res)) {
-        g_next_gipa_map.erase(instance);
+        std::lock_guard<std::mutex> lock(g_next_dispatch_mutex);
+        g_next_dispatch_map.erase(instance);
     }
 
     return res;
 }
 
-XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetInstanceProcAddr(XrInstance instance, const char *name, PFN_xrVoidFunction *function) {
+XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetSystem(XrInstance instance, const XrSystemGetInfo *getInfo, XrSystemId *systemId) {
+    LayerTestNextDispatch next_dispatch;
+    if (!LayerTestGetNextDispatch(instance, &next_dispatch) || next_dispatch.getSystem == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    return next_dispatch.getSystem(instance, getInfo, systemId);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetSystemProperties(XrInstance instance, XrSystemId systemId,
+                                                              XrSystemProperties *properties) {
+    LayerTestNextDispatch next_dispatch;
+    if (!LayerTestGetNextDispatch(instance, &next_dispatch) || next_dispatch.getSystemProperties == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    return next_dispatch.getSystemProperties(instance, systemId, properties);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetInstanceProcAddr(XrInstance instance, const char *name, PFN_xrVoidFunction *function);
+
+// Returns this layer's version of a command, or nullptr if the command is not intercepted.
+static PFN_xrVoidFunction LayerTestInterceptedFunction(const char *name) {
     if (0 == strcmp(name, "xrGetInstanceProcAddr")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrGetInstanceProcAddr);
+        return reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrGetInstanceProcAddr);
     } else if (0 == strcmp(name, "xrCreateInstance")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrCreateInstance);
+        return reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrCreateInstance);
     } else if (0 == strcmp(name, "xrDestroyInstance")) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrDestroyInstance);
-    } else {
-        *function = nullptr;
+        return reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrDestroyInstance);
+    } else if (0 == strcmp(name, "xrGetSystem")) {
+        return reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrGetSystem);
+    } else if (0 == strcmp(name, "xrGetSystemProperties")) {
+        return reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrGetSystemProperties);
     }
+    return nullptr;
+}
+
+// The number of times each command has been asked for through LayerTestXrGetInstanceProcAddr.
+std::map<std::string, uint32_t> g_get_instance_proc_addr_counts;
+std::mutex g_get_instance_proc_addr_counts_mutex;
+
+// Returns how many times the command has been asked for through this layer's xrGetInstanceProcAddr
+LAYER_EXPORT uint32_t TestLayerGetInstanceProcAddrCount(const char *name) {
+    std::lock_guard<std::mutex> lock(g_get_instance_proc_addr_counts_mutex);
+    return g_get_instance_proc_addr_counts[name];
+}
 
+XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetInstanceProcAddr(XrInstance instance, const char *name, PFN_xrVoidFunction *function) {
+    {
+        std::lock_guard<std::mutex> lock(g_get_instance_proc_addr_counts_mutex);
+        ++g_get_instance_proc_addr_counts[name];
+    }
+    *function = LayerTestInterceptedFunction(name);
     if (*function != nullptr) {
         return XR_SUCCESS;
     }
 
     // If the function is not intercepted in this layer, call down to the next layer.
-    auto it = g_next_gipa_map.find(instance);
-    if (it == std::end(g_next_gipa_map)) {
+    LayerTestNextDispatch next_dispatch;
+    if (!LayerTestGetNextDispatch(instance, &next_dispatch)) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+
+    return next_dispatch.getInstanceProcAddr(instance, name, function);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetInstanceProcAddrBatch(XrInstance instance, uint32_t nameCount,
+                                                                   const char *const *names, PFN_xrVoidFunction *functions) {
+    LayerTestNextDispatch next_dispatch;
+    if (!LayerTestGetNextDispatch(instance, &next_dispatch)) {
         return XR_ERROR_HANDLE_INVALID;
     }
 
-    return it->second(instance, name, function);
+    // Resolve everything below this layer with as few calls as possible, then substitute the intercepted commands.
+    if (next_dispatch.getInstanceProcAddrBatch != nullptr) {
+        XrResult res = next_dispatch.getInstanceProcAddrBatch(instance, nameCount, names, functions);
+        if (XR_FAILED(res)) {
+            return res;
+        }
+    } else {
+        for (uint32_t i = 0; i < nameCount; ++i) {
+            if (XR_FAILED(next_dispatch.getInstanceProcAddr(instance, names[i], &functions[i]))) {
+                functions[i] = nullptr;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < nameCount; ++i) {
+        PFN_xrVoidFunction intercepted = LayerTestInterceptedFunction(names[i]);
+        if (intercepted != nullptr) {
+            functions[i] = intercepted;
+        }
+    }
+    return XR_SUCCESS;
 }
 
 XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrCreateApiLayerInstance(const XrInstanceCreateInfo *info,
@@ -97,7 +199,25 @@ XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrCreateApiLayerInstance(const XrInstanc
         return res;  // The next layer's xrCreateApiLayerInstance failed.
     }
 
-    g_next_gipa_map[*instance] = apiLayerInfo->nextInfo->nextGetInstanceProcAddr;
+    LayerTestNextDispatch next_dispatch{};
+    next_dispatch.getInstanceProcAddr = apiLayerInfo->nextInfo->nextGetInstanceProcAddr;
+    if (apiLayerInfo->nextInfo->structVersion >= 2 && apiLayerInfo->nextInfo->structSize >= sizeof(XrApiLayerNextInfo)) {
+        next_dispatch.getInstanceProcAddrBatch = apiLayerInfo->nextInfo->nextGetInstanceProcAddrBatch;
+    }
+    if (next_dispatch.getInstanceProcAddrBatch != nullptr) {
+        const char *const names[] = {"xrGetSystem", "xrGetSystemProperties"};
+        PFN_xrVoidFunction functions[2] = {};
+        next_dispatch.getInstanceProcAddrBatch(*instance, 2, names, functions);
+        next_dispatch.getSystem = reinterpret_cast<PFN_xrGetSystem>(functions[0]);
+        next_dispatch.getSystemProperties = reinterpret_cast<PFN_xrGetSystemProperties>(functions[1]);
+    } else {
+        next_dispatch.getInstanceProcAddr(*instance, "xrGetSystem",
+                                          reinterpret_cast<PFN_xrVoidFunction *>(&next_dispatch.getSystem));
+        next_dispatch.getInstanceProcAddr(*instance, "xrGetSystemProperties",
+                                          reinterpret_cast<PFN_xrVoidFunction *>(&next_dispatch.getSystemProperties));
+    }
+    std::lock_guard<std::mutex> lock(g_next_dispatch_mutex);
+    g_next_dispatch_map[*instance] = next_dispatch;
 
     return XR_SUCCESS;
 }
@@ -108,21 +228,25 @@ LAYER_EXPORT XrResult xrNegotiateLoaderApiLayerInterface(const XrNegotiateLoader
                                                          XrNegotiateApiLayerRequest *layerRequest) {
     if (nullptr == loaderInfo || nullptr == layerRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
-        layerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
-        layerRequest->structSize != sizeof(XrNegotiateApiLayerRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST || layerRequest->structVersion < 1 ||
+        layerRequest->structSize < offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->minApiVersion < XR_MAKE_VERSION(0, 1, 0) || loaderInfo->minApiVersion >= XR_MAKE_VERSION(1, 1, 0)) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
 
     (void)layerName;
-    layerRequest->layerInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    layerRequest->layerInterfaceVersion =
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ? loaderInfo->maxInterfaceVersion
+                                                                              : XR_CURRENT_LOADER_API_LAYER_VERSION;
     layerRequest->layerApiVersion = XR_MAKE_VERSION(0, 1, 0);
     layerRequest->getInstanceProcAddr = LayerTestXrGetInstanceProcAddr;
     layerRequest->createApiLayerInstance = LayerTestXrCreateApiLayerInstance;
+    // The batch member only exists in the version 2 request, which older loaders do not pass.
+    if (layerRequest->layerInterfaceVersion >= 2 && layerRequest->structVersion >= 2 &&
+        layerRequest->structSize >= sizeof(XrNegotiateApiLayerRequest)) {
+        layerRequest->getInstanceProcAddrBatch = LayerTestXrGetInstanceProcAddrBatch;
+    }
 
     return XR_SUCCESS;
 }
@@ -134,23 +258,80 @@ LAYER_EXPORT XrResult TestlayerAlwaysFailNegotiateLoaderApiLayerInterface(const
     return XR_ERROR_INITIALIZATION_FAILED;
 }
 
+// Pass, after sleeping for the number of milliseconds at the end of the layer name, such as 200 for XR_APILAYER_test_delay_200
+LAYER_EXPORT XrResult TestLayerDelayedNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo *loaderInfo,
+                                                                       const char *layerName,
+                                                                       XrNegotiateApiLayerRequest *layerRequest) {
+    const char *delay = nullptr == layerName ? nullptr : strrchr(layerName, '_');
+    if (nullptr != delay) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(atoi(delay + 1)));
+    }
+    return xrNegotiateLoaderApiLayerInterface(loaderInfo, layerName, layerRequest);
+}
+
+// Fail, after sleeping for the number of milliseconds at the end of the layer name
+LAYER_EXPORT XrResult TestLayerDelayedFailNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo * /* loaderInfo */,
+                                                                           const char *layerName,
+                                                                           XrNegotiateApiLayerRequest * /* layerRequest */) {
+    const char *delay = nullptr == layerName ? nullptr : strrchr(layerName, '_');
+    if (nullptr != delay) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(atoi(delay + 1)));
+    }
+    return XR_ERROR_INITIALIZATION_FAILED;
+}
+
+// Set by TestLayerBlockedNegotiateLoaderApiLayerInterface and TestLayerReleaseBlockedNegotiate.
+std::mutex g_blocked_negotiate_mutex;
+std::condition_variable g_blocked_negotiate_condition;
+bool g_blocked_negotiate_entered = false;
+bool g_blocked_negotiate_released = false;
+
+// Pass, once TestLayerReleaseBlockedNegotiate has been called, so that a test can act while the loader is negotiating
+LAYER_EXPORT XrResult TestLayerBlockedNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo *loaderInfo,
+                                                                       const char *layerName,
+                                                                       XrNegotiateApiLayerRequest *layerRequest) {
+    {
+        std::unique_lock<std::mutex> lock(g_blocked_negotiate_mutex);
+        g_blocked_negotiate_entered = true;
+        g_blocked_negotiate_condition.notify_all();
+        g_blocked_negotiate_condition.wait(lock, []() { return g_blocked_negotiate_released; });
+    }
+    return xrNegotiateLoaderApiLayerInterface(loaderInfo, layerName, layerRequest);
+}
+
+// Wait up to the given number of milliseconds for the loader to call TestLayerBlockedNegotiateLoaderApiLayerInterface
+LAYER_EXPORT XrResult TestLayerWaitForBlockedNegotiate(uint32_t milliseconds) {
+    std::unique_lock<std::mutex> lock(g_blocked_negotiate_mutex);
+    if (!g_blocked_negotiate_condition.wait_for(lock, std::chrono::milliseconds(milliseconds),
+                                                []() { return g_blocked_negotiate_entered; })) {
+        return XR_TIMEOUT_EXPIRED;
+    }
+    return XR_SUCCESS;
+}
+
+// Let TestLayerBlockedNegotiateLoaderApiLayerInterface finish negotiating, now and whenever it is called again
+LAYER_EXPORT void TestLayerReleaseBlockedNegotiate() {
+    std::lock_guard<std::mutex> lock(g_blocked_negotiate_mutex);
+    g_blocked_negotiate_released = true;
+    g_blocked_negotiate_condition.notify_all();
+}
+
 // Pass, but return NULL for the layer's xrGetInstanceProcAddr
 LAYER_EXPORT XrResult TestLayerNullGipaNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo *loaderInfo,
                                                                         const char *layerName,
                                                                         XrNegotiateApiLayerRequest *layerRequest) {
     if (nullptr == loaderInfo || nullptr == layerRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
-        layerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
-        layerRequest->structSize != sizeof(XrNegotiateApiLayerRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST || layerRequest->structVersion < 1 ||
+        layerRequest->structSize < offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->minApiVersion < XR_MAKE_VERSION(0, 1, 0) || loaderInfo->minApiVersion >= XR_MAKE_VERSION(1, 1, 0)) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
     (void)layerName;
-    layerRequest->layerInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    layerRequest->layerInterfaceVersion =
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ? loaderInfo->maxInterfaceVersion
+                                                                              : XR_CURRENT_LOADER_API_LAYER_VERSION;
     layerRequest->layerApiVersion = XR_MAKE_VERSION(0, 1, 0);
     layerRequest->getInstanceProcAddr = nullptr;
 
@@ -163,12 +344,9 @@ LAYER_EXPORT XrResult TestLayerInvalidInterfaceNegotiateLoaderApiLayerInterface(
                                                                                 XrNegotiateApiLayerRequest *layerRequest) {
     if (nullptr == loaderInfo || nullptr == layerRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
-        layerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
-        layerRequest->structSize != sizeof(XrNegotiateApiLayerRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST || layerRequest->structVersion < 1 ||
+        layerRequest->structSize < offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->minApiVersion < XR_MAKE_VERSION(0, 1, 0) || loaderInfo->minApiVersion >= XR_MAKE_VERSION(1, 1, 0)) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
@@ -186,17 +364,16 @@ LAYER_EXPORT XrResult TestLayerInvalidApiNegotiateLoaderApiLayerInterface(const
                                                                           XrNegotiateApiLayerRequest *layerRequest) {
     if (nullptr == loaderInfo || nullptr == layerRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
-        layerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
-        layerRequest->structSize != sizeof(XrNegotiateApiLayerRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        layerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST || layerRequest->structVersion < 1 ||
+        layerRequest->structSize < offsetof(XrNegotiateApiLayerRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->minApiVersion < XR_MAKE_VERSION(0, 1, 0) || loaderInfo->minApiVersion >= XR_MAKE_VERSION(1, 1, 0)) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
     (void)layerName;
-    layerRequest->layerInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    layerRequest->layerInterfaceVersion =
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ? loaderInfo->maxInterfaceVersion
+                                                                              : XR_CURRENT_LOADER_API_LAYER_VERSION;
     layerRequest->layerApiVersion = 0;
     layerRequest->getInstanceProcAddr = reinterpret_cast<PFN_xrGetInstanceProcAddr>(LayerTestXrGetInstanceProcAddr);
 
@@ -19,8 +19,13 @@
 // Author: Mark Young <marky@lunarg.com>
 //
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 
 #include "xr_dependencies.h"
 #include <openxr/openxr.h>
@@ -38,7 +43,9 @@
 extern "C" {
 
 XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateInstance(const XrInstanceCreateInfo * /* info */, XrInstance *instance) {
-    *instance = (XrInstance)1;
+    // Give every instance its own handle so the loader can be tested with several of them alive at once.
+    static std::atomic<uint64_t> next_instance{1};
+    *instance = (XrInstance)next_instance.fetch_add(1);
     return XR_SUCCESS;
 }
 
@@ -84,10 +91,92 @@ XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetSystemProperties(XrInstance insta
     properties->graphicsProperties.maxSwapchainImageWidth = 1;
     properties->systemId = systemId;
     strcpy(properties->systemName, "Test system");
-    properties->vendorId = 0x0;
+    // Report the instance the call arrived on, so callers can check it was dispatched to the right one.
+    properties->vendorId = static_cast<uint32_t>((uint64_t)instance);
     return XR_SUCCESS;
 }
 
+// Sessions and spaces only get handles, so that the loader's tracking of which instance owns a handle can be tested.
+static uint64_t RuntimeTestNextHandle() {
+    static std::atomic<uint64_t> next_handle{0x1000};
+    return next_handle.fetch_add(1);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateSession(XrInstance /* instance */, const XrSessionCreateInfo * /* createInfo */,
+                                                          XrSession *session) {
+    *session = (XrSession)RuntimeTestNextHandle();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrDestroySession(XrSession /* session */) { return XR_SUCCESS; }
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateReferenceSpace(XrSession /* session */,
+                                                                 const XrReferenceSpaceCreateInfo * /* createInfo */,
+                                                                 XrSpace *space) {
+    *space = (XrSpace)RuntimeTestNextHandle();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrCreateSpatialAnchorSpaceMSFT(XrSession /* session */,
+                                                                         const XrSpatialAnchorSpaceCreateInfoMSFT * /* createInfo */,
+                                                                         XrSpace *space) {
+    *space = (XrSpace)RuntimeTestNextHandle();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrLocateSpace(XrSpace /* space */, XrSpace /* baseSpace */, XrTime /* time */,
+                                                        XrSpaceLocation *location) {
+    location->locationFlags = 0;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrDestroySpace(XrSpace /* space */) { return XR_SUCCESS; }
+
+// xrWaitFrame blocks until xrBeginFrame is called on another thread, so that the loader can be tested with a call blocked
+// inside the runtime.  xrRequestExitSession only reports whether an xrWaitFrame is blocked.
+struct RuntimeTestFrameWait {
+    std::mutex mutex;
+    std::condition_variable begun;
+    uint32_t waiting{0};
+    uint64_t begin_count{0};
+};
+
+static RuntimeTestFrameWait &GetRuntimeTestFrameWait() {
+    static RuntimeTestFrameWait frame_wait;
+    return frame_wait;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrWaitFrame(XrSession /* session */, const XrFrameWaitInfo * /* frameWaitInfo */,
+                                                      XrFrameState *frameState) {
+    RuntimeTestFrameWait &frame_wait = GetRuntimeTestFrameWait();
+    std::unique_lock<std::mutex> lock(frame_wait.mutex);
+    const uint64_t begin_count = frame_wait.begin_count;
+    ++frame_wait.waiting;
+    frame_wait.begun.wait(lock, [&]() { return frame_wait.begin_count != begin_count; });
+    --frame_wait.waiting;
+    frameState->shouldRender = XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrBeginFrame(XrSession /* session */, const XrFrameBeginInfo * /* frameBeginInfo */) {
+    RuntimeTestFrameWait &frame_wait = GetRuntimeTestFrameWait();
+    {
+        std::lock_guard<std::mutex> lock(frame_wait.mutex);
+        if (frame_wait.waiting == 0) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        ++frame_wait.begin_count;
+    }
+    frame_wait.begun.notify_all();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrRequestExitSession(XrSession /* session */) {
+    RuntimeTestFrameWait &frame_wait = GetRuntimeTestFrameWait();
+    std::lock_guard<std::mutex> lock(frame_wait.mutex);
+    return frame_wait.waiting != 0 ? XR_SUCCESS : XR_ERROR_SESSION_NOT_RUNNING;
+}
+
 XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetInstanceProcAddr(XrInstance instance, const char *name,
                                                                 PFN_xrVoidFunction *function) {
     if (0 == strcmp(name, "xrGetInstanceProcAddr")) {
@@ -106,6 +195,24 @@ XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetInstanceProcAddr(XrInstance insta
         *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrGetSystem);
     } else if (0 == strcmp(name, "xrGetSystemProperties")) {
         *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrGetSystemProperties);
+    } else if (0 == strcmp(name, "xrCreateSession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrCreateSession);
+    } else if (0 == strcmp(name, "xrDestroySession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrDestroySession);
+    } else if (0 == strcmp(name, "xrCreateReferenceSpace")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrCreateReferenceSpace);
+    } else if (0 == strcmp(name, "xrCreateSpatialAnchorSpaceMSFT")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrCreateSpatialAnchorSpaceMSFT);
+    } else if (0 == strcmp(name, "xrLocateSpace")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrLocateSpace);
+    } else if (0 == strcmp(name, "xrDestroySpace")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrDestroySpace);
+    } else if (0 == strcmp(name, "xrWaitFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrWaitFrame);
+    } else if (0 == strcmp(name, "xrBeginFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrBeginFrame);
+    } else if (0 == strcmp(name, "xrRequestExitSession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(RuntimeTestXrRequestExitSession);
     } else {
         *function = nullptr;
     }
@@ -113,24 +220,41 @@ XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetInstanceProcAddr(XrInstance insta
     return *function ? XR_SUCCESS : XR_ERROR_FUNCTION_UNSUPPORTED;
 }
 
+XRAPI_ATTR XrResult XRAPI_CALL RuntimeTestXrGetInstanceProcAddrBatch(XrInstance instance, uint32_t nameCount,
+                                                                     const char *const *names, PFN_xrVoidFunction *functions) {
+    if (instance == XR_NULL_HANDLE) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    for (uint32_t i = 0; i < nameCount; ++i) {
+        if (XR_FAILED(RuntimeTestXrGetInstanceProcAddr(instance, names[i], &functions[i]))) {
+            functions[i] = nullptr;
+        }
+    }
+    return XR_SUCCESS;
+}
+
 // Function used to negotiate an interface betewen the loader and a runtime.
 RUNTIME_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrNegotiateLoaderRuntimeInterface(const XrNegotiateLoaderInfo *loaderInfo,
                                                                                 XrNegotiateRuntimeRequest *runtimeRequest) {
     if (nullptr == loaderInfo || nullptr == runtimeRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
         loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
-        runtimeRequest->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST ||
-        runtimeRequest->structVersion != XR_RUNTIME_INFO_STRUCT_VERSION ||
-        runtimeRequest->structSize != sizeof(XrNegotiateRuntimeRequest) ||
-        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION ||
-        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_RUNTIME_VERSION ||
-        loaderInfo->maxInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        runtimeRequest->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST || runtimeRequest->structVersion < 1 ||
+        runtimeRequest->structSize < offsetof(XrNegotiateRuntimeRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION || loaderInfo->maxInterfaceVersion < 1 ||
         loaderInfo->minApiVersion < XR_MAKE_VERSION(0, 1, 0) || loaderInfo->minApiVersion >= XR_MAKE_VERSION(1, 1, 0)) {
         return XR_ERROR_INITIALIZATION_FAILED;
     }
 
-    runtimeRequest->runtimeInterfaceVersion = XR_CURRENT_LOADER_RUNTIME_VERSION;
+    runtimeRequest->runtimeInterfaceVersion =
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_RUNTIME_VERSION ? loaderInfo->maxInterfaceVersion
+                                                                            : XR_CURRENT_LOADER_RUNTIME_VERSION;
     runtimeRequest->runtimeApiVersion = XR_CURRENT_API_VERSION;
     runtimeRequest->getInstanceProcAddr = reinterpret_cast<PFN_xrGetInstanceProcAddr>(RuntimeTestXrGetInstanceProcAddr);
+    // The batch member only exists in the version 2 request, which older loaders do not pass.
+    if (runtimeRequest->runtimeInterfaceVersion >= 2 && runtimeRequest->structVersion >= 2 &&
+        runtimeRequest->structSize >= sizeof(XrNegotiateRuntimeRequest)) {
+        runtimeRequest->getInstanceProcAddrBatch = RuntimeTestXrGetInstanceProcAddrBatch;
+    }
 
     return XR_SUCCESS;
 }
@@ -174,4 +298,23 @@ RUNTIME_EXPORT XRAPI_ATTR XrResult XRAPI_CALL TestRuntimeInvalidApiNegotiateLoad
     return result;
 }
 
+// Behave like a runtime built against interface version 1, which does not know about the batched query
+RUNTIME_EXPORT XRAPI_ATTR XrResult XRAPI_CALL TestRuntimeInterfaceVersion1NegotiateLoaderRuntimeInterface(
+    const XrNegotiateLoaderInfo *loaderInfo, XrNegotiateRuntimeRequest *runtimeRequest) {
+    if (nullptr == loaderInfo || nullptr == runtimeRequest || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
+        loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
+        runtimeRequest->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST || runtimeRequest->structVersion != 1 ||
+        runtimeRequest->structSize != offsetof(XrNegotiateRuntimeRequest, getInstanceProcAddrBatch) ||
+        loaderInfo->minInterfaceVersion > 1 || loaderInfo->maxInterfaceVersion != 1 ||
+        loaderInfo->minApiVersion < XR_MAKE_VERSION(0, 1, 0) || loaderInfo->minApiVersion >= XR_MAKE_VERSION(1, 1, 0)) {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+
+    runtimeRequest->runtimeInterfaceVersion = 1;
+    runtimeRequest->runtimeApiVersion = XR_CURRENT_API_VERSION;
+    runtimeRequest->getInstanceProcAddr = reinterpret_cast<PFN_xrGetInstanceProcAddr>(RuntimeTestXrGetInstanceProcAddr);
+
+    return XR_SUCCESS;
+}
+
 }  // extern "C"